@@ -1,8 +1,10 @@
 #pragma once
+#include "common/data/source_location.h"
 #include "common/data/symbol_table.h"
 #include "common/data/type.h"
 #include <cassert>
 #include <memory>
+#include <optional>
 #include <string>
 #include <vector>
 
@@ -18,15 +20,18 @@ class MovInstruction;
 class UnaryInstruction;
 class BinaryInstruction;
 class CmpInstruction;
+class TestInstruction;
 class IdivInstruction;
 class CdqInstruction;
 class JmpInstruction;
 class JmpCCInstruction;
 class SetCCInstruction;
+class CmovInstruction;
 class LabelInstruction;
 class FunctionDefinition;
 class Program;
 class PushInstruction;
+class PopInstruction;
 class CallInstruction;
 class StaticVariable;
 class DataOperand;
@@ -34,6 +39,8 @@ class MovsxInstruction;
 class CommentInstruction;
 class MovZeroExtendInstruction;
 class DivInstruction;
+class ImulInstruction;
+class MulInstruction;
 class StaticConstant;
 class Cvttsd2siInstruction;
 class Cvtsi2sdInstruction;
@@ -62,14 +69,19 @@ public:
     virtual void visit(UnaryInstruction& node) = 0;
     virtual void visit(BinaryInstruction& node) = 0;
     virtual void visit(CmpInstruction& node) = 0;
+    virtual void visit(TestInstruction& node) = 0;
     virtual void visit(IdivInstruction& node) = 0;
     virtual void visit(DivInstruction& node) = 0;
+    virtual void visit(ImulInstruction& node) = 0;
+    virtual void visit(MulInstruction& node) = 0;
     virtual void visit(CdqInstruction& node) = 0;
     virtual void visit(JmpInstruction& node) = 0;
     virtual void visit(JmpCCInstruction& node) = 0;
     virtual void visit(SetCCInstruction& node) = 0;
+    virtual void visit(CmovInstruction& node) = 0;
     virtual void visit(LabelInstruction& node) = 0;
     virtual void visit(PushInstruction& node) = 0;
+    virtual void visit(PopInstruction& node) = 0;
     virtual void visit(CallInstruction& node) = 0;
     virtual void visit(FunctionDefinition& node) = 0;
     virtual void visit(StaticVariable& node) = 0;
@@ -88,6 +100,11 @@ enum class RegisterName {
     R9,
     R10,
     R11,
+    BX,
+    R12,
+    R13,
+    R14,
+    R15,
     SP,
     BP,
     XMM0,
@@ -98,6 +115,12 @@ enum class RegisterName {
     XMM5,
     XMM6,
     XMM7,
+    XMM8,
+    XMM9,
+    XMM10,
+    XMM11,
+    XMM12,
+    XMM13,
     XMM14,
     XMM15,
     MAX_REG
@@ -235,7 +258,12 @@ enum class BinaryOperator {
     DIV_DOUBLE,
     AND,
     OR,
-    XOR
+    XOR,
+    // destination = ~destination & source, only for doubles (andnpd)
+    AND_NOT,
+    SHL,
+    SAR,
+    SHR
 };
 
 enum class ConditionCode {
@@ -249,6 +277,9 @@ enum class ConditionCode {
     AE,
     B,
     BE,
+    // Parity flag, set by comisd when either operand is NaN
+    P,
+    NP,
     NONE
 };
 
@@ -443,6 +474,9 @@ public:
     virtual ~Instruction() = default;
     virtual std::unique_ptr<Instruction> clone() const = 0;
 
+    // Location of the Tacky instruction this one was generated from, the remarks of the register allocators use it
+    std::optional<SourceLocationIndex> source_location;
+
 protected:
     void check_and_replace_register_type(AssemblyType type, Operand* operand)
     {
@@ -753,6 +787,36 @@ public:
     std::unique_ptr<Operand> destination;
 };
 
+// Sets the flags on source & destination, "test %reg, %reg" compares a register with zero
+class TestInstruction : public Instruction {
+public:
+    TestInstruction(AssemblyType type, std::unique_ptr<Operand> source, std::unique_ptr<Operand> destination)
+        : type(type)
+        , source(std::move(source))
+        , destination(std::move(destination))
+    {
+        check_and_replace_register_type(type, this->source.get());
+        check_and_replace_register_type(type, this->destination.get());
+    }
+
+    void accept(AssemblyVisitor& visitor) override
+    {
+        visitor.visit(*this);
+    }
+
+    std::unique_ptr<Instruction> clone() const override
+    {
+        return std::make_unique<TestInstruction>(
+            type,
+            source->clone(),
+            destination->clone());
+    }
+
+    AssemblyType type;
+    std::unique_ptr<Operand> source;
+    std::unique_ptr<Operand> destination;
+};
+
 class IdivInstruction : public Instruction {
 public:
     IdivInstruction(AssemblyType type, std::unique_ptr<Operand> op)
@@ -801,6 +865,56 @@ public:
     std::unique_ptr<Operand> operand;
 };
 
+// One operand signed multiply, DX:AX = AX * operand
+class ImulInstruction : public Instruction {
+public:
+    ImulInstruction(AssemblyType type, std::unique_ptr<Operand> op)
+        : type(type)
+        , operand(std::move(op))
+    {
+        check_and_replace_register_type(type, this->operand.get());
+    }
+
+    void accept(AssemblyVisitor& visitor) override
+    {
+        visitor.visit(*this);
+    }
+
+    std::unique_ptr<Instruction> clone() const override
+    {
+        return std::make_unique<ImulInstruction>(
+            type, operand->clone());
+    }
+
+    AssemblyType type;
+    std::unique_ptr<Operand> operand;
+};
+
+// One operand unsigned multiply, DX:AX = AX * operand
+class MulInstruction : public Instruction {
+public:
+    MulInstruction(AssemblyType type, std::unique_ptr<Operand> op)
+        : type(type)
+        , operand(std::move(op))
+    {
+        check_and_replace_register_type(type, this->operand.get());
+    }
+
+    void accept(AssemblyVisitor& visitor) override
+    {
+        visitor.visit(*this);
+    }
+
+    std::unique_ptr<Instruction> clone() const override
+    {
+        return std::make_unique<MulInstruction>(
+            type, operand->clone());
+    }
+
+    AssemblyType type;
+    std::unique_ptr<Operand> operand;
+};
+
 class CdqInstruction : public Instruction {
 public:
     CdqInstruction(AssemblyType type)
@@ -891,6 +1005,39 @@ public:
     std::unique_ptr<Operand> destination;
 };
 
+// Moves source into destination if the condition holds, destination is read either way
+class CmovInstruction : public Instruction {
+public:
+    CmovInstruction(ConditionCode cc, AssemblyType type, std::unique_ptr<Operand> source, std::unique_ptr<Operand> destination)
+        : condition_code(cc)
+        , type(type)
+        , source(std::move(source))
+        , destination(std::move(destination))
+    {
+        check_and_replace_register_type(type, this->source.get());
+        check_and_replace_register_type(type, this->destination.get());
+    }
+
+    void accept(AssemblyVisitor& visitor) override
+    {
+        visitor.visit(*this);
+    }
+
+    std::unique_ptr<Instruction> clone() const override
+    {
+        return std::make_unique<CmovInstruction>(
+            condition_code,
+            type,
+            source->clone(),
+            destination->clone());
+    }
+
+    ConditionCode condition_code;
+    AssemblyType type;
+    std::unique_ptr<Operand> source;
+    std::unique_ptr<Operand> destination;
+};
+
 class LabelInstruction : public Instruction {
 public:
     LabelInstruction(const std::string& id)
@@ -934,6 +1081,27 @@ public:
     std::unique_ptr<Operand> destination;
 };
 
+// Only used to restore callee-saved registers before a return
+class PopInstruction : public Instruction {
+public:
+    PopInstruction(RegisterName reg)
+        : reg { reg }
+    {
+    }
+
+    void accept(AssemblyVisitor& visitor) override
+    {
+        visitor.visit(*this);
+    }
+
+    std::unique_ptr<Instruction> clone() const override
+    {
+        return std::make_unique<PopInstruction>(reg);
+    }
+
+    RegisterName reg;
+};
+
 class CallInstruction : public Instruction {
 public:
     CallInstruction(const std::string& id)
@@ -983,12 +1151,15 @@ public:
             cloned_instructions.push_back(instruction->clone());
         }
 
-        return std::make_unique<FunctionDefinition>(name.name, global, std::move(cloned_instructions));
+        auto cloned = std::make_unique<FunctionDefinition>(name.name, global, std::move(cloned_instructions));
+        cloned->source_location = source_location;
+        return cloned;
     }
 
     Identifier name;
     bool global;
     std::vector<std::unique_ptr<Instruction>> instructions;
+    std::optional<SourceLocationIndex> source_location;
 };
 
 class StaticVariable : public TopLevel {
@@ -1,12 +1,20 @@
 #pragma once
 #include "backend/assembly_ast.h"
 #include "backend/backend_symbol_table.h"
+#include "backend/divide_by_constant.h"
+#include "backend/multiply_by_constant.h"
 #include "common/data/compile_options.h"
 #include "common/data/name_generator.h"
+#include "common/data/remark_manager.h"
 #include "common/data/symbol_table.h"
 #include "tacky/tacky_ast.h"
 #include <memory>
+#include <optional>
 #include <stdexcept>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <utility>
 #include <vector>
 
 namespace backend {
@@ -22,7 +30,7 @@ public:
 // Generate an AssemblyAST from a TackyAST
 class AssemblyGenerator {
 public:
-    AssemblyGenerator(std::shared_ptr<tacky::TackyAST> ast, std::shared_ptr<SymbolTable> symbol_table, std::shared_ptr<BackendSymbolTable> backend_symbol_table, std::shared_ptr<CompileOptions> compile_options, std::shared_ptr<NameGenerator> name_generator);
+    AssemblyGenerator(std::shared_ptr<tacky::TackyAST> ast, std::shared_ptr<SymbolTable> symbol_table, std::shared_ptr<BackendSymbolTable> backend_symbol_table, std::shared_ptr<CompileOptions> compile_options, std::shared_ptr<NameGenerator> name_generator, std::shared_ptr<RemarkManager> remark_manager = nullptr);
     std::shared_ptr<AssemblyAST> generate();
 
 private:
@@ -37,6 +45,17 @@ private:
     std::vector<std::unique_ptr<Instruction>> transform_get_address_instruction(tacky::GetAddressInstruction& get_address_instruction);
     std::vector<std::unique_ptr<Instruction>> transform_copy_to_offset_instruction(tacky::CopyToOffsetInstruction& copy_to_offset_instruction);
     std::vector<std::unique_ptr<Instruction>> transform_add_pointer_instruction(tacky::AddPointerInstruction& add_pointer_instruction);
+    // A load or store through the pointer the AddPointerInstruction at position computes addresses memory with the
+    // base, index and scale of the addition. Returns the instructions up to the access and its position, nothing if
+    // the pair does not qualify
+    std::optional<std::pair<std::vector<std::unique_ptr<Instruction>>, size_t>> transform_indexed_access(std::vector<std::unique_ptr<tacky::Instruction>>& body, size_t position);
+    // Finds the pointer variables that always hold the same address inside a local array
+    void collect_frame_addresses(tacky::FunctionDefinition& function_definition);
+    bool is_local_array(const std::string& name);
+    // The element of the local array the pointer points to, nullptr if the pointer is not a frame address
+    std::unique_ptr<Operand> get_frame_address_operand(tacky::Value& pointer);
+    // Puts the pointer in AX, frame addresses are computed with a lea
+    void emit_pointer_to_register(tacky::Value& pointer, std::vector<std::unique_ptr<Instruction>>& instructions);
 
     std::vector<std::unique_ptr<Instruction>> transform_label_instruction(tacky::LabelInstruction& label_instruction);
     std::vector<std::unique_ptr<Instruction>> transform_sign_extend_instruction(tacky::SignExtendInstruction& sign_extend_instruction);
@@ -48,7 +67,36 @@ private:
     std::vector<std::unique_ptr<Instruction>> transform_double_to_uint_instruction(tacky::DoubleToUIntIntruction& double_to_uint_instruction);
     std::vector<std::unique_ptr<Instruction>> transform_unary_instruction(tacky::UnaryInstruction& unary_instruction);
     std::vector<std::unique_ptr<Instruction>> transform_binary_instruction(tacky::BinaryInstruction& binary_instruction);
+    // An integer multiplication by a constant compiles to shifts, leas and adds when they beat imul, nothing otherwise
+    std::optional<std::vector<std::unique_ptr<Instruction>>> transform_multiply_by_constant(tacky::BinaryInstruction& binary_instruction);
+    // Steps of the plan on the product register, which holds the source on entry, the source register is scratch
+    void emit_multiply_plan(const MultiplyPlan& plan, AssemblyType type, RegisterName product, RegisterName source, std::vector<std::unique_ptr<Instruction>>& instructions);
+    std::optional<uint64_t> get_integer_constant(tacky::Value& value);
+    std::unique_ptr<Operand> make_integer_immediate(uint64_t bits, AssemblyType type);
+    // An integer division or remainder by a constant compiles to a multiplication by its reciprocal and shifts,
+    // nothing for a division by 0
+    std::optional<std::vector<std::unique_ptr<Instruction>>> transform_divide_by_constant(tacky::BinaryInstruction& binary_instruction);
+    // Computes the quotient of the plan in AX or DX and returns which, both are clobbered
+    RegisterName emit_division_plan(const DivisionPlan& plan, AssemblyType type, tacky::Value& dividend, std::vector<std::unique_ptr<Instruction>>& instructions);
     std::vector<std::unique_ptr<Instruction>> transform_jump_instruction(tacky::Instruction& jump_instruction);
+    // A relational operator or ! whose result only feeds the conditional jump or the select that follows it compiles
+    // to a compare and a conditional jump or cmov on the flags, nothing if the pair does not qualify
+    std::optional<std::vector<std::unique_ptr<Instruction>>> transform_compare_and_branch(tacky::Instruction& condition, tacky::Instruction& user);
+    std::vector<std::unique_ptr<Instruction>> transform_select_instruction(tacky::SelectInstruction& select_instruction);
+
+    // What a condition is once the flags are set: the condition code holds, or the parity flag is set too when
+    // also_unordered is (comisd reports NaN operands as unordered). A negated condition is true when that does not hold
+    struct FlagsCondition {
+        ConditionCode condition_code;
+        bool also_unordered = false;
+        bool negated = false;
+    };
+    FlagsCondition emit_relational_flags(tacky::BinaryOperator op, tacky::Value& source1, tacky::Value& source2, std::vector<std::unique_ptr<Instruction>>& instructions);
+    // The condition is true when the value is not zero, NaN is not zero
+    FlagsCondition emit_nonzero_flags(tacky::Value& value, std::vector<std::unique_ptr<Instruction>>& instructions);
+    void emit_flags_jump(const FlagsCondition& condition, bool jump_if_true, const std::string& target, std::vector<std::unique_ptr<Instruction>>& instructions);
+    // Integers go through cmov, doubles are blended with a mask built by cmov: (mask & a) | (~mask & b)
+    void emit_select(const FlagsCondition& condition, tacky::SelectInstruction& select_instruction, std::vector<std::unique_ptr<Instruction>>& instructions);
     std::vector<std::unique_ptr<Instruction>> transform_function_call_instruction(tacky::FunctionCallInstruction& function_call_instruction);
     std::unique_ptr<FunctionDefinition> transform_function(tacky::FunctionDefinition& function);
     std::unique_ptr<TopLevel> transform_top_level(tacky::TopLevel& top_level);
@@ -56,6 +104,7 @@ private:
 
     bool is_relational_operator(tacky::BinaryOperator op);
     ConditionCode to_condition_code(tacky::BinaryOperator op, bool is_signed);
+    ConditionCode invert_condition_code(ConditionCode condition_code);
     std::pair<AssemblyType, bool> get_converted_operand_type(tacky::Value& operand);
     std::unique_ptr<Type> get_operand_type(tacky::Value& operand);
     std::pair<AssemblyType, bool> convert_type(const Type& type);
@@ -64,17 +113,29 @@ private:
     std::shared_ptr<BackendSymbolTable> m_backend_symbol_table;
     std::shared_ptr<CompileOptions> m_compile_options;
     std::shared_ptr<NameGenerator> m_name_generator;
+    std::shared_ptr<RemarkManager> m_remark_manager;
 
     void add_comment_instruction(const std::string& message, std::vector<std::unique_ptr<Instruction>>& instructions);
 
+    // How far after the pointer addition a load or store may be and still address memory with its operands
+    static constexpr size_t MAX_INDEXED_ACCESS_DISTANCE = 4;
+
     const std::vector<RegisterName> INT_FUNCTION_REGISTERS;
     const std::vector<RegisterName> DOUBLE_FUNCTION_REGISTERS;
 
     void generate_backend_symbol_table();
+    std::vector<RegisterName> get_param_registers(const FunctionType& function_type);
     std::string add_static_double_constant(double val, size_t alignment);
     std::string get_constant_label(double val, size_t alignment);
 
     std::unordered_map<std::string, std::pair<std::string, std::unique_ptr<TopLevel>>> m_static_constants_map;
+    // Uses of each variable in the function being transformed, and the variables memory can change behind its back
+    std::unordered_map<std::string, size_t> m_use_counts;
+    std::unordered_set<std::string> m_aliased_variables;
+    // Pointer variables holding a constant address inside a local array, as the array and the offset, and the ones
+    // only ever dereferenced or offset, which are never computed
+    std::unordered_map<std::string, std::pair<std::string, long>> m_frame_addresses;
+    std::unordered_set<std::string> m_unused_frame_addresses;
 };
 
 } // namespace backend
@@ -32,14 +32,19 @@ public:
     void visit(UnaryInstruction& node) override;
     void visit(BinaryInstruction& node) override;
     void visit(CmpInstruction& node) override;
+    void visit(TestInstruction& node) override;
     void visit(IdivInstruction& node) override;
     void visit(DivInstruction& node) override { } // TODO
+    void visit(ImulInstruction& node) override;
+    void visit(MulInstruction& node) override;
     void visit(CdqInstruction& node) override;
     void visit(JmpInstruction& node) override;
     void visit(JmpCCInstruction& node) override;
     void visit(SetCCInstruction& node) override;
+    void visit(CmovInstruction& node) override;
     void visit(LabelInstruction& node) override;
     void visit(PushInstruction& node) override;
+    void visit(PopInstruction& node) override;
     void visit(CallInstruction& node) override;
     void visit(FunctionDefinition& node) override;
     void visit(StaticVariable& node) override;
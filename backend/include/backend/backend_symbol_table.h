@@ -4,6 +4,7 @@
 #include <string>
 #include <unordered_map>
 #include <variant>
+#include <vector>
 
 namespace backend {
 
@@ -16,6 +17,11 @@ struct ObjectEntry {
 struct FunctionEntry {
     size_t stack_frame_size;
     bool defined;
+    // Registers the arguments are passed in and the value is returned in, what a call reads and a return keeps live
+    std::vector<RegisterName> param_registers {};
+    std::vector<RegisterName> return_registers {};
+    // Callee-saved registers the register allocator used, the prologue saves them and every return restores them
+    std::vector<RegisterName> callee_saved_registers {};
 };
 
 using BackendSymbolTableEntry = std::variant<ObjectEntry, FunctionEntry>;
@@ -4,6 +4,7 @@
 #include "common/error/internal_compiler_error.h"
 #include <fstream>
 #include <memory>
+#include <ostream>
 #include <stdexcept>
 #include <string>
 
@@ -20,7 +21,12 @@ public:
 class CodeEmitter : public AssemblyVisitor {
 public:
     CodeEmitter(const std::string& output_file, std::shared_ptr<AssemblyAST> ast, std::shared_ptr<BackendSymbolTable> symbol_table);
+    // Emitter without an output file, for emit_code(std::ostream&)
+    CodeEmitter(std::shared_ptr<AssemblyAST> ast, std::shared_ptr<BackendSymbolTable> symbol_table);
+    // Writes the assembly to the output file
     void emit_code();
+    // Writes the assembly to out, the output file is not used
+    void emit_code(std::ostream& out);
 
 private:
     void visit(Identifier& node) override { throw InternalCompilerError("visit(Identifier&) is not supported"); }
@@ -42,14 +48,19 @@ private:
     void visit(UnaryInstruction& node) override;
     void visit(BinaryInstruction& node) override;
     void visit(CmpInstruction& node) override;
+    void visit(TestInstruction& node) override;
     void visit(IdivInstruction& node) override;
     void visit(DivInstruction& node) override;
+    void visit(ImulInstruction& node) override;
+    void visit(MulInstruction& node) override;
     void visit(CdqInstruction& node) override;
     void visit(JmpInstruction& node) override;
     void visit(JmpCCInstruction& node) override;
     void visit(SetCCInstruction& node) override;
+    void visit(CmovInstruction& node) override;
     void visit(LabelInstruction& node) override;
     void visit(PushInstruction& node) override;
+    void visit(PopInstruction& node) override;
     void visit(CallInstruction& node) override;
     void visit(FunctionDefinition& node) override;
     void visit(StaticVariable& node) override;
@@ -62,10 +73,10 @@ private:
     std::string to_instruction_suffix(AssemblyType type);
     std::string get_function_name(const std::string& in_name);
     std::string escape_string(const std::string& str);
-    const std::string m_output_file;
+    std::string m_output_file;
     std::shared_ptr<AssemblyAST> m_ast;
     std::shared_ptr<BackendSymbolTable> m_symbol_table;
-    std::ofstream* m_file_stream;
+    std::ostream* m_file_stream { nullptr };
 };
 
 }
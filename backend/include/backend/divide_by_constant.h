@@ -0,0 +1,45 @@
+#pragma once
+#include <cstdint>
+#include <optional>
+
+namespace backend {
+
+// How a division by a constant is computed without div or idiv, with the reciprocal multiplications of Granlund and
+// Montgomery ("Division by Invariant Integers using Multiplication"). N is the width of the operands, mulhi the high
+// half of the 2N bit product and >>> a logical shift
+struct DivisionPlan {
+    enum class Kind {
+        // x, the divisor is 1
+        IDENTITY,
+        // -x, the signed divisor is -1
+        NEGATE,
+        // x >>> shift, the unsigned divisor is 2^shift
+        SHIFT,
+        // (x + ((x >> N-1) >>> N-shift)) >> shift, the signed divisor is 2^shift or -2^shift (negate is set), the
+        // added bias makes the shift round toward zero
+        SIGNED_SHIFT,
+        // mulhi(x, magic) >>> shift, unsigned
+        MULTIPLY_HIGH,
+        // t = mulhi(x, magic), (t + ((x - t) >>> 1)) >>> shift - 1, unsigned when the magic needs N+1 bits, magic
+        // holds its low N bits
+        MULTIPLY_HIGH_ADD,
+        // q = (signed mulhi(x, magic) + correction * x) >> shift, q + (q >>> N-1), signed
+        SIGNED_MULTIPLY_HIGH
+    };
+
+    Kind kind;
+    uint64_t magic = 0;
+    int shift = 0;
+    // SIGNED_MULTIPLY_HIGH adds x (1), subtracts it (-1) or neither (0) after the multiplication
+    int correction = 0;
+    // SIGNED_SHIFT negates the quotient for a negative divisor
+    bool negate = false;
+};
+
+// Plan for the quotient of an N bit division (width is 32 or 64) by the low N bits of divisor, nothing for 0
+std::optional<DivisionPlan> plan_divide_by_constant(uint64_t divisor, int width, bool is_signed);
+
+// Quotient the plan computes for the dividend, as the generated instructions do, modulo 2^width
+uint64_t evaluate_division_plan(const DivisionPlan& plan, uint64_t dividend, int width);
+
+}
@@ -42,14 +42,19 @@ private:
     void visit(UnaryInstruction& node) override { }
     void visit(BinaryInstruction& node) override { }
     void visit(CmpInstruction& node) override { }
+    void visit(TestInstruction& node) override { }
     void visit(IdivInstruction& node) override { }
     void visit(DivInstruction& node) override { }
+    void visit(ImulInstruction& node) override { }
+    void visit(MulInstruction& node) override { }
     void visit(CdqInstruction& node) override { }
     void visit(JmpInstruction& node) override { }
     void visit(JmpCCInstruction& node) override { }
     void visit(SetCCInstruction& node) override { }
+    void visit(CmovInstruction& node) override { }
     void visit(LabelInstruction& node) override { }
     void visit(PushInstruction& node) override { }
+    void visit(PopInstruction& node) override { }
     void visit(CallInstruction& node) override { }
     void visit(FunctionDefinition& node) override;
     void visit(StaticVariable& node) override { }
@@ -63,8 +68,10 @@ private:
     void fixup_binary_instruction(std::unique_ptr<Instruction>& instruction, std::vector<std::unique_ptr<Instruction>>& instructions);
     void fixup_idiv_instruction(std::unique_ptr<Instruction>& instruction, std::vector<std::unique_ptr<Instruction>>& instructions);
     void fixup_div_instruction(std::unique_ptr<Instruction>& instruction, std::vector<std::unique_ptr<Instruction>>& instructions);
+    void fixup_widening_multiply_instruction(std::unique_ptr<Instruction>& instruction, std::vector<std::unique_ptr<Instruction>>& instructions);
     void fixup_movsx_instruction(std::unique_ptr<Instruction>& instruction, std::vector<std::unique_ptr<Instruction>>& instructions);
     void fixup_mov_zero_extend_instruction(std::unique_ptr<Instruction>& instruction, std::vector<std::unique_ptr<Instruction>>& instructions);
+    void fixup_cmov_instruction(std::unique_ptr<Instruction>& instruction, std::vector<std::unique_ptr<Instruction>>& instructions);
     void fixup_lea_instruction(std::unique_ptr<Instruction>& instruction, std::vector<std::unique_ptr<Instruction>>& instructions);
     void fixup_push_instruction(std::unique_ptr<Instruction>& instruction, std::vector<std::unique_ptr<Instruction>>& instructions);
     void fixup_cvttsd2si_instruction(std::unique_ptr<Instruction>& instruction, std::vector<std::unique_ptr<Instruction>>& instructions);
@@ -0,0 +1,37 @@
+#pragma once
+#include "backend/assembly_ast.h"
+#include "backend/backend_symbol_table.h"
+#include "common/data/remark_manager.h"
+#include <memory>
+#include <stdexcept>
+
+namespace backend {
+
+class LinearScanAllocatorError : public std::runtime_error {
+public:
+    explicit LinearScanAllocatorError(const std::string& message)
+        : std::runtime_error(message)
+    {
+    }
+};
+
+// Linear scan register allocator (Poletto and Sarkar), a cheaper alternative to RegisterAllocator.
+// Every pseudo register gets one live interval, the hull of the instructions where it is live, and the intervals are
+// assigned registers in order of their start. When no register is free the interval that ends last is spilled.
+// Hard registers keep their exact live points, so values never land in a register a call or a division clobbers.
+// Spilled pseudo registers are left in place for PseudoRegisterReplaceStep to put in memory.
+class LinearScanAllocator {
+public:
+    LinearScanAllocator(std::shared_ptr<AssemblyAST> ast, std::shared_ptr<BackendSymbolTable> symbol_table, std::shared_ptr<RemarkManager> remark_manager = nullptr);
+
+    void allocate();
+
+private:
+    void allocate_function(FunctionDefinition& function);
+
+    std::shared_ptr<AssemblyAST> m_ast;
+    std::shared_ptr<BackendSymbolTable> m_symbol_table;
+    std::shared_ptr<RemarkManager> m_remark_manager;
+};
+
+}
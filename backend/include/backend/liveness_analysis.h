@@ -0,0 +1,146 @@
+#pragma once
+#include "backend/assembly_ast.h"
+#include "backend/backend_symbol_table.h"
+#include <bit>
+#include <cstdint>
+#include <memory>
+#include <optional>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace backend {
+
+// How an instruction accesses one of its operands
+enum class OperandAccess {
+    USE,
+    DEF,
+    USE_DEF,
+};
+
+// An explicit operand of an instruction, with the width the instruction accesses it with
+struct OperandSlot {
+    std::unique_ptr<Operand>* operand;
+    OperandAccess access;
+    AssemblyType type;
+};
+
+// What an instruction reads and writes, including the registers it uses implicitly (division, calls, returns)
+struct InstructionUseDef {
+    std::vector<OperandSlot> operands;
+    std::vector<RegisterName> implicit_uses;
+    std::vector<RegisterName> implicit_defs;
+};
+
+InstructionUseDef get_use_def(Instruction& instruction, const BackendSymbolTable& symbol_table, const std::string& function_name);
+
+// Fixed size set of locations
+class LiveSet {
+public:
+    explicit LiveSet(size_t size = 0)
+        : m_words((size + 63) / 64, 0)
+    {
+    }
+
+    void set(size_t i) { m_words[i / 64] |= uint64_t(1) << (i % 64); }
+    void reset(size_t i) { m_words[i / 64] &= ~(uint64_t(1) << (i % 64)); }
+    bool test(size_t i) const { return m_words[i / 64] & (uint64_t(1) << (i % 64)); }
+
+    // Returns true if the set changed
+    bool union_with(const LiveSet& other)
+    {
+        bool changed = false;
+        for (size_t i = 0; i < m_words.size(); ++i) {
+            uint64_t word = m_words[i] | other.m_words[i];
+            changed |= word != m_words[i];
+            m_words[i] = word;
+        }
+        return changed;
+    }
+
+    void subtract(const LiveSet& other)
+    {
+        for (size_t i = 0; i < m_words.size(); ++i) {
+            m_words[i] &= ~other.m_words[i];
+        }
+    }
+
+    template<typename Function>
+    void for_each(Function&& function) const
+    {
+        for (size_t i = 0; i < m_words.size(); ++i) {
+            uint64_t word = m_words[i];
+            while (word) {
+                function(i * 64 + std::countr_zero(word));
+                word &= word - 1;
+            }
+        }
+    }
+
+    bool operator==(const LiveSet& other) const = default;
+
+private:
+    std::vector<uint64_t> m_words;
+};
+
+// Instruction level liveness of a function, before pseudo registers are replaced.
+// The locations are the hard registers, numbered as RegisterName, followed by the pseudo registers that could live
+// in a register: static, address taken and aggregate pseudos are not tracked, they always stay in memory
+class LivenessAnalysis {
+public:
+    struct BasicBlock {
+        // Instructions [begin, end)
+        size_t begin;
+        size_t end;
+        std::vector<size_t> successors;
+        // Number of back edges spanning the block, a cheap stand-in for the loop nesting depth
+        size_t loop_depth { 0 };
+    };
+
+    LivenessAnalysis(FunctionDefinition& function, const BackendSymbolTable& symbol_table);
+
+    size_t location_count() const { return FIRST_PSEUDO + m_pseudo_names.size(); }
+    static bool is_pseudo(size_t location) { return location >= FIRST_PSEUDO; }
+    const std::string& pseudo_name(size_t location) const { return m_pseudo_names[location - FIRST_PSEUDO]; }
+    // True for the XMM registers and the pseudo registers holding doubles
+    bool is_xmm(size_t location) const;
+    // Location of an operand, nothing for immediates, memory and untracked pseudo registers
+    std::optional<size_t> location_of(const Operand& operand) const;
+    // Pseudo registers excluded because their address is taken
+    size_t address_taken_count() const { return m_address_taken_count; }
+
+    const std::vector<BasicBlock>& blocks() const { return m_blocks; }
+    const LiveSet& live_out(size_t block) const { return m_live_out[block]; }
+
+    const InstructionUseDef& use_def(size_t instruction) const { return m_use_defs[instruction]; }
+    const std::vector<size_t>& uses(size_t instruction) const { return m_uses[instruction]; }
+    const std::vector<size_t>& defs(size_t instruction) const { return m_defs[instruction]; }
+    // Register to register copy between two tracked locations, a candidate for coalescing
+    bool is_move(size_t instruction) const { return m_is_move[instruction]; }
+
+    // Turns the set of locations live after an instruction into the set live before it
+    void step_backward(LiveSet& live, size_t instruction) const;
+
+    static constexpr size_t FIRST_PSEUDO = static_cast<size_t>(RegisterName::MAX_REG);
+
+private:
+    void collect_pseudo_registers(FunctionDefinition& function, const BackendSymbolTable& symbol_table);
+    void build_blocks(FunctionDefinition& function);
+    void compute_loop_depths();
+    void solve();
+
+    std::vector<std::string> m_pseudo_names;
+    std::vector<bool> m_pseudo_is_xmm;
+    std::unordered_map<std::string, size_t> m_pseudo_locations;
+    size_t m_address_taken_count { 0 };
+
+    std::vector<InstructionUseDef> m_use_defs;
+    std::vector<std::vector<size_t>> m_uses;
+    std::vector<std::vector<size_t>> m_defs;
+    std::vector<bool> m_is_move;
+
+    std::vector<BasicBlock> m_blocks;
+    std::vector<LiveSet> m_live_out;
+};
+
+}
@@ -0,0 +1,56 @@
+#pragma once
+#include <cstdint>
+#include <optional>
+#include <vector>
+
+namespace backend {
+
+// Latency in cycles of the instructions a multiplication by a constant can be lowered to, as on recent x86-64 cores.
+// A multiplication is only rewritten when the replacement is faster than the imul it replaces
+namespace multiply_latency {
+constexpr int IMUL = 3;
+constexpr int SHIFT = 1;
+constexpr int LEA = 1;
+constexpr int ADD = 1;
+constexpr int SUB = 1;
+constexpr int NEG = 1;
+}
+
+// One step of a multiplication by a constant, on the product p computed so far from the source x (p starts as x)
+struct MultiplyStep {
+    enum class Kind {
+        // p << amount
+        SHIFT_LEFT,
+        // p + p * amount, lea (p, p, amount) with amount 2, 4 or 8
+        SCALE_ADD,
+        // x + p * amount, add x, p when amount is 1 and lea (x, p, amount) otherwise
+        ADD_SOURCE,
+        // p - x
+        SUB_SOURCE,
+        // -p
+        NEGATE
+    };
+
+    Kind kind;
+    int amount = 0;
+
+    bool operator==(const MultiplyStep&) const = default;
+};
+
+struct MultiplyPlan {
+    std::vector<MultiplyStep> steps;
+    int latency = 0;
+
+    // The steps need the source kept in a second register
+    bool uses_source() const;
+};
+
+// Cheapest sequence of shifts, leas, adds, subs and negs computing x * constant modulo 2^width (width is 32 or 64),
+// nothing if none is faster than imul. The constant is taken modulo 2^width, so signed and unsigned constants of
+// the same bits share a plan. Multiplying by 0 has no plan
+std::optional<MultiplyPlan> plan_multiply_by_constant(uint64_t constant, int width);
+
+// Result of the plan on the source, modulo 2^width
+uint64_t evaluate_multiply_plan(const MultiplyPlan& plan, uint64_t source, int width);
+
+}
@@ -0,0 +1,78 @@
+#pragma once
+#include "backend/assembly_ast.h"
+#include "backend/backend_symbol_table.h"
+#include "common/stats/statistic.h"
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+namespace backend {
+
+class PeepholeOptimizerError : public std::runtime_error {
+public:
+    explicit PeepholeOptimizerError(const std::string& message)
+        : std::runtime_error(message)
+    {
+    }
+};
+
+// The instructions of a function seen from one position, comments and erased instructions are skipped so that
+// at(0), at(1), ... are the instructions that execute one after the other
+class PeepholeWindow {
+public:
+    PeepholeWindow(std::vector<std::unique_ptr<Instruction>>& instructions, size_t start, const BackendSymbolTable& symbol_table, const std::string& function_name);
+
+    // The k-th instruction of the window, nullptr past the end of the function
+    Instruction* at(size_t k) const;
+
+    template<typename T>
+    T* get(size_t k) const
+    {
+        return dynamic_cast<T*>(at(k));
+    }
+
+    void erase(size_t k);
+    void replace(size_t k, std::unique_ptr<Instruction> instruction);
+
+    // Conservative, true unless the register is overwritten before any read after the k-th instruction.
+    // Labels and jumps end the scan
+    bool is_register_read_after(size_t k, RegisterName reg) const;
+    // Same for the flags
+    bool are_flags_read_after(size_t k) const;
+
+private:
+    size_t index_of(size_t k) const;
+    size_t next_index(size_t index) const;
+
+    std::vector<std::unique_ptr<Instruction>>& m_instructions;
+    size_t m_start;
+    const BackendSymbolTable& m_symbol_table;
+    const std::string& m_function_name;
+};
+
+// A rewrite of a short instruction sequence, apply returns true if it changed the window
+struct PeepholeRule {
+    const char* name;
+    stats::Statistic* statistic;
+    bool (*apply)(PeepholeWindow& window);
+};
+
+// Pattern driven cleanup of the final instructions, run after FixUpInstructionsStep. Every rule of the table is
+// tried at every position, passes repeat until nothing changes
+class PeepholeOptimizer {
+public:
+    PeepholeOptimizer(std::shared_ptr<AssemblyAST> ast, std::shared_ptr<BackendSymbolTable> symbol_table);
+
+    void optimize();
+
+    static const std::vector<PeepholeRule>& rules();
+
+private:
+    void optimize_function(FunctionDefinition& function);
+
+    std::shared_ptr<AssemblyAST> m_ast;
+    std::shared_ptr<BackendSymbolTable> m_symbol_table;
+};
+
+}
@@ -1,6 +1,7 @@
 #pragma once
 #include "backend/assembly_ast.h"
 #include "backend/backend_symbol_table.h"
+#include "common/data/remark_manager.h"
 #include <memory>
 #include <stdexcept>
 #include <unordered_map>
@@ -17,7 +18,7 @@ public:
 
 class PseudoRegisterReplaceStep : public AssemblyVisitor {
 public:
-    PseudoRegisterReplaceStep(std::shared_ptr<AssemblyAST> ast, std::shared_ptr<BackendSymbolTable> symbol_table);
+    PseudoRegisterReplaceStep(std::shared_ptr<AssemblyAST> ast, std::shared_ptr<BackendSymbolTable> symbol_table, std::shared_ptr<RemarkManager> remark_manager = nullptr);
 
     void replace();
 
@@ -42,27 +43,40 @@ private:
     void visit(UnaryInstruction& node) override;
     void visit(BinaryInstruction& node) override;
     void visit(CmpInstruction& node) override;
+    void visit(TestInstruction& node) override;
     void visit(IdivInstruction& node) override;
     void visit(DivInstruction& node) override;
+    void visit(ImulInstruction& node) override;
+    void visit(MulInstruction& node) override;
     void visit(CdqInstruction& node) override { }
     void visit(JmpInstruction& node) override { }
     void visit(JmpCCInstruction& node) override { }
     void visit(SetCCInstruction& node) override;
+    void visit(CmovInstruction& node) override;
     void visit(LabelInstruction& node) override { }
     void visit(PushInstruction& node) override;
+    void visit(PopInstruction& node) override { }
     void visit(CallInstruction& node) override { }
     void visit(FunctionDefinition& node) override;
     void visit(StaticVariable& node) override { }
     void visit(StaticConstant& node) override { } // TODO: IMPLEMENT IF NEEDED
     void visit(Program& node) override;
 
+    // Assigns the stack slots of the pseudo registers liveness tracks before any operand is replaced: values that
+    // are never live at the same time share a slot of the same size
+    void color_stack_slots(FunctionDefinition& function);
     size_t get_offset(AssemblyType type, const std::string& name);
+    // Offset of a new slot of the given type below offset
+    size_t next_offset(size_t offset, AssemblyType type);
     void check_and_replace(std::unique_ptr<Operand>& op);
 
     std::shared_ptr<AssemblyAST> m_ast;
     std::unordered_map<std::string, int> m_stack_offsets;
     std::shared_ptr<BackendSymbolTable> m_symbol_table;
+    std::shared_ptr<RemarkManager> m_remark_manager;
     size_t m_curr_offset;
+    // Frame size the function would need with a slot for every pseudo register
+    size_t m_unshared_offset;
 
     // round-up to next multiple of alignment
     size_t round_up(size_t value, size_t alignment)
@@ -0,0 +1,37 @@
+#pragma once
+#include "backend/assembly_ast.h"
+#include "backend/backend_symbol_table.h"
+#include "common/data/remark_manager.h"
+#include <memory>
+#include <stdexcept>
+
+namespace backend {
+
+class RegisterAllocatorError : public std::runtime_error {
+public:
+    explicit RegisterAllocatorError(const std::string& message)
+        : std::runtime_error(message)
+    {
+    }
+};
+
+// Graph coloring register allocator with iterated coalescing (George and Appel).
+// For every function it builds the interference graph of the general purpose and of the XMM pseudo registers from
+// the liveness of the instruction list, colors it with the hard registers and rewrites the colored pseudo registers.
+// Copies between coalesced values are deleted. Spilled pseudo registers, and those that can not live in a register
+// (static, address taken, arrays), are left in place for PseudoRegisterReplaceStep to put in memory.
+class RegisterAllocator {
+public:
+    RegisterAllocator(std::shared_ptr<AssemblyAST> ast, std::shared_ptr<BackendSymbolTable> symbol_table, std::shared_ptr<RemarkManager> remark_manager = nullptr);
+
+    void allocate();
+
+private:
+    void allocate_function(FunctionDefinition& function);
+
+    std::shared_ptr<AssemblyAST> m_ast;
+    std::shared_ptr<BackendSymbolTable> m_symbol_table;
+    std::shared_ptr<RemarkManager> m_remark_manager;
+};
+
+}
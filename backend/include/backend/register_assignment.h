@@ -0,0 +1,26 @@
+#pragma once
+#include "backend/assembly_ast.h"
+#include "backend/liveness_analysis.h"
+#include "common/data/source_location.h"
+#include <optional>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace backend {
+
+// Pseudo register name to the hard register an allocator gave it
+using RegisterAssignment = std::unordered_map<std::string, RegisterName>;
+
+// Rewrites the assigned pseudo registers of a function, each operand gets the width its instruction accesses it
+// with, then deletes the copies that became "mov %reg, %reg". Returns the number of deleted copies
+size_t apply_register_assignment(FunctionDefinition& function, const LivenessAnalysis& liveness, const RegisterAssignment& assignment);
+
+// Callee-saved registers used by an assignment, in RegisterName order
+std::vector<RegisterName> used_callee_saved_registers(const RegisterAssignment& assignment);
+
+// Source location of the first instruction reading or writing each pseudo register, indexed by location minus
+// FIRST_PSEUDO. The allocators put their remark about a pseudo register there
+std::vector<std::optional<SourceLocationIndex>> pseudo_source_locations(const FunctionDefinition& function, const LivenessAnalysis& liveness);
+
+}
@@ -0,0 +1,86 @@
+#pragma once
+#include "backend/assembly_ast.h"
+#include <array>
+
+namespace backend {
+
+// Registers the register allocators may assign to pseudo registers.
+// R10/R11 and XMM14/XMM15 are left out, FixUpInstructionsStep uses them as scratch registers.
+// The callee-saved registers come last, using one costs a push and a pop in the function
+inline constexpr std::array GP_ALLOCATABLE_REGISTERS {
+    RegisterName::AX,
+    RegisterName::CX,
+    RegisterName::DX,
+    RegisterName::DI,
+    RegisterName::SI,
+    RegisterName::R8,
+    RegisterName::R9,
+    RegisterName::BX,
+    RegisterName::R12,
+    RegisterName::R13,
+    RegisterName::R14,
+    RegisterName::R15,
+};
+
+inline constexpr std::array XMM_ALLOCATABLE_REGISTERS {
+    RegisterName::XMM0,
+    RegisterName::XMM1,
+    RegisterName::XMM2,
+    RegisterName::XMM3,
+    RegisterName::XMM4,
+    RegisterName::XMM5,
+    RegisterName::XMM6,
+    RegisterName::XMM7,
+    RegisterName::XMM8,
+    RegisterName::XMM9,
+    RegisterName::XMM10,
+    RegisterName::XMM11,
+    RegisterName::XMM12,
+    RegisterName::XMM13,
+};
+
+// Registers a call may overwrite (System V ABI), every XMM register is caller-saved
+inline constexpr std::array CALLER_SAVED_REGISTERS {
+    RegisterName::AX,
+    RegisterName::CX,
+    RegisterName::DX,
+    RegisterName::DI,
+    RegisterName::SI,
+    RegisterName::R8,
+    RegisterName::R9,
+    RegisterName::R10,
+    RegisterName::R11,
+    RegisterName::XMM0,
+    RegisterName::XMM1,
+    RegisterName::XMM2,
+    RegisterName::XMM3,
+    RegisterName::XMM4,
+    RegisterName::XMM5,
+    RegisterName::XMM6,
+    RegisterName::XMM7,
+    RegisterName::XMM8,
+    RegisterName::XMM9,
+    RegisterName::XMM10,
+    RegisterName::XMM11,
+    RegisterName::XMM12,
+    RegisterName::XMM13,
+    RegisterName::XMM14,
+    RegisterName::XMM15,
+};
+
+inline bool is_xmm_register(RegisterName reg)
+{
+    return reg >= RegisterName::XMM0 && reg <= RegisterName::XMM15;
+}
+
+inline bool is_caller_saved(RegisterName reg)
+{
+    for (RegisterName caller_saved : CALLER_SAVED_REGISTERS) {
+        if (caller_saved == reg) {
+            return true;
+        }
+    }
+    return false;
+}
+
+}
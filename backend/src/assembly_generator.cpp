@@ -4,14 +4,20 @@
 #include "backend/assembly_printer.h"
 #include "backend/backend_symbol_table.h"
 #include "backend/fixup_instruction_step.h"
+#include "backend/linear_scan_allocator.h"
+#include "backend/peephole_optimizer.h"
 #include "backend/pseudo_register_replace_step.h"
+#include "backend/register_allocator.h"
 #include "common/data/symbol_table.h"
 #include "common/data/type.h"
 #include "common/error/internal_compiler_error.h"
+#include "common/stats/statistic.h"
 #include "tacky/tacky_ast.h"
 #include "tacky/tacky_printer.h"
+#include "tacky/use_def.h"
 #include <cassert>
 #include <format>
+#include <limits>
 #include <memory>
 #include <ranges>
 #include <string>
@@ -20,12 +26,21 @@
 
 using namespace backend;
 
-AssemblyGenerator::AssemblyGenerator(std::shared_ptr<tacky::TackyAST> ast, std::shared_ptr<SymbolTable> symbol_table, std::shared_ptr<BackendSymbolTable> backend_symbol_table, std::shared_ptr<CompileOptions> compile_options, std::shared_ptr<NameGenerator> name_generator)
+STATISTIC(NumStaticConstants, "assembly-generator", "Number of static double constants created");
+STATISTIC(NumStaticConstantsDeduplicated, "assembly-generator", "Number of static double constants deduplicated");
+STATISTIC(NumCompareAndBranchFused, "assembly-generator", "Number of comparisons fused with the conditional jump on their result");
+STATISTIC(NumCompareAndSelectFused, "assembly-generator", "Number of comparisons fused with the select on their result");
+STATISTIC(NumAddressesFolded, "assembly-generator", "Number of address computations folded into the memory operand of a load or store");
+STATISTIC(NumMultipliesStrengthReduced, "assembly-generator", "Number of multiplications by a constant lowered without imul");
+STATISTIC(NumDivisionsByConstant, "assembly-generator", "Number of divisions and remainders by a constant lowered without div or idiv");
+
+AssemblyGenerator::AssemblyGenerator(std::shared_ptr<tacky::TackyAST> ast, std::shared_ptr<SymbolTable> symbol_table, std::shared_ptr<BackendSymbolTable> backend_symbol_table, std::shared_ptr<CompileOptions> compile_options, std::shared_ptr<NameGenerator> name_generator, std::shared_ptr<RemarkManager> remark_manager)
     : m_ast { ast }
     , m_symbol_table(symbol_table)
     , m_backend_symbol_table(backend_symbol_table)
     , m_compile_options(compile_options)
     , m_name_generator(name_generator)
+    , m_remark_manager(remark_manager)
     , INT_FUNCTION_REGISTERS { RegisterName::DI, RegisterName::SI, RegisterName::DX, RegisterName::CX, RegisterName::R8, RegisterName::R9 }
     , DOUBLE_FUNCTION_REGISTERS { RegisterName::XMM0, RegisterName::XMM1, RegisterName::XMM2, RegisterName::XMM3, RegisterName::XMM4, RegisterName::XMM5, RegisterName::XMM6, RegisterName::XMM7 }
 {
@@ -41,7 +56,9 @@ void AssemblyGenerator::generate_backend_symbol_table()
         if (dynamic_cast<FunctionType*>(st_entry.second.type.get())) {
             assert(std::holds_alternative<FunctionAttribute>(st_entry.second.attribute));
             const auto& function_attribute = std::get<FunctionAttribute>(st_entry.second.attribute);
-            m_backend_symbol_table->insert_symbol(symbol_name, FunctionEntry { 0, function_attribute.defined });
+            const auto& function_type = dynamic_cast<const FunctionType&>(*st_entry.second.type);
+            bool returns_double = dynamic_cast<const DoubleType*>(function_type.return_type.get());
+            m_backend_symbol_table->insert_symbol(symbol_name, FunctionEntry { 0, function_attribute.defined, get_param_registers(function_type), { returns_double ? RegisterName::XMM0 : RegisterName::AX } });
         } else {
             auto [type, _] = convert_type(*st_entry.second.type);
             bool is_static = std::holds_alternative<StaticAttribute>(st_entry.second.attribute);
@@ -50,15 +67,45 @@ void AssemblyGenerator::generate_backend_symbol_table()
     }
 }
 
+std::vector<RegisterName> AssemblyGenerator::get_param_registers(const FunctionType& function_type)
+{
+    std::vector<RegisterName> registers;
+    size_t int_count = 0;
+    size_t double_count = 0;
+    for (const auto& param_type : function_type.parameters_type) {
+        auto [type, _] = convert_type(*param_type);
+        if (type == AssemblyType::DOUBLE) {
+            if (double_count < DOUBLE_FUNCTION_REGISTERS.size()) {
+                registers.push_back(DOUBLE_FUNCTION_REGISTERS[double_count++]);
+            }
+        } else if (int_count < INT_FUNCTION_REGISTERS.size()) {
+            registers.push_back(INT_FUNCTION_REGISTERS[int_count++]);
+        }
+    }
+    return registers;
+}
+
 std::shared_ptr<AssemblyAST> AssemblyGenerator::generate()
 {
     std::shared_ptr<AssemblyAST> m_assembly_ast = transform_program(*dynamic_cast<tacky::Program*>(m_ast.get()));
     generate_backend_symbol_table();
 
-    PseudoRegisterReplaceStep step1(m_assembly_ast, m_backend_symbol_table);
+    // Pseudo registers the allocator leaves behind (spilled, address taken or static) go to the stack or data section
+    if (m_compile_options->optimization_level >= 2) {
+        RegisterAllocator register_allocator(m_assembly_ast, m_backend_symbol_table, m_remark_manager);
+        register_allocator.allocate();
+    } else if (m_compile_options->optimization_level == 1) {
+        LinearScanAllocator register_allocator(m_assembly_ast, m_backend_symbol_table, m_remark_manager);
+        register_allocator.allocate();
+    }
+    PseudoRegisterReplaceStep step1(m_assembly_ast, m_backend_symbol_table, m_remark_manager);
     step1.replace();
     FixUpInstructionsStep step2(m_assembly_ast, m_backend_symbol_table);
     step2.fixup();
+    if (m_compile_options->optimization_level >= 1) {
+        PeepholeOptimizer peephole_optimizer(m_assembly_ast, m_backend_symbol_table);
+        peephole_optimizer.optimize();
+    }
     return m_assembly_ast;
 }
 
@@ -156,6 +203,8 @@ std::vector<std::unique_ptr<Instruction>> AssemblyGenerator::transform_instructi
         return transform_copy_to_offset_instruction(*copy_to_offset_instruction);
     } else if (auto add_pointer_instruction = dynamic_cast<tacky::AddPointerInstruction*>(&instruction)) {
         return transform_add_pointer_instruction(*add_pointer_instruction);
+    } else if (auto select_instruction = dynamic_cast<tacky::SelectInstruction*>(&instruction)) {
+        return transform_select_instruction(*select_instruction);
     } else {
         throw InternalCompilerError("AssemblyGenerator: Invalid or Unsupported tacky::Instruction");
     }
@@ -196,6 +245,12 @@ std::vector<std::unique_ptr<Instruction>> AssemblyGenerator::transform_load_inst
     auto [dst_type, _] = get_converted_operand_type(*load_instruction.destination);
     std::unique_ptr<Operand> src_ptr = transform_operand(*load_instruction.source_pointer);
     std::unique_ptr<Operand> dst = transform_operand(*load_instruction.destination);
+    if (auto memory = get_frame_address_operand(*load_instruction.source_pointer)) {
+        add_comment_instruction("load_instruction from frame address", instructions);
+        instructions.emplace_back(std::make_unique<MovInstruction>(dst_type, std::move(memory), std::move(dst)));
+        ++NumAddressesFolded;
+        return instructions;
+    }
     add_comment_instruction("load_instruction", instructions);
     // use QUAD_WORD as we are copying a pointer into a register
     auto reg = std::make_unique<Register>(RegisterName::AX);
@@ -210,6 +265,12 @@ std::vector<std::unique_ptr<Instruction>> AssemblyGenerator::transform_store_ins
     auto [src_type, _] = get_converted_operand_type(*store_instruction.source);
     std::unique_ptr<Operand> src = transform_operand(*store_instruction.source);
     std::unique_ptr<Operand> dst_ptr = transform_operand(*store_instruction.destination_pointer);
+    if (auto memory = get_frame_address_operand(*store_instruction.destination_pointer)) {
+        add_comment_instruction("store_instruction to frame address", instructions);
+        instructions.emplace_back(std::make_unique<MovInstruction>(src_type, std::move(src), std::move(memory)));
+        ++NumAddressesFolded;
+        return instructions;
+    }
     add_comment_instruction("store_instruction", instructions);
     // use QUAD_WORD as we are copying a pointer into a register
     auto reg = std::make_unique<Register>(RegisterName::AX);
@@ -221,6 +282,10 @@ std::vector<std::unique_ptr<Instruction>> AssemblyGenerator::transform_store_ins
 std::vector<std::unique_ptr<Instruction>> AssemblyGenerator::transform_get_address_instruction(tacky::GetAddressInstruction& get_address_instruction)
 {
     std::vector<std::unique_ptr<Instruction>> instructions;
+    auto pointer = dynamic_cast<tacky::TemporaryVariable*>(get_address_instruction.destination.get());
+    if (pointer && m_unused_frame_addresses.contains(pointer->identifier.name)) {
+        return instructions;
+    }
     std::unique_ptr<Operand> src = transform_operand(*get_address_instruction.source);
     std::unique_ptr<Operand> dst = transform_operand(*get_address_instruction.destination);
     add_comment_instruction("get_address_instruction", instructions);
@@ -242,9 +307,17 @@ std::vector<std::unique_ptr<Instruction>> AssemblyGenerator::transform_copy_to_o
 std::vector<std::unique_ptr<Instruction>> AssemblyGenerator::transform_add_pointer_instruction(tacky::AddPointerInstruction& add_pointer_instruction)
 {
     std::vector<std::unique_ptr<Instruction>> instructions;
-    std::unique_ptr<Operand> src_ptr = transform_operand(*add_pointer_instruction.source_pointer);
     std::unique_ptr<Operand> idx = transform_operand(*add_pointer_instruction.index);
     std::unique_ptr<Operand> dst = transform_operand(*add_pointer_instruction.destination);
+    auto pointer = dynamic_cast<tacky::TemporaryVariable*>(add_pointer_instruction.destination.get());
+    if (pointer && m_unused_frame_addresses.contains(pointer->identifier.name)) {
+        return instructions;
+    }
+    if (auto memory = get_frame_address_operand(*add_pointer_instruction.destination)) {
+        add_comment_instruction("add_pointer_instruction to frame address", instructions);
+        instructions.emplace_back(std::make_unique<LeaInstruction>(std::move(memory), std::move(dst)));
+        return instructions;
+    }
     add_comment_instruction("add_pointer_instruction", instructions);
 
     if (auto imm_val = dynamic_cast<ImmediateValue*>(idx.get())) {
@@ -264,9 +337,14 @@ std::vector<std::unique_ptr<Instruction>> AssemblyGenerator::transform_add_point
             }
         },
             imm_val->value);
+        // A pointer stepping through an array is incremented in place
+        auto source = dynamic_cast<tacky::TemporaryVariable*>(add_pointer_instruction.source_pointer.get());
+        if (pointer && source && source->identifier.name == pointer->identifier.name && res >= std::numeric_limits<int32_t>::min() && res <= std::numeric_limits<int32_t>::max()) {
+            instructions.emplace_back(std::make_unique<BinaryInstruction>(BinaryOperator::ADD, AssemblyType::QUAD_WORD, std::make_unique<ImmediateValue>(res), std::move(dst)));
+            return instructions;
+        }
         std::unique_ptr<Operand> mem = std::make_unique<MemoryAddress>(RegisterName::AX, res);
-        std::unique_ptr<Operand> reg = std::make_unique<Register>(RegisterName::AX);
-        instructions.emplace_back(std::make_unique<MovInstruction>(AssemblyType::QUAD_WORD, std::move(src_ptr), std::move(reg)));
+        emit_pointer_to_register(*add_pointer_instruction.source_pointer, instructions);
         instructions.emplace_back(std::make_unique<LeaInstruction>(std::move(mem), std::move(dst)));
 
     } else {
@@ -274,15 +352,23 @@ std::vector<std::unique_ptr<Instruction>> AssemblyGenerator::transform_add_point
             std::unique_ptr<Register> reg1 = std::make_unique<Register>(RegisterName::AX);
             std::unique_ptr<Register> reg2 = std::make_unique<Register>(RegisterName::DX);
 
-            instructions.emplace_back(std::make_unique<MovInstruction>(AssemblyType::QUAD_WORD, std::move(src_ptr), reg1->clone()));
+            emit_pointer_to_register(*add_pointer_instruction.source_pointer, instructions);
             instructions.emplace_back(std::make_unique<MovInstruction>(AssemblyType::QUAD_WORD, std::move(idx), reg2->clone()));
             std::unique_ptr<Operand> idx_addr = std::make_unique<IndexedAddress>(std::move(reg1), std::move(reg2), add_pointer_instruction.scale);
             instructions.emplace_back(std::make_unique<LeaInstruction>(std::move(idx_addr), std::move(dst)));
+        } else if (auto plan = plan_multiply_by_constant(add_pointer_instruction.scale, 64)) {
+            // The index is scaled in DX with AX as scratch before AX gets the pointer
+            instructions.emplace_back(std::make_unique<MovInstruction>(AssemblyType::QUAD_WORD, std::move(idx), std::make_unique<Register>(RegisterName::DX)));
+            emit_multiply_plan(*plan, AssemblyType::QUAD_WORD, RegisterName::DX, RegisterName::AX, instructions);
+            emit_pointer_to_register(*add_pointer_instruction.source_pointer, instructions);
+            std::unique_ptr<Operand> idx_addr = std::make_unique<IndexedAddress>(RegisterName::AX, RegisterName::DX, 1);
+            instructions.emplace_back(std::make_unique<LeaInstruction>(std::move(idx_addr), std::move(dst)));
+            ++NumMultipliesStrengthReduced;
         } else {
             std::unique_ptr<Register> reg1 = std::make_unique<Register>(RegisterName::AX);
             std::unique_ptr<Register> reg2 = std::make_unique<Register>(RegisterName::DX);
 
-            instructions.emplace_back(std::make_unique<MovInstruction>(AssemblyType::QUAD_WORD, std::move(src_ptr), reg1->clone()));
+            emit_pointer_to_register(*add_pointer_instruction.source_pointer, instructions);
             instructions.emplace_back(std::make_unique<MovInstruction>(AssemblyType::QUAD_WORD, std::move(idx), reg2->clone()));
             auto imm = std::make_unique<ImmediateValue>(add_pointer_instruction.scale);
             instructions.emplace_back(std::make_unique<BinaryInstruction>(BinaryOperator::MULT, AssemblyType::QUAD_WORD, std::move(imm), reg2->clone()));
@@ -294,6 +380,180 @@ std::vector<std::unique_ptr<Instruction>> AssemblyGenerator::transform_add_point
     return instructions;
 }
 
+std::optional<std::pair<std::vector<std::unique_ptr<Instruction>>, size_t>> AssemblyGenerator::transform_indexed_access(std::vector<std::unique_ptr<tacky::Instruction>>& body, size_t position)
+{
+    // The sum must only be read by the access, which then reads the base and the index instead
+    auto& add_pointer_instruction = dynamic_cast<tacky::AddPointerInstruction&>(*body[position]);
+    auto pointer = dynamic_cast<tacky::TemporaryVariable*>(add_pointer_instruction.destination.get());
+    if (!pointer || m_use_counts[pointer->identifier.name] != 1 || m_aliased_variables.contains(pointer->identifier.name)
+        || m_frame_addresses.contains(pointer->identifier.name)) {
+        return std::nullopt;
+    }
+    auto is_operand = [&](const std::string& name) {
+        for (tacky::Value* value : { add_pointer_instruction.source_pointer.get(), add_pointer_instruction.index.get() }) {
+            auto variable = dynamic_cast<tacky::TemporaryVariable*>(value);
+            if (variable && variable->identifier.name == name) {
+                return true;
+            }
+        }
+        return false;
+    };
+
+    // The access may come a few instructions later in the same block, as long as they leave the base and index alone
+    tacky::LoadInstruction* load_instruction = nullptr;
+    tacky::StoreInstruction* store_instruction = nullptr;
+    size_t access = position + 1;
+    for (; access < body.size() && access <= position + MAX_INDEXED_ACCESS_DISTANCE; ++access) {
+        tacky::Instruction& instruction = *body[access];
+        load_instruction = dynamic_cast<tacky::LoadInstruction*>(&instruction);
+        store_instruction = dynamic_cast<tacky::StoreInstruction*>(&instruction);
+        tacky::Value* accessed = load_instruction ? load_instruction->source_pointer.get() : store_instruction ? store_instruction->destination_pointer.get() : nullptr;
+        auto accessed_variable = dynamic_cast<tacky::TemporaryVariable*>(accessed);
+        if (accessed_variable && accessed_variable->identifier.name == pointer->identifier.name) {
+            break;
+        }
+        load_instruction = nullptr;
+        store_instruction = nullptr;
+        auto defined = tacky::defined_variable(instruction);
+        if (dynamic_cast<tacky::LabelInstruction*>(&instruction) || dynamic_cast<tacky::JumpInstruction*>(&instruction)
+            || dynamic_cast<tacky::JumpIfZeroInstruction*>(&instruction) || dynamic_cast<tacky::JumpIfNotZeroInstruction*>(&instruction)
+            || dynamic_cast<tacky::ReturnInstruction*>(&instruction) || dynamic_cast<tacky::FunctionCallInstruction*>(&instruction)
+            || dynamic_cast<tacky::AddPointerInstruction*>(&instruction) || (defined && is_operand(*defined))) {
+            return std::nullopt;
+        }
+    }
+    if (!load_instruction && !store_instruction) {
+        return std::nullopt;
+    }
+
+    size_t scale = add_pointer_instruction.scale;
+    std::optional<uint64_t> index = get_integer_constant(*add_pointer_instruction.index);
+    int64_t displacement = index ? static_cast<int64_t>(*index) * static_cast<int64_t>(scale) : 0;
+    if (index ? displacement < std::numeric_limits<int32_t>::min() || displacement > std::numeric_limits<int32_t>::max() : scale != 1 && scale != 2 && scale != 4 && scale != 8) {
+        return std::nullopt;
+    }
+
+    std::vector<std::unique_ptr<Instruction>> instructions;
+    for (size_t i = position + 1; i < access; ++i) {
+        for (auto& instruction : transform_instruction(*body[i])) {
+            instructions.push_back(std::move(instruction));
+        }
+    }
+    std::unique_ptr<Operand> memory;
+    if (index) {
+        add_comment_instruction(load_instruction ? "load_instruction with displacement" : "store_instruction with displacement", instructions);
+        emit_pointer_to_register(*add_pointer_instruction.source_pointer, instructions);
+        memory = std::make_unique<MemoryAddress>(RegisterName::AX, displacement);
+    } else {
+        add_comment_instruction(load_instruction ? "indexed load_instruction" : "indexed store_instruction", instructions);
+        emit_pointer_to_register(*add_pointer_instruction.source_pointer, instructions);
+        instructions.emplace_back(std::make_unique<MovInstruction>(AssemblyType::QUAD_WORD, transform_operand(*add_pointer_instruction.index), std::make_unique<Register>(RegisterName::DX)));
+        memory = std::make_unique<IndexedAddress>(RegisterName::AX, RegisterName::DX, static_cast<int>(scale));
+    }
+
+    if (load_instruction) {
+        auto [dst_type, _] = get_converted_operand_type(*load_instruction->destination);
+        instructions.emplace_back(std::make_unique<MovInstruction>(dst_type, std::move(memory), transform_operand(*load_instruction->destination)));
+    } else {
+        auto [src_type, _] = get_converted_operand_type(*store_instruction->source);
+        instructions.emplace_back(std::make_unique<MovInstruction>(src_type, transform_operand(*store_instruction->source), std::move(memory)));
+    }
+    ++NumAddressesFolded;
+    return std::pair { std::move(instructions), access };
+}
+
+void AssemblyGenerator::collect_frame_addresses(tacky::FunctionDefinition& function_definition)
+{
+    m_frame_addresses.clear();
+    m_unused_frame_addresses.clear();
+    std::unordered_map<std::string, size_t> definition_counts;
+    for (auto& instruction : function_definition.body) {
+        if (auto name = tacky::defined_variable(*instruction)) {
+            ++definition_counts[*name];
+        }
+    }
+    // A pointer written once and never through another pointer holds the same value wherever it is read
+    auto single_definition = [&](tacky::Value& value) -> const std::string* {
+        auto variable = dynamic_cast<tacky::TemporaryVariable*>(&value);
+        if (!variable || definition_counts[variable->identifier.name] != 1 || m_aliased_variables.contains(variable->identifier.name)) {
+            return nullptr;
+        }
+        return &variable->identifier.name;
+    };
+
+    for (auto& instruction : function_definition.body) {
+        if (auto get_address = dynamic_cast<tacky::GetAddressInstruction*>(instruction.get())) {
+            auto array = dynamic_cast<tacky::TemporaryVariable*>(get_address->source.get());
+            const std::string* pointer = single_definition(*get_address->destination);
+            if (array && pointer && is_local_array(array->identifier.name)) {
+                m_frame_addresses[*pointer] = { array->identifier.name, 0 };
+            }
+        } else if (auto add_pointer = dynamic_cast<tacky::AddPointerInstruction*>(instruction.get())) {
+            auto base = dynamic_cast<tacky::TemporaryVariable*>(add_pointer->source_pointer.get());
+            auto it = base ? m_frame_addresses.find(base->identifier.name) : m_frame_addresses.end();
+            std::optional<uint64_t> index = get_integer_constant(*add_pointer->index);
+            const std::string* pointer = single_definition(*add_pointer->destination);
+            if (it == m_frame_addresses.end() || !index || !pointer) {
+                continue;
+            }
+            int64_t offset = it->second.second + static_cast<int64_t>(*index) * static_cast<int64_t>(add_pointer->scale);
+            if (offset >= std::numeric_limits<int32_t>::min() && offset <= std::numeric_limits<int32_t>::max()) {
+                m_frame_addresses[*pointer] = { it->second.first, offset };
+            }
+        }
+    }
+
+    // Loads, stores and pointer additions take a frame address directly, a pointer used nowhere else is not computed
+    std::unordered_map<std::string, size_t> address_uses;
+    auto count_address_use = [&](tacky::Value& value) {
+        if (auto variable = dynamic_cast<tacky::TemporaryVariable*>(&value)) {
+            ++address_uses[variable->identifier.name];
+        }
+    };
+    for (auto& instruction : function_definition.body) {
+        if (auto load = dynamic_cast<tacky::LoadInstruction*>(instruction.get())) {
+            count_address_use(*load->source_pointer);
+        } else if (auto store = dynamic_cast<tacky::StoreInstruction*>(instruction.get())) {
+            count_address_use(*store->destination_pointer);
+        } else if (auto add_pointer = dynamic_cast<tacky::AddPointerInstruction*>(instruction.get())) {
+            count_address_use(*add_pointer->source_pointer);
+        }
+    }
+    for (const auto& [pointer, _] : m_frame_addresses) {
+        if (address_uses[pointer] == m_use_counts[pointer]) {
+            m_unused_frame_addresses.insert(pointer);
+        }
+    }
+}
+
+bool AssemblyGenerator::is_local_array(const std::string& name)
+{
+    if (!m_symbol_table->contains_symbol(name)) {
+        return false;
+    }
+    const auto& symbol = m_symbol_table->symbol_at(name);
+    return !symbol.type->is_scalar() && std::holds_alternative<LocalAttribute>(symbol.attribute);
+}
+
+std::unique_ptr<Operand> AssemblyGenerator::get_frame_address_operand(tacky::Value& pointer)
+{
+    auto variable = dynamic_cast<tacky::TemporaryVariable*>(&pointer);
+    auto it = variable ? m_frame_addresses.find(variable->identifier.name) : m_frame_addresses.end();
+    if (it == m_frame_addresses.end()) {
+        return nullptr;
+    }
+    return std::make_unique<PseudoMemory>(it->second.first, static_cast<int>(it->second.second));
+}
+
+void AssemblyGenerator::emit_pointer_to_register(tacky::Value& pointer, std::vector<std::unique_ptr<Instruction>>& instructions)
+{
+    if (auto memory = get_frame_address_operand(pointer)) {
+        instructions.emplace_back(std::make_unique<LeaInstruction>(std::move(memory), std::make_unique<Register>(RegisterName::AX, AssemblyType::QUAD_WORD)));
+    } else {
+        instructions.emplace_back(std::make_unique<MovInstruction>(AssemblyType::QUAD_WORD, transform_operand(pointer), std::make_unique<Register>(RegisterName::AX)));
+    }
+}
+
 std::vector<std::unique_ptr<Instruction>> AssemblyGenerator::transform_label_instruction(tacky::LabelInstruction& label_instruction)
 {
     std::vector<std::unique_ptr<Instruction>> instructions;
@@ -446,7 +706,7 @@ std::vector<std::unique_ptr<Instruction>> AssemblyGenerator::transform_double_to
         std::string label2 = m_name_generator->make_label("uint_to_double");
         std::string upper_bound_label = add_static_double_constant(9223372036854775808.0, 8);
 
-        instructions.emplace_back(std::make_unique<CmpInstruction>(AssemblyType::QUAD_WORD, std::make_unique<DataOperand>(upper_bound_label), src->clone()));
+        instructions.emplace_back(std::make_unique<CmpInstruction>(AssemblyType::DOUBLE, std::make_unique<DataOperand>(upper_bound_label), src->clone()));
         instructions.emplace_back(std::make_unique<JmpCCInstruction>(ConditionCode::AE, label1));
         instructions.emplace_back(std::make_unique<Cvttsd2siInstruction>(AssemblyType::QUAD_WORD, src->clone(), dst->clone()));
         instructions.emplace_back(std::make_unique<JmpInstruction>(label2));
@@ -454,7 +714,7 @@ std::vector<std::unique_ptr<Instruction>> AssemblyGenerator::transform_double_to
         instructions.emplace_back(std::make_unique<MovInstruction>(AssemblyType::DOUBLE, src->clone(), regx->clone()));
         instructions.emplace_back(std::make_unique<BinaryInstruction>(BinaryOperator::SUB, AssemblyType::DOUBLE, std::make_unique<DataOperand>(upper_bound_label), regx->clone()));
         instructions.emplace_back(std::make_unique<Cvttsd2siInstruction>(AssemblyType::QUAD_WORD, regx->clone(), dst->clone()));
-        instructions.emplace_back(std::make_unique<BinaryInstruction>(BinaryOperator::AND, AssemblyType::QUAD_WORD, std::make_unique<ImmediateValue>(9223372036854775808ul), regr->clone()));
+        instructions.emplace_back(std::make_unique<MovInstruction>(AssemblyType::QUAD_WORD, std::make_unique<ImmediateValue>(9223372036854775808ul), regr->clone()));
         instructions.emplace_back(std::make_unique<BinaryInstruction>(BinaryOperator::ADD, AssemblyType::QUAD_WORD, regr->clone(), dst->clone()));
         instructions.emplace_back(std::make_unique<LabelInstruction>(label2));
     }
@@ -480,7 +740,15 @@ std::vector<std::unique_ptr<Instruction>> AssemblyGenerator::transform_unary_ins
             instructions.emplace_back(std::make_unique<CmpInstruction>(source_type, std::make_unique<ImmediateValue>(0), std::move(src)));
         }
         instructions.emplace_back(std::make_unique<MovInstruction>(destination_type, std::make_unique<ImmediateValue>(0), std::move(dst)));
-        instructions.emplace_back(std::make_unique<SetCCInstruction>(ConditionCode::E, std::move(dst_copy)));
+        if (is_double) {
+            // !NaN is 0, comisd reports NaN as equal to 0.0 and sets the parity flag
+            std::string unordered_label = m_name_generator->make_label("unordered");
+            instructions.emplace_back(std::make_unique<JmpCCInstruction>(ConditionCode::P, unordered_label));
+            instructions.emplace_back(std::make_unique<SetCCInstruction>(ConditionCode::E, std::move(dst_copy)));
+            instructions.emplace_back(std::make_unique<LabelInstruction>(unordered_label));
+        } else {
+            instructions.emplace_back(std::make_unique<SetCCInstruction>(ConditionCode::E, std::move(dst_copy)));
+        }
 
     } else if (is_double && unary_instruction.unary_operator == tacky::UnaryOperator::NEGATE) {
         // We need to align -0.0 to 16 bytes so that we can use it in the xorpd instruction
@@ -503,26 +771,66 @@ std::vector<std::unique_ptr<Instruction>> AssemblyGenerator::transform_binary_in
     auto [source1_type, is_signed] = get_converted_operand_type(*binary_instruction.source1);
     bool is_double = source1_type == AssemblyType::DOUBLE;
     auto destination_type = get_converted_operand_type(*binary_instruction.destination).first;
+    // dst = src1 op src2 as mov src1, dst and op src2, dst. The mov would overwrite a src2 that is dst itself, which
+    // copy propagation makes of t = x; x = a - t: the operands of an addition or a multiplication swap, any other
+    // operation goes through a scratch register
+    auto emit_two_operand = [&](BinaryOperator op) {
+        auto destination = dynamic_cast<tacky::TemporaryVariable*>(binary_instruction.destination.get());
+        auto is_destination = [&](const tacky::Value& value) {
+            auto variable = dynamic_cast<const tacky::TemporaryVariable*>(&value);
+            return destination && variable && variable->identifier.name == destination->identifier.name;
+        };
+        tacky::Value* source1 = binary_instruction.source1.get();
+        tacky::Value* source2 = binary_instruction.source2.get();
+        std::unique_ptr<Operand> dst = transform_operand(*binary_instruction.destination);
+        if (!is_destination(*source2) || is_destination(*source1)) {
+            instructions.emplace_back(std::make_unique<MovInstruction>(source1_type, transform_operand(*source1), dst->clone()));
+            instructions.emplace_back(std::make_unique<BinaryInstruction>(op, source1_type, transform_operand(*source2), std::move(dst)));
+        } else if (op == BinaryOperator::ADD || op == BinaryOperator::MULT) {
+            instructions.emplace_back(std::make_unique<BinaryInstruction>(op, source1_type, transform_operand(*source1), std::move(dst)));
+        } else {
+            RegisterName scratch = is_double ? RegisterName::XMM0 : RegisterName::AX;
+            instructions.emplace_back(std::make_unique<MovInstruction>(source1_type, transform_operand(*source1), std::make_unique<Register>(scratch)));
+            instructions.emplace_back(std::make_unique<BinaryInstruction>(op, source1_type, transform_operand(*source2), std::make_unique<Register>(scratch)));
+            instructions.emplace_back(std::make_unique<MovInstruction>(source1_type, std::make_unique<Register>(scratch), std::move(dst)));
+        }
+    };
     if (is_relational_operator(binary_instruction.binary_operator)) {
         std::unique_ptr<Operand> src1 = transform_operand(*binary_instruction.source1);
         std::unique_ptr<Operand> src2 = transform_operand(*binary_instruction.source2);
         std::unique_ptr<Operand> dst = transform_operand(*binary_instruction.destination);
         std::unique_ptr<Operand> dst_copy = dst->clone();
         add_comment_instruction("relational binary_instruction", instructions);
+        tacky::BinaryOperator op = binary_instruction.binary_operator;
+        if (is_double && (op == tacky::BinaryOperator::LESS_THAN || op == tacky::BinaryOperator::LESS_OR_EQUAL)) {
+            // a < b as b > a, the above conditions are false when comisd finds the operands unordered (NaN)
+            std::swap(src1, src2);
+            op = op == tacky::BinaryOperator::LESS_THAN ? tacky::BinaryOperator::GREATER_THAN : tacky::BinaryOperator::GREATER_OR_EQUAL;
+        }
         instructions.emplace_back(std::make_unique<CmpInstruction>(source1_type, std::move(src2), std::move(src1)));
-        instructions.emplace_back(std::make_unique<MovInstruction>(destination_type, std::make_unique<ImmediateValue>(0), std::move(dst)));
-        // condition code differs between signed and unsigned/double
-        instructions.emplace_back(std::make_unique<SetCCInstruction>(to_condition_code(binary_instruction.binary_operator, is_signed), std::move(dst_copy)));
+        if (is_double && (op == tacky::BinaryOperator::EQUAL || op == tacky::BinaryOperator::NOT_EQUAL)) {
+            // Unordered operands compare equal with the parity flag set, NaN == x is 0 and NaN != x is 1
+            std::string unordered_label = m_name_generator->make_label("unordered");
+            int unordered_result = op == tacky::BinaryOperator::NOT_EQUAL ? 1 : 0;
+            instructions.emplace_back(std::make_unique<MovInstruction>(destination_type, std::make_unique<ImmediateValue>(unordered_result), std::move(dst)));
+            instructions.emplace_back(std::make_unique<JmpCCInstruction>(ConditionCode::P, unordered_label));
+            instructions.emplace_back(std::make_unique<SetCCInstruction>(to_condition_code(op, is_signed), std::move(dst_copy)));
+            instructions.emplace_back(std::make_unique<LabelInstruction>(unordered_label));
+        } else {
+            instructions.emplace_back(std::make_unique<MovInstruction>(destination_type, std::make_unique<ImmediateValue>(0), std::move(dst)));
+            // condition code differs between signed and unsigned/double
+            instructions.emplace_back(std::make_unique<SetCCInstruction>(to_condition_code(op, is_signed), std::move(dst_copy)));
+        }
+    } else if (auto divide_instructions = transform_divide_by_constant(binary_instruction)) {
+        instructions = std::move(*divide_instructions);
     } else if (binary_instruction.binary_operator == tacky::BinaryOperator::DIVIDE) {
-        std::unique_ptr<Operand> src1 = transform_operand(*binary_instruction.source1);
-        std::unique_ptr<Operand> src2 = transform_operand(*binary_instruction.source2);
-        std::unique_ptr<Operand> dst = transform_operand(*binary_instruction.destination);
-        std::unique_ptr<Operand> dst_copy = dst->clone();
         add_comment_instruction("divide binary_instruction", instructions);
         if (is_double) {
-            instructions.emplace_back(std::make_unique<MovInstruction>(source1_type, std::move(src1), std::move(dst)));
-            instructions.emplace_back(std::make_unique<BinaryInstruction>(BinaryOperator::DIV_DOUBLE, source1_type, std::move(src2), std::move(dst_copy)));
+            emit_two_operand(BinaryOperator::DIV_DOUBLE);
         } else {
+            std::unique_ptr<Operand> src1 = transform_operand(*binary_instruction.source1);
+            std::unique_ptr<Operand> src2 = transform_operand(*binary_instruction.source2);
+            std::unique_ptr<Operand> dst = transform_operand(*binary_instruction.destination);
             instructions.emplace_back(std::make_unique<MovInstruction>(source1_type, std::move(src1), std::make_unique<Register>(RegisterName::AX)));
             if (is_signed) {
                 instructions.emplace_back(std::make_unique<CdqInstruction>(source1_type));
@@ -549,20 +857,234 @@ std::vector<std::unique_ptr<Instruction>> AssemblyGenerator::transform_binary_in
             instructions.emplace_back(std::make_unique<DivInstruction>(source1_type, std::move(src2)));
         }
         instructions.emplace_back(std::make_unique<MovInstruction>(source1_type, std::make_unique<Register>(RegisterName::DX), std::move(dst)));
+    } else if (auto multiply_instructions = transform_multiply_by_constant(binary_instruction)) {
+        instructions = std::move(*multiply_instructions);
     } else {
-        std::unique_ptr<Operand> src1 = transform_operand(*binary_instruction.source1);
-        std::unique_ptr<Operand> dst = transform_operand(*binary_instruction.destination);
-        std::unique_ptr<Operand> dst_copy = dst->clone();
         add_comment_instruction("arithmetic binary_instruction", instructions);
-        instructions.emplace_back(std::make_unique<MovInstruction>(source1_type, std::move(src1), std::move(dst)));
+        emit_two_operand(transform_operator(binary_instruction.binary_operator));
+    }
+    return instructions;
+}
 
-        BinaryOperator op = transform_operator(binary_instruction.binary_operator);
-        std::unique_ptr<Operand> src2 = transform_operand(*binary_instruction.source2);
-        instructions.emplace_back(std::make_unique<BinaryInstruction>(op, source1_type, std::move(src2), std::move(dst_copy)));
+std::optional<std::vector<std::unique_ptr<Instruction>>> AssemblyGenerator::transform_multiply_by_constant(tacky::BinaryInstruction& binary_instruction)
+{
+    if (binary_instruction.binary_operator != tacky::BinaryOperator::MULTIPLY) {
+        return std::nullopt;
+    }
+    auto type = get_converted_operand_type(*binary_instruction.source1).first;
+    if (type != AssemblyType::LONG_WORD && type != AssemblyType::QUAD_WORD) {
+        return std::nullopt;
+    }
+    tacky::Value* variable = binary_instruction.source1.get();
+    std::optional<uint64_t> constant = get_integer_constant(*binary_instruction.source2);
+    if (!constant) {
+        variable = binary_instruction.source2.get();
+        constant = get_integer_constant(*binary_instruction.source1);
+    }
+    if (!constant) {
+        return std::nullopt;
+    }
+
+    // Products wrap around, the plan is computed modulo 2^32 or 2^64 and a 64 bit lea leaves the right low 32 bits
+    int width = type == AssemblyType::QUAD_WORD ? 64 : 32;
+    std::vector<std::unique_ptr<Instruction>> instructions;
+    std::unique_ptr<Operand> dst = transform_operand(*binary_instruction.destination);
+    if (type == AssemblyType::LONG_WORD ? static_cast<uint32_t>(*constant) == 0 : *constant == 0) {
+        add_comment_instruction("multiply by zero binary_instruction", instructions);
+        instructions.emplace_back(std::make_unique<MovInstruction>(type, std::make_unique<ImmediateValue>(0), std::move(dst)));
+        ++NumMultipliesStrengthReduced;
+        return instructions;
     }
+    auto plan = plan_multiply_by_constant(*constant, width);
+    if (!plan) {
+        return std::nullopt;
+    }
+
+    add_comment_instruction("multiply by constant binary_instruction", instructions);
+    instructions.emplace_back(std::make_unique<MovInstruction>(type, transform_operand(*variable), std::make_unique<Register>(RegisterName::AX)));
+    emit_multiply_plan(*plan, type, RegisterName::AX, RegisterName::DX, instructions);
+    instructions.emplace_back(std::make_unique<MovInstruction>(type, std::make_unique<Register>(RegisterName::AX), std::move(dst)));
+    ++NumMultipliesStrengthReduced;
     return instructions;
 }
 
+void AssemblyGenerator::emit_multiply_plan(const MultiplyPlan& plan, AssemblyType type, RegisterName product, RegisterName source, std::vector<std::unique_ptr<Instruction>>& instructions)
+{
+    if (plan.uses_source()) {
+        instructions.emplace_back(std::make_unique<MovInstruction>(type, std::make_unique<Register>(product), std::make_unique<Register>(source)));
+    }
+    for (const auto& step : plan.steps) {
+        switch (step.kind) {
+        case MultiplyStep::Kind::SHIFT_LEFT:
+            instructions.emplace_back(std::make_unique<BinaryInstruction>(BinaryOperator::SHL, type, std::make_unique<ImmediateValue>(step.amount), std::make_unique<Register>(product)));
+            break;
+        case MultiplyStep::Kind::SCALE_ADD:
+            instructions.emplace_back(std::make_unique<LeaInstruction>(std::make_unique<IndexedAddress>(product, product, step.amount), std::make_unique<Register>(product, AssemblyType::QUAD_WORD)));
+            break;
+        case MultiplyStep::Kind::ADD_SOURCE:
+            if (step.amount == 1) {
+                instructions.emplace_back(std::make_unique<BinaryInstruction>(BinaryOperator::ADD, type, std::make_unique<Register>(source), std::make_unique<Register>(product)));
+            } else {
+                instructions.emplace_back(std::make_unique<LeaInstruction>(std::make_unique<IndexedAddress>(source, product, step.amount), std::make_unique<Register>(product, AssemblyType::QUAD_WORD)));
+            }
+            break;
+        case MultiplyStep::Kind::SUB_SOURCE:
+            instructions.emplace_back(std::make_unique<BinaryInstruction>(BinaryOperator::SUB, type, std::make_unique<Register>(source), std::make_unique<Register>(product)));
+            break;
+        case MultiplyStep::Kind::NEGATE:
+            instructions.emplace_back(std::make_unique<UnaryInstruction>(UnaryOperator::NEG, type, std::make_unique<Register>(product)));
+            break;
+        }
+    }
+}
+
+std::optional<std::vector<std::unique_ptr<Instruction>>> AssemblyGenerator::transform_divide_by_constant(tacky::BinaryInstruction& binary_instruction)
+{
+    tacky::BinaryOperator op = binary_instruction.binary_operator;
+    if (op != tacky::BinaryOperator::DIVIDE && op != tacky::BinaryOperator::REMAINDER) {
+        return std::nullopt;
+    }
+    auto [type, is_signed] = get_converted_operand_type(*binary_instruction.source1);
+    if (type != AssemblyType::LONG_WORD && type != AssemblyType::QUAD_WORD) {
+        return std::nullopt;
+    }
+    std::optional<uint64_t> divisor = get_integer_constant(*binary_instruction.source2);
+    if (!divisor) {
+        return std::nullopt;
+    }
+    int width = type == AssemblyType::QUAD_WORD ? 64 : 32;
+    auto plan = plan_divide_by_constant(*divisor, width, is_signed);
+    if (!plan) {
+        return std::nullopt;
+    }
+
+    std::vector<std::unique_ptr<Instruction>> instructions;
+    std::unique_ptr<Operand> dst = transform_operand(*binary_instruction.destination);
+    ++NumDivisionsByConstant;
+    if (op == tacky::BinaryOperator::DIVIDE) {
+        add_comment_instruction("divide by constant binary_instruction", instructions);
+        RegisterName quotient = emit_division_plan(*plan, type, *binary_instruction.source1, instructions);
+        instructions.emplace_back(std::make_unique<MovInstruction>(type, std::make_unique<Register>(quotient), std::move(dst)));
+        return instructions;
+    }
+
+    add_comment_instruction("remainder by constant binary_instruction", instructions);
+    if (plan->kind == DivisionPlan::Kind::IDENTITY || plan->kind == DivisionPlan::Kind::NEGATE) {
+        instructions.emplace_back(std::make_unique<MovInstruction>(type, std::make_unique<ImmediateValue>(0), std::move(dst)));
+        return instructions;
+    }
+    if (plan->kind == DivisionPlan::Kind::SHIFT) {
+        // x % 2^k is the low k bits of x
+        uint64_t low_bits = (uint64_t { 1 } << plan->shift) - 1;
+        instructions.emplace_back(std::make_unique<MovInstruction>(type, transform_operand(*binary_instruction.source1), std::make_unique<Register>(RegisterName::AX)));
+        instructions.emplace_back(std::make_unique<BinaryInstruction>(BinaryOperator::AND, type, make_integer_immediate(low_bits, type), std::make_unique<Register>(RegisterName::AX)));
+        instructions.emplace_back(std::make_unique<MovInstruction>(type, std::make_unique<Register>(RegisterName::AX), std::move(dst)));
+        return instructions;
+    }
+
+    // x % d = x - (x / d) * d
+    RegisterName quotient = emit_division_plan(*plan, type, *binary_instruction.source1, instructions);
+    RegisterName scratch = quotient == RegisterName::AX ? RegisterName::DX : RegisterName::AX;
+    if (auto multiply_plan = plan_multiply_by_constant(*divisor, width)) {
+        emit_multiply_plan(*multiply_plan, type, quotient, scratch, instructions);
+    } else {
+        instructions.emplace_back(std::make_unique<BinaryInstruction>(BinaryOperator::MULT, type, make_integer_immediate(*divisor, type), std::make_unique<Register>(quotient)));
+    }
+    instructions.emplace_back(std::make_unique<MovInstruction>(type, transform_operand(*binary_instruction.source1), std::make_unique<Register>(scratch)));
+    instructions.emplace_back(std::make_unique<BinaryInstruction>(BinaryOperator::SUB, type, std::make_unique<Register>(quotient), std::make_unique<Register>(scratch)));
+    instructions.emplace_back(std::make_unique<MovInstruction>(type, std::make_unique<Register>(scratch), std::move(dst)));
+    return instructions;
+}
+
+RegisterName AssemblyGenerator::emit_division_plan(const DivisionPlan& plan, AssemblyType type, tacky::Value& dividend, std::vector<std::unique_ptr<Instruction>>& instructions)
+{
+    int width = type == AssemblyType::QUAD_WORD ? 64 : 32;
+    auto reg = [](RegisterName name) { return std::make_unique<Register>(name); };
+    auto shift = [&](BinaryOperator op, int amount, RegisterName name) {
+        if (amount > 0) {
+            instructions.emplace_back(std::make_unique<BinaryInstruction>(op, type, std::make_unique<ImmediateValue>(amount), reg(name)));
+        }
+    };
+
+    instructions.emplace_back(std::make_unique<MovInstruction>(type, transform_operand(dividend), reg(RegisterName::AX)));
+    switch (plan.kind) {
+    case DivisionPlan::Kind::IDENTITY:
+        return RegisterName::AX;
+    case DivisionPlan::Kind::NEGATE:
+        instructions.emplace_back(std::make_unique<UnaryInstruction>(UnaryOperator::NEG, type, reg(RegisterName::AX)));
+        return RegisterName::AX;
+    case DivisionPlan::Kind::SHIFT:
+        shift(BinaryOperator::SHR, plan.shift, RegisterName::AX);
+        return RegisterName::AX;
+    case DivisionPlan::Kind::SIGNED_SHIFT:
+        // A negative dividend is biased by 2^k - 1 so the arithmetic shift rounds toward zero
+        if (plan.shift > 1) {
+            shift(BinaryOperator::SAR, width - 1, RegisterName::AX);
+        }
+        shift(BinaryOperator::SHR, width - plan.shift, RegisterName::AX);
+        instructions.emplace_back(std::make_unique<BinaryInstruction>(BinaryOperator::ADD, type, transform_operand(dividend), reg(RegisterName::AX)));
+        shift(BinaryOperator::SAR, plan.shift, RegisterName::AX);
+        if (plan.negate) {
+            instructions.emplace_back(std::make_unique<UnaryInstruction>(UnaryOperator::NEG, type, reg(RegisterName::AX)));
+        }
+        return RegisterName::AX;
+    case DivisionPlan::Kind::MULTIPLY_HIGH:
+        instructions.emplace_back(std::make_unique<MovInstruction>(type, make_integer_immediate(plan.magic, type), reg(RegisterName::DX)));
+        instructions.emplace_back(std::make_unique<MulInstruction>(type, reg(RegisterName::DX)));
+        shift(BinaryOperator::SHR, plan.shift, RegisterName::DX);
+        return RegisterName::DX;
+    case DivisionPlan::Kind::MULTIPLY_HIGH_ADD:
+        instructions.emplace_back(std::make_unique<MovInstruction>(type, make_integer_immediate(plan.magic, type), reg(RegisterName::DX)));
+        instructions.emplace_back(std::make_unique<MulInstruction>(type, reg(RegisterName::DX)));
+        instructions.emplace_back(std::make_unique<MovInstruction>(type, transform_operand(dividend), reg(RegisterName::AX)));
+        instructions.emplace_back(std::make_unique<BinaryInstruction>(BinaryOperator::SUB, type, reg(RegisterName::DX), reg(RegisterName::AX)));
+        shift(BinaryOperator::SHR, 1, RegisterName::AX);
+        instructions.emplace_back(std::make_unique<BinaryInstruction>(BinaryOperator::ADD, type, reg(RegisterName::DX), reg(RegisterName::AX)));
+        shift(BinaryOperator::SHR, plan.shift - 1, RegisterName::AX);
+        return RegisterName::AX;
+    case DivisionPlan::Kind::SIGNED_MULTIPLY_HIGH:
+        instructions.emplace_back(std::make_unique<MovInstruction>(type, make_integer_immediate(plan.magic, type), reg(RegisterName::DX)));
+        instructions.emplace_back(std::make_unique<ImulInstruction>(type, reg(RegisterName::DX)));
+        if (plan.correction != 0) {
+            BinaryOperator correction = plan.correction > 0 ? BinaryOperator::ADD : BinaryOperator::SUB;
+            instructions.emplace_back(std::make_unique<BinaryInstruction>(correction, type, transform_operand(dividend), reg(RegisterName::DX)));
+        }
+        shift(BinaryOperator::SAR, plan.shift, RegisterName::DX);
+        // Adds one to a negative quotient, which the multiplication rounded down
+        instructions.emplace_back(std::make_unique<MovInstruction>(type, reg(RegisterName::DX), reg(RegisterName::AX)));
+        shift(BinaryOperator::SHR, width - 1, RegisterName::AX);
+        instructions.emplace_back(std::make_unique<BinaryInstruction>(BinaryOperator::ADD, type, reg(RegisterName::AX), reg(RegisterName::DX)));
+        return RegisterName::DX;
+    }
+    throw InternalCompilerError("AssemblyGenerator: Invalid division plan");
+}
+
+std::unique_ptr<Operand> AssemblyGenerator::make_integer_immediate(uint64_t bits, AssemblyType type)
+{
+    if (type == AssemblyType::QUAD_WORD) {
+        return std::make_unique<ImmediateValue>(static_cast<long>(bits));
+    }
+    return std::make_unique<ImmediateValue>(static_cast<int>(static_cast<uint32_t>(bits)));
+}
+
+std::optional<uint64_t> AssemblyGenerator::get_integer_constant(tacky::Value& value)
+{
+    auto constant = dynamic_cast<tacky::Constant*>(&value);
+    if (!constant) {
+        return std::nullopt;
+    }
+    return std::visit([](auto v) -> std::optional<uint64_t> {
+        using T = decltype(v);
+        if constexpr (std::is_integral_v<T>) {
+            // Sign extended, the low bits are the same whatever the width
+            return static_cast<uint64_t>(static_cast<int64_t>(v));
+        } else {
+            return std::nullopt;
+        }
+    },
+        constant->value);
+}
+
 std::vector<std::unique_ptr<Instruction>> AssemblyGenerator::transform_jump_instruction(tacky::Instruction& instruction)
 {
     std::vector<std::unique_ptr<Instruction>> instructions;
@@ -570,38 +1092,166 @@ std::vector<std::unique_ptr<Instruction>> AssemblyGenerator::transform_jump_inst
         add_comment_instruction("jump_instruction", instructions);
         instructions.emplace_back(std::make_unique<JmpInstruction>(jump_instruction->identifier.name));
     } else if (tacky::JumpIfZeroInstruction* jump_if_zero_instruction = dynamic_cast<tacky::JumpIfZeroInstruction*>(&instruction)) {
-        auto [condition_type, _] = get_converted_operand_type(*jump_if_zero_instruction->condition);
-        bool is_double = (condition_type == AssemblyType::DOUBLE);
-        std::unique_ptr<Operand> cond = transform_operand(*jump_if_zero_instruction->condition);
         add_comment_instruction("jump_if_zero_instruction", instructions);
-        if (is_double) {
-            // zero-out XMM0
-            instructions.emplace_back(std::make_unique<BinaryInstruction>(BinaryOperator::XOR, condition_type, std::make_unique<Register>(RegisterName::XMM0), std::make_unique<Register>(RegisterName::XMM0)));
-            instructions.emplace_back(std::make_unique<CmpInstruction>(condition_type, std::make_unique<Register>(RegisterName::XMM0), std::move(cond)));
-        } else {
-            instructions.emplace_back(std::make_unique<CmpInstruction>(condition_type, std::make_unique<ImmediateValue>(0), std::move(cond)));
-        }
-
-        instructions.emplace_back(std::make_unique<JmpCCInstruction>(ConditionCode::E, jump_if_zero_instruction->identifier.name));
+        emit_flags_jump(emit_nonzero_flags(*jump_if_zero_instruction->condition, instructions), false, jump_if_zero_instruction->identifier.name, instructions);
     } else if (tacky::JumpIfNotZeroInstruction* jump_if_not_zero_instruction = dynamic_cast<tacky::JumpIfNotZeroInstruction*>(&instruction)) {
-        auto [condition_type, _] = get_converted_operand_type(*jump_if_not_zero_instruction->condition);
-        bool is_double = (condition_type == AssemblyType::DOUBLE);
-        std::unique_ptr<Operand> cond = transform_operand(*jump_if_not_zero_instruction->condition);
         add_comment_instruction("jump_if_not_zero_instruction", instructions);
-        if (is_double) {
-            // zero-out XMM0
-            instructions.emplace_back(std::make_unique<BinaryInstruction>(BinaryOperator::XOR, AssemblyType::DOUBLE, std::make_unique<Register>(RegisterName::XMM0), std::make_unique<Register>(RegisterName::XMM0)));
-            instructions.emplace_back(std::make_unique<CmpInstruction>(condition_type, std::make_unique<Register>(RegisterName::XMM0), std::move(cond)));
-        } else {
-            instructions.emplace_back(std::make_unique<CmpInstruction>(condition_type, std::make_unique<ImmediateValue>(0), std::move(cond)));
-        }
-        instructions.emplace_back(std::make_unique<JmpCCInstruction>(ConditionCode::NE, jump_if_not_zero_instruction->identifier.name));
+        emit_flags_jump(emit_nonzero_flags(*jump_if_not_zero_instruction->condition, instructions), true, jump_if_not_zero_instruction->identifier.name, instructions);
     } else {
         assert(false && "AssemblyGenerator::transform_jump_instruction Invalid or Unsupported tacky::Instruction");
     }
     return instructions;
 }
 
+std::optional<std::vector<std::unique_ptr<Instruction>>> AssemblyGenerator::transform_compare_and_branch(tacky::Instruction& condition, tacky::Instruction& user)
+{
+    tacky::Value* tested = nullptr;
+    const std::string* target = nullptr;
+    bool jump_if_zero = false;
+    auto select = dynamic_cast<tacky::SelectInstruction*>(&user);
+    if (auto jump_if_zero_instruction = dynamic_cast<tacky::JumpIfZeroInstruction*>(&user)) {
+        tested = jump_if_zero_instruction->condition.get();
+        target = &jump_if_zero_instruction->identifier.name;
+        jump_if_zero = true;
+    } else if (auto jump_if_not_zero_instruction = dynamic_cast<tacky::JumpIfNotZeroInstruction*>(&user)) {
+        tested = jump_if_not_zero_instruction->condition.get();
+        target = &jump_if_not_zero_instruction->identifier.name;
+    } else if (select) {
+        tested = select->condition.get();
+    } else {
+        return std::nullopt;
+    }
+
+    // The result must be dead after the jump or the select, nothing else may read it, not even through a pointer
+    auto variable = dynamic_cast<tacky::TemporaryVariable*>(tested);
+    if (!variable || m_use_counts[variable->identifier.name] != 1 || m_aliased_variables.contains(variable->identifier.name)) {
+        return std::nullopt;
+    }
+    auto writes_tested = [&](const std::unique_ptr<tacky::Value>& destination) {
+        auto written = dynamic_cast<tacky::TemporaryVariable*>(destination.get());
+        return written && written->identifier.name == variable->identifier.name;
+    };
+
+    std::vector<std::unique_ptr<Instruction>> instructions;
+    FlagsCondition flags_condition;
+    if (auto binary = dynamic_cast<tacky::BinaryInstruction*>(&condition); binary && is_relational_operator(binary->binary_operator) && writes_tested(binary->destination)) {
+        add_comment_instruction(select ? "compare and select" : "compare and branch", instructions);
+        flags_condition = emit_relational_flags(binary->binary_operator, *binary->source1, *binary->source2, instructions);
+    } else if (auto unary = dynamic_cast<tacky::UnaryInstruction*>(&condition); unary && unary->unary_operator == tacky::UnaryOperator::NOT && writes_tested(unary->destination)) {
+        // !x is true when x is zero
+        add_comment_instruction(select ? "not and select" : "not and branch", instructions);
+        flags_condition = emit_nonzero_flags(*unary->source, instructions);
+        flags_condition.negated = !flags_condition.negated;
+    } else {
+        return std::nullopt;
+    }
+    if (select) {
+        emit_select(flags_condition, *select, instructions);
+        ++NumCompareAndSelectFused;
+    } else {
+        emit_flags_jump(flags_condition, !jump_if_zero, *target, instructions);
+        ++NumCompareAndBranchFused;
+    }
+    return instructions;
+}
+
+std::vector<std::unique_ptr<Instruction>> AssemblyGenerator::transform_select_instruction(tacky::SelectInstruction& select_instruction)
+{
+    std::vector<std::unique_ptr<Instruction>> instructions;
+    add_comment_instruction("select_instruction", instructions);
+    FlagsCondition flags_condition = emit_nonzero_flags(*select_instruction.condition, instructions);
+    emit_select(flags_condition, select_instruction, instructions);
+    return instructions;
+}
+
+AssemblyGenerator::FlagsCondition AssemblyGenerator::emit_relational_flags(tacky::BinaryOperator op, tacky::Value& source1, tacky::Value& source2, std::vector<std::unique_ptr<Instruction>>& instructions)
+{
+    auto [type, is_signed] = get_converted_operand_type(source1);
+    tacky::Value* left = &source1;
+    tacky::Value* right = &source2;
+    if (type == AssemblyType::DOUBLE && (op == tacky::BinaryOperator::LESS_THAN || op == tacky::BinaryOperator::LESS_OR_EQUAL)) {
+        // a < b as b > a: A and AE are false on unordered operands and their inverses BE and B are true, as
+        // !(a < b) is when either is NaN
+        std::swap(left, right);
+        op = op == tacky::BinaryOperator::LESS_THAN ? tacky::BinaryOperator::GREATER_THAN : tacky::BinaryOperator::GREATER_OR_EQUAL;
+    }
+    instructions.emplace_back(std::make_unique<CmpInstruction>(type, transform_operand(*right), transform_operand(*left)));
+    if (type == AssemblyType::DOUBLE && op == tacky::BinaryOperator::EQUAL) {
+        return { ConditionCode::NE, true, true };
+    } else if (type == AssemblyType::DOUBLE && op == tacky::BinaryOperator::NOT_EQUAL) {
+        return { ConditionCode::NE, true };
+    }
+    return { to_condition_code(op, is_signed) };
+}
+
+AssemblyGenerator::FlagsCondition AssemblyGenerator::emit_nonzero_flags(tacky::Value& value, std::vector<std::unique_ptr<Instruction>>& instructions)
+{
+    auto [type, _] = get_converted_operand_type(value);
+    std::unique_ptr<Operand> operand = transform_operand(value);
+    if (type == AssemblyType::DOUBLE) {
+        // zero-out XMM0
+        instructions.emplace_back(std::make_unique<BinaryInstruction>(BinaryOperator::XOR, AssemblyType::DOUBLE, std::make_unique<Register>(RegisterName::XMM0), std::make_unique<Register>(RegisterName::XMM0)));
+        instructions.emplace_back(std::make_unique<CmpInstruction>(type, std::make_unique<Register>(RegisterName::XMM0), std::move(operand)));
+        return { ConditionCode::NE, true };
+    }
+    instructions.emplace_back(std::make_unique<CmpInstruction>(type, std::make_unique<ImmediateValue>(0), std::move(operand)));
+    return { ConditionCode::NE };
+}
+
+void AssemblyGenerator::emit_flags_jump(const FlagsCondition& condition, bool jump_if_true, const std::string& target, std::vector<std::unique_ptr<Instruction>>& instructions)
+{
+    if (jump_if_true != condition.negated) {
+        instructions.emplace_back(std::make_unique<JmpCCInstruction>(condition.condition_code, target));
+        if (condition.also_unordered) {
+            instructions.emplace_back(std::make_unique<JmpCCInstruction>(ConditionCode::P, target));
+        }
+    } else if (condition.also_unordered) {
+        // Neither the condition code nor the parity flag may hold
+        std::string unordered_label = m_name_generator->make_label("unordered");
+        instructions.emplace_back(std::make_unique<JmpCCInstruction>(ConditionCode::P, unordered_label));
+        instructions.emplace_back(std::make_unique<JmpCCInstruction>(invert_condition_code(condition.condition_code), target));
+        instructions.emplace_back(std::make_unique<LabelInstruction>(unordered_label));
+    } else {
+        instructions.emplace_back(std::make_unique<JmpCCInstruction>(invert_condition_code(condition.condition_code), target));
+    }
+}
+
+void AssemblyGenerator::emit_select(const FlagsCondition& condition, tacky::SelectInstruction& select_instruction, std::vector<std::unique_ptr<Instruction>>& instructions)
+{
+    auto [type, _] = get_converted_operand_type(*select_instruction.destination);
+    tacky::Value* when_holds = select_instruction.true_value.get();
+    tacky::Value* otherwise = select_instruction.false_value.get();
+    if (condition.negated) {
+        std::swap(when_holds, otherwise);
+    }
+    auto emit_cmovs = [&](AssemblyType cmov_type, std::unique_ptr<Operand> source, RegisterName destination) {
+        if (condition.also_unordered) {
+            instructions.emplace_back(std::make_unique<CmovInstruction>(ConditionCode::P, cmov_type, source->clone(), std::make_unique<Register>(destination)));
+        }
+        instructions.emplace_back(std::make_unique<CmovInstruction>(condition.condition_code, cmov_type, std::move(source), std::make_unique<Register>(destination)));
+    };
+
+    if (type == AssemblyType::DOUBLE) {
+        // All ones in XMM0 when the condition holds, zero otherwise
+        instructions.emplace_back(std::make_unique<MovInstruction>(AssemblyType::QUAD_WORD, std::make_unique<ImmediateValue>(0l), std::make_unique<Register>(RegisterName::AX)));
+        instructions.emplace_back(std::make_unique<MovInstruction>(AssemblyType::QUAD_WORD, std::make_unique<ImmediateValue>(-1l), std::make_unique<Register>(RegisterName::CX)));
+        emit_cmovs(AssemblyType::QUAD_WORD, std::make_unique<Register>(RegisterName::CX), RegisterName::AX);
+        instructions.emplace_back(std::make_unique<MovInstruction>(AssemblyType::QUAD_WORD, std::make_unique<Register>(RegisterName::AX), std::make_unique<Register>(RegisterName::XMM0)));
+        instructions.emplace_back(std::make_unique<MovInstruction>(AssemblyType::DOUBLE, transform_operand(*when_holds), std::make_unique<Register>(RegisterName::XMM1)));
+        instructions.emplace_back(std::make_unique<BinaryInstruction>(BinaryOperator::AND, AssemblyType::DOUBLE, std::make_unique<Register>(RegisterName::XMM0), std::make_unique<Register>(RegisterName::XMM1)));
+        instructions.emplace_back(std::make_unique<BinaryInstruction>(BinaryOperator::AND_NOT, AssemblyType::DOUBLE, transform_operand(*otherwise), std::make_unique<Register>(RegisterName::XMM0)));
+        instructions.emplace_back(std::make_unique<BinaryInstruction>(BinaryOperator::OR, AssemblyType::DOUBLE, std::make_unique<Register>(RegisterName::XMM1), std::make_unique<Register>(RegisterName::XMM0)));
+        instructions.emplace_back(std::make_unique<MovInstruction>(AssemblyType::DOUBLE, std::make_unique<Register>(RegisterName::XMM0), transform_operand(*select_instruction.destination)));
+    } else if (type == AssemblyType::LONG_WORD || type == AssemblyType::QUAD_WORD) {
+        instructions.emplace_back(std::make_unique<MovInstruction>(type, transform_operand(*otherwise), std::make_unique<Register>(RegisterName::AX)));
+        emit_cmovs(type, transform_operand(*when_holds), RegisterName::AX);
+        instructions.emplace_back(std::make_unique<MovInstruction>(type, std::make_unique<Register>(RegisterName::AX), transform_operand(*select_instruction.destination)));
+    } else {
+        // cmov has no byte form, IfConversion leaves char variables alone
+        throw AssemblyGeneratorError("AssemblyGenerator: select on a byte value");
+    }
+}
+
 std::vector<std::unique_ptr<Instruction>> AssemblyGenerator::transform_function_call_instruction(tacky::FunctionCallInstruction& function_call_instruction)
 {
     std::vector<std::unique_ptr<Instruction>> instructions;
@@ -779,14 +1429,40 @@ std::unique_ptr<FunctionDefinition> AssemblyGenerator::transform_function(tacky:
         stack_offset += 8;
     }
 
-    add_comment_instruction("function_definition body", instructions);
+    m_use_counts.clear();
     for (auto& i : function_definition.body) {
-        std::vector<std::unique_ptr<Instruction>> tmp_instrucitons = transform_instruction(*i);
+        for (auto value : tacky::used_values(*i)) {
+            if (auto variable = dynamic_cast<tacky::TemporaryVariable*>(value->get())) {
+                ++m_use_counts[variable->identifier.name];
+            }
+        }
+    }
+    m_aliased_variables = tacky::aliased_variables(function_definition, *m_symbol_table);
+    collect_frame_addresses(function_definition);
+
+    add_comment_instruction("function_definition body", instructions);
+    auto& body = function_definition.body;
+    for (size_t i = 0; i < body.size(); ++i) {
+        std::vector<std::unique_ptr<Instruction>> tmp_instrucitons;
+        std::optional<SourceLocationIndex> source_location = body[i]->source_location;
+        bool is_add_pointer = dynamic_cast<tacky::AddPointerInstruction*>(body[i].get());
+        if (auto fused = i + 1 < body.size() ? transform_compare_and_branch(*body[i], *body[i + 1]) : std::nullopt) {
+            tmp_instrucitons = std::move(*fused);
+            ++i;
+        } else if (auto folded = is_add_pointer ? transform_indexed_access(body, i) : std::nullopt) {
+            tmp_instrucitons = std::move(folded->first);
+            i = folded->second;
+        } else {
+            tmp_instrucitons = transform_instruction(*body[i]);
+        }
         for (auto& tmp_i : tmp_instrucitons) {
+            tmp_i->source_location = source_location;
             instructions.push_back(std::move(tmp_i));
         }
     }
-    return std::make_unique<FunctionDefinition>(function_definition.name.name, function_definition.global, std::move(instructions));
+    auto assembly_function = std::make_unique<FunctionDefinition>(function_definition.name.name, function_definition.global, std::move(instructions));
+    assembly_function->source_location = function_definition.source_location;
+    return assembly_function;
 }
 
 std::unique_ptr<TopLevel> AssemblyGenerator::transform_top_level(tacky::TopLevel& top_level)
@@ -857,6 +1533,39 @@ ConditionCode AssemblyGenerator::to_condition_code(tacky::BinaryOperator op, boo
     }
 }
 
+ConditionCode AssemblyGenerator::invert_condition_code(ConditionCode condition_code)
+{
+    switch (condition_code) {
+    case ConditionCode::E:
+        return ConditionCode::NE;
+    case ConditionCode::NE:
+        return ConditionCode::E;
+    case ConditionCode::G:
+        return ConditionCode::LE;
+    case ConditionCode::GE:
+        return ConditionCode::L;
+    case ConditionCode::L:
+        return ConditionCode::GE;
+    case ConditionCode::LE:
+        return ConditionCode::G;
+    case ConditionCode::A:
+        return ConditionCode::BE;
+    case ConditionCode::AE:
+        return ConditionCode::B;
+    case ConditionCode::B:
+        return ConditionCode::AE;
+    case ConditionCode::BE:
+        return ConditionCode::A;
+    case ConditionCode::P:
+        return ConditionCode::NP;
+    case ConditionCode::NP:
+        return ConditionCode::P;
+    default:
+        assert(false && "AssemblyGenerator::invert_condition_code invalid condition code");
+        return ConditionCode::NONE;
+    }
+}
+
 std::unique_ptr<Type> AssemblyGenerator::get_operand_type(tacky::Value& operand)
 {
     if (tacky::Constant* tacky_constant = dynamic_cast<tacky::Constant*>(&operand)) {
@@ -931,6 +1640,9 @@ std::string AssemblyGenerator::add_static_double_constant(double val, size_t ali
         init.values = { StaticInitialValueType(val) };
         m_static_constants_map[label].second = std::make_unique<StaticConstant>(compact_label, alignment, init);
         m_backend_symbol_table->insert_symbol(compact_label, ObjectEntry { AssemblyType::DOUBLE, true, true });
+        ++NumStaticConstants;
+    } else {
+        ++NumStaticConstantsDeduplicated;
     }
     return m_static_constants_map[label].first;
 }
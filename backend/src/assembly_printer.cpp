@@ -97,6 +97,16 @@ std::string PrinterVisitor::register_name_to_string(RegisterName name)
         return "R10";
     case RegisterName::R11:
         return "R11";
+    case RegisterName::BX:
+        return "BX";
+    case RegisterName::R12:
+        return "R12";
+    case RegisterName::R13:
+        return "R13";
+    case RegisterName::R14:
+        return "R14";
+    case RegisterName::R15:
+        return "R15";
     case RegisterName::SP:
         return "SP";
     default:
@@ -262,6 +272,24 @@ void PrinterVisitor::visit(CmpInstruction& node)
     }
 }
 
+void PrinterVisitor::visit(TestInstruction& node)
+{
+    int id = get_node_id(&node);
+    m_dot_content << "  node" << id << " [label=\"TestInstruction\\ntype: " << assembly_type_to_string(node.type) << "\"];\n";
+
+    if (node.source) {
+        node.source->accept(*this);
+        m_dot_content << "  node" << id << " -> node" << get_node_id(node.source.get())
+                      << " [label=\"source\"];\n";
+    }
+
+    if (node.destination) {
+        node.destination->accept(*this);
+        m_dot_content << "  node" << id << " -> node" << get_node_id(node.destination.get())
+                      << " [label=\"destination\"];\n";
+    }
+}
+
 void PrinterVisitor::visit(IdivInstruction& node)
 {
     int id = get_node_id(&node);
@@ -274,6 +302,30 @@ void PrinterVisitor::visit(IdivInstruction& node)
     }
 }
 
+void PrinterVisitor::visit(ImulInstruction& node)
+{
+    int id = get_node_id(&node);
+    m_dot_content << "  node" << id << " [label=\"ImulInstruction\\ntype: " << assembly_type_to_string(node.type) << "\"];\n";
+
+    if (node.operand) {
+        node.operand->accept(*this);
+        m_dot_content << "  node" << id << " -> node" << get_node_id(node.operand.get())
+                      << " [label=\"operand\"];\n";
+    }
+}
+
+void PrinterVisitor::visit(MulInstruction& node)
+{
+    int id = get_node_id(&node);
+    m_dot_content << "  node" << id << " [label=\"MulInstruction\\ntype: " << assembly_type_to_string(node.type) << "\"];\n";
+
+    if (node.operand) {
+        node.operand->accept(*this);
+        m_dot_content << "  node" << id << " -> node" << get_node_id(node.operand.get())
+                      << " [label=\"operand\"];\n";
+    }
+}
+
 void PrinterVisitor::visit(CdqInstruction& node)
 {
     int id = get_node_id(&node);
@@ -316,6 +368,25 @@ void PrinterVisitor::visit(SetCCInstruction& node)
     }
 }
 
+void PrinterVisitor::visit(CmovInstruction& node)
+{
+    int id = get_node_id(&node);
+    m_dot_content << "  node" << id << " [label=\"CmovInstruction\\ncondition: "
+                  << operator_to_string(node.condition_code) << "\\ntype: " << assembly_type_to_string(node.type) << "\"];\n";
+
+    if (node.source) {
+        node.source->accept(*this);
+        m_dot_content << "  node" << id << " -> node" << get_node_id(node.source.get())
+                      << " [label=\"source\"];\n";
+    }
+
+    if (node.destination) {
+        node.destination->accept(*this);
+        m_dot_content << "  node" << id << " -> node" << get_node_id(node.destination.get())
+                      << " [label=\"destination\"];\n";
+    }
+}
+
 void PrinterVisitor::visit(LabelInstruction& node)
 {
     int id = get_node_id(&node);
@@ -339,6 +410,12 @@ void PrinterVisitor::visit(PushInstruction& node)
     }
 }
 
+void PrinterVisitor::visit(PopInstruction& node)
+{
+    int id = get_node_id(&node);
+    m_dot_content << "  node" << id << " [label=\"PopInstruction\\nregister: " << register_name_to_string(node.reg) << "\"];\n";
+}
+
 void PrinterVisitor::visit(CallInstruction& node)
 {
     int id = get_node_id(&node);
@@ -430,6 +507,12 @@ std::string PrinterVisitor::operator_to_string(BinaryOperator op)
         return "SUB";
     case BinaryOperator::MULT:
         return "MULT";
+    case BinaryOperator::SHL:
+        return "SHL";
+    case BinaryOperator::SAR:
+        return "SAR";
+    case BinaryOperator::SHR:
+        return "SHR";
     default:
         return "unknown";
     }
@@ -450,6 +533,18 @@ std::string PrinterVisitor::operator_to_string(ConditionCode cc)
         return "L";
     case ConditionCode::LE:
         return "LE";
+    case ConditionCode::A:
+        return "A";
+    case ConditionCode::AE:
+        return "AE";
+    case ConditionCode::B:
+        return "B";
+    case ConditionCode::BE:
+        return "BE";
+    case ConditionCode::P:
+        return "P";
+    case ConditionCode::NP:
+        return "NP";
     default:
         return "unknown";
     }
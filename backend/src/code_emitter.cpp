@@ -4,6 +4,7 @@
 #include "common/data/symbol_table.h"
 #include "common/data/type.h"
 #include "common/error/internal_compiler_error.h"
+#include "common/stats/statistic.h"
 #include <cassert>
 #include <filesystem>
 #include <format>
@@ -11,11 +12,22 @@
 
 using namespace backend;
 
-CodeEmitter::CodeEmitter(const std::string& output_file, std::shared_ptr<AssemblyAST> ast, std::shared_ptr<BackendSymbolTable> symbol_table)
-    : m_output_file { output_file }
-    , m_ast { ast }
+STATISTIC(NumPltCalls, "code-emitter", "Number of calls emitted through the PLT");
+
+CodeEmitter::CodeEmitter(std::shared_ptr<AssemblyAST> ast, std::shared_ptr<BackendSymbolTable> symbol_table)
+    : m_ast { ast }
     , m_symbol_table { symbol_table }
 {
+    if (!m_ast || !dynamic_cast<Program*>(m_ast.get())) {
+        throw CodeEmitterError("CodeEmitter: Invalid AST");
+    }
+}
+
+CodeEmitter::CodeEmitter(const std::string& output_file, std::shared_ptr<AssemblyAST> ast, std::shared_ptr<BackendSymbolTable> symbol_table)
+    : CodeEmitter(ast, symbol_table)
+{
+    m_output_file = output_file;
+
     namespace fs = std::filesystem;
 
     bool file_exists = fs::exists(m_output_file);
@@ -36,18 +48,19 @@ CodeEmitter::CodeEmitter(const std::string& output_file, std::shared_ptr<Assembl
         throw CodeEmitterError(std::format("CodeEmitter: Failed to check permissions for {}: {}",
             m_output_file, e.what()));
     }
-
-    if (!m_ast || !dynamic_cast<Program*>(m_ast.get())) {
-        throw CodeEmitterError("CodeEmitter: Invalid AST");
-    }
 }
 
 void CodeEmitter::emit_code()
 {
     std::ofstream file_stream(m_output_file, std::ios::out | std::ios::trunc);
-    m_file_stream = &file_stream;
+    emit_code(file_stream);
+}
 
+void CodeEmitter::emit_code(std::ostream& out)
+{
+    m_file_stream = &out;
     m_ast->accept(*this);
+    m_file_stream = nullptr;
 }
 
 void CodeEmitter::visit(ImmediateValue& node)
@@ -57,6 +70,9 @@ std::visit([this](auto&& value) {
     if constexpr (std::is_same_v<T, std::monostate>) {
         // Handle the "no value" case - maybe throw or use default
         *m_file_stream << "$0";  // or whatever default makes sense
+    } else if constexpr (std::is_same_v<T, char> || std::is_same_v<T, unsigned char>) {
+        // Print the numeric value, not the character
+        *m_file_stream << std::format("${}", static_cast<int>(value));
     } else {
         *m_file_stream << std::format("${}", value);
     }
@@ -210,6 +226,86 @@ void CodeEmitter::visit(Register& node)
         }
         break;
     }
+    case RegisterName::BX: {
+        switch (node.type) {
+        case AssemblyType::QUAD_WORD:
+            *m_file_stream << "%rbx";
+            break;
+        case AssemblyType::LONG_WORD:
+            *m_file_stream << "%ebx";
+            break;
+        case AssemblyType::BYTE:
+            *m_file_stream << "%bl";
+            break;
+        default:
+            throw CodeEmitterError("CodeEmitter: Unsupported RegisterType for BX");
+        }
+        break;
+    }
+    case RegisterName::R12: {
+        switch (node.type) {
+        case AssemblyType::QUAD_WORD:
+            *m_file_stream << "%r12";
+            break;
+        case AssemblyType::LONG_WORD:
+            *m_file_stream << "%r12d";
+            break;
+        case AssemblyType::BYTE:
+            *m_file_stream << "%r12b";
+            break;
+        default:
+            throw CodeEmitterError("CodeEmitter: Unsupported RegisterType for R12");
+        }
+        break;
+    }
+    case RegisterName::R13: {
+        switch (node.type) {
+        case AssemblyType::QUAD_WORD:
+            *m_file_stream << "%r13";
+            break;
+        case AssemblyType::LONG_WORD:
+            *m_file_stream << "%r13d";
+            break;
+        case AssemblyType::BYTE:
+            *m_file_stream << "%r13b";
+            break;
+        default:
+            throw CodeEmitterError("CodeEmitter: Unsupported RegisterType for R13");
+        }
+        break;
+    }
+    case RegisterName::R14: {
+        switch (node.type) {
+        case AssemblyType::QUAD_WORD:
+            *m_file_stream << "%r14";
+            break;
+        case AssemblyType::LONG_WORD:
+            *m_file_stream << "%r14d";
+            break;
+        case AssemblyType::BYTE:
+            *m_file_stream << "%r14b";
+            break;
+        default:
+            throw CodeEmitterError("CodeEmitter: Unsupported RegisterType for R14");
+        }
+        break;
+    }
+    case RegisterName::R15: {
+        switch (node.type) {
+        case AssemblyType::QUAD_WORD:
+            *m_file_stream << "%r15";
+            break;
+        case AssemblyType::LONG_WORD:
+            *m_file_stream << "%r15d";
+            break;
+        case AssemblyType::BYTE:
+            *m_file_stream << "%r15b";
+            break;
+        default:
+            throw CodeEmitterError("CodeEmitter: Unsupported RegisterType for R15");
+        }
+        break;
+    }
     case RegisterName::SP: {
         *m_file_stream << "%rsp";
         break;
@@ -245,6 +341,24 @@ void CodeEmitter::visit(Register& node)
     case RegisterName::XMM7:
         *m_file_stream << "%xmm7";
         break;
+    case RegisterName::XMM8:
+        *m_file_stream << "%xmm8";
+        break;
+    case RegisterName::XMM9:
+        *m_file_stream << "%xmm9";
+        break;
+    case RegisterName::XMM10:
+        *m_file_stream << "%xmm10";
+        break;
+    case RegisterName::XMM11:
+        *m_file_stream << "%xmm11";
+        break;
+    case RegisterName::XMM12:
+        *m_file_stream << "%xmm12";
+        break;
+    case RegisterName::XMM13:
+        *m_file_stream << "%xmm13";
+        break;
     case RegisterName::XMM14:
         *m_file_stream << "%xmm14";
         break;
@@ -363,6 +477,12 @@ void CodeEmitter::visit(BinaryInstruction& node)
 {
     if (node.binary_operator == BinaryOperator::XOR && node.type == AssemblyType::DOUBLE) {
         *m_file_stream << std::format("\txorpd\t");
+    } else if (node.binary_operator == BinaryOperator::AND && node.type == AssemblyType::DOUBLE) {
+        *m_file_stream << std::format("\tandpd\t");
+    } else if (node.binary_operator == BinaryOperator::OR && node.type == AssemblyType::DOUBLE) {
+        *m_file_stream << std::format("\torpd\t");
+    } else if (node.binary_operator == BinaryOperator::AND_NOT && node.type == AssemblyType::DOUBLE) {
+        *m_file_stream << std::format("\tandnpd\t");
     } else if (node.binary_operator == BinaryOperator::MULT && node.type == AssemblyType::DOUBLE) {
         *m_file_stream << std::format("\tmulsd\t");
     } else {
@@ -387,6 +507,15 @@ void CodeEmitter::visit(CmpInstruction& node)
     *m_file_stream << "\n";
 }
 
+void CodeEmitter::visit(TestInstruction& node)
+{
+    *m_file_stream << std::format("\ttest{}\t", to_instruction_suffix(node.type));
+    node.source->accept(*this);
+    *m_file_stream << ",\t";
+    node.destination->accept(*this);
+    *m_file_stream << "\n";
+}
+
 void CodeEmitter::visit(IdivInstruction& node)
 {
     *m_file_stream << std::format("\tidiv{}\t", to_instruction_suffix(node.type));
@@ -401,6 +530,20 @@ void CodeEmitter::visit(DivInstruction& node)
     *m_file_stream << "\n";
 }
 
+void CodeEmitter::visit(ImulInstruction& node)
+{
+    *m_file_stream << std::format("\timul{}\t", to_instruction_suffix(node.type));
+    node.operand->accept(*this);
+    *m_file_stream << "\n";
+}
+
+void CodeEmitter::visit(MulInstruction& node)
+{
+    *m_file_stream << std::format("\tmul{}\t", to_instruction_suffix(node.type));
+    node.operand->accept(*this);
+    *m_file_stream << "\n";
+}
+
 void CodeEmitter::visit(CdqInstruction& node)
 {
     if (node.type == AssemblyType::LONG_WORD) {
@@ -429,6 +572,15 @@ void CodeEmitter::visit(SetCCInstruction& node)
     *m_file_stream << "\n";
 }
 
+void CodeEmitter::visit(CmovInstruction& node)
+{
+    *m_file_stream << std::format("\tcmov{}{}\t", to_instruction_suffix(node.condition_code), to_instruction_suffix(node.type));
+    node.source->accept(*this);
+    *m_file_stream << ",\t";
+    node.destination->accept(*this);
+    *m_file_stream << "\n";
+}
+
 void CodeEmitter::visit(LabelInstruction& node)
 {
     *m_file_stream << std::format(".L{}:\n", node.identifier.name);
@@ -440,6 +592,14 @@ void CodeEmitter::visit(PushInstruction& node)
     node.destination->accept(*this);
     *m_file_stream << "\n";
 }
+
+void CodeEmitter::visit(PopInstruction& node)
+{
+    Register reg(node.reg, AssemblyType::QUAD_WORD);
+    *m_file_stream << "\tpopq\t";
+    reg.accept(*this);
+    *m_file_stream << "\n";
+}
 void CodeEmitter::visit(CallInstruction& node)
 {
     *m_file_stream << std::format("\tcall\t{}\n", get_function_name(node.identifier.name));
@@ -592,6 +752,14 @@ std::string CodeEmitter::operator_instruction(BinaryOperator op)
         return "and";
     case BinaryOperator::OR:
         return "or";
+    case BinaryOperator::XOR:
+        return "xor";
+    case BinaryOperator::SHL:
+        return "shl";
+    case BinaryOperator::SAR:
+        return "sar";
+    case BinaryOperator::SHR:
+        return "shr";
     default:
         throw CodeEmitterError("CodeEmitter: Unsupported BinaryOperator");
     }
@@ -620,6 +788,10 @@ std::string CodeEmitter::to_instruction_suffix(ConditionCode cc)
         return "b";
     case ConditionCode::BE:
         return "be";
+    case ConditionCode::P:
+        return "p";
+    case ConditionCode::NP:
+        return "np";
     default:
         assert(false);
     }
@@ -647,6 +819,9 @@ std::string CodeEmitter::get_function_name(const std::string& in_name)
 {
     const auto& fun_attr = std::get<FunctionEntry>(m_symbol_table->symbol_at(in_name));
     std::string suffix = fun_attr.defined ? "" : "@PLT";
+    if (!fun_attr.defined) {
+        ++NumPltCalls;
+    }
     return in_name + suffix;
 }
 
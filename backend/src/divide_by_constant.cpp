@@ -0,0 +1,157 @@
+#include "backend/divide_by_constant.h"
+#include <bit>
+
+using namespace backend;
+
+namespace {
+
+using uint128 = unsigned __int128;
+using int128 = __int128;
+
+uint64_t width_mask(int width)
+{
+    return width == 64 ? ~uint64_t { 0 } : (uint64_t { 1 } << width) - 1;
+}
+
+int64_t sign_extend(uint64_t value, int width)
+{
+    return width == 64 ? static_cast<int64_t>(value) : static_cast<int64_t>(static_cast<int32_t>(static_cast<uint32_t>(value)));
+}
+
+uint64_t shift_right_arithmetic(uint64_t value, int shift, int width)
+{
+    return static_cast<uint64_t>(sign_extend(value, width) >> shift) & width_mask(width);
+}
+
+uint64_t multiply_high(uint64_t a, uint64_t b, int width)
+{
+    return static_cast<uint64_t>((static_cast<uint128>(a) * b) >> width) & width_mask(width);
+}
+
+uint64_t signed_multiply_high(uint64_t a, uint64_t b, int width)
+{
+    int128 product = static_cast<int128>(sign_extend(a, width)) * sign_extend(b, width);
+    return static_cast<uint64_t>(product >> width) & width_mask(width);
+}
+
+DivisionPlan plan_unsigned(uint64_t divisor, int width)
+{
+    if (std::has_single_bit(divisor)) {
+        int shift = std::countr_zero(divisor);
+        return { shift == 0 ? DivisionPlan::Kind::IDENTITY : DivisionPlan::Kind::SHIFT, 0, shift };
+    }
+
+    // With l = ceil(log2 d), a magic m such that 2^(N+p) <= m * d <= 2^(N+p) + 2^p gives x / d = mulhi(x, m) >>> p,
+    // the smallest p whose magic fits in N bits is taken
+    int l = std::bit_width(divisor - 1);
+    for (int p = 0; p < l; ++p) {
+        uint128 power = static_cast<uint128>(1) << (width + p);
+        uint128 magic = (power + divisor - 1) / divisor;
+        if (magic * divisor - power <= (static_cast<uint128>(1) << p) && magic <= width_mask(width)) {
+            return { DivisionPlan::Kind::MULTIPLY_HIGH, static_cast<uint64_t>(magic), p };
+        }
+    }
+    // The magic for p = l always satisfies the bound but takes N+1 bits, only its low N bits are multiplied and
+    // the top one is added back as x
+    uint128 low_magic = (static_cast<uint128>(1) << width) * ((static_cast<uint128>(1) << l) - divisor) / divisor + 1;
+    return { DivisionPlan::Kind::MULTIPLY_HIGH_ADD, static_cast<uint64_t>(low_magic), l };
+}
+
+DivisionPlan plan_signed(uint64_t divisor, int width)
+{
+    uint64_t mask = width_mask(width);
+    int64_t value = sign_extend(divisor, width);
+    // |d| as an unsigned value, right for the most negative divisor too
+    uint64_t magnitude = (value < 0 ? 0 - divisor : divisor) & mask;
+    if (magnitude == 1) {
+        return { value < 0 ? DivisionPlan::Kind::NEGATE : DivisionPlan::Kind::IDENTITY };
+    }
+    if (std::has_single_bit(magnitude)) {
+        DivisionPlan plan { DivisionPlan::Kind::SIGNED_SHIFT, 0, std::countr_zero(magnitude) };
+        plan.negate = value < 0;
+        return plan;
+    }
+
+    // Hacker's Delight, figure 10-1, in unsigned N bit arithmetic
+    uint64_t sign_bit = uint64_t { 1 } << (width - 1);
+    uint64_t t = sign_bit + (value < 0 ? 1 : 0);
+    uint64_t anc = t - 1 - t % magnitude;
+    int p = width - 1;
+    uint64_t q1 = sign_bit / anc;
+    uint64_t r1 = sign_bit - q1 * anc;
+    uint64_t q2 = sign_bit / magnitude;
+    uint64_t r2 = sign_bit - q2 * magnitude;
+    uint64_t delta;
+    do {
+        ++p;
+        q1 = (2 * q1) & mask;
+        r1 = (2 * r1) & mask;
+        if (r1 >= anc) {
+            q1 = (q1 + 1) & mask;
+            r1 = (r1 - anc) & mask;
+        }
+        q2 = (2 * q2) & mask;
+        r2 = (2 * r2) & mask;
+        if (r2 >= magnitude) {
+            q2 = (q2 + 1) & mask;
+            r2 = (r2 - magnitude) & mask;
+        }
+        delta = magnitude - r2;
+    } while (q1 < delta || (q1 == delta && r1 == 0));
+
+    uint64_t magic = (q2 + 1) & mask;
+    if (value < 0) {
+        magic = (0 - magic) & mask;
+    }
+    DivisionPlan plan { DivisionPlan::Kind::SIGNED_MULTIPLY_HIGH, magic, p - width };
+    int64_t signed_magic = sign_extend(magic, width);
+    if (value > 0 && signed_magic < 0) {
+        plan.correction = 1;
+    } else if (value < 0 && signed_magic > 0) {
+        plan.correction = -1;
+    }
+    return plan;
+}
+
+}
+
+std::optional<DivisionPlan> backend::plan_divide_by_constant(uint64_t divisor, int width, bool is_signed)
+{
+    divisor &= width_mask(width);
+    if (divisor == 0) {
+        return std::nullopt;
+    }
+    return is_signed ? plan_signed(divisor, width) : plan_unsigned(divisor, width);
+}
+
+uint64_t backend::evaluate_division_plan(const DivisionPlan& plan, uint64_t dividend, int width)
+{
+    uint64_t mask = width_mask(width);
+    uint64_t x = dividend & mask;
+    switch (plan.kind) {
+    case DivisionPlan::Kind::IDENTITY:
+        return x;
+    case DivisionPlan::Kind::NEGATE:
+        return (0 - x) & mask;
+    case DivisionPlan::Kind::SHIFT:
+        return x >> plan.shift;
+    case DivisionPlan::Kind::SIGNED_SHIFT: {
+        uint64_t bias = shift_right_arithmetic(x, width - 1, width) >> (width - plan.shift);
+        uint64_t quotient = shift_right_arithmetic((x + bias) & mask, plan.shift, width);
+        return plan.negate ? (0 - quotient) & mask : quotient;
+    }
+    case DivisionPlan::Kind::MULTIPLY_HIGH:
+        return multiply_high(x, plan.magic, width) >> plan.shift;
+    case DivisionPlan::Kind::MULTIPLY_HIGH_ADD: {
+        uint64_t high = multiply_high(x, plan.magic, width);
+        return (((x - high) >> 1) + high) >> (plan.shift - 1);
+    }
+    case DivisionPlan::Kind::SIGNED_MULTIPLY_HIGH: {
+        uint64_t quotient = signed_multiply_high(x, plan.magic, width);
+        quotient = (quotient + static_cast<uint64_t>(plan.correction) * x) & mask;
+        quotient = shift_right_arithmetic(quotient, plan.shift, width);
+        return (quotient + (quotient >> (width - 1))) & mask;
+    }
+    }
+    return x;
+}
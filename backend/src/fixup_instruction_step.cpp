@@ -1,12 +1,32 @@
 #include "backend/fixup_instruction_step.h"
 #include "backend/assembly_ast.h"
 #include "backend/backend_symbol_table.h"
+#include "common/stats/statistic.h"
 #include <cstdint>
 #include <memory>
 #include <variant>
 
 using namespace backend;
 
+STATISTIC(NumMovFixups, "fixup", "Number of instructions inserted to fix up mov instructions");
+STATISTIC(NumCmpFixups, "fixup", "Number of instructions inserted to fix up cmp instructions");
+STATISTIC(NumBinaryFixups, "fixup", "Number of instructions inserted to fix up binary instructions");
+STATISTIC(NumDivFixups, "fixup", "Number of instructions inserted to fix up div/idiv instructions");
+STATISTIC(NumMovsxFixups, "fixup", "Number of instructions inserted to fix up movsx instructions");
+STATISTIC(NumMovZeroExtendFixups, "fixup", "Number of instructions inserted to fix up zero extend instructions");
+STATISTIC(NumPushFixups, "fixup", "Number of instructions inserted to fix up push instructions");
+STATISTIC(NumCvtFixups, "fixup", "Number of instructions inserted to fix up cvttsd2si/cvtsi2sd instructions");
+STATISTIC(NumLeaFixups, "fixup", "Number of instructions inserted to fix up lea instructions");
+STATISTIC(NumCmovFixups, "fixup", "Number of instructions inserted to fix up cmov instructions");
+
+// Counts the instructions a fixup added next to the one it rewrote
+static void count_fixup(stats::Statistic& statistic, size_t before, size_t after)
+{
+    if (after - before > 1) {
+        statistic += after - before - 1;
+    }
+}
+
 FixUpInstructionsStep::FixUpInstructionsStep(std::shared_ptr<AssemblyAST> ast, std::shared_ptr<BackendSymbolTable> symbol_table)
     : m_ast { ast }
     , m_symbol_table { symbol_table }
@@ -27,17 +47,37 @@ void FixUpInstructionsStep::visit(FunctionDefinition& node)
     std::vector<std::unique_ptr<Instruction>> tmp_instructions = std::move(node.instructions);
     node.instructions.clear();
 
+    const auto& function_entry = std::get<FunctionEntry>(m_symbol_table->symbol_at(node.name.name));
+    const auto& callee_saved = function_entry.callee_saved_registers;
+
     // Add stack frame allocation at the beginning using SUB instruction
-    // Stack space must be aligned to 16 bytes as required by x86-64 ABI
-    long stack_offset = round_up_to_16(std::get<FunctionEntry>(m_symbol_table->symbol_at(node.name.name)).stack_frame_size);
+    // Stack space must be aligned to 16 bytes as required by x86-64 ABI, the callee-saved registers are pushed
+    // right below the frame so they count towards the alignment
+    long saved_size = static_cast<long>(callee_saved.size()) * 8;
+    long stack_offset = static_cast<long>(round_up_to_16(function_entry.stack_frame_size + saved_size)) - saved_size;
     node.instructions.emplace_back(std::make_unique<BinaryInstruction>(
         BinaryOperator::SUB,
         AssemblyType::QUAD_WORD,
         std::make_unique<ImmediateValue>(stack_offset),
         std::make_unique<Register>(RegisterName::SP)));
+    for (RegisterName reg : callee_saved) {
+        node.instructions.emplace_back(std::make_unique<PushInstruction>(std::make_unique<Register>(reg, AssemblyType::QUAD_WORD)));
+    }
 
-    // Process each instruction and apply necessary fixups
+    // Process each instruction and apply necessary fixups, every return restores the callee-saved registers first
     std::vector<std::unique_ptr<Instruction>> tmp_instructions2;
+    if (!callee_saved.empty()) {
+        std::vector<std::unique_ptr<Instruction>> with_restores;
+        for (auto& instruction : tmp_instructions) {
+            if (dynamic_cast<ReturnInstruction*>(instruction.get())) {
+                for (auto it = callee_saved.rbegin(); it != callee_saved.rend(); ++it) {
+                    with_restores.emplace_back(std::make_unique<PopInstruction>(*it));
+                }
+            }
+            with_restores.emplace_back(std::move(instruction));
+        }
+        tmp_instructions = std::move(with_restores);
+    }
     fixup_instructions(tmp_instructions, tmp_instructions2);
 
     // Do another pass to fix new mov instructions
@@ -47,28 +87,46 @@ void FixUpInstructionsStep::visit(FunctionDefinition& node)
 void FixUpInstructionsStep::fixup_instructions(std::vector<std::unique_ptr<Instruction>>& old_instructions, std::vector<std::unique_ptr<Instruction>>& new_instructions)
 {
     for (auto& instruction : old_instructions) {
+        size_t before = new_instructions.size();
         if (dynamic_cast<MovInstruction*>(instruction.get())) {
             fixup_mov_instruction(instruction, new_instructions);
+            count_fixup(NumMovFixups, before, new_instructions.size());
         } else if (dynamic_cast<CmpInstruction*>(instruction.get())) {
             fixup_cmp_instruction(instruction, new_instructions);
+            count_fixup(NumCmpFixups, before, new_instructions.size());
         } else if (dynamic_cast<BinaryInstruction*>(instruction.get())) {
             fixup_binary_instruction(instruction, new_instructions);
+            count_fixup(NumBinaryFixups, before, new_instructions.size());
         } else if (dynamic_cast<IdivInstruction*>(instruction.get())) {
             fixup_idiv_instruction(instruction, new_instructions);
+            count_fixup(NumDivFixups, before, new_instructions.size());
         } else if (dynamic_cast<DivInstruction*>(instruction.get())) {
             fixup_div_instruction(instruction, new_instructions);
+            count_fixup(NumDivFixups, before, new_instructions.size());
+        } else if (dynamic_cast<ImulInstruction*>(instruction.get()) || dynamic_cast<MulInstruction*>(instruction.get())) {
+            fixup_widening_multiply_instruction(instruction, new_instructions);
+            count_fixup(NumBinaryFixups, before, new_instructions.size());
         } else if (dynamic_cast<MovsxInstruction*>(instruction.get())) {
             fixup_movsx_instruction(instruction, new_instructions);
+            count_fixup(NumMovsxFixups, before, new_instructions.size());
         } else if (dynamic_cast<MovZeroExtendInstruction*>(instruction.get())) {
             fixup_mov_zero_extend_instruction(instruction, new_instructions);
+            count_fixup(NumMovZeroExtendFixups, before, new_instructions.size());
         } else if (dynamic_cast<PushInstruction*>(instruction.get())) {
             fixup_push_instruction(instruction, new_instructions);
+            count_fixup(NumPushFixups, before, new_instructions.size());
         } else if (dynamic_cast<Cvttsd2siInstruction*>(instruction.get())) {
             fixup_cvttsd2si_instruction(instruction, new_instructions);
+            count_fixup(NumCvtFixups, before, new_instructions.size());
         } else if (dynamic_cast<Cvtsi2sdInstruction*>(instruction.get())) {
             fixup_cvtsi2sd_instruction(instruction, new_instructions);
+            count_fixup(NumCvtFixups, before, new_instructions.size());
+        } else if (dynamic_cast<CmovInstruction*>(instruction.get())) {
+            fixup_cmov_instruction(instruction, new_instructions);
+            count_fixup(NumCmovFixups, before, new_instructions.size());
         } else if (dynamic_cast<LeaInstruction*>(instruction.get())) {
             fixup_lea_instruction(instruction, new_instructions);
+            count_fixup(NumLeaFixups, before, new_instructions.size());
         } else {
             // No fixup needed for other instruction types
             new_instructions.emplace_back(std::move(instruction));
@@ -111,7 +169,7 @@ void FixUpInstructionsStep::fixup_mov_instruction(std::unique_ptr<Instruction>&
                 } else if (original_type == AssemblyType::BYTE) {
                     // For movb instructions, truncate to avoid assembler warnings
                     imm_val->value = static_cast<char>(value);
-                } else if (dynamic_cast<MemoryAddress*>(mov_instruction->destination.get()) || dynamic_cast<DataOperand*>(mov_instruction->destination.get())) {
+                } else if (mov_instruction->destination->is_memory()) {
                     // movq can move large immediates to registers but not directly to memory
                     // Use two-step process: immediate -> R10 -> memory
                     instructions.emplace_back(std::make_unique<MovInstruction>(
@@ -131,7 +189,7 @@ void FixUpInstructionsStep::fixup_mov_instruction(std::unique_ptr<Instruction>&
                 } else if (original_type == AssemblyType::BYTE) {
                     // For movb instructions, truncate to avoid assembler warnings
                     imm_val->value = static_cast<char>(value);
-                } else if (dynamic_cast<MemoryAddress*>(mov_instruction->destination.get()) || dynamic_cast<DataOperand*>(mov_instruction->destination.get())) {
+                } else if (mov_instruction->destination->is_memory()) {
                     // movq can move large immediates to registers but not directly to memory
                     // Use two-step process: immediate -> R10 -> memory
                     instructions.emplace_back(std::make_unique<MovInstruction>(
@@ -150,7 +208,7 @@ void FixUpInstructionsStep::fixup_mov_instruction(std::unique_ptr<Instruction>&
                 } else if (original_type == AssemblyType::BYTE) {
                     // For movb instructions, truncate to avoid assembler warnings
                     imm_val->value = static_cast<char>(value);
-                } else if (dynamic_cast<MemoryAddress*>(mov_instruction->destination.get()) || dynamic_cast<DataOperand*>(mov_instruction->destination.get())) {
+                } else if (mov_instruction->destination->is_memory()) {
                     // movq can move large immediates to registers but not directly to memory
                     // Use two-step process: immediate -> R10 -> memory
                     instructions.emplace_back(std::make_unique<MovInstruction>(
@@ -256,6 +314,16 @@ void FixUpInstructionsStep::fixup_binary_instruction(std::unique_ptr<Instruction
 
     // For ALL floating-point binary operations
     if (type == AssemblyType::DOUBLE) {
+        // andpd, andnpd and orpd read 16 bytes from memory and fault unless they are aligned, only the 8 byte
+        // double goes through a register
+        BinaryOperator op = binary_instruction->binary_operator;
+        if ((op == BinaryOperator::AND || op == BinaryOperator::OR || op == BinaryOperator::AND_NOT) && binary_instruction->source->is_memory()) {
+            instructions.emplace_back(std::make_unique<MovInstruction>(
+                type,
+                std::move(binary_instruction->source),
+                std::make_unique<Register>(RegisterName::XMM15)));
+            binary_instruction->source = std::make_unique<Register>(RegisterName::XMM15);
+        }
         // The destination of an addsd, subsd, mulsd, divsd, or xorpd instruction must be a register
         if (!dynamic_cast<Register*>(binary_instruction->destination.get())) {
             std::unique_ptr<Operand> destination_copy = binary_instruction->destination->clone();
@@ -327,7 +395,7 @@ void FixUpInstructionsStep::fixup_binary_instruction(std::unique_ptr<Instruction
         }
 
         instructions.emplace_back(std::move(instruction));
-    } else if (binary_instruction->binary_operator == BinaryOperator::MULT) {
+    } else if (binary_instruction->binary_operator == BinaryOperator::MULT && !dynamic_cast<Register*>(binary_instruction->destination.get())) {
         // IMUL cannot use memory addresses as destination operand
         // Use three-step process: load dest -> R11, perform imul, store R11 -> original dest
         std::unique_ptr<Operand> destination_copy = binary_instruction->destination->clone();
@@ -382,6 +450,27 @@ void FixUpInstructionsStep::fixup_div_instruction(std::unique_ptr<Instruction>&
     instructions.emplace_back(std::move(instruction));
 }
 
+void FixUpInstructionsStep::fixup_widening_multiply_instruction(std::unique_ptr<Instruction>& instruction, std::vector<std::unique_ptr<Instruction>>& instructions)
+{
+    // The one operand forms of IMUL and MUL cannot operate on immediate values either
+    std::unique_ptr<Operand>* operand;
+    AssemblyType type;
+    if (auto imul_instruction = dynamic_cast<ImulInstruction*>(instruction.get())) {
+        operand = &imul_instruction->operand;
+        type = imul_instruction->type;
+    } else {
+        auto mul_instruction = dynamic_cast<MulInstruction*>(instruction.get());
+        operand = &mul_instruction->operand;
+        type = mul_instruction->type;
+    }
+    if (dynamic_cast<ImmediateValue*>(operand->get())) {
+        instructions.emplace_back(std::make_unique<MovInstruction>(type, std::move(*operand), std::make_unique<Register>(RegisterName::R10)));
+        *operand = std::make_unique<Register>(RegisterName::R10, type);
+    }
+
+    instructions.emplace_back(std::move(instruction));
+}
+
 void FixUpInstructionsStep::fixup_push_instruction(std::unique_ptr<Instruction>& instruction, std::vector<std::unique_ptr<Instruction>>& instructions)
 {
     auto push_instruction = dynamic_cast<PushInstruction*>(instruction.get());
@@ -487,9 +576,9 @@ void FixUpInstructionsStep::fixup_movsx_instruction(std::unique_ptr<Instruction>
     bool dest_is_memory = movsx_instruction->destination->is_memory();
 
     if (dest_is_memory) {
-        // Store original destination for final move (result is 8 bytes, so use QUAD_WORD)
+        // Store original destination for final move, with the width of the extended result
         additional_instruction = std::make_unique<MovInstruction>(
-            AssemblyType::QUAD_WORD,
+            movsx_instruction->destination_type,
             std::make_unique<Register>(RegisterName::R11),
             std::move(movsx_instruction->destination));
         movsx_instruction->destination = std::make_unique<Register>(RegisterName::R11, movsx_instruction->destination_type);
@@ -542,10 +631,10 @@ void FixUpInstructionsStep::fixup_mov_zero_extend_instruction(std::unique_ptr<In
             if (dest_is_memory) {
                 // Store the original destination for the final move
                 final_move = std::make_unique<MovInstruction>(
-                    AssemblyType::LONG_WORD, // movzbl produces a 32-bit result
-                    std::make_unique<Register>(RegisterName::R11, AssemblyType::LONG_WORD),
+                    mov_zero_extend_instruction->destination_type,
+                    std::make_unique<Register>(RegisterName::R11),
                     std::move(mov_zero_extend_instruction->destination));
-                mov_zero_extend_instruction->destination = std::make_unique<Register>(RegisterName::R11, AssemblyType::LONG_WORD);
+                mov_zero_extend_instruction->destination = std::make_unique<Register>(RegisterName::R11, mov_zero_extend_instruction->destination_type);
             }
 
             // Step 3: Add the fixed movzbl instruction
@@ -565,6 +654,38 @@ void FixUpInstructionsStep::fixup_mov_zero_extend_instruction(std::unique_ptr<In
     }
 }
 
+void FixUpInstructionsStep::fixup_cmov_instruction(std::unique_ptr<Instruction>& instruction, std::vector<std::unique_ptr<Instruction>>& instructions)
+{
+    auto cmov_instruction = dynamic_cast<CmovInstruction*>(instruction.get());
+    auto type = cmov_instruction->type;
+
+    // cmov has no immediate form
+    if (dynamic_cast<ImmediateValue*>(cmov_instruction->source.get())) {
+        instructions.emplace_back(std::make_unique<MovInstruction>(
+            type,
+            std::move(cmov_instruction->source),
+            std::make_unique<Register>(RegisterName::R10)));
+        cmov_instruction->source = std::make_unique<Register>(RegisterName::R10, type);
+    }
+
+    // The destination of cmov must be a register, it is read too so it is loaded first
+    if (!dynamic_cast<Register*>(cmov_instruction->destination.get())) {
+        std::unique_ptr<Operand> destination_copy = cmov_instruction->destination->clone();
+        instructions.emplace_back(std::make_unique<MovInstruction>(
+            type,
+            std::move(cmov_instruction->destination),
+            std::make_unique<Register>(RegisterName::R11)));
+        cmov_instruction->destination = std::make_unique<Register>(RegisterName::R11, type);
+        instructions.emplace_back(std::move(instruction));
+        instructions.emplace_back(std::make_unique<MovInstruction>(
+            type,
+            std::make_unique<Register>(RegisterName::R11),
+            std::move(destination_copy)));
+        return;
+    }
+    instructions.emplace_back(std::move(instruction));
+}
+
 void FixUpInstructionsStep::fixup_lea_instruction(std::unique_ptr<Instruction>& instruction, std::vector<std::unique_ptr<Instruction>>& instructions)
 {
     auto lea_instruction = dynamic_cast<LeaInstruction*>(instruction.get());
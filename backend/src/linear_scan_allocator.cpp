@@ -0,0 +1,272 @@
+#include "backend/linear_scan_allocator.h"
+#include "backend/assembly_ast.h"
+#include "backend/backend_symbol_table.h"
+#include "backend/liveness_analysis.h"
+#include "backend/register_assignment.h"
+#include "backend/registers.h"
+#include "common/stats/statistic.h"
+#include <algorithm>
+#include <cstdint>
+#include <format>
+#include <limits>
+#include <optional>
+#include <span>
+#include <vector>
+
+using namespace backend;
+
+STATISTIC(NumIntervalsAllocated, "linear-scan", "Number of live intervals assigned a hard register");
+STATISTIC(NumIntervalsSpilled, "linear-scan", "Number of live intervals spilled to the stack");
+STATISTIC(NumMovesDeleted, "linear-scan", "Number of register to register moves deleted after allocation");
+
+namespace {
+
+constexpr size_t NO_POINT = std::numeric_limits<size_t>::max();
+
+struct Interval {
+    size_t location;
+    // Instructions [start, end] the pseudo register occupies a register for
+    size_t start;
+    size_t end;
+    std::optional<RegisterName> assigned;
+};
+
+// Points where each hard register is live or written, as prefix counts so that overlap with an interval is O(1)
+class FixedIntervals {
+public:
+    explicit FixedIntervals(size_t instruction_count)
+        : m_instruction_count { instruction_count }
+        , m_points(LivenessAnalysis::FIRST_PSEUDO)
+    {
+    }
+
+    void add(size_t location, size_t point)
+    {
+        auto& points = m_points[location];
+        if (points.empty()) {
+            points.assign(m_instruction_count + 1, 0);
+        }
+        points[point + 1] = 1;
+    }
+
+    void finalize()
+    {
+        for (auto& points : m_points) {
+            for (size_t i = 1; i < points.size(); ++i) {
+                points[i] += points[i - 1];
+            }
+        }
+    }
+
+    bool overlaps(RegisterName reg, size_t start, size_t end) const
+    {
+        const auto& points = m_points[static_cast<size_t>(reg)];
+        return !points.empty() && points[end + 1] != points[start];
+    }
+
+private:
+    size_t m_instruction_count;
+    std::vector<std::vector<uint32_t>> m_points;
+};
+
+}
+
+LinearScanAllocator::LinearScanAllocator(std::shared_ptr<AssemblyAST> ast, std::shared_ptr<BackendSymbolTable> symbol_table, std::shared_ptr<RemarkManager> remark_manager)
+    : m_ast { ast }
+    , m_symbol_table { symbol_table }
+    , m_remark_manager { remark_manager }
+{
+    if (!m_ast || !dynamic_cast<Program*>(m_ast.get())) {
+        throw LinearScanAllocatorError("LinearScanAllocator: Invalid AST");
+    }
+}
+
+void LinearScanAllocator::allocate()
+{
+    auto& program = dynamic_cast<Program&>(*m_ast);
+    for (auto& definition : program.definitions) {
+        if (auto function = dynamic_cast<FunctionDefinition*>(definition.get())) {
+            allocate_function(*function);
+        }
+    }
+}
+
+void LinearScanAllocator::allocate_function(FunctionDefinition& function)
+{
+    LivenessAnalysis liveness(function, *m_symbol_table);
+    size_t pseudo_count = liveness.location_count() - LivenessAnalysis::FIRST_PSEUDO;
+    if (pseudo_count == 0) {
+        return;
+    }
+
+    // A location occupies a register at an instruction if it is live after it or written by it
+    std::vector<Interval> intervals(pseudo_count);
+    for (size_t p = 0; p < pseudo_count; ++p) {
+        intervals[p] = { LivenessAnalysis::FIRST_PSEUDO + p, NO_POINT, 0, std::nullopt };
+    }
+    FixedIntervals fixed(function.instructions.size());
+    // Copy partners of each pseudo register, their register is tried first so that the copy can be deleted
+    std::vector<std::vector<size_t>> hints(pseudo_count);
+
+    auto occupy = [&](size_t location, size_t point) {
+        if (LivenessAnalysis::is_pseudo(location)) {
+            Interval& interval = intervals[location - LivenessAnalysis::FIRST_PSEUDO];
+            interval.start = std::min(interval.start, point);
+            interval.end = std::max(interval.end, point);
+        } else {
+            fixed.add(location, point);
+        }
+    };
+
+    for (size_t b = 0; b < liveness.blocks().size(); ++b) {
+        const auto& block = liveness.blocks()[b];
+        if (block.begin == block.end) {
+            continue;
+        }
+        LiveSet live = liveness.live_out(b);
+        for (size_t i = block.end; i-- > block.begin;) {
+            live.for_each([&](size_t location) { occupy(location, i); });
+            for (size_t location : liveness.defs(i)) {
+                occupy(location, i);
+            }
+            if (liveness.is_move(i)) {
+                size_t source = liveness.uses(i)[0];
+                size_t destination = liveness.defs(i)[0];
+                if (LivenessAnalysis::is_pseudo(source)) {
+                    hints[source - LivenessAnalysis::FIRST_PSEUDO].push_back(destination);
+                }
+                if (LivenessAnalysis::is_pseudo(destination)) {
+                    hints[destination - LivenessAnalysis::FIRST_PSEUDO].push_back(source);
+                }
+            }
+            liveness.step_backward(live, i);
+        }
+        // Pseudo registers live into the block must reach at least its first instruction, blocks are not laid out
+        // in execution order. Hard registers do not need this, they are live out of a predecessor
+        live.for_each([&](size_t location) {
+            if (LivenessAnalysis::is_pseudo(location)) {
+                occupy(location, block.begin);
+            }
+        });
+    }
+    fixed.finalize();
+
+    std::vector<size_t> order;
+    for (size_t p = 0; p < pseudo_count; ++p) {
+        if (intervals[p].start != NO_POINT) {
+            order.push_back(p);
+        }
+    }
+    std::ranges::sort(order, [&](size_t a, size_t b) {
+        return intervals[a].start != intervals[b].start ? intervals[a].start < intervals[b].start : a < b;
+    });
+
+    // Interval holding each hard register
+    std::vector<size_t> holder(LivenessAnalysis::FIRST_PSEUDO, NO_POINT);
+    std::vector<size_t> active;
+    size_t spilled = 0;
+    bool remarks = m_remark_manager && m_remark_manager->is_enabled();
+    std::vector<std::optional<SourceLocationIndex>> locations = remarks ? pseudo_source_locations(function, liveness) : std::vector<std::optional<SourceLocationIndex>> {};
+    auto remark_spill = [&](const Interval& spilled_interval, const Interval& competitor) {
+        if (remarks) {
+            emit_remark(m_remark_manager, RemarkKind::MISSED, "linear-scan", function.name.name, locations[spilled_interval.location - LivenessAnalysis::FIRST_PSEUDO],
+                "'{}' spilled to the stack, no register was free and its interval ends after the one of '{}'", liveness.pseudo_name(spilled_interval.location),
+                liveness.pseudo_name(competitor.location));
+        }
+    };
+
+    for (size_t current : order) {
+        Interval& interval = intervals[current];
+
+        std::erase_if(active, [&](size_t other) {
+            if (intervals[other].end < interval.start) {
+                holder[static_cast<size_t>(*intervals[other].assigned)] = NO_POINT;
+                return true;
+            }
+            return false;
+        });
+
+        bool xmm = liveness.is_xmm(interval.location);
+        std::span<const RegisterName> registers = xmm ? std::span<const RegisterName>(XMM_ALLOCATABLE_REGISTERS) : std::span<const RegisterName>(GP_ALLOCATABLE_REGISTERS);
+        auto is_free = [&](RegisterName reg) {
+            return holder[static_cast<size_t>(reg)] == NO_POINT && !fixed.overlaps(reg, interval.start, interval.end);
+        };
+
+        std::optional<RegisterName> choice;
+        for (size_t partner : hints[current]) {
+            std::optional<RegisterName> hint;
+            if (LivenessAnalysis::is_pseudo(partner)) {
+                hint = intervals[partner - LivenessAnalysis::FIRST_PSEUDO].assigned;
+            } else if (std::ranges::find(registers, static_cast<RegisterName>(partner)) != registers.end()) {
+                hint = static_cast<RegisterName>(partner);
+            }
+            if (hint && is_free(*hint)) {
+                choice = hint;
+                break;
+            }
+        }
+        if (!choice) {
+            auto it = std::ranges::find_if(registers, is_free);
+            if (it != registers.end()) {
+                choice = *it;
+            }
+        }
+
+        if (!choice) {
+            // Spill whichever of the current and the active intervals of this class ends last
+            auto victim = active.end();
+            for (auto it = active.begin(); it != active.end(); ++it) {
+                const Interval& other = intervals[*it];
+                if (liveness.is_xmm(other.location) != xmm || fixed.overlaps(*other.assigned, interval.start, interval.end)) {
+                    continue;
+                }
+                if (victim == active.end() || other.end > intervals[*victim].end) {
+                    victim = it;
+                }
+            }
+            if (victim == active.end() || intervals[*victim].end <= interval.end) {
+                if (remarks) {
+                    if (victim != active.end()) {
+                        remark_spill(interval, intervals[*victim]);
+                    } else {
+                        emit_remark(m_remark_manager, RemarkKind::MISSED, "linear-scan", function.name.name, locations[current],
+                            "'{}' spilled to the stack, every register is clobbered or taken while it is live", liveness.pseudo_name(interval.location));
+                    }
+                }
+                ++spilled;
+                continue;
+            }
+            remark_spill(intervals[*victim], interval);
+            choice = intervals[*victim].assigned;
+            intervals[*victim].assigned.reset();
+            active.erase(victim);
+            ++spilled;
+        }
+
+        interval.assigned = choice;
+        holder[static_cast<size_t>(*choice)] = current;
+        active.push_back(current);
+    }
+
+    RegisterAssignment assignment;
+    for (const Interval& interval : intervals) {
+        if (interval.assigned) {
+            assignment.emplace(liveness.pseudo_name(interval.location), *interval.assigned);
+            if (remarks) {
+                emit_remark(m_remark_manager, RemarkKind::PASSED, "linear-scan", function.name.name, locations[interval.location - LivenessAnalysis::FIRST_PSEUDO],
+                    "'{}' kept in a register", liveness.pseudo_name(interval.location));
+            }
+        }
+    }
+    size_t deleted = apply_register_assignment(function, liveness, assignment);
+    std::get<FunctionEntry>(m_symbol_table->symbol_at(function.name.name)).callee_saved_registers = used_callee_saved_registers(assignment);
+
+    NumIntervalsAllocated += assignment.size();
+    NumIntervalsSpilled += spilled;
+    NumMovesDeleted += deleted;
+
+    if (remarks) {
+        m_remark_manager->emit(RemarkKind::ANALYSIS, "linear-scan", function.name.name, function.source_location,
+            std::format("{} values assigned to registers, {} spilled, {} copies deleted", assignment.size(), spilled, deleted));
+    }
+}
@@ -0,0 +1,325 @@
+#include "backend/liveness_analysis.h"
+#include "backend/assembly_ast.h"
+#include "backend/backend_symbol_table.h"
+#include "backend/registers.h"
+#include <unordered_set>
+#include <variant>
+
+using namespace backend;
+
+// Used for calls to functions the backend symbol table knows nothing about
+static const std::vector<RegisterName> ALL_ARGUMENT_REGISTERS {
+    RegisterName::DI, RegisterName::SI, RegisterName::DX, RegisterName::CX, RegisterName::R8, RegisterName::R9,
+    RegisterName::XMM0, RegisterName::XMM1, RegisterName::XMM2, RegisterName::XMM3,
+    RegisterName::XMM4, RegisterName::XMM5, RegisterName::XMM6, RegisterName::XMM7
+};
+
+static const FunctionEntry* find_function(const BackendSymbolTable& symbol_table, const std::string& name)
+{
+    if (!symbol_table.contains_symbol(name)) {
+        return nullptr;
+    }
+    return std::get_if<FunctionEntry>(&symbol_table.symbol_at(name));
+}
+
+InstructionUseDef backend::get_use_def(Instruction& instruction, const BackendSymbolTable& symbol_table, const std::string& function_name)
+{
+    InstructionUseDef result;
+    auto add = [&result](std::unique_ptr<Operand>& operand, OperandAccess access, AssemblyType type) {
+        result.operands.push_back({ &operand, access, type });
+    };
+
+    if (auto mov = dynamic_cast<MovInstruction*>(&instruction)) {
+        add(mov->source, OperandAccess::USE, mov->type);
+        add(mov->destination, OperandAccess::DEF, mov->type);
+    } else if (auto movsx = dynamic_cast<MovsxInstruction*>(&instruction)) {
+        add(movsx->source, OperandAccess::USE, movsx->source_type);
+        add(movsx->destination, OperandAccess::DEF, movsx->destination_type);
+    } else if (auto movzx = dynamic_cast<MovZeroExtendInstruction*>(&instruction)) {
+        add(movzx->source, OperandAccess::USE, movzx->source_type);
+        add(movzx->destination, OperandAccess::DEF, movzx->destination_type);
+    } else if (auto lea = dynamic_cast<LeaInstruction*>(&instruction)) {
+        add(lea->source, OperandAccess::USE, AssemblyType::QUAD_WORD);
+        add(lea->destination, OperandAccess::DEF, AssemblyType::QUAD_WORD);
+    } else if (auto cvttsd2si = dynamic_cast<Cvttsd2siInstruction*>(&instruction)) {
+        add(cvttsd2si->source, OperandAccess::USE, AssemblyType::DOUBLE);
+        add(cvttsd2si->destination, OperandAccess::DEF, cvttsd2si->type);
+    } else if (auto cvtsi2sd = dynamic_cast<Cvtsi2sdInstruction*>(&instruction)) {
+        add(cvtsi2sd->source, OperandAccess::USE, cvtsi2sd->type);
+        add(cvtsi2sd->destination, OperandAccess::DEF, AssemblyType::DOUBLE);
+    } else if (auto unary = dynamic_cast<UnaryInstruction*>(&instruction)) {
+        add(unary->operand, OperandAccess::USE_DEF, unary->type);
+    } else if (auto binary = dynamic_cast<BinaryInstruction*>(&instruction)) {
+        // "xor %reg, %reg" only zeroes the register, it does not read it
+        auto source_register = dynamic_cast<Register*>(binary->source.get());
+        auto destination_register = dynamic_cast<Register*>(binary->destination.get());
+        bool zeroing = binary->binary_operator == BinaryOperator::XOR && source_register && destination_register
+            && source_register->name == destination_register->name;
+        add(binary->source, zeroing ? OperandAccess::DEF : OperandAccess::USE, binary->type);
+        add(binary->destination, zeroing ? OperandAccess::DEF : OperandAccess::USE_DEF, binary->type);
+    } else if (auto cmp = dynamic_cast<CmpInstruction*>(&instruction)) {
+        add(cmp->source, OperandAccess::USE, cmp->type);
+        add(cmp->destination, OperandAccess::USE, cmp->type);
+    } else if (auto test = dynamic_cast<TestInstruction*>(&instruction)) {
+        add(test->source, OperandAccess::USE, test->type);
+        add(test->destination, OperandAccess::USE, test->type);
+    } else if (auto idiv = dynamic_cast<IdivInstruction*>(&instruction)) {
+        add(idiv->operand, OperandAccess::USE, idiv->type);
+        result.implicit_uses = { RegisterName::AX, RegisterName::DX };
+        result.implicit_defs = { RegisterName::AX, RegisterName::DX };
+    } else if (auto div = dynamic_cast<DivInstruction*>(&instruction)) {
+        add(div->operand, OperandAccess::USE, div->type);
+        result.implicit_uses = { RegisterName::AX, RegisterName::DX };
+        result.implicit_defs = { RegisterName::AX, RegisterName::DX };
+    } else if (auto imul = dynamic_cast<ImulInstruction*>(&instruction)) {
+        add(imul->operand, OperandAccess::USE, imul->type);
+        result.implicit_uses = { RegisterName::AX };
+        result.implicit_defs = { RegisterName::AX, RegisterName::DX };
+    } else if (auto mul = dynamic_cast<MulInstruction*>(&instruction)) {
+        add(mul->operand, OperandAccess::USE, mul->type);
+        result.implicit_uses = { RegisterName::AX };
+        result.implicit_defs = { RegisterName::AX, RegisterName::DX };
+    } else if (dynamic_cast<CdqInstruction*>(&instruction)) {
+        result.implicit_uses = { RegisterName::AX };
+        result.implicit_defs = { RegisterName::DX };
+    } else if (auto setcc = dynamic_cast<SetCCInstruction*>(&instruction)) {
+        // setcc only writes the low byte, the rest of the destination is still live
+        add(setcc->destination, OperandAccess::USE_DEF, AssemblyType::BYTE);
+    } else if (auto cmov = dynamic_cast<CmovInstruction*>(&instruction)) {
+        // The destination keeps its value when the condition does not hold
+        add(cmov->source, OperandAccess::USE, cmov->type);
+        add(cmov->destination, OperandAccess::USE_DEF, cmov->type);
+    } else if (auto push = dynamic_cast<PushInstruction*>(&instruction)) {
+        add(push->destination, OperandAccess::USE, AssemblyType::QUAD_WORD);
+    } else if (auto pop = dynamic_cast<PopInstruction*>(&instruction)) {
+        result.implicit_defs = { pop->reg };
+    } else if (auto call = dynamic_cast<CallInstruction*>(&instruction)) {
+        const FunctionEntry* callee = find_function(symbol_table, call->identifier.name);
+        result.implicit_uses = callee ? callee->param_registers : ALL_ARGUMENT_REGISTERS;
+        result.implicit_defs.assign(CALLER_SAVED_REGISTERS.begin(), CALLER_SAVED_REGISTERS.end());
+    } else if (dynamic_cast<ReturnInstruction*>(&instruction)) {
+        if (const FunctionEntry* function = find_function(symbol_table, function_name)) {
+            result.implicit_uses = function->return_registers;
+        }
+    }
+    return result;
+}
+
+LivenessAnalysis::LivenessAnalysis(FunctionDefinition& function, const BackendSymbolTable& symbol_table)
+{
+    m_use_defs.reserve(function.instructions.size());
+    for (auto& instruction : function.instructions) {
+        m_use_defs.push_back(get_use_def(*instruction, symbol_table, function.name.name));
+    }
+    collect_pseudo_registers(function, symbol_table);
+
+    auto add_register = [](std::vector<size_t>& locations, RegisterName name) {
+        if (name != RegisterName::SP && name != RegisterName::BP) {
+            locations.push_back(static_cast<size_t>(name));
+        }
+    };
+
+    size_t count = function.instructions.size();
+    m_uses.resize(count);
+    m_defs.resize(count);
+    m_is_move.resize(count, false);
+    for (size_t i = 0; i < count; ++i) {
+        const InstructionUseDef& use_def = m_use_defs[i];
+        for (const OperandSlot& slot : use_def.operands) {
+            const Operand& operand = **slot.operand;
+            if (auto location = location_of(operand)) {
+                if (slot.access != OperandAccess::DEF) {
+                    m_uses[i].push_back(*location);
+                }
+                if (slot.access != OperandAccess::USE) {
+                    m_defs[i].push_back(*location);
+                }
+            } else if (auto memory = dynamic_cast<const MemoryAddress*>(&operand)) {
+                add_register(m_uses[i], memory->base_register->name);
+            } else if (auto indexed = dynamic_cast<const IndexedAddress*>(&operand)) {
+                add_register(m_uses[i], indexed->base_register->name);
+                add_register(m_uses[i], indexed->index_register->name);
+            }
+        }
+        for (RegisterName name : use_def.implicit_uses) {
+            add_register(m_uses[i], name);
+        }
+        for (RegisterName name : use_def.implicit_defs) {
+            add_register(m_defs[i], name);
+        }
+
+        if (auto mov = dynamic_cast<MovInstruction*>(function.instructions[i].get())) {
+            m_is_move[i] = location_of(*mov->source) && location_of(*mov->destination);
+        }
+    }
+
+    build_blocks(function);
+    compute_loop_depths();
+    solve();
+}
+
+void LivenessAnalysis::collect_pseudo_registers(FunctionDefinition& function, const BackendSymbolTable& symbol_table)
+{
+    // A pseudo register whose address is taken can be written through a pointer, it has to stay in memory
+    std::unordered_set<std::string> address_taken;
+    for (auto& instruction : function.instructions) {
+        if (auto lea = dynamic_cast<LeaInstruction*>(instruction.get())) {
+            if (auto pseudo = dynamic_cast<PseudoRegister*>(lea->source.get())) {
+                address_taken.insert(pseudo->identifier.name);
+            }
+        }
+    }
+    m_address_taken_count = address_taken.size();
+
+    for (const InstructionUseDef& use_def : m_use_defs) {
+        for (const OperandSlot& slot : use_def.operands) {
+            auto pseudo = dynamic_cast<PseudoRegister*>(slot.operand->get());
+            if (!pseudo) {
+                continue;
+            }
+            const std::string& name = pseudo->identifier.name;
+            if (m_pseudo_locations.contains(name) || address_taken.contains(name) || !symbol_table.contains_symbol(name)) {
+                continue;
+            }
+            auto object = std::get_if<ObjectEntry>(&symbol_table.symbol_at(name));
+            if (!object || object->is_static || object->type == AssemblyType::BYTE_ARRAY) {
+                continue;
+            }
+            m_pseudo_locations.emplace(name, location_count());
+            m_pseudo_names.push_back(name);
+            m_pseudo_is_xmm.push_back(object->type == AssemblyType::DOUBLE);
+        }
+    }
+}
+
+bool LivenessAnalysis::is_xmm(size_t location) const
+{
+    if (is_pseudo(location)) {
+        return m_pseudo_is_xmm[location - FIRST_PSEUDO];
+    }
+    return is_xmm_register(static_cast<RegisterName>(location));
+}
+
+std::optional<size_t> LivenessAnalysis::location_of(const Operand& operand) const
+{
+    if (auto reg = dynamic_cast<const Register*>(&operand)) {
+        if (reg->name == RegisterName::SP || reg->name == RegisterName::BP) {
+            return std::nullopt;
+        }
+        return static_cast<size_t>(reg->name);
+    }
+    if (auto pseudo = dynamic_cast<const PseudoRegister*>(&operand)) {
+        auto it = m_pseudo_locations.find(pseudo->identifier.name);
+        if (it != m_pseudo_locations.end()) {
+            return it->second;
+        }
+    }
+    return std::nullopt;
+}
+
+void LivenessAnalysis::build_blocks(FunctionDefinition& function)
+{
+    auto& instructions = function.instructions;
+    std::unordered_map<std::string, size_t> label_blocks;
+
+    size_t begin = 0;
+    for (size_t i = 0; i < instructions.size(); ++i) {
+        Instruction* instruction = instructions[i].get();
+        if (auto label = dynamic_cast<LabelInstruction*>(instruction)) {
+            if (i > begin) {
+                m_blocks.push_back({ begin, i, {} });
+                begin = i;
+            }
+            label_blocks[label->identifier.name] = m_blocks.size();
+        }
+        if (dynamic_cast<JmpInstruction*>(instruction) || dynamic_cast<JmpCCInstruction*>(instruction) || dynamic_cast<ReturnInstruction*>(instruction)) {
+            m_blocks.push_back({ begin, i + 1, {} });
+            begin = i + 1;
+        }
+    }
+    if (begin < instructions.size()) {
+        m_blocks.push_back({ begin, instructions.size(), {} });
+    }
+
+    for (size_t b = 0; b < m_blocks.size(); ++b) {
+        Instruction* last = instructions[m_blocks[b].end - 1].get();
+        bool falls_through = true;
+        if (auto jmp = dynamic_cast<JmpInstruction*>(last)) {
+            m_blocks[b].successors.push_back(label_blocks.at(jmp->identifier.name));
+            falls_through = false;
+        } else if (auto jmpcc = dynamic_cast<JmpCCInstruction*>(last)) {
+            m_blocks[b].successors.push_back(label_blocks.at(jmpcc->identifier.name));
+        } else if (dynamic_cast<ReturnInstruction*>(last)) {
+            falls_through = false;
+        }
+        if (falls_through && b + 1 < m_blocks.size()) {
+            m_blocks[b].successors.push_back(b + 1);
+        }
+    }
+}
+
+void LivenessAnalysis::compute_loop_depths()
+{
+    // A jump backwards closes a loop over the blocks in between
+    std::vector<long> delta(m_blocks.size() + 1, 0);
+    for (size_t b = 0; b < m_blocks.size(); ++b) {
+        for (size_t successor : m_blocks[b].successors) {
+            if (successor <= b) {
+                ++delta[successor];
+                --delta[b + 1];
+            }
+        }
+    }
+    long depth = 0;
+    for (size_t b = 0; b < m_blocks.size(); ++b) {
+        depth += delta[b];
+        m_blocks[b].loop_depth = static_cast<size_t>(depth);
+    }
+}
+
+void LivenessAnalysis::solve()
+{
+    size_t size = location_count();
+    std::vector<LiveSet> gen(m_blocks.size(), LiveSet(size));
+    std::vector<LiveSet> kill(m_blocks.size(), LiveSet(size));
+    for (size_t b = 0; b < m_blocks.size(); ++b) {
+        for (size_t i = m_blocks[b].end; i-- > m_blocks[b].begin;) {
+            for (size_t d : m_defs[i]) {
+                kill[b].set(d);
+                gen[b].reset(d);
+            }
+            for (size_t u : m_uses[i]) {
+                gen[b].set(u);
+            }
+        }
+    }
+
+    m_live_out.assign(m_blocks.size(), LiveSet(size));
+    std::vector<LiveSet> live_in = gen;
+    bool changed = true;
+    while (changed) {
+        changed = false;
+        for (size_t b = m_blocks.size(); b-- > 0;) {
+            for (size_t successor : m_blocks[b].successors) {
+                m_live_out[b].union_with(live_in[successor]);
+            }
+            LiveSet in = m_live_out[b];
+            in.subtract(kill[b]);
+            in.union_with(gen[b]);
+            if (!(in == live_in[b])) {
+                live_in[b] = std::move(in);
+                changed = true;
+            }
+        }
+    }
+}
+
+void LivenessAnalysis::step_backward(LiveSet& live, size_t instruction) const
+{
+    for (size_t d : m_defs[instruction]) {
+        live.reset(d);
+    }
+    for (size_t u : m_uses[instruction]) {
+        live.set(u);
+    }
+}
@@ -0,0 +1,158 @@
+#include "backend/multiply_by_constant.h"
+#include <algorithm>
+#include <bit>
+
+using namespace backend;
+
+namespace {
+
+uint64_t width_mask(int width)
+{
+    return width == 64 ? ~uint64_t { 0 } : (uint64_t { 1 } << width) - 1;
+}
+
+int step_latency(const MultiplyStep& step)
+{
+    switch (step.kind) {
+    case MultiplyStep::Kind::SHIFT_LEFT:
+        return multiply_latency::SHIFT;
+    case MultiplyStep::Kind::SCALE_ADD:
+        return multiply_latency::LEA;
+    case MultiplyStep::Kind::ADD_SOURCE:
+        return step.amount == 1 ? multiply_latency::ADD : multiply_latency::LEA;
+    case MultiplyStep::Kind::SUB_SOURCE:
+        return multiply_latency::SUB;
+    case MultiplyStep::Kind::NEGATE:
+        return multiply_latency::NEG;
+    }
+    return multiply_latency::IMUL;
+}
+
+bool needs_source(const MultiplyStep& step)
+{
+    return step.kind == MultiplyStep::Kind::ADD_SOURCE || step.kind == MultiplyStep::Kind::SUB_SOURCE;
+}
+
+uint64_t apply(const MultiplyStep& step, uint64_t product, uint64_t source, uint64_t mask)
+{
+    switch (step.kind) {
+    case MultiplyStep::Kind::SHIFT_LEFT:
+        return (product << step.amount) & mask;
+    case MultiplyStep::Kind::SCALE_ADD:
+        return (product + product * step.amount) & mask;
+    case MultiplyStep::Kind::ADD_SOURCE:
+        return (source + product * step.amount) & mask;
+    case MultiplyStep::Kind::SUB_SOURCE:
+        return (product - source) & mask;
+    case MultiplyStep::Kind::NEGATE:
+        return (0 - product) & mask;
+    }
+    return product;
+}
+
+class PlanSearch {
+public:
+    PlanSearch(uint64_t constant, int width)
+        : m_constant { constant }
+        , m_width { width }
+        , m_mask { width_mask(width) }
+    {
+        // Candidates in order of preference, the first plan found at a latency wins
+        for (int shift = 1; shift < width; ++shift) {
+            m_candidates.push_back({ MultiplyStep::Kind::SHIFT_LEFT, shift });
+        }
+        for (int scale : { 2, 4, 8 }) {
+            m_candidates.push_back({ MultiplyStep::Kind::SCALE_ADD, scale });
+        }
+        m_candidates.push_back({ MultiplyStep::Kind::NEGATE, 0 });
+        for (int scale : { 1, 2, 4, 8 }) {
+            m_candidates.push_back({ MultiplyStep::Kind::ADD_SOURCE, scale });
+        }
+        m_candidates.push_back({ MultiplyStep::Kind::SUB_SOURCE, 0 });
+    }
+
+    std::optional<MultiplyPlan> run()
+    {
+        // Cheapest plan first, at equal latency one that does not need the source in a second register
+        for (int budget = 0; budget < multiply_latency::IMUL; ++budget) {
+            for (bool allow_source : { false, true }) {
+                m_allow_source = allow_source;
+                m_steps.clear();
+                if (search(1, budget)) {
+                    MultiplyPlan plan { m_steps, 0 };
+                    for (const auto& step : plan.steps) {
+                        plan.latency += step_latency(step);
+                    }
+                    return plan;
+                }
+            }
+        }
+        return std::nullopt;
+    }
+
+private:
+    // Depth first over the steps, the product is tracked as its coefficient of the source
+    bool search(uint64_t coefficient, int budget)
+    {
+        if (coefficient == m_constant) {
+            return true;
+        }
+        // The one shift that can end the plan is found directly, shifts are only enumerated when more steps follow
+        bool shift_ends = budget >= multiply_latency::SHIFT && budget - multiply_latency::SHIFT < MIN_STEP_LATENCY;
+        if (shift_ends && coefficient != 0) {
+            int shift = std::countr_zero(m_constant) - std::countr_zero(coefficient);
+            if (shift > 0 && shift < m_width && ((coefficient << shift) & m_mask) == m_constant) {
+                m_steps.push_back({ MultiplyStep::Kind::SHIFT_LEFT, shift });
+                return true;
+            }
+        }
+        for (const auto& step : m_candidates) {
+            int latency = step_latency(step);
+            if (latency > budget || (!m_allow_source && needs_source(step)) || (shift_ends && step.kind == MultiplyStep::Kind::SHIFT_LEFT)) {
+                continue;
+            }
+            m_steps.push_back(step);
+            if (search(apply(step, coefficient, 1, m_mask), budget - latency)) {
+                return true;
+            }
+            m_steps.pop_back();
+        }
+        return false;
+    }
+
+    static constexpr int MIN_STEP_LATENCY = std::min({ multiply_latency::SHIFT, multiply_latency::LEA, multiply_latency::ADD, multiply_latency::SUB, multiply_latency::NEG });
+
+    uint64_t m_constant;
+    int m_width;
+    uint64_t m_mask;
+    bool m_allow_source = false;
+    std::vector<MultiplyStep> m_candidates;
+    std::vector<MultiplyStep> m_steps;
+};
+
+}
+
+bool MultiplyPlan::uses_source() const
+{
+    return std::ranges::any_of(steps, needs_source);
+}
+
+std::optional<MultiplyPlan> backend::plan_multiply_by_constant(uint64_t constant, int width)
+{
+    constant &= width_mask(width);
+    if (constant == 0) {
+        return std::nullopt;
+    }
+    PlanSearch search(constant, width);
+    return search.run();
+}
+
+uint64_t backend::evaluate_multiply_plan(const MultiplyPlan& plan, uint64_t source, int width)
+{
+    uint64_t mask = width_mask(width);
+    uint64_t product = source & mask;
+    for (const auto& step : plan.steps) {
+        product = apply(step, product, source & mask, mask);
+    }
+    return product;
+}
@@ -0,0 +1,372 @@
+#include "backend/peephole_optimizer.h"
+#include "backend/assembly_ast.h"
+#include "backend/backend_symbol_table.h"
+#include "backend/liveness_analysis.h"
+#include "common/stats/statistic.h"
+#include <algorithm>
+#include <memory>
+#include <type_traits>
+#include <variant>
+
+using namespace backend;
+
+STATISTIC(NumSelfMovesRemoved, "peephole", "Number of moves of a register to itself removed");
+STATISTIC(NumScratchMovesForwarded, "peephole", "Number of moves through a scratch register forwarded");
+STATISTIC(NumJumpsToNextLabelRemoved, "peephole", "Number of jumps to the next label removed");
+STATISTIC(NumZeroMovesToXor, "peephole", "Number of moves of zero into a register turned into xor");
+STATISTIC(NumCompareZeroToTest, "peephole", "Number of comparisons of a register with zero turned into test");
+STATISTIC(NumDeadStoresRemoved, "peephole", "Number of stores overwritten by the next store removed");
+
+namespace {
+
+// Passes over a function stop once nothing changes, or after this many
+constexpr int MAX_PASSES = 4;
+
+// Only used by FixUpInstructionsStep, so never live across the instructions it expands
+bool is_scratch_register(RegisterName reg)
+{
+    return reg == RegisterName::R10 || reg == RegisterName::R11 || reg == RegisterName::XMM14 || reg == RegisterName::XMM15;
+}
+
+bool is_xmm_register(RegisterName reg)
+{
+    return reg >= RegisterName::XMM0 && reg <= RegisterName::XMM15;
+}
+
+Register* as_register(const std::unique_ptr<Operand>& operand)
+{
+    return dynamic_cast<Register*>(operand.get());
+}
+
+// True if the operand is the register or addresses memory through it
+bool references_register(const Operand& operand, RegisterName reg)
+{
+    if (auto r = dynamic_cast<const Register*>(&operand)) {
+        return r->name == reg;
+    }
+    if (auto memory = dynamic_cast<const MemoryAddress*>(&operand)) {
+        return memory->base_register->name == reg;
+    }
+    if (auto indexed = dynamic_cast<const IndexedAddress*>(&operand)) {
+        return indexed->base_register->name == reg || indexed->index_register->name == reg;
+    }
+    return false;
+}
+
+bool is_same_memory(const Operand& a, const Operand& b)
+{
+    if (auto memory_a = dynamic_cast<const MemoryAddress*>(&a)) {
+        auto memory_b = dynamic_cast<const MemoryAddress*>(&b);
+        return memory_b && memory_a->base_register->name == memory_b->base_register->name && memory_a->offset == memory_b->offset;
+    }
+    if (auto data_a = dynamic_cast<const DataOperand*>(&a)) {
+        auto data_b = dynamic_cast<const DataOperand*>(&b);
+        return data_b && data_a->identifier.name == data_b->identifier.name;
+    }
+    return false;
+}
+
+bool is_zero_immediate(const std::unique_ptr<Operand>& operand)
+{
+    auto immediate = dynamic_cast<ImmediateValue*>(operand.get());
+    if (!immediate) {
+        return false;
+    }
+    return std::visit([](const auto& value) {
+        using T = std::decay_t<decltype(value)>;
+        if constexpr (std::is_same_v<T, std::monostate> || std::is_same_v<T, double>) {
+            return false;
+        } else {
+            return value == 0;
+        }
+    },
+        immediate->value);
+}
+
+bool sets_flags(const Instruction& instruction)
+{
+    if (dynamic_cast<const CmpInstruction*>(&instruction) || dynamic_cast<const TestInstruction*>(&instruction)) {
+        return true;
+    }
+    // SSE arithmetic leaves the flags alone
+    if (auto binary = dynamic_cast<const BinaryInstruction*>(&instruction)) {
+        return binary->type != AssemblyType::DOUBLE;
+    }
+    if (auto unary = dynamic_cast<const UnaryInstruction*>(&instruction)) {
+        return unary->unary_operator != UnaryOperator::NOT;
+    }
+    // Division leaves the flags undefined and calls do not preserve them, nothing can read them afterwards
+    return dynamic_cast<const IdivInstruction*>(&instruction) || dynamic_cast<const DivInstruction*>(&instruction)
+        || dynamic_cast<const ImulInstruction*>(&instruction) || dynamic_cast<const MulInstruction*>(&instruction)
+        || dynamic_cast<const CallInstruction*>(&instruction) || dynamic_cast<const ReturnInstruction*>(&instruction);
+}
+
+// movq %rax, %rax and movsd %xmm0, %xmm0 do nothing, movl %eax, %eax clears the upper half of %rax and stays
+bool remove_self_move(PeepholeWindow& window)
+{
+    auto mov = window.get<MovInstruction>(0);
+    if (!mov || mov->type == AssemblyType::LONG_WORD) {
+        return false;
+    }
+    auto source = as_register(mov->source);
+    auto destination = as_register(mov->destination);
+    if (!source || !destination || source->name != destination->name) {
+        return false;
+    }
+    window.erase(0);
+    return true;
+}
+
+// mov X, %r10 ; mov %r10, Y => mov X, Y when one of X and Y is a register and %r10 is dead afterwards
+bool forward_scratch_move(PeepholeWindow& window)
+{
+    auto first = window.get<MovInstruction>(0);
+    auto second = window.get<MovInstruction>(1);
+    if (!first || !second || first->type != second->type) {
+        return false;
+    }
+    auto scratch = as_register(first->destination);
+    auto middle = as_register(second->source);
+    if (!scratch || !middle || scratch->name != middle->name || !is_scratch_register(scratch->name)) {
+        return false;
+    }
+    auto& source = first->source;
+    auto& destination = second->destination;
+    if (!as_register(source) && !as_register(destination)) {
+        return false;
+    }
+    if (references_register(*source, scratch->name) || references_register(*destination, scratch->name)) {
+        return false;
+    }
+    if (window.is_register_read_after(1, scratch->name)) {
+        return false;
+    }
+    window.replace(1, std::make_unique<MovInstruction>(first->type, std::move(source), std::move(destination)));
+    window.erase(0);
+    return true;
+}
+
+// jmp .L ; .L: => .L:, also when other labels come in between
+bool remove_jump_to_next_label(PeepholeWindow& window)
+{
+    const std::string* target = nullptr;
+    if (auto jmp = window.get<JmpInstruction>(0)) {
+        target = &jmp->identifier.name;
+    } else if (auto jmpcc = window.get<JmpCCInstruction>(0)) {
+        target = &jmpcc->identifier.name;
+    } else {
+        return false;
+    }
+    for (size_t k = 1; auto label = window.get<LabelInstruction>(k); ++k) {
+        if (label->identifier.name == *target) {
+            window.erase(0);
+            return true;
+        }
+    }
+    return false;
+}
+
+// mov $0, %reg => xor %reg, %reg when the flags are dead, the 32 bit xor also clears the upper half
+bool zero_with_xor(PeepholeWindow& window)
+{
+    auto mov = window.get<MovInstruction>(0);
+    if (!mov || (mov->type != AssemblyType::LONG_WORD && mov->type != AssemblyType::QUAD_WORD) || !is_zero_immediate(mov->source)) {
+        return false;
+    }
+    auto destination = as_register(mov->destination);
+    if (!destination || is_xmm_register(destination->name) || window.are_flags_read_after(0)) {
+        return false;
+    }
+    RegisterName reg = destination->name;
+    window.replace(0, std::make_unique<BinaryInstruction>(BinaryOperator::XOR, AssemblyType::LONG_WORD, std::make_unique<Register>(reg), std::make_unique<Register>(reg)));
+    return true;
+}
+
+// cmp $0, %reg => test %reg, %reg, both set ZF and SF from the register and clear CF and OF
+bool compare_zero_with_test(PeepholeWindow& window)
+{
+    auto cmp = window.get<CmpInstruction>(0);
+    if (!cmp || cmp->type == AssemblyType::DOUBLE || !is_zero_immediate(cmp->source)) {
+        return false;
+    }
+    auto destination = as_register(cmp->destination);
+    if (!destination) {
+        return false;
+    }
+    RegisterName reg = destination->name;
+    window.replace(0, std::make_unique<TestInstruction>(cmp->type, std::make_unique<Register>(reg), std::make_unique<Register>(reg)));
+    return true;
+}
+
+// mov A, M ; mov B, M => mov B, M when the second store covers every byte of the first
+bool remove_dead_store(PeepholeWindow& window)
+{
+    auto first = window.get<MovInstruction>(0);
+    auto second = window.get<MovInstruction>(1);
+    if (!first || !second || !first->destination->is_memory() || second->source->is_memory()) {
+        return false;
+    }
+    if (second->type.size() < first->type.size() || !is_same_memory(*first->destination, *second->destination)) {
+        return false;
+    }
+    window.erase(0);
+    return true;
+}
+
+}
+
+PeepholeWindow::PeepholeWindow(std::vector<std::unique_ptr<Instruction>>& instructions, size_t start, const BackendSymbolTable& symbol_table, const std::string& function_name)
+    : m_instructions { instructions }
+    , m_start { start }
+    , m_symbol_table { symbol_table }
+    , m_function_name { function_name }
+{
+}
+
+size_t PeepholeWindow::next_index(size_t index) const
+{
+    while (index < m_instructions.size() && (!m_instructions[index] || dynamic_cast<CommentInstruction*>(m_instructions[index].get()))) {
+        ++index;
+    }
+    return index;
+}
+
+size_t PeepholeWindow::index_of(size_t k) const
+{
+    size_t index = next_index(m_start);
+    for (size_t i = 0; i < k && index < m_instructions.size(); ++i) {
+        index = next_index(index + 1);
+    }
+    return index;
+}
+
+Instruction* PeepholeWindow::at(size_t k) const
+{
+    size_t index = index_of(k);
+    return index < m_instructions.size() ? m_instructions[index].get() : nullptr;
+}
+
+void PeepholeWindow::erase(size_t k)
+{
+    size_t index = index_of(k);
+    if (index < m_instructions.size()) {
+        m_instructions[index].reset();
+    }
+}
+
+void PeepholeWindow::replace(size_t k, std::unique_ptr<Instruction> instruction)
+{
+    size_t index = index_of(k);
+    if (index < m_instructions.size()) {
+        m_instructions[index] = std::move(instruction);
+    }
+}
+
+bool PeepholeWindow::is_register_read_after(size_t k, RegisterName reg) const
+{
+    for (size_t index = next_index(index_of(k) + 1); index < m_instructions.size(); index = next_index(index + 1)) {
+        Instruction& instruction = *m_instructions[index];
+        if (dynamic_cast<LabelInstruction*>(&instruction) || dynamic_cast<JmpInstruction*>(&instruction) || dynamic_cast<JmpCCInstruction*>(&instruction)) {
+            return true;
+        }
+        InstructionUseDef use_def = get_use_def(instruction, m_symbol_table, m_function_name);
+        bool defined = false;
+        for (const OperandSlot& slot : use_def.operands) {
+            const Operand& operand = **slot.operand;
+            auto r = dynamic_cast<const Register*>(&operand);
+            if (!r) {
+                // Registers that form an address are read
+                if (references_register(operand, reg)) {
+                    return true;
+                }
+                continue;
+            }
+            if (r->name != reg) {
+                continue;
+            }
+            if (slot.access != OperandAccess::DEF) {
+                return true;
+            }
+            // Byte writes keep the rest of the register
+            defined |= slot.type != AssemblyType::BYTE;
+        }
+        if (std::ranges::find(use_def.implicit_uses, reg) != use_def.implicit_uses.end()) {
+            return true;
+        }
+        if (defined || std::ranges::find(use_def.implicit_defs, reg) != use_def.implicit_defs.end() || dynamic_cast<ReturnInstruction*>(&instruction)) {
+            return false;
+        }
+    }
+    return false;
+}
+
+bool PeepholeWindow::are_flags_read_after(size_t k) const
+{
+    for (size_t index = next_index(index_of(k) + 1); index < m_instructions.size(); index = next_index(index + 1)) {
+        Instruction& instruction = *m_instructions[index];
+        if (dynamic_cast<JmpCCInstruction*>(&instruction) || dynamic_cast<SetCCInstruction*>(&instruction)
+            || dynamic_cast<CmovInstruction*>(&instruction) || dynamic_cast<LabelInstruction*>(&instruction) || dynamic_cast<JmpInstruction*>(&instruction)) {
+            return true;
+        }
+        if (sets_flags(instruction)) {
+            return false;
+        }
+    }
+    return false;
+}
+
+const std::vector<PeepholeRule>& PeepholeOptimizer::rules()
+{
+    // New rules go here, each one counts its rewrites in its own statistic
+    static const std::vector<PeepholeRule> table {
+        { "remove-self-move", &NumSelfMovesRemoved, remove_self_move },
+        { "forward-scratch-move", &NumScratchMovesForwarded, forward_scratch_move },
+        { "remove-jump-to-next-label", &NumJumpsToNextLabelRemoved, remove_jump_to_next_label },
+        { "zero-with-xor", &NumZeroMovesToXor, zero_with_xor },
+        { "compare-zero-with-test", &NumCompareZeroToTest, compare_zero_with_test },
+        { "remove-dead-store", &NumDeadStoresRemoved, remove_dead_store },
+    };
+    return table;
+}
+
+PeepholeOptimizer::PeepholeOptimizer(std::shared_ptr<AssemblyAST> ast, std::shared_ptr<BackendSymbolTable> symbol_table)
+    : m_ast { ast }
+    , m_symbol_table { symbol_table }
+{
+    if (!m_ast || !dynamic_cast<Program*>(m_ast.get())) {
+        throw PeepholeOptimizerError("PeepholeOptimizer: Invalid AST");
+    }
+}
+
+void PeepholeOptimizer::optimize()
+{
+    auto& program = dynamic_cast<Program&>(*m_ast);
+    for (auto& definition : program.definitions) {
+        if (auto function = dynamic_cast<FunctionDefinition*>(definition.get())) {
+            optimize_function(*function);
+        }
+    }
+}
+
+void PeepholeOptimizer::optimize_function(FunctionDefinition& function)
+{
+    auto& instructions = function.instructions;
+    bool changed = true;
+    for (int pass = 0; changed && pass < MAX_PASSES; ++pass) {
+        changed = false;
+        for (size_t i = 0; i < instructions.size(); ++i) {
+            if (!instructions[i] || dynamic_cast<CommentInstruction*>(instructions[i].get())) {
+                continue;
+            }
+            PeepholeWindow window(instructions, i, *m_symbol_table, function.name.name);
+            for (const PeepholeRule& rule : rules()) {
+                // Rules may erase the instruction at the start of the window, the next one is tried then
+                if (window.at(0) && rule.apply(window)) {
+                    ++*rule.statistic;
+                    changed = true;
+                }
+            }
+        }
+        std::erase(instructions, nullptr);
+    }
+}
@@ -1,15 +1,29 @@
 #include "backend/pseudo_register_replace_step.h"
 #include "backend/assembly_ast.h"
 #include "backend/backend_symbol_table.h"
+#include "backend/liveness_analysis.h"
 #include "common/error/internal_compiler_error.h"
+#include "common/stats/statistic.h"
 #include <cassert>
+#include <format>
+#include <unordered_map>
 #include <variant>
+#include <vector>
 
 using namespace backend;
 
-PseudoRegisterReplaceStep::PseudoRegisterReplaceStep(std::shared_ptr<AssemblyAST> ast, std::shared_ptr<BackendSymbolTable> symbol_table)
+STATISTIC(NumPseudoRegistersReplaced, "pseudo-replace", "Number of pseudo registers replaced");
+STATISTIC(NumPseudoMemoryReplaced, "pseudo-replace", "Number of pseudo memory operands replaced");
+STATISTIC(NumStackSlots, "pseudo-replace", "Number of stack slots allocated");
+STATISTIC(NumStackBytes, "pseudo-replace", "Number of stack bytes allocated across all frames");
+STATISTIC(MaxStackFrameSize, "pseudo-replace", "Maximum stack frame size in bytes");
+STATISTIC(NumUnsharedStackBytes, "pseudo-replace", "Number of stack bytes all frames would need without slot sharing");
+STATISTIC(NumStackSlotsShared, "pseudo-replace", "Number of pseudo registers placed in a slot shared with another one");
+
+PseudoRegisterReplaceStep::PseudoRegisterReplaceStep(std::shared_ptr<AssemblyAST> ast, std::shared_ptr<BackendSymbolTable> symbol_table, std::shared_ptr<RemarkManager> remark_manager)
     : m_ast { ast }
     , m_symbol_table { symbol_table }
+    , m_remark_manager { remark_manager }
 {
     if (!m_ast || !dynamic_cast<Program*>(m_ast.get())) {
         throw PseudoRegisterReplaceStepError("PseudoRegisterReplaceStep: Invalid AST");
@@ -74,11 +88,23 @@ void PseudoRegisterReplaceStep::visit(CmpInstruction& node)
     check_and_replace(node.destination);
 }
 
+void PseudoRegisterReplaceStep::visit(TestInstruction& node)
+{
+    check_and_replace(node.source);
+    check_and_replace(node.destination);
+}
+
 void PseudoRegisterReplaceStep::visit(SetCCInstruction& node)
 {
     check_and_replace(node.destination);
 }
 
+void PseudoRegisterReplaceStep::visit(CmovInstruction& node)
+{
+    check_and_replace(node.source);
+    check_and_replace(node.destination);
+}
+
 void PseudoRegisterReplaceStep::visit(IdivInstruction& node)
 {
     check_and_replace(node.operand);
@@ -89,6 +115,16 @@ void PseudoRegisterReplaceStep::visit(DivInstruction& node)
     check_and_replace(node.operand);
 }
 
+void PseudoRegisterReplaceStep::visit(ImulInstruction& node)
+{
+    check_and_replace(node.operand);
+}
+
+void PseudoRegisterReplaceStep::visit(MulInstruction& node)
+{
+    check_and_replace(node.operand);
+}
+
 void PseudoRegisterReplaceStep::visit(PushInstruction& node)
 {
     check_and_replace(node.destination);
@@ -98,12 +134,22 @@ void PseudoRegisterReplaceStep::visit(FunctionDefinition& node)
 {
     m_stack_offsets.clear();
     m_curr_offset = 0;
+    m_unshared_offset = 0;
 
+    color_stack_slots(node);
     for (auto& i : node.instructions) {
         i->accept(*this);
     }
 
     std::get<FunctionEntry>(m_symbol_table->symbol_at(node.name.name)).stack_frame_size = m_curr_offset;
+    NumStackBytes += m_curr_offset;
+    NumUnsharedStackBytes += m_unshared_offset;
+    MaxStackFrameSize.update_max(m_curr_offset);
+
+    if (m_remark_manager && m_remark_manager->is_enabled() && !m_stack_offsets.empty()) {
+        m_remark_manager->emit(RemarkKind::ANALYSIS, "pseudo-replace", node.name.name, node.source_location,
+            std::format("{} values spilled to the stack, {} bytes of stack frame ({} without slot sharing)", m_stack_offsets.size(), m_curr_offset, m_unshared_offset));
+    }
 }
 
 void PseudoRegisterReplaceStep::visit(Program& node)
@@ -135,6 +181,7 @@ void PseudoRegisterReplaceStep::check_and_replace(std::unique_ptr<Operand>& op)
             new_op = std::make_unique<MemoryAddress>(RegisterName::BP, -offset);
         }
         op = std::move(new_op);
+        ++NumPseudoRegistersReplaced;
     } else if (auto mem = dynamic_cast<PseudoMemory*>(op.get())) {
         const std::string& pseudo_mem_name = mem->identifier.name;
         std::unique_ptr<Operand> new_op = nullptr;
@@ -156,23 +203,101 @@ void PseudoRegisterReplaceStep::check_and_replace(std::unique_ptr<Operand>& op)
             new_op = std::make_unique<MemoryAddress>(RegisterName::BP, -offset);
         }
         op = std::move(new_op);
+        ++NumPseudoMemoryReplaced;
+    }
+}
+
+void PseudoRegisterReplaceStep::color_stack_slots(FunctionDefinition& function)
+{
+    LivenessAnalysis liveness(function, *m_symbol_table);
+    size_t pseudo_count = liveness.location_count() - LivenessAnalysis::FIRST_PSEUDO;
+    if (pseudo_count == 0) {
+        return;
+    }
+
+    // Two pseudo registers interfere when one is written while the other is live, the source of a copy does not
+    // interfere with its destination
+    std::vector<std::vector<size_t>> interferences(pseudo_count);
+    for (size_t b = 0; b < liveness.blocks().size(); ++b) {
+        const auto& block = liveness.blocks()[b];
+        LiveSet live = liveness.live_out(b);
+        for (size_t i = block.end; i-- > block.begin;) {
+            if (liveness.is_move(i)) {
+                live.reset(liveness.uses(i)[0]);
+            }
+            for (size_t d : liveness.defs(i)) {
+                if (!LivenessAnalysis::is_pseudo(d)) {
+                    continue;
+                }
+                live.for_each([&](size_t l) {
+                    if (LivenessAnalysis::is_pseudo(l) && l != d) {
+                        interferences[d - LivenessAnalysis::FIRST_PSEUDO].push_back(l - LivenessAnalysis::FIRST_PSEUDO);
+                        interferences[l - LivenessAnalysis::FIRST_PSEUDO].push_back(d - LivenessAnalysis::FIRST_PSEUDO);
+                    }
+                });
+            }
+            liveness.step_backward(live, i);
+        }
+    }
+
+    // Greedy coloring in order of first appearance, slots are only shared between values of the same size so that
+    // offsets keep their alignment
+    struct Slot {
+        size_t offset;
+        size_t size;
+    };
+    std::vector<Slot> slots;
+    std::vector<size_t> slot_of(pseudo_count, 0);
+    std::vector<bool> taken;
+    for (size_t p = 0; p < pseudo_count; ++p) {
+        const std::string& name = liveness.pseudo_name(LivenessAnalysis::FIRST_PSEUDO + p);
+        AssemblyType type = std::get<ObjectEntry>(m_symbol_table->symbol_at(name)).type;
+        m_unshared_offset = next_offset(m_unshared_offset, type);
+
+        taken.assign(slots.size(), false);
+        for (size_t other : interferences[p]) {
+            if (other < p) {
+                taken[slot_of[other]] = true;
+            }
+        }
+        size_t slot = 0;
+        while (slot < slots.size() && (taken[slot] || slots[slot].size != type.size())) {
+            ++slot;
+        }
+        if (slot == slots.size()) {
+            m_curr_offset = next_offset(m_curr_offset, type);
+            slots.push_back({ m_curr_offset, type.size() });
+            ++NumStackSlots;
+        } else {
+            ++NumStackSlotsShared;
+        }
+        slot_of[p] = slot;
+        m_stack_offsets[name] = slots[slot].offset;
     }
 }
 
 size_t PseudoRegisterReplaceStep::get_offset(AssemblyType type, const std::string& name)
 {
     if (!m_stack_offsets.contains(name)) {
-        if (type == AssemblyType::BYTE) {
-            m_curr_offset++;
-        } else if (type == AssemblyType::LONG_WORD) {
-            m_curr_offset += 4;
-        } else if (type == AssemblyType::QUAD_WORD || type == AssemblyType::DOUBLE) {
-            m_curr_offset = round_up(m_curr_offset + 8, 8);
-        } else if (type == AssemblyType::BYTE_ARRAY) {
-            m_curr_offset = round_up(m_curr_offset + type.size(), type.alignment());
-        }
+        m_curr_offset = next_offset(m_curr_offset, type);
+        m_unshared_offset = next_offset(m_unshared_offset, type);
         m_stack_offsets[name] = m_curr_offset;
+        ++NumStackSlots;
     }
 
     return m_stack_offsets[name];
 }
+
+size_t PseudoRegisterReplaceStep::next_offset(size_t offset, AssemblyType type)
+{
+    if (type == AssemblyType::BYTE) {
+        return offset + 1;
+    } else if (type == AssemblyType::LONG_WORD) {
+        return offset + 4;
+    } else if (type == AssemblyType::QUAD_WORD || type == AssemblyType::DOUBLE) {
+        return round_up(offset + 8, 8);
+    } else if (type == AssemblyType::BYTE_ARRAY) {
+        return round_up(offset + type.size(), type.alignment());
+    }
+    return offset;
+}
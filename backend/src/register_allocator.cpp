@@ -0,0 +1,577 @@
+#include "backend/register_allocator.h"
+#include "backend/assembly_ast.h"
+#include "backend/backend_symbol_table.h"
+#include "backend/liveness_analysis.h"
+#include "backend/register_assignment.h"
+#include "backend/registers.h"
+#include "common/stats/statistic.h"
+#include <cmath>
+#include <cstdint>
+#include <format>
+#include <limits>
+#include <optional>
+#include <set>
+#include <span>
+#include <unordered_map>
+#include <unordered_set>
+#include <variant>
+#include <vector>
+
+using namespace backend;
+
+STATISTIC(NumPseudosAllocated, "regalloc", "Number of pseudo registers assigned a hard register");
+STATISTIC(NumPseudosSpilled, "regalloc", "Number of pseudo registers spilled to the stack");
+STATISTIC(NumAddressTaken, "regalloc", "Number of pseudo registers kept in memory because their address is taken");
+STATISTIC(NumMovesCoalesced, "regalloc", "Number of moves coalesced");
+STATISTIC(NumMovesDeleted, "regalloc", "Number of register to register moves deleted after allocation");
+
+namespace {
+
+// Spill cost of a use or def inside a loop is multiplied by this factor for each level of nesting
+constexpr double LOOP_WEIGHT = 10.0;
+
+// Iterated register coalescing over one register class, following Appel's "Modern Compiler Implementation", 11.4.
+// Nodes [0, K) are the hard registers of the class (precolored), the pseudo registers follow
+class GraphColoring {
+public:
+    GraphColoring(std::span<const RegisterName> registers, size_t pseudo_count)
+        : m_registers { registers }
+        , m_k { registers.size() }
+    {
+        size_t count = m_k + pseudo_count;
+        m_adjacency.resize(count);
+        m_degree.resize(count, 0);
+        m_move_list.resize(count);
+        m_alias.resize(count);
+        m_color.resize(count, 0);
+        m_state.resize(count, NodeState::INITIAL);
+        m_spill_cost.resize(count, 0.0);
+        m_mark.resize(count, 0);
+        for (size_t i = 0; i < m_k; ++i) {
+            m_state[i] = NodeState::PRECOLORED;
+            m_color[i] = i;
+            m_degree[i] = INFINITE_DEGREE;
+        }
+    }
+
+    void add_edge(size_t u, size_t v)
+    {
+        if (u == v || !m_edges.insert(edge_key(u, v)).second) {
+            return;
+        }
+        if (!is_precolored(u)) {
+            m_adjacency[u].push_back(v);
+            ++m_degree[u];
+        }
+        if (!is_precolored(v)) {
+            m_adjacency[v].push_back(u);
+            ++m_degree[v];
+        }
+    }
+
+    void add_move(size_t destination, size_t source)
+    {
+        size_t move = m_moves.size();
+        m_moves.push_back({ destination, source, MoveState::WORKLIST });
+        m_move_list[destination].push_back(move);
+        if (source != destination) {
+            m_move_list[source].push_back(move);
+        }
+        m_worklist_moves.insert(move);
+    }
+
+    void add_spill_cost(size_t node, double cost) { m_spill_cost[node] += cost; }
+
+    void run()
+    {
+        make_worklist();
+        while (true) {
+            if (!m_simplify_worklist.empty()) {
+                simplify();
+            } else if (!m_worklist_moves.empty()) {
+                coalesce();
+            } else if (!m_freeze_worklist.empty()) {
+                freeze();
+            } else if (!m_spill_worklist.empty()) {
+                select_spill();
+            } else {
+                break;
+            }
+        }
+        assign_colors();
+    }
+
+    // Hard register given to a node, nothing if the node was spilled
+    std::optional<RegisterName> register_of(size_t node) const
+    {
+        size_t representative = alias(node);
+        if (m_state[representative] == NodeState::COLORED || m_state[representative] == NodeState::PRECOLORED) {
+            return m_registers[m_color[representative]];
+        }
+        return std::nullopt;
+    }
+
+    size_t coalesced_move_count() const { return m_coalesced_moves; }
+
+    // Spill cost of a node and the number of nodes its coalesced group interferes with, the reasons for a spill
+    double spill_cost(size_t node) const { return m_spill_cost[node]; }
+    size_t interference_count(size_t node) const { return m_adjacency[alias(node)].size(); }
+
+private:
+    enum class NodeState {
+        PRECOLORED,
+        INITIAL,
+        SIMPLIFY,
+        FREEZE,
+        SPILL,
+        SELECTED,
+        COALESCED,
+        COLORED,
+        SPILLED,
+    };
+
+    enum class MoveState {
+        WORKLIST,
+        ACTIVE,
+        COALESCED,
+        CONSTRAINED,
+        FROZEN,
+    };
+
+    struct Move {
+        size_t destination;
+        size_t source;
+        MoveState state;
+    };
+
+    static constexpr size_t INFINITE_DEGREE = std::numeric_limits<size_t>::max() / 2;
+
+    static uint64_t edge_key(size_t u, size_t v)
+    {
+        if (u > v) {
+            std::swap(u, v);
+        }
+        return (static_cast<uint64_t>(u) << 32) | v;
+    }
+
+    bool is_precolored(size_t node) const { return node < m_k; }
+    bool adjacent(size_t u, size_t v) const { return m_edges.contains(edge_key(u, v)); }
+
+    template<typename Function>
+    void for_each_adjacent(size_t node, Function&& function)
+    {
+        // Indexed loop, the function can add edges to other nodes
+        for (size_t i = 0; i < m_adjacency[node].size(); ++i) {
+            size_t neighbor = m_adjacency[node][i];
+            if (m_state[neighbor] != NodeState::SELECTED && m_state[neighbor] != NodeState::COALESCED) {
+                function(neighbor);
+            }
+        }
+    }
+
+    bool move_related(size_t node) const
+    {
+        for (size_t move : m_move_list[node]) {
+            if (m_moves[move].state == MoveState::WORKLIST || m_moves[move].state == MoveState::ACTIVE) {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    size_t alias(size_t node) const
+    {
+        while (m_state[node] == NodeState::COALESCED) {
+            node = m_alias[node];
+        }
+        return node;
+    }
+
+    void set_state(size_t node, NodeState state)
+    {
+        switch (m_state[node]) {
+        case NodeState::SIMPLIFY:
+            m_simplify_worklist.erase(node);
+            break;
+        case NodeState::FREEZE:
+            m_freeze_worklist.erase(node);
+            break;
+        case NodeState::SPILL:
+            m_spill_worklist.erase(node);
+            break;
+        default:
+            break;
+        }
+        m_state[node] = state;
+        switch (state) {
+        case NodeState::SIMPLIFY:
+            m_simplify_worklist.insert(node);
+            break;
+        case NodeState::FREEZE:
+            m_freeze_worklist.insert(node);
+            break;
+        case NodeState::SPILL:
+            m_spill_worklist.insert(node);
+            break;
+        default:
+            break;
+        }
+    }
+
+    void make_worklist()
+    {
+        for (size_t node = m_k; node < m_state.size(); ++node) {
+            if (m_degree[node] >= m_k) {
+                set_state(node, NodeState::SPILL);
+            } else if (move_related(node)) {
+                set_state(node, NodeState::FREEZE);
+            } else {
+                set_state(node, NodeState::SIMPLIFY);
+            }
+        }
+    }
+
+    void simplify()
+    {
+        size_t node = *m_simplify_worklist.begin();
+        set_state(node, NodeState::SELECTED);
+        m_select_stack.push_back(node);
+        for_each_adjacent(node, [this](size_t neighbor) { decrement_degree(neighbor); });
+    }
+
+    void decrement_degree(size_t node)
+    {
+        if (is_precolored(node)) {
+            return;
+        }
+        size_t degree = m_degree[node]--;
+        if (degree == m_k && m_state[node] == NodeState::SPILL) {
+            enable_moves(node);
+            for_each_adjacent(node, [this](size_t neighbor) { enable_moves(neighbor); });
+            set_state(node, move_related(node) ? NodeState::FREEZE : NodeState::SIMPLIFY);
+        }
+    }
+
+    void enable_moves(size_t node)
+    {
+        for (size_t move : m_move_list[node]) {
+            if (m_moves[move].state == MoveState::ACTIVE) {
+                m_moves[move].state = MoveState::WORKLIST;
+                m_worklist_moves.insert(move);
+            }
+        }
+    }
+
+    void add_worklist(size_t node)
+    {
+        if (!is_precolored(node) && !move_related(node) && m_degree[node] < m_k && m_state[node] == NodeState::FREEZE) {
+            set_state(node, NodeState::SIMPLIFY);
+        }
+    }
+
+    // George's test: every neighbor of v is already adjacent to the hard register u or is harmless
+    bool george(size_t u, size_t v)
+    {
+        bool ok = true;
+        for_each_adjacent(v, [&](size_t t) {
+            ok = ok && (m_degree[t] < m_k || is_precolored(t) || adjacent(t, u));
+        });
+        return ok;
+    }
+
+    // Briggs' test: the combined node has fewer than K neighbors of significant degree
+    bool briggs(size_t u, size_t v)
+    {
+        ++m_mark_epoch;
+        size_t significant = 0;
+        auto count = [&](size_t t) {
+            if (m_mark[t] != m_mark_epoch) {
+                m_mark[t] = m_mark_epoch;
+                if (m_degree[t] >= m_k) {
+                    ++significant;
+                }
+            }
+        };
+        for_each_adjacent(u, count);
+        for_each_adjacent(v, count);
+        return significant < m_k;
+    }
+
+    void coalesce()
+    {
+        size_t move = *m_worklist_moves.begin();
+        m_worklist_moves.erase(m_worklist_moves.begin());
+        size_t x = alias(m_moves[move].destination);
+        size_t y = alias(m_moves[move].source);
+        size_t u = is_precolored(y) ? y : x;
+        size_t v = is_precolored(y) ? x : y;
+
+        if (u == v) {
+            m_moves[move].state = MoveState::COALESCED;
+            ++m_coalesced_moves;
+            add_worklist(u);
+        } else if (is_precolored(v) || adjacent(u, v)) {
+            m_moves[move].state = MoveState::CONSTRAINED;
+            add_worklist(u);
+            add_worklist(v);
+        } else if ((is_precolored(u) && george(u, v)) || (!is_precolored(u) && briggs(u, v))) {
+            m_moves[move].state = MoveState::COALESCED;
+            ++m_coalesced_moves;
+            combine(u, v);
+            add_worklist(u);
+        } else {
+            m_moves[move].state = MoveState::ACTIVE;
+        }
+    }
+
+    void combine(size_t u, size_t v)
+    {
+        set_state(v, NodeState::COALESCED);
+        m_alias[v] = u;
+        m_move_list[u].insert(m_move_list[u].end(), m_move_list[v].begin(), m_move_list[v].end());
+        enable_moves(v);
+        for_each_adjacent(v, [&](size_t t) {
+            add_edge(t, u);
+            decrement_degree(t);
+        });
+        if (m_degree[u] >= m_k && m_state[u] == NodeState::FREEZE) {
+            set_state(u, NodeState::SPILL);
+        }
+    }
+
+    void freeze()
+    {
+        size_t node = *m_freeze_worklist.begin();
+        set_state(node, NodeState::SIMPLIFY);
+        freeze_moves(node);
+    }
+
+    void freeze_moves(size_t node)
+    {
+        for (size_t move : m_move_list[node]) {
+            MoveState state = m_moves[move].state;
+            if (state != MoveState::WORKLIST && state != MoveState::ACTIVE) {
+                continue;
+            }
+            if (state == MoveState::WORKLIST) {
+                m_worklist_moves.erase(move);
+            }
+            m_moves[move].state = MoveState::FROZEN;
+
+            size_t x = alias(m_moves[move].destination);
+            size_t y = alias(m_moves[move].source);
+            size_t other = (y == alias(node)) ? x : y;
+            if (!is_precolored(other) && !move_related(other) && m_degree[other] < m_k && m_state[other] == NodeState::FREEZE) {
+                set_state(other, NodeState::SIMPLIFY);
+            }
+        }
+    }
+
+    void select_spill()
+    {
+        // Cheapest value per interference removed: rarely used values with many neighbors go first
+        size_t candidate = *m_spill_worklist.begin();
+        double best = std::numeric_limits<double>::infinity();
+        for (size_t node : m_spill_worklist) {
+            double metric = m_spill_cost[node] / static_cast<double>(m_degree[node]);
+            if (metric < best) {
+                best = metric;
+                candidate = node;
+            }
+        }
+        set_state(candidate, NodeState::SIMPLIFY);
+        freeze_moves(candidate);
+    }
+
+    void assign_colors()
+    {
+        std::vector<bool> used(m_k);
+        while (!m_select_stack.empty()) {
+            size_t node = m_select_stack.back();
+            m_select_stack.pop_back();
+
+            std::fill(used.begin(), used.end(), false);
+            for (size_t neighbor : m_adjacency[node]) {
+                size_t representative = alias(neighbor);
+                if (m_state[representative] == NodeState::COLORED || m_state[representative] == NodeState::PRECOLORED) {
+                    used[m_color[representative]] = true;
+                }
+            }
+
+            // Prefer the register of a value this one is copied to or from, the copy then disappears
+            std::optional<size_t> color;
+            for (size_t move : m_move_list[node]) {
+                size_t x = alias(m_moves[move].destination);
+                size_t y = alias(m_moves[move].source);
+                size_t other = (x == node) ? y : x;
+                if ((m_state[other] == NodeState::COLORED || m_state[other] == NodeState::PRECOLORED) && !used[m_color[other]]) {
+                    color = m_color[other];
+                    break;
+                }
+            }
+            // Registers are listed caller-saved first, so values that do not live across a call leave the
+            // callee-saved registers alone
+            for (size_t c = 0; !color && c < m_k; ++c) {
+                if (!used[c]) {
+                    color = c;
+                }
+            }
+
+            if (color) {
+                m_state[node] = NodeState::COLORED;
+                m_color[node] = *color;
+            } else {
+                m_state[node] = NodeState::SPILLED;
+            }
+        }
+    }
+
+    std::span<const RegisterName> m_registers;
+    size_t m_k;
+
+    std::unordered_set<uint64_t> m_edges;
+    std::vector<std::vector<size_t>> m_adjacency;
+    std::vector<size_t> m_degree;
+    std::vector<std::vector<size_t>> m_move_list;
+    std::vector<size_t> m_alias;
+    std::vector<size_t> m_color;
+    std::vector<NodeState> m_state;
+    std::vector<double> m_spill_cost;
+
+    std::set<size_t> m_simplify_worklist;
+    std::set<size_t> m_freeze_worklist;
+    std::set<size_t> m_spill_worklist;
+    std::set<size_t> m_worklist_moves;
+    std::vector<size_t> m_select_stack;
+    std::vector<Move> m_moves;
+    size_t m_coalesced_moves { 0 };
+
+    // Scratch marks for Briggs' test
+    std::vector<size_t> m_mark;
+    size_t m_mark_epoch { 0 };
+};
+
+}
+
+RegisterAllocator::RegisterAllocator(std::shared_ptr<AssemblyAST> ast, std::shared_ptr<BackendSymbolTable> symbol_table, std::shared_ptr<RemarkManager> remark_manager)
+    : m_ast { ast }
+    , m_symbol_table { symbol_table }
+    , m_remark_manager { remark_manager }
+{
+    if (!m_ast || !dynamic_cast<Program*>(m_ast.get())) {
+        throw RegisterAllocatorError("RegisterAllocator: Invalid AST");
+    }
+}
+
+void RegisterAllocator::allocate()
+{
+    auto& program = dynamic_cast<Program&>(*m_ast);
+    for (auto& definition : program.definitions) {
+        if (auto function = dynamic_cast<FunctionDefinition*>(definition.get())) {
+            allocate_function(*function);
+        }
+    }
+}
+
+void RegisterAllocator::allocate_function(FunctionDefinition& function)
+{
+    LivenessAnalysis liveness(function, *m_symbol_table);
+    NumAddressTaken += liveness.address_taken_count();
+
+    RegisterAssignment assignment;
+    size_t coalesced_moves = 0;
+    size_t spilled = 0;
+    bool remarks = m_remark_manager && m_remark_manager->is_enabled();
+    std::vector<std::optional<SourceLocationIndex>> locations = remarks ? pseudo_source_locations(function, liveness) : std::vector<std::optional<SourceLocationIndex>> {};
+
+    // The two register classes never interfere, each one is colored on its own
+    for (bool xmm : { false, true }) {
+        std::span<const RegisterName> registers = xmm ? std::span<const RegisterName>(XMM_ALLOCATABLE_REGISTERS) : std::span<const RegisterName>(GP_ALLOCATABLE_REGISTERS);
+
+        // Graph node of every location in this class, hard registers that are not allocatable have none
+        constexpr size_t NO_NODE = std::numeric_limits<size_t>::max();
+        std::vector<size_t> nodes(liveness.location_count(), NO_NODE);
+        for (size_t i = 0; i < registers.size(); ++i) {
+            nodes[static_cast<size_t>(registers[i])] = i;
+        }
+        std::vector<size_t> pseudos;
+        for (size_t location = LivenessAnalysis::FIRST_PSEUDO; location < liveness.location_count(); ++location) {
+            if (liveness.is_xmm(location) == xmm) {
+                nodes[location] = registers.size() + pseudos.size();
+                pseudos.push_back(location);
+            }
+        }
+        if (pseudos.empty()) {
+            continue;
+        }
+
+        GraphColoring graph(registers, pseudos.size());
+        for (size_t b = 0; b < liveness.blocks().size(); ++b) {
+            const auto& block = liveness.blocks()[b];
+            double weight = std::pow(LOOP_WEIGHT, static_cast<double>(std::min<size_t>(block.loop_depth, 8)));
+            LiveSet live = liveness.live_out(b);
+            for (size_t i = block.end; i-- > block.begin;) {
+                const auto& uses = liveness.uses(i);
+                const auto& defs = liveness.defs(i);
+                if (liveness.is_move(i) && nodes[uses[0]] != NO_NODE && nodes[defs[0]] != NO_NODE) {
+                    // The source of a copy does not interfere with its destination, they may share a register
+                    live.reset(uses[0]);
+                    graph.add_move(nodes[defs[0]], nodes[uses[0]]);
+                }
+                for (size_t d : defs) {
+                    live.set(d);
+                }
+                for (size_t d : defs) {
+                    if (nodes[d] == NO_NODE) {
+                        continue;
+                    }
+                    live.for_each([&](size_t l) {
+                        if (nodes[l] != NO_NODE) {
+                            graph.add_edge(nodes[l], nodes[d]);
+                        }
+                    });
+                }
+                for (size_t location : uses) {
+                    if (LivenessAnalysis::is_pseudo(location) && nodes[location] != NO_NODE) {
+                        graph.add_spill_cost(nodes[location], weight);
+                    }
+                }
+                for (size_t location : defs) {
+                    if (LivenessAnalysis::is_pseudo(location) && nodes[location] != NO_NODE) {
+                        graph.add_spill_cost(nodes[location], weight);
+                    }
+                }
+                liveness.step_backward(live, i);
+            }
+        }
+
+        graph.run();
+        coalesced_moves += graph.coalesced_move_count();
+        for (size_t location : pseudos) {
+            const std::string& name = liveness.pseudo_name(location);
+            std::optional<SourceLocationIndex> source_location = remarks ? locations[location - LivenessAnalysis::FIRST_PSEUDO] : std::nullopt;
+            if (auto reg = graph.register_of(nodes[location])) {
+                assignment.emplace(name, *reg);
+                emit_remark(m_remark_manager, RemarkKind::PASSED, "regalloc", function.name.name, source_location, "'{}' kept in a register", name);
+            } else {
+                ++spilled;
+                emit_remark(m_remark_manager, RemarkKind::MISSED, "regalloc", function.name.name, source_location,
+                    "'{}' spilled to the stack, it interferes with {} values and its spill cost is {:g}", name, graph.interference_count(nodes[location]),
+                    graph.spill_cost(nodes[location]));
+            }
+        }
+    }
+
+    size_t deleted = apply_register_assignment(function, liveness, assignment);
+    std::get<FunctionEntry>(m_symbol_table->symbol_at(function.name.name)).callee_saved_registers = used_callee_saved_registers(assignment);
+
+    NumPseudosAllocated += assignment.size();
+    NumPseudosSpilled += spilled;
+    NumMovesCoalesced += coalesced_moves;
+    NumMovesDeleted += deleted;
+
+    if (remarks && (assignment.size() + spilled) > 0) {
+        m_remark_manager->emit(RemarkKind::ANALYSIS, "regalloc", function.name.name, function.source_location,
+            std::format("{} values assigned to registers, {} spilled, {} copies coalesced", assignment.size(), spilled, deleted));
+    }
+}
@@ -0,0 +1,66 @@
+#include "backend/register_assignment.h"
+#include "backend/assembly_ast.h"
+#include "backend/liveness_analysis.h"
+#include "backend/registers.h"
+#include <algorithm>
+#include <memory>
+#include <vector>
+
+using namespace backend;
+
+size_t backend::apply_register_assignment(FunctionDefinition& function, const LivenessAnalysis& liveness, const RegisterAssignment& assignment)
+{
+    for (size_t i = 0; i < function.instructions.size(); ++i) {
+        for (const OperandSlot& slot : liveness.use_def(i).operands) {
+            if (auto pseudo = dynamic_cast<PseudoRegister*>(slot.operand->get())) {
+                auto it = assignment.find(pseudo->identifier.name);
+                if (it != assignment.end()) {
+                    *slot.operand = std::make_unique<Register>(it->second, slot.type);
+                }
+            }
+        }
+    }
+
+    // Copies between values that ended up in the same register are no-ops
+    size_t before = function.instructions.size();
+    std::erase_if(function.instructions, [](const std::unique_ptr<Instruction>& instruction) {
+        auto mov = dynamic_cast<MovInstruction*>(instruction.get());
+        if (!mov) {
+            return false;
+        }
+        auto source = dynamic_cast<Register*>(mov->source.get());
+        auto destination = dynamic_cast<Register*>(mov->destination.get());
+        return source && destination && source->name == destination->name;
+    });
+    return before - function.instructions.size();
+}
+
+std::vector<RegisterName> backend::used_callee_saved_registers(const RegisterAssignment& assignment)
+{
+    std::vector<RegisterName> registers;
+    for (const auto& [name, reg] : assignment) {
+        if (!is_caller_saved(reg) && std::ranges::find(registers, reg) == registers.end()) {
+            registers.push_back(reg);
+        }
+    }
+    std::ranges::sort(registers);
+    return registers;
+}
+
+std::vector<std::optional<SourceLocationIndex>> backend::pseudo_source_locations(const FunctionDefinition& function, const LivenessAnalysis& liveness)
+{
+    std::vector<std::optional<SourceLocationIndex>> locations(liveness.location_count() - LivenessAnalysis::FIRST_PSEUDO);
+    for (size_t i = 0; i < function.instructions.size(); ++i) {
+        if (!function.instructions[i]->source_location) {
+            continue;
+        }
+        for (const auto* accessed : { &liveness.uses(i), &liveness.defs(i) }) {
+            for (size_t location : *accessed) {
+                if (LivenessAnalysis::is_pseudo(location) && !locations[location - LivenessAnalysis::FIRST_PSEUDO]) {
+                    locations[location - LivenessAnalysis::FIRST_PSEUDO] = function.instructions[i]->source_location;
+                }
+            }
+        }
+    }
+    return locations;
+}
@@ -0,0 +1,159 @@
+#include "backend/divide_by_constant.h"
+#include <cstdint>
+#include <gtest/gtest.h>
+#include <limits>
+#include <optional>
+#include <random>
+#include <utility>
+#include <vector>
+
+using namespace backend;
+
+namespace {
+
+uint64_t mask_of(int width)
+{
+    return width == 64 ? ~uint64_t { 0 } : 0xFFFFFFFF;
+}
+
+int64_t as_signed(uint64_t value, int width)
+{
+    return width == 64 ? static_cast<int64_t>(value) : static_cast<int32_t>(static_cast<uint32_t>(value));
+}
+
+// Quotient and remainder as div and idiv compute them, nothing for the divisions that trap
+std::optional<std::pair<uint64_t, uint64_t>> divide(uint64_t dividend, uint64_t divisor, int width, bool is_signed)
+{
+    uint64_t mask = mask_of(width);
+    if (!is_signed) {
+        return std::pair { (dividend / divisor) & mask, (dividend % divisor) & mask };
+    }
+    int64_t x = as_signed(dividend, width);
+    int64_t d = as_signed(divisor, width);
+    int64_t min = width == 64 ? std::numeric_limits<int64_t>::min() : std::numeric_limits<int32_t>::min();
+    if (d == -1 && x == min) {
+        return std::nullopt;
+    }
+    return std::pair { static_cast<uint64_t>(x / d) & mask, static_cast<uint64_t>(x % d) & mask };
+}
+
+std::vector<uint64_t> interesting_divisors()
+{
+    std::vector<uint64_t> divisors;
+    for (int64_t d = -1000; d <= 1000; ++d) {
+        divisors.push_back(static_cast<uint64_t>(d));
+    }
+    for (int shift = 1; shift < 64; ++shift) {
+        uint64_t power = uint64_t { 1 } << shift;
+        for (int64_t delta : { -3, -1, 0, 1, 3 }) {
+            divisors.push_back(power + delta);
+            divisors.push_back(0 - power + delta);
+        }
+    }
+    for (uint64_t d : { 0x7FFFFFFFull, 0x80000001ull, 0xFFFFFFFFull, 0xFFFFFFFEull, 0x7FFFFFFFFFFFFFFFull, 0xFFFFFFFFFFFFFFFFull,
+             641ull, 6700417ull, 1000000007ull, 274177ull, 67280421310721ull }) {
+        divisors.push_back(d);
+    }
+    std::mt19937_64 generator(7);
+    for (int i = 0; i < 200; ++i) {
+        divisors.push_back(generator() >> (generator() % 64));
+    }
+    return divisors;
+}
+
+std::vector<uint64_t> interesting_dividends(int width)
+{
+    uint64_t mask = mask_of(width);
+    uint64_t sign_bit = uint64_t { 1 } << (width - 1);
+    std::vector<uint64_t> dividends { 0, 1, 2, 3, 7, mask, mask - 1, sign_bit, sign_bit - 1, sign_bit + 1 };
+    for (int64_t x = -300; x <= 300; ++x) {
+        dividends.push_back(static_cast<uint64_t>(x) & mask);
+    }
+    std::mt19937_64 generator(width);
+    for (int i = 0; i < 300; ++i) {
+        dividends.push_back(generator() & mask);
+        dividends.push_back((generator() >> (generator() % width)) & mask);
+    }
+    return dividends;
+}
+
+}
+
+TEST(DivideByConstantTest, DivisionByZeroHasNoPlan)
+{
+    EXPECT_FALSE(plan_divide_by_constant(0, 32, true));
+    EXPECT_FALSE(plan_divide_by_constant(0x100000000ull, 32, false));
+}
+
+TEST(DivideByConstantTest, UnsignedPowerOfTwoIsShift)
+{
+    auto plan = plan_divide_by_constant(64, 64, false);
+    ASSERT_TRUE(plan);
+    EXPECT_EQ(plan->kind, DivisionPlan::Kind::SHIFT);
+    EXPECT_EQ(plan->shift, 6);
+}
+
+TEST(DivideByConstantTest, SignedPowerOfTwoRoundsTowardZero)
+{
+    auto plan = plan_divide_by_constant(static_cast<uint64_t>(-4), 32, true);
+    ASSERT_TRUE(plan);
+    EXPECT_EQ(plan->kind, DivisionPlan::Kind::SIGNED_SHIFT);
+    EXPECT_TRUE(plan->negate);
+    EXPECT_EQ(evaluate_division_plan(*plan, static_cast<uint32_t>(-7), 32), 1u);
+}
+
+TEST(DivideByConstantTest, KnownMagicNumbers)
+{
+    // Unsigned 32 bit division by 3 multiplies by 0xAAAAAAAB and shifts by 1
+    auto by_three = plan_divide_by_constant(3, 32, false);
+    ASSERT_TRUE(by_three);
+    EXPECT_EQ(by_three->kind, DivisionPlan::Kind::MULTIPLY_HIGH);
+    EXPECT_EQ(by_three->magic, 0xAAAAAAABu);
+    EXPECT_EQ(by_three->shift, 1);
+
+    // Unsigned 32 bit division by 7 needs a 33 bit magic
+    auto by_seven = plan_divide_by_constant(7, 32, false);
+    ASSERT_TRUE(by_seven);
+    EXPECT_EQ(by_seven->kind, DivisionPlan::Kind::MULTIPLY_HIGH_ADD);
+    EXPECT_EQ(by_seven->magic, 0x24924925u);
+    EXPECT_EQ(by_seven->shift, 3);
+
+    // Signed 32 bit division by 7, from Hacker's Delight
+    auto signed_by_seven = plan_divide_by_constant(7, 32, true);
+    ASSERT_TRUE(signed_by_seven);
+    EXPECT_EQ(signed_by_seven->kind, DivisionPlan::Kind::SIGNED_MULTIPLY_HIGH);
+    EXPECT_EQ(signed_by_seven->magic, 0x92492493u);
+    EXPECT_EQ(signed_by_seven->shift, 2);
+    EXPECT_EQ(signed_by_seven->correction, 1);
+}
+
+TEST(DivideByConstantTest, PlansMatchRealDivision)
+{
+    auto divisors = interesting_divisors();
+    for (int width : { 32, 64 }) {
+        uint64_t mask = mask_of(width);
+        auto dividends = interesting_dividends(width);
+        for (bool is_signed : { false, true }) {
+            for (uint64_t divisor : divisors) {
+                divisor &= mask;
+                auto plan = plan_divide_by_constant(divisor, width, is_signed);
+                if (divisor == 0) {
+                    EXPECT_FALSE(plan);
+                    continue;
+                }
+                ASSERT_TRUE(plan);
+                for (uint64_t dividend : dividends) {
+                    auto expected = divide(dividend, divisor, width, is_signed);
+                    if (!expected) {
+                        continue;
+                    }
+                    uint64_t quotient = evaluate_division_plan(*plan, dividend, width);
+                    // The remainder is computed from the quotient as x - q * d
+                    uint64_t remainder = (dividend - quotient * divisor) & mask;
+                    ASSERT_EQ(quotient, expected->first) << (is_signed ? "signed" : "unsigned") << " width " << width << " " << dividend << " / " << divisor;
+                    ASSERT_EQ(remainder, expected->second) << (is_signed ? "signed" : "unsigned") << " width " << width << " " << dividend << " % " << divisor;
+                }
+            }
+        }
+    }
+}
@@ -0,0 +1,107 @@
+#include "backend/assembly_ast.h"
+#include "backend/backend_symbol_table.h"
+#include "backend/fixup_instruction_step.h"
+#include "common/stats/statistic.h"
+#include <cstring>
+#include <gtest/gtest.h>
+#include <memory>
+#include <vector>
+
+using namespace backend;
+
+class FixUpInstructionsStepTest : public ::testing::Test {
+protected:
+    // Runs the fixup step on "f" with the given frame size and saved registers and returns its instructions
+    std::vector<std::unique_ptr<Instruction>>& fixup(size_t stack_frame_size, std::vector<RegisterName> callee_saved)
+    {
+        auto symbol_table = std::make_shared<BackendSymbolTable>();
+        FunctionEntry entry { stack_frame_size, true, {}, { RegisterName::AX } };
+        entry.callee_saved_registers = std::move(callee_saved);
+        symbol_table->insert_symbol("f", entry);
+
+        std::vector<std::unique_ptr<TopLevel>> definitions;
+        definitions.push_back(std::make_unique<FunctionDefinition>("f", true, std::move(body)));
+        ast = std::make_shared<Program>(std::move(definitions));
+        FixUpInstructionsStep step(ast, symbol_table);
+        step.fixup();
+        auto& program = dynamic_cast<Program&>(*ast);
+        return dynamic_cast<FunctionDefinition&>(*program.definitions[0]).instructions;
+    }
+
+    static uint64_t statistic(const char* name)
+    {
+        for (const stats::Statistic* statistic : stats::StatisticRegistry::instance().statistics()) {
+            if (std::strcmp(statistic->name(), name) == 0) {
+                return statistic->value();
+            }
+        }
+        ADD_FAILURE() << "no statistic " << name;
+        return 0;
+    }
+
+    static long frame_allocation(const std::unique_ptr<Instruction>& instruction)
+    {
+        auto sub = dynamic_cast<BinaryInstruction*>(instruction.get());
+        EXPECT_NE(sub, nullptr);
+        EXPECT_EQ(sub->binary_operator, BinaryOperator::SUB);
+        return std::get<long>(dynamic_cast<ImmediateValue*>(sub->source.get())->value);
+    }
+
+    std::shared_ptr<AssemblyAST> ast;
+    std::vector<std::unique_ptr<Instruction>> body;
+};
+
+TEST_F(FixUpInstructionsStepTest, NoCalleeSavedRegistersNoPushes)
+{
+    body.push_back(std::make_unique<ReturnInstruction>());
+    auto& instructions = fixup(20, {});
+    ASSERT_EQ(instructions.size(), 2u);
+    EXPECT_EQ(frame_allocation(instructions[0]), 32);
+    EXPECT_NE(dynamic_cast<ReturnInstruction*>(instructions[1].get()), nullptr);
+}
+
+TEST_F(FixUpInstructionsStepTest, SavesUsedCalleeSavedRegistersAndKeepsAlignment)
+{
+    body.push_back(std::make_unique<MovInstruction>(AssemblyType::LONG_WORD, std::make_unique<ImmediateValue>(1), std::make_unique<Register>(RegisterName::BX)));
+    body.push_back(std::make_unique<ReturnInstruction>());
+    body.push_back(std::make_unique<ReturnInstruction>());
+    auto& instructions = fixup(20, { RegisterName::BX, RegisterName::R12, RegisterName::R13 });
+
+    // 20 bytes of locals and 24 bytes of saved registers round up to 48
+    EXPECT_EQ(frame_allocation(instructions[0]), 24);
+    std::vector<RegisterName> pushed;
+    for (size_t i = 1; i <= 3; ++i) {
+        auto push = dynamic_cast<PushInstruction*>(instructions[i].get());
+        ASSERT_NE(push, nullptr);
+        pushed.push_back(dynamic_cast<Register*>(push->destination.get())->name);
+    }
+    EXPECT_EQ(pushed, (std::vector<RegisterName> { RegisterName::BX, RegisterName::R12, RegisterName::R13 }));
+
+    // Every return pops them in reverse order
+    size_t returns = 0;
+    for (size_t i = 0; i < instructions.size(); ++i) {
+        if (!dynamic_cast<ReturnInstruction*>(instructions[i].get())) {
+            continue;
+        }
+        ++returns;
+        ASSERT_GE(i, 3u);
+        std::vector<RegisterName> popped;
+        for (size_t j = i - 3; j < i; ++j) {
+            auto pop = dynamic_cast<PopInstruction*>(instructions[j].get());
+            ASSERT_NE(pop, nullptr);
+            popped.push_back(pop->reg);
+        }
+        EXPECT_EQ(popped, (std::vector<RegisterName> { RegisterName::R13, RegisterName::R12, RegisterName::BX }));
+    }
+    EXPECT_EQ(returns, 2u);
+}
+
+TEST_F(FixUpInstructionsStepTest, CountsTheInstructionsInserted)
+{
+    stats::StatisticRegistry::instance().reset();
+    // The immediate goes to R10 first and the result is stored from R11, two instructions around the movsx
+    body.push_back(std::make_unique<MovsxInstruction>(AssemblyType::LONG_WORD, AssemblyType::QUAD_WORD, std::make_unique<ImmediateValue>(-1), std::make_unique<MemoryAddress>(RegisterName::BP, -8)));
+    body.push_back(std::make_unique<ReturnInstruction>());
+    fixup(8, {});
+    EXPECT_EQ(statistic("NumMovsxFixups"), 2u);
+}
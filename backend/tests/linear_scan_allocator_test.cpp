@@ -0,0 +1,229 @@
+#include "backend/assembly_ast.h"
+#include "backend/backend_symbol_table.h"
+#include "backend/linear_scan_allocator.h"
+#include "common/data/remark_manager.h"
+#include <algorithm>
+#include <gtest/gtest.h>
+#include <memory>
+#include <string>
+#include <vector>
+
+using namespace backend;
+
+class LinearScanAllocatorTest : public ::testing::Test {
+protected:
+    void SetUp() override
+    {
+        symbol_table = std::make_shared<BackendSymbolTable>();
+        symbol_table->insert_symbol("f", FunctionEntry { 0, true, { RegisterName::DI }, { RegisterName::AX } });
+        symbol_table->insert_symbol("g", FunctionEntry { 0, false, {}, { RegisterName::AX } });
+    }
+
+    void add_object(const std::string& name, AssemblyType type, bool is_static = false)
+    {
+        symbol_table->insert_symbol(name, ObjectEntry { type, is_static, false });
+    }
+
+    std::unique_ptr<Operand> pseudo(const std::string& name) { return std::make_unique<PseudoRegister>(name); }
+    std::unique_ptr<Operand> reg(RegisterName name) { return std::make_unique<Register>(name); }
+    std::unique_ptr<Operand> imm(int value) { return std::make_unique<ImmediateValue>(value); }
+
+    // Runs the allocator on "f" and returns its instructions
+    std::vector<std::unique_ptr<Instruction>>& allocate()
+    {
+        std::vector<std::unique_ptr<TopLevel>> definitions;
+        definitions.push_back(std::make_unique<FunctionDefinition>("f", true, std::move(body)));
+        ast = std::make_shared<Program>(std::move(definitions));
+        LinearScanAllocator allocator(ast, symbol_table, remark_manager);
+        allocator.allocate();
+        auto& program = dynamic_cast<Program&>(*ast);
+        return dynamic_cast<FunctionDefinition&>(*program.definitions[0]).instructions;
+    }
+
+    static bool is_pseudo(const std::unique_ptr<Operand>& operand)
+    {
+        return dynamic_cast<PseudoRegister*>(operand.get()) != nullptr;
+    }
+
+    static Register* as_register(const std::unique_ptr<Operand>& operand)
+    {
+        return dynamic_cast<Register*>(operand.get());
+    }
+
+    // Remark manager whose location index i resolves to line i + 1
+    void enable_remarks(size_t lines)
+    {
+        auto tokens = std::make_shared<std::vector<Token>>();
+        for (size_t line = 1; line <= lines; ++line) {
+            tokens->emplace_back(TokenType::IDENTIFIER, "x", std::monostate {}, SourceLocation("file.c", line, 1));
+        }
+        auto source_manager = std::make_shared<SourceManager>();
+        source_manager->set_token_list(tokens);
+        remark_manager = std::make_shared<RemarkManager>(source_manager, true);
+    }
+
+    std::shared_ptr<BackendSymbolTable> symbol_table;
+    std::shared_ptr<RemarkManager> remark_manager;
+    std::shared_ptr<AssemblyAST> ast;
+    std::vector<std::unique_ptr<Instruction>> body;
+};
+
+TEST_F(LinearScanAllocatorTest, ReusesRegisterOfCopySource)
+{
+    add_object("a", AssemblyType::LONG_WORD);
+    add_object("b", AssemblyType::LONG_WORD);
+    // b = a + 1; return b
+    body.push_back(std::make_unique<MovInstruction>(AssemblyType::LONG_WORD, reg(RegisterName::DI), pseudo("a")));
+    body.push_back(std::make_unique<MovInstruction>(AssemblyType::LONG_WORD, pseudo("a"), pseudo("b")));
+    body.push_back(std::make_unique<BinaryInstruction>(BinaryOperator::ADD, AssemblyType::LONG_WORD, imm(1), pseudo("b")));
+    body.push_back(std::make_unique<MovInstruction>(AssemblyType::LONG_WORD, pseudo("b"), reg(RegisterName::AX)));
+    body.push_back(std::make_unique<ReturnInstruction>());
+
+    auto& instructions = allocate();
+    // a takes the argument register and b the register of one of its copy partners, only one copy is left
+    ASSERT_EQ(instructions.size(), 3u);
+    auto it = std::find_if(instructions.begin(), instructions.end(), [](const auto& instruction) {
+        return dynamic_cast<BinaryInstruction*>(instruction.get()) != nullptr;
+    });
+    ASSERT_NE(it, instructions.end());
+    auto add = dynamic_cast<BinaryInstruction*>(it->get());
+    ASSERT_NE(as_register(add->destination), nullptr);
+    RegisterName b = as_register(add->destination)->name;
+    EXPECT_TRUE(b == RegisterName::DI || b == RegisterName::AX);
+    EXPECT_EQ(as_register(add->destination)->type, AssemblyType::LONG_WORD);
+}
+
+TEST_F(LinearScanAllocatorTest, ValueLiveAcrossCallIsInCalleeSavedRegister)
+{
+    add_object("x", AssemblyType::QUAD_WORD);
+    add_object("y", AssemblyType::QUAD_WORD);
+    body.push_back(std::make_unique<MovInstruction>(AssemblyType::QUAD_WORD, imm(5), pseudo("x")));
+    body.push_back(std::make_unique<CallInstruction>("g"));
+    body.push_back(std::make_unique<MovInstruction>(AssemblyType::QUAD_WORD, reg(RegisterName::AX), pseudo("y")));
+    body.push_back(std::make_unique<BinaryInstruction>(BinaryOperator::ADD, AssemblyType::QUAD_WORD, pseudo("x"), pseudo("y")));
+    body.push_back(std::make_unique<MovInstruction>(AssemblyType::QUAD_WORD, pseudo("y"), reg(RegisterName::AX)));
+    body.push_back(std::make_unique<ReturnInstruction>());
+
+    auto& instructions = allocate();
+    auto first = dynamic_cast<MovInstruction*>(instructions[0].get());
+    ASSERT_NE(first, nullptr);
+    // x stays in a callee-saved register, which the function now has to save
+    auto x = as_register(first->destination);
+    ASSERT_NE(x, nullptr);
+    EXPECT_TRUE(x->name == RegisterName::BX || (x->name >= RegisterName::R12 && x->name <= RegisterName::R15));
+    const auto& saved = std::get<FunctionEntry>(symbol_table->symbol_at("f")).callee_saved_registers;
+    EXPECT_EQ(saved, std::vector<RegisterName> { x->name });
+}
+
+TEST_F(LinearScanAllocatorTest, SpillsIntervalThatEndsLast)
+{
+    // Fifteen values are live at the same time but only twelve general purpose registers can be assigned.
+    // They die in order, so the ones defined last live longest and are the ones spilled
+    const int count = 15;
+    for (int i = 0; i < count; ++i) {
+        add_object("v" + std::to_string(i), AssemblyType::LONG_WORD);
+        body.push_back(std::make_unique<MovInstruction>(AssemblyType::LONG_WORD, imm(i), pseudo("v" + std::to_string(i))));
+    }
+    add_object("sum", AssemblyType::LONG_WORD);
+    body.push_back(std::make_unique<MovInstruction>(AssemblyType::LONG_WORD, imm(0), pseudo("sum")));
+    for (int i = 0; i < count; ++i) {
+        body.push_back(std::make_unique<BinaryInstruction>(BinaryOperator::ADD, AssemblyType::LONG_WORD, pseudo("v" + std::to_string(i)), pseudo("sum")));
+    }
+    body.push_back(std::make_unique<MovInstruction>(AssemblyType::LONG_WORD, pseudo("sum"), reg(RegisterName::AX)));
+    body.push_back(std::make_unique<ReturnInstruction>());
+
+    auto& instructions = allocate();
+    int spilled = 0;
+    std::vector<RegisterName> used;
+    for (int i = 0; i < count; ++i) {
+        auto mov = dynamic_cast<MovInstruction*>(instructions[i].get());
+        ASSERT_NE(mov, nullptr);
+        if (is_pseudo(mov->destination)) {
+            ++spilled;
+        } else {
+            ASSERT_NE(as_register(mov->destination), nullptr);
+            RegisterName name = as_register(mov->destination)->name;
+            EXPECT_EQ(std::count(used.begin(), used.end(), name), 0);
+            used.push_back(name);
+        }
+    }
+    EXPECT_GE(spilled, 3);
+    auto first = dynamic_cast<MovInstruction*>(instructions[0].get());
+    EXPECT_NE(as_register(first->destination), nullptr);
+}
+
+TEST_F(LinearScanAllocatorTest, ValueLiveAroundLoopKeepsItsRegister)
+{
+    add_object("i", AssemblyType::LONG_WORD);
+    add_object("t", AssemblyType::LONG_WORD);
+    // i = 0; loop: t = i; t += 1; i = t; if (i < 10) goto loop; return i
+    body.push_back(std::make_unique<MovInstruction>(AssemblyType::LONG_WORD, imm(0), pseudo("i")));
+    body.push_back(std::make_unique<LabelInstruction>("loop"));
+    body.push_back(std::make_unique<MovInstruction>(AssemblyType::LONG_WORD, pseudo("i"), pseudo("t")));
+    body.push_back(std::make_unique<BinaryInstruction>(BinaryOperator::ADD, AssemblyType::LONG_WORD, imm(1), pseudo("t")));
+    body.push_back(std::make_unique<MovInstruction>(AssemblyType::LONG_WORD, pseudo("t"), pseudo("i")));
+    body.push_back(std::make_unique<CmpInstruction>(AssemblyType::LONG_WORD, imm(10), pseudo("i")));
+    body.push_back(std::make_unique<JmpCCInstruction>(ConditionCode::L, "loop"));
+    body.push_back(std::make_unique<MovInstruction>(AssemblyType::LONG_WORD, pseudo("i"), reg(RegisterName::AX)));
+    body.push_back(std::make_unique<ReturnInstruction>());
+
+    auto& instructions = allocate();
+    auto init = dynamic_cast<MovInstruction*>(instructions[0].get());
+    ASSERT_NE(init, nullptr);
+    ASSERT_NE(as_register(init->destination), nullptr);
+    RegisterName i = as_register(init->destination)->name;
+    auto compare = std::find_if(instructions.begin(), instructions.end(), [](const auto& instruction) {
+        return dynamic_cast<CmpInstruction*>(instruction.get()) != nullptr;
+    });
+    ASSERT_NE(compare, instructions.end());
+    auto compared = as_register(dynamic_cast<CmpInstruction*>(compare->get())->destination);
+    ASSERT_NE(compared, nullptr);
+    EXPECT_EQ(compared->name, i);
+}
+
+TEST_F(LinearScanAllocatorTest, RemarksEverySpillAndKeptValueAtItsInstruction)
+{
+    // Fifteen values live at the same time, the definition of each one comes from line i + 1
+    const int count = 15;
+    enable_remarks(count);
+    for (int i = 0; i < count; ++i) {
+        add_object("v" + std::to_string(i), AssemblyType::LONG_WORD);
+        body.push_back(std::make_unique<MovInstruction>(AssemblyType::LONG_WORD, imm(i), pseudo("v" + std::to_string(i))));
+        body.back()->source_location = SourceLocationIndex(i);
+    }
+    add_object("sum", AssemblyType::LONG_WORD);
+    body.push_back(std::make_unique<MovInstruction>(AssemblyType::LONG_WORD, imm(0), pseudo("sum")));
+    for (int i = 0; i < count; ++i) {
+        body.push_back(std::make_unique<BinaryInstruction>(BinaryOperator::ADD, AssemblyType::LONG_WORD, pseudo("v" + std::to_string(i)), pseudo("sum")));
+    }
+    body.push_back(std::make_unique<MovInstruction>(AssemblyType::LONG_WORD, pseudo("sum"), reg(RegisterName::AX)));
+    body.push_back(std::make_unique<ReturnInstruction>());
+
+    auto& instructions = allocate();
+    size_t spilled = 0;
+    size_t passed = 0;
+    size_t missed = 0;
+    for (int i = 0; i < count; ++i) {
+        spilled += is_pseudo(dynamic_cast<MovInstruction*>(instructions[i].get())->destination) ? 1 : 0;
+    }
+    for (const Remark& remark : remark_manager->remarks()) {
+        if (remark.kind == RemarkKind::ANALYSIS || remark.message.starts_with("'sum'")) {
+            continue;
+        }
+        EXPECT_EQ(remark.pass_name, "linear-scan");
+        ASSERT_TRUE(remark.message.starts_with("'v")) << remark.message;
+        int value = std::stoi(remark.message.substr(2));
+        ASSERT_TRUE(remark.location.has_value());
+        EXPECT_EQ(remark.location->line_number, static_cast<size_t>(value + 1));
+        if (remark.kind == RemarkKind::PASSED) {
+            ++passed;
+            EXPECT_NE(remark.message.find("kept in a register"), std::string::npos) << remark.message;
+        } else {
+            ++missed;
+            EXPECT_NE(remark.message.find("spilled to the stack, "), std::string::npos) << remark.message;
+        }
+    }
+    EXPECT_GT(spilled, 0u);
+    EXPECT_EQ(missed, spilled);
+    EXPECT_EQ(passed, count - spilled);
+}
@@ -0,0 +1,89 @@
+#include "backend/multiply_by_constant.h"
+#include <cstdint>
+#include <gtest/gtest.h>
+#include <random>
+#include <vector>
+
+using namespace backend;
+
+using Kind = MultiplyStep::Kind;
+
+TEST(MultiplyByConstantTest, PowerOfTwoIsOneShift)
+{
+    auto plan = plan_multiply_by_constant(16, 32);
+    ASSERT_TRUE(plan);
+    EXPECT_EQ(plan->steps, (std::vector<MultiplyStep> { { Kind::SHIFT_LEFT, 4 } }));
+    EXPECT_EQ(plan->latency, multiply_latency::SHIFT);
+}
+
+TEST(MultiplyByConstantTest, NineIsOneLea)
+{
+    auto plan = plan_multiply_by_constant(9, 64);
+    ASSERT_TRUE(plan);
+    EXPECT_EQ(plan->steps, (std::vector<MultiplyStep> { { Kind::SCALE_ADD, 8 } }));
+    EXPECT_FALSE(plan->uses_source());
+}
+
+TEST(MultiplyByConstantTest, FortyIsLeaAndShift)
+{
+    auto plan = plan_multiply_by_constant(40, 64);
+    ASSERT_TRUE(plan);
+    EXPECT_EQ(plan->latency, 2);
+    EXPECT_FALSE(plan->uses_source());
+}
+
+TEST(MultiplyByConstantTest, NegativeConstantNegates)
+{
+    auto plan = plan_multiply_by_constant(static_cast<uint64_t>(-8), 64);
+    ASSERT_TRUE(plan);
+    EXPECT_EQ(plan->latency, 2);
+    EXPECT_EQ(plan->steps.back(), (MultiplyStep { Kind::NEGATE, 0 }));
+}
+
+TEST(MultiplyByConstantTest, ConstantsWithoutCheapPlanKeepImul)
+{
+    EXPECT_FALSE(plan_multiply_by_constant(0, 32));
+    EXPECT_FALSE(plan_multiply_by_constant(1000003, 64));
+    EXPECT_FALSE(plan_multiply_by_constant(0x12345678, 32));
+}
+
+TEST(MultiplyByConstantTest, OnlyLowBitsOfConstantMatterAt32Bits)
+{
+    // 0xFFFFFFFF is -1 as a 32 bit value
+    auto plan = plan_multiply_by_constant(0xFFFFFFFFu, 32);
+    ASSERT_TRUE(plan);
+    EXPECT_EQ(plan->steps, (std::vector<MultiplyStep> { { Kind::NEGATE, 0 } }));
+}
+
+TEST(MultiplyByConstantTest, PlansMatchMultiplicationWithWraparound)
+{
+    std::mt19937_64 generator(42);
+    std::vector<uint64_t> sources { 0, 1, 2, 0x7FFFFFFF, 0x80000000, 0xFFFFFFFF, 0x7FFFFFFFFFFFFFFF, 0x8000000000000000, ~uint64_t { 0 } };
+    for (int i = 0; i < 16; ++i) {
+        sources.push_back(generator());
+    }
+    std::vector<uint64_t> constants;
+    for (int64_t c = -300; c <= 300; ++c) {
+        constants.push_back(static_cast<uint64_t>(c));
+    }
+    for (int shift = 0; shift < 64; ++shift) {
+        for (int64_t delta : { -9, -1, 0, 1, 3, 9 }) {
+            constants.push_back((uint64_t { 1 } << shift) + delta);
+        }
+    }
+
+    for (int width : { 32, 64 }) {
+        uint64_t mask = width == 64 ? ~uint64_t { 0 } : 0xFFFFFFFF;
+        for (uint64_t constant : constants) {
+            auto plan = plan_multiply_by_constant(constant, width);
+            if (!plan) {
+                continue;
+            }
+            EXPECT_LT(plan->latency, multiply_latency::IMUL);
+            for (uint64_t source : sources) {
+                ASSERT_EQ(evaluate_multiply_plan(*plan, source, width), (source * constant) & mask)
+                    << "width " << width << " constant " << static_cast<int64_t>(constant) << " source " << source;
+            }
+        }
+    }
+}
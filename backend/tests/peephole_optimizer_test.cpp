@@ -0,0 +1,177 @@
+#include "backend/assembly_ast.h"
+#include "backend/backend_symbol_table.h"
+#include "backend/code_emitter.h"
+#include "backend/peephole_optimizer.h"
+#include "common/stats/statistic.h"
+#include <gtest/gtest.h>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <vector>
+
+using namespace backend;
+
+class PeepholeOptimizerTest : public ::testing::Test {
+protected:
+    void SetUp() override
+    {
+        stats::StatisticRegistry::instance().reset();
+        symbol_table = std::make_shared<BackendSymbolTable>();
+        symbol_table->insert_symbol("f", FunctionEntry { 0, true, {}, { RegisterName::AX } });
+    }
+
+    void add(std::unique_ptr<Instruction> instruction)
+    {
+        body.push_back(std::move(instruction));
+    }
+
+    // Runs the optimizer on "f", before and after hold its instructions one per line
+    void optimize()
+    {
+        std::vector<std::unique_ptr<TopLevel>> definitions;
+        definitions.push_back(std::make_unique<FunctionDefinition>("f", true, std::move(body)));
+        ast = std::make_shared<Program>(std::move(definitions));
+        before = emit();
+        PeepholeOptimizer optimizer(ast, symbol_table);
+        optimizer.optimize();
+        after = emit();
+    }
+
+    // Number of rewrites counted by the statistic of the rule
+    static uint64_t rewrites(const std::string& rule)
+    {
+        for (const auto& peephole_rule : PeepholeOptimizer::rules()) {
+            if (rule == peephole_rule.name) {
+                return peephole_rule.statistic->value();
+            }
+        }
+        ADD_FAILURE() << "no rule " << rule;
+        return 0;
+    }
+
+    std::shared_ptr<AssemblyAST> ast;
+    std::shared_ptr<BackendSymbolTable> symbol_table;
+    std::vector<std::unique_ptr<Instruction>> body;
+    std::vector<std::string> before;
+    std::vector<std::string> after;
+
+private:
+    // The body of "f" without the prologue, whitespace runs become single spaces
+    std::vector<std::string> emit()
+    {
+        std::ostringstream out;
+        CodeEmitter emitter(ast, symbol_table);
+        emitter.emit_code(out);
+        std::istringstream in(out.str());
+        std::vector<std::string> lines;
+        bool in_body = false;
+        for (std::string line; std::getline(in, line);) {
+            std::istringstream words(line);
+            std::string normalized;
+            for (std::string word; words >> word;) {
+                normalized += normalized.empty() ? word : " " + word;
+            }
+            if (normalized.starts_with(".section")) {
+                break;
+            }
+            if (in_body) {
+                lines.push_back(normalized);
+            }
+            in_body |= normalized == "movq %rsp, %rbp";
+        }
+        return lines;
+    }
+};
+
+using Lines = std::vector<std::string>;
+
+TEST_F(PeepholeOptimizerTest, RemovesMovesOfARegisterToItself)
+{
+    add(std::make_unique<MovInstruction>(AssemblyType::QUAD_WORD, std::make_unique<Register>(RegisterName::AX), std::make_unique<Register>(RegisterName::AX)));
+    add(std::make_unique<MovInstruction>(AssemblyType::LONG_WORD, std::make_unique<Register>(RegisterName::AX), std::make_unique<Register>(RegisterName::AX)));
+    add(std::make_unique<MovInstruction>(AssemblyType::DOUBLE, std::make_unique<Register>(RegisterName::XMM1), std::make_unique<Register>(RegisterName::XMM1)));
+    add(std::make_unique<MovInstruction>(AssemblyType::LONG_WORD, std::make_unique<Register>(RegisterName::CX), std::make_unique<Register>(RegisterName::DX)));
+    optimize();
+
+    EXPECT_EQ(before, (Lines { "movq %rax, %rax", "movl %eax, %eax", "movsd %xmm1, %xmm1", "movl %ecx, %edx" }));
+    // The 32 bit move clears the upper half of %rax and stays
+    EXPECT_EQ(after, (Lines { "movl %eax, %eax", "movl %ecx, %edx" }));
+    EXPECT_EQ(rewrites("remove-self-move"), 2u);
+}
+
+TEST_F(PeepholeOptimizerTest, ForwardsMovesThroughAScratchRegister)
+{
+    add(std::make_unique<MovInstruction>(AssemblyType::LONG_WORD, std::make_unique<Register>(RegisterName::AX), std::make_unique<Register>(RegisterName::R10)));
+    add(std::make_unique<MovInstruction>(AssemblyType::LONG_WORD, std::make_unique<Register>(RegisterName::R10), std::make_unique<MemoryAddress>(RegisterName::BP, -4)));
+    // Memory to memory needs the scratch register
+    add(std::make_unique<MovInstruction>(AssemblyType::LONG_WORD, std::make_unique<MemoryAddress>(RegisterName::BP, -4), std::make_unique<Register>(RegisterName::R10)));
+    add(std::make_unique<MovInstruction>(AssemblyType::LONG_WORD, std::make_unique<Register>(RegisterName::R10), std::make_unique<MemoryAddress>(RegisterName::BP, -8)));
+    // The scratch register is read afterwards
+    add(std::make_unique<MovInstruction>(AssemblyType::QUAD_WORD, std::make_unique<Register>(RegisterName::CX), std::make_unique<Register>(RegisterName::R11)));
+    add(std::make_unique<MovInstruction>(AssemblyType::QUAD_WORD, std::make_unique<Register>(RegisterName::R11), std::make_unique<Register>(RegisterName::DX)));
+    add(std::make_unique<BinaryInstruction>(BinaryOperator::ADD, AssemblyType::QUAD_WORD, std::make_unique<Register>(RegisterName::R11), std::make_unique<Register>(RegisterName::DX)));
+    optimize();
+
+    EXPECT_EQ(before, (Lines { "movl %eax, %r10d", "movl %r10d, -4(%rbp)", "movl -4(%rbp), %r10d", "movl %r10d, -8(%rbp)", "movq %rcx, %r11", "movq %r11, %rdx", "addq %r11, %rdx" }));
+    EXPECT_EQ(after, (Lines { "movl %eax, -4(%rbp)", "movl -4(%rbp), %r10d", "movl %r10d, -8(%rbp)", "movq %rcx, %r11", "movq %r11, %rdx", "addq %r11, %rdx" }));
+    EXPECT_EQ(rewrites("forward-scratch-move"), 1u);
+}
+
+TEST_F(PeepholeOptimizerTest, RemovesJumpsToTheNextLabel)
+{
+    add(std::make_unique<JmpInstruction>("end"));
+    add(std::make_unique<LabelInstruction>("other"));
+    add(std::make_unique<LabelInstruction>("end"));
+    add(std::make_unique<JmpCCInstruction>(ConditionCode::E, "next"));
+    add(std::make_unique<CommentInstruction>("comments do not count"));
+    add(std::make_unique<LabelInstruction>("next"));
+    add(std::make_unique<JmpInstruction>("other"));
+    add(std::make_unique<LabelInstruction>("last"));
+    optimize();
+
+    EXPECT_EQ(before, (Lines { "jmp .Lend", ".Lother:", ".Lend:", "je .Lnext", "#comments do not count", ".Lnext:", "jmp .Lother", ".Llast:" }));
+    EXPECT_EQ(after, (Lines { ".Lother:", ".Lend:", "#comments do not count", ".Lnext:", "jmp .Lother", ".Llast:" }));
+    EXPECT_EQ(rewrites("remove-jump-to-next-label"), 2u);
+}
+
+TEST_F(PeepholeOptimizerTest, ZeroesRegistersWithXorWhenFlagsAreDead)
+{
+    add(std::make_unique<MovInstruction>(AssemblyType::QUAD_WORD, std::make_unique<ImmediateValue>(0l), std::make_unique<Register>(RegisterName::CX)));
+    add(std::make_unique<CmpInstruction>(AssemblyType::LONG_WORD, std::make_unique<Register>(RegisterName::DX), std::make_unique<Register>(RegisterName::SI)));
+    // xor would clobber the flags setl reads
+    add(std::make_unique<MovInstruction>(AssemblyType::LONG_WORD, std::make_unique<ImmediateValue>(0), std::make_unique<Register>(RegisterName::AX)));
+    add(std::make_unique<SetCCInstruction>(ConditionCode::L, std::make_unique<Register>(RegisterName::AX)));
+    add(std::make_unique<MovInstruction>(AssemblyType::LONG_WORD, std::make_unique<ImmediateValue>(0), std::make_unique<MemoryAddress>(RegisterName::BP, -4)));
+    optimize();
+
+    EXPECT_EQ(before, (Lines { "movq $0, %rcx", "cmpl %edx, %esi", "movl $0, %eax", "setl %al", "movl $0, -4(%rbp)" }));
+    EXPECT_EQ(after, (Lines { "xorl %ecx, %ecx", "cmpl %edx, %esi", "movl $0, %eax", "setl %al", "movl $0, -4(%rbp)" }));
+    EXPECT_EQ(rewrites("zero-with-xor"), 1u);
+}
+
+TEST_F(PeepholeOptimizerTest, ComparesRegistersWithZeroWithTest)
+{
+    add(std::make_unique<CmpInstruction>(AssemblyType::LONG_WORD, std::make_unique<ImmediateValue>(0), std::make_unique<Register>(RegisterName::AX)));
+    add(std::make_unique<JmpCCInstruction>(ConditionCode::E, "zero"));
+    add(std::make_unique<CmpInstruction>(AssemblyType::QUAD_WORD, std::make_unique<ImmediateValue>(0l), std::make_unique<MemoryAddress>(RegisterName::BP, -8)));
+    add(std::make_unique<JmpCCInstruction>(ConditionCode::L, "negative"));
+    optimize();
+
+    EXPECT_EQ(before, (Lines { "cmpl $0, %eax", "je .Lzero", "cmpq $0, -8(%rbp)", "jl .Lnegative" }));
+    EXPECT_EQ(after, (Lines { "testl %eax, %eax", "je .Lzero", "cmpq $0, -8(%rbp)", "jl .Lnegative" }));
+    EXPECT_EQ(rewrites("compare-zero-with-test"), 1u);
+}
+
+TEST_F(PeepholeOptimizerTest, RemovesStoresOverwrittenByTheNextStore)
+{
+    add(std::make_unique<MovInstruction>(AssemblyType::LONG_WORD, std::make_unique<ImmediateValue>(1), std::make_unique<MemoryAddress>(RegisterName::BP, -4)));
+    add(std::make_unique<MovInstruction>(AssemblyType::LONG_WORD, std::make_unique<Register>(RegisterName::AX), std::make_unique<MemoryAddress>(RegisterName::BP, -4)));
+    // The second store is narrower and leaves the upper half
+    add(std::make_unique<MovInstruction>(AssemblyType::QUAD_WORD, std::make_unique<ImmediateValue>(1l), std::make_unique<MemoryAddress>(RegisterName::BP, -16)));
+    add(std::make_unique<MovInstruction>(AssemblyType::LONG_WORD, std::make_unique<Register>(RegisterName::AX), std::make_unique<MemoryAddress>(RegisterName::BP, -16)));
+    optimize();
+
+    EXPECT_EQ(before, (Lines { "movl $1, -4(%rbp)", "movl %eax, -4(%rbp)", "movq $1, -16(%rbp)", "movl %eax, -16(%rbp)" }));
+    EXPECT_EQ(after, (Lines { "movl %eax, -4(%rbp)", "movq $1, -16(%rbp)", "movl %eax, -16(%rbp)" }));
+    EXPECT_EQ(rewrites("remove-dead-store"), 1u);
+}
@@ -0,0 +1,105 @@
+#include "backend/assembly_ast.h"
+#include "backend/backend_symbol_table.h"
+#include "backend/pseudo_register_replace_step.h"
+#include <gtest/gtest.h>
+#include <memory>
+#include <string>
+#include <vector>
+
+using namespace backend;
+
+class PseudoRegisterReplaceStepTest : public ::testing::Test {
+protected:
+    void SetUp() override
+    {
+        symbol_table = std::make_shared<BackendSymbolTable>();
+        symbol_table->insert_symbol("f", FunctionEntry { 0, true, {}, { RegisterName::AX } });
+    }
+
+    void add_object(const std::string& name, AssemblyType type)
+    {
+        symbol_table->insert_symbol(name, ObjectEntry { type, false, false });
+    }
+
+    std::unique_ptr<Operand> pseudo(const std::string& name) { return std::make_unique<PseudoRegister>(name); }
+    std::unique_ptr<Operand> reg(RegisterName name) { return std::make_unique<Register>(name); }
+    std::unique_ptr<Operand> imm(int value) { return std::make_unique<ImmediateValue>(value); }
+
+    // Runs the step on "f" and returns its instructions
+    std::vector<std::unique_ptr<Instruction>>& replace()
+    {
+        std::vector<std::unique_ptr<TopLevel>> definitions;
+        definitions.push_back(std::make_unique<FunctionDefinition>("f", true, std::move(body)));
+        ast = std::make_shared<Program>(std::move(definitions));
+        PseudoRegisterReplaceStep step(ast, symbol_table);
+        step.replace();
+        auto& program = dynamic_cast<Program&>(*ast);
+        return dynamic_cast<FunctionDefinition&>(*program.definitions[0]).instructions;
+    }
+
+    static int offset_of(const std::unique_ptr<Operand>& operand)
+    {
+        auto memory = dynamic_cast<MemoryAddress*>(operand.get());
+        EXPECT_NE(memory, nullptr);
+        return memory ? memory->offset : 0;
+    }
+
+    size_t frame_size() const
+    {
+        return std::get<FunctionEntry>(symbol_table->symbol_at("f")).stack_frame_size;
+    }
+
+    std::shared_ptr<BackendSymbolTable> symbol_table;
+    std::shared_ptr<AssemblyAST> ast;
+    std::vector<std::unique_ptr<Instruction>> body;
+};
+
+TEST_F(PseudoRegisterReplaceStepTest, ValuesWithDisjointLifetimesShareSlot)
+{
+    add_object("a", AssemblyType::LONG_WORD);
+    add_object("b", AssemblyType::LONG_WORD);
+    // a is dead once b is written
+    body.push_back(std::make_unique<MovInstruction>(AssemblyType::LONG_WORD, imm(1), pseudo("a")));
+    body.push_back(std::make_unique<MovInstruction>(AssemblyType::LONG_WORD, pseudo("a"), reg(RegisterName::CX)));
+    body.push_back(std::make_unique<MovInstruction>(AssemblyType::LONG_WORD, imm(2), pseudo("b")));
+    body.push_back(std::make_unique<MovInstruction>(AssemblyType::LONG_WORD, pseudo("b"), reg(RegisterName::AX)));
+    body.push_back(std::make_unique<ReturnInstruction>());
+
+    auto& instructions = replace();
+    EXPECT_EQ(offset_of(dynamic_cast<MovInstruction*>(instructions[0].get())->destination),
+        offset_of(dynamic_cast<MovInstruction*>(instructions[2].get())->destination));
+    EXPECT_EQ(frame_size(), 4u);
+}
+
+TEST_F(PseudoRegisterReplaceStepTest, OverlappingValuesGetDifferentSlots)
+{
+    add_object("a", AssemblyType::LONG_WORD);
+    add_object("b", AssemblyType::LONG_WORD);
+    body.push_back(std::make_unique<MovInstruction>(AssemblyType::LONG_WORD, imm(1), pseudo("a")));
+    body.push_back(std::make_unique<MovInstruction>(AssemblyType::LONG_WORD, imm(2), pseudo("b")));
+    body.push_back(std::make_unique<BinaryInstruction>(BinaryOperator::ADD, AssemblyType::LONG_WORD, pseudo("a"), pseudo("b")));
+    body.push_back(std::make_unique<MovInstruction>(AssemblyType::LONG_WORD, pseudo("b"), reg(RegisterName::AX)));
+    body.push_back(std::make_unique<ReturnInstruction>());
+
+    auto& instructions = replace();
+    EXPECT_NE(offset_of(dynamic_cast<MovInstruction*>(instructions[0].get())->destination),
+        offset_of(dynamic_cast<MovInstruction*>(instructions[1].get())->destination));
+    EXPECT_EQ(frame_size(), 8u);
+}
+
+TEST_F(PseudoRegisterReplaceStepTest, SlotsAreOnlySharedBetweenValuesOfTheSameSize)
+{
+    add_object("a", AssemblyType::LONG_WORD);
+    add_object("q", AssemblyType::QUAD_WORD);
+    body.push_back(std::make_unique<MovInstruction>(AssemblyType::LONG_WORD, imm(1), pseudo("a")));
+    body.push_back(std::make_unique<MovInstruction>(AssemblyType::LONG_WORD, pseudo("a"), reg(RegisterName::CX)));
+    body.push_back(std::make_unique<MovInstruction>(AssemblyType::QUAD_WORD, imm(2), pseudo("q")));
+    body.push_back(std::make_unique<MovInstruction>(AssemblyType::QUAD_WORD, pseudo("q"), reg(RegisterName::AX)));
+    body.push_back(std::make_unique<ReturnInstruction>());
+
+    auto& instructions = replace();
+    int a = offset_of(dynamic_cast<MovInstruction*>(instructions[0].get())->destination);
+    int q = offset_of(dynamic_cast<MovInstruction*>(instructions[2].get())->destination);
+    EXPECT_NE(a, q);
+    EXPECT_EQ(q % 8, 0);
+}
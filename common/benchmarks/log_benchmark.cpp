@@ -0,0 +1,54 @@
+#include "common/log/log.h"
+#include <chrono>
+#include <cstdio>
+#include <string>
+
+// Measures the cost of a disabled log call site, which is what every stage of the compiler pays on its hot paths
+// Run with LOG_CONFIG_PATH pointing to a configuration where the "benchmark" context is above DEBUG
+
+namespace {
+
+constexpr const char* LOG_CONTEXT = "benchmark";
+constexpr long ITERATIONS = 20'000'000;
+
+template <typename F>
+double measure_ns_per_call(F&& f)
+{
+    auto start = std::chrono::steady_clock::now();
+    for (long i = 0; i < ITERATIONS; ++i) {
+        f(i);
+    }
+    auto end = std::chrono::steady_clock::now();
+    return std::chrono::duration<double, std::nano>(end - start).count() / ITERATIONS;
+}
+
+}
+
+int main()
+{
+    logging::LogManager::init();
+    volatile long sink = 0;
+
+    // What the LOG_* macros used to expand to: shared_ptr copy, std::string context and a virtual call
+    double legacy = measure_ns_per_call([&](long i) {
+        std::shared_ptr<logging::ILogger> logger = logging::LogManager::logger();
+        if (logger->is_enabled(LOG_CONTEXT, logging::LogLevel::DEBUG)) {
+            logger->debug(LOG_CONTEXT, std::format("iteration {}", i));
+        }
+        sink = sink + 1;
+    });
+
+    double cached = measure_ns_per_call([&](long i) {
+        LOG_DEBUG(LOG_CONTEXT, "iteration {}", i);
+        sink = sink + 1;
+    });
+
+    double baseline = measure_ns_per_call([&](long i) {
+        sink = sink + 1;
+    });
+
+    std::printf("disabled LOG_DEBUG, legacy path: %8.2f ns/call\n", legacy - baseline);
+    std::printf("disabled LOG_DEBUG, cached level: %8.2f ns/call\n", cached - baseline);
+    std::printf("compile time threshold (LOG_ACTIVE_LEVEL): %s\n", logging::log_level_to_string(logging::ACTIVE_LEVEL).c_str());
+    return 0;
+}
@@ -1,5 +1,29 @@
 #pragma once
+#include <string>
+
+// The stages of the pipeline, in order, compilation stops after CompileOptions::stop_after
+enum class CompileStage {
+    LEX,
+    PARSE,
+    VALIDATE,
+    TACKY,
+    CODEGEN,
+    EMIT,
+};
 
 struct CompileOptions {
     bool enable_assembly_comments { false };
+    // When not empty, optimization remarks are written to this file in YAML format
+    std::string remarks_file;
+    CompileStage stop_after { CompileStage::EMIT };
+    // Name of the source in token locations and diagnostics, used until the first line marker
+    std::string source_name { "<source>" };
+    // 0 keeps every value in a stack slot, 1 optimizes Tacky and allocates registers with linear scan, 2 with graph
+    // coloring
+    int optimization_level { 2 };
+    // Copies of the body an unrolled loop runs between two exit tests, 1 turns partial unrolling off
+    int unroll_factor { 4 };
+    // Tacky instructions the copies of one loop body may take, loops with a known trip count that fit are unrolled
+    // completely. 0 turns unrolling off
+    int unroll_size_budget { 64 };
 };
@@ -0,0 +1,68 @@
+#pragma once
+#include "common/data/source_location.h"
+#include "common/data/source_manager.h"
+#include <format>
+#include <memory>
+#include <optional>
+#include <ostream>
+#include <string>
+#include <unordered_set>
+#include <vector>
+
+enum class RemarkKind {
+    PASSED,   // an optimization was applied
+    MISSED,   // an optimization was considered but not applied
+    ANALYSIS, // information about the code that can explain the other remarks
+};
+
+struct Remark {
+    RemarkKind kind;
+    std::string pass_name;
+    std::string function_name;
+    std::optional<SourceLocation> location;
+    std::string message;
+};
+
+// This class collects the optimization remarks emitted by the compiler passes
+// Remarks are only recorded when enabled, passes should check is_enabled() before building expensive messages
+// Locations are resolved through the SourceManager so they point to the original source file
+// A remark equal to one already recorded is dropped, the passes that run to a fixed point make the same decisions again
+
+class RemarkManager {
+public:
+    explicit RemarkManager(std::shared_ptr<SourceManager> source_manager = nullptr, bool enabled = false)
+        : m_source_manager { source_manager }
+        , m_enabled { enabled }
+    {
+    }
+    virtual ~RemarkManager() = default;
+
+    bool is_enabled() const { return m_enabled; }
+    void set_enabled(bool enabled) { m_enabled = enabled; }
+
+    virtual void emit(RemarkKind kind, const std::string& pass_name, const std::string& function_name, std::optional<SourceLocationIndex> location, const std::string& message);
+
+    const std::vector<Remark>& remarks() const { return m_remarks; }
+
+    // Write the remarks in the same YAML layout used by clang -fsave-optimization-record
+    void write_yaml(std::ostream& out) const;
+    void write_yaml(const std::string& file_path) const;
+
+    static std::string kind_to_string(RemarkKind kind);
+
+private:
+    std::shared_ptr<SourceManager> m_source_manager;
+    bool m_enabled;
+    std::vector<Remark> m_remarks;
+    std::unordered_set<std::string> m_emitted;
+};
+
+// Emits a remark when the manager is set and enabled, the message is only formatted then
+template<typename... Args>
+void emit_remark(const std::shared_ptr<RemarkManager>& remark_manager, RemarkKind kind, const std::string& pass_name, const std::string& function_name,
+    std::optional<SourceLocationIndex> location, std::format_string<Args...> format, Args&&... args)
+{
+    if (remark_manager && remark_manager->is_enabled()) {
+        remark_manager->emit(kind, pass_name, function_name, location, std::format(format, std::forward<Args>(args)...));
+    }
+}
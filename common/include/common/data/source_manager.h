@@ -1,17 +1,25 @@
 #pragma once
 #include "common/data/source_location.h"
 #include "common/data/token.h"
+#include <memory>
 #include <string>
+#include <string_view>
+#include <unordered_map>
 #include <vector>
 
 class SourceManager {
 public:
     void set_token_list(std::shared_ptr<std::vector<Token>> token_list) { m_token_list = token_list; }
 
+    // Registers the content of an in-memory source, source lines of file_name are then read from it instead of the disk
+    void add_source(const std::string& file_name, std::string_view content) { m_sources[file_name] = std::string(content); }
+
     std::string get_source_line(const SourceLocation& location) const;
     std::string get_source_line(const SourceLocationIndex& location) const;
+    SourceLocation get_location(const SourceLocationIndex& location) const;
     SourceLocationIndex get_index(const Token& token) const;
 
 private:
     std::shared_ptr<std::vector<Token>> m_token_list;
+    std::unordered_map<std::string, std::string> m_sources;
 };
@@ -1,9 +1,7 @@
 #pragma once
+#include <cstddef>
 #include <optional>
-#include <regex>
 #include <string_view>
-#include <unordered_map>
-#include <vector>
 
 enum class TokenType {
     IDENTIFIER,
@@ -68,9 +66,12 @@ enum class TokenType {
     COMMA
     // Add other types as needed
 };
+// Classifies lexemes without regular expressions: keywords and punctuators are looked up in
+// perfect hash tables built at compile time, constants, literals and identifiers are scanned by hand.
+// Construction is free, so creating the table does not show up in the compiler start up time.
 class TokenTable {
 public:
-    TokenTable();
+    TokenTable() = default;
 
     // Delete copy
     TokenTable(const TokenTable&) = delete;
@@ -83,14 +84,4 @@ public:
 
     // Determines the type of a lexeme (for token classification)
     std::optional<TokenType> match(std::string_view lexeme) const;
-
-private:
-    // Data members
-    std::unordered_map<std::string_view, TokenType> m_keywords;
-    std::vector<std::pair<std::regex, TokenType>> m_constant_search_patterns;
-    std::vector<std::pair<std::regex, TokenType>> m_constant_match_patterns;
-    std::vector<std::pair<std::regex, TokenType>> m_literal_patterns;
-    std::unordered_map<char, TokenType> m_single_char_tokens;
-    std::unordered_map<std::string_view, TokenType> m_double_char_tokens;
-    std::regex m_identifier_pattern;
 };
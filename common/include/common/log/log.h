@@ -1,8 +1,14 @@
 #pragma once
 
+#include "common/build_options.h"
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <format>
 #include <memory>
 #include <stdexcept>
 #include <string>
+#include <utility>
 #include <vector>
 
 namespace logging {
@@ -56,10 +62,14 @@ public:
     virtual void configure(const std::string& configFile) = 0;
 };
 
+// Integer handle of a registered log context, see register_context
+using ContextId = uint16_t;
+
 class LogManager {
 public:
     // Get the singleton instance
-    static std::shared_ptr<ILogger> logger()
+    // Returned by reference to avoid the atomic refcount traffic of a shared_ptr copy on every log call
+    static const std::shared_ptr<ILogger>& logger()
     {
         static LogManager instance; // Meyer's singleton - created once on first use
         return instance.m_logger;
@@ -70,7 +80,13 @@ public:
         logger();
     }
 
+    // Recompute the cached level of every registered context, must be called after the logger is reconfigured
+    static void refresh_levels();
+
 private:
+    static void refresh_levels(const ILogger& logger);
+    friend ContextId register_context(const std::string& name);
+
     // Private constructor - this is a static utility class
     LogManager();
 
@@ -78,41 +94,76 @@ private:
     std::shared_ptr<ILogger> m_logger;
 };
 
-// Helper macros for convenient logging
-#define LOG_TRACE(context, message)                                                     \
-    if (logging::LogManager::logger()->is_enabled(context, logging::LogLevel::TRACE)) { \
-        logging::LogManager::logger()->trace(context, message);                         \
-    }
-
-#define LOG_DEBUG(context, message)                                                     \
-    if (logging::LogManager::logger()->is_enabled(context, logging::LogLevel::DEBUG)) { \
-        logging::LogManager::logger()->debug(context, message);                         \
-    }
-
-#define LOG_INFO(context, message)                                                     \
-    if (logging::LogManager::logger()->is_enabled(context, logging::LogLevel::INFO)) { \
-        logging::LogManager::logger()->info(context, message);                         \
-    }
+namespace detail {
+
+inline constexpr size_t MAX_CONTEXTS = 64;
+
+// Minimum enabled level of each registered context, indexed by ContextId
+// This is the only state read by the fast path of the LOG_* macros
+extern std::array<std::atomic<int8_t>, MAX_CONTEXTS> context_levels;
+
+const std::string& context_name(ContextId id);
+void write(ContextId id, LogLevel level, const std::string& message);
+
+// A single argument is an already built message
+template <typename T>
+decltype(auto) format_message(T&& message)
+{
+    return std::forward<T>(message);
+}
+
+// More arguments are a format string and its arguments, only formatted when the level is enabled
+template <typename... Args>
+std::string format_message(std::format_string<Args...> fmt, Args&&... args)
+{
+    return std::format(fmt, std::forward<Args>(args)...);
+}
+
+}
+
+// Register a context by name and return its handle, registering the same name twice returns the same handle
+// This initializes the LogManager so that the level of the context can be cached
+ContextId register_context(const std::string& name);
+
+inline ContextId register_context(ContextId id)
+{
+    return id;
+}
+
+// Cached level check: a single load and compare
+inline bool is_enabled(ContextId id, LogLevel level)
+{
+    return static_cast<int8_t>(level) >= detail::context_levels[id].load(std::memory_order_relaxed);
+}
+
+// Levels below LOG_ACTIVE_LEVEL (set with the LOG_ACTIVE_LEVEL CMake option) are compiled out
+inline constexpr LogLevel ACTIVE_LEVEL = LOG_ACTIVE_LEVEL;
+
+// context can be a context name or a ContextId returned by register_context
+// The handle of a context name is resolved once per call site
+// The message can be a string or a format string followed by its arguments, they are evaluated only when the level is enabled
+#define LOG(context, level, ...)                                                                         \
+    do {                                                                                                 \
+        static const logging::ContextId log_context_id_ = logging::register_context(context);          \
+        if (logging::is_enabled(log_context_id_, level)) {                                               \
+            logging::detail::write(log_context_id_, level, logging::detail::format_message(__VA_ARGS__)); \
+        }                                                                                                \
+    } while (0)
+
+// Same as LOG for a level known at compile time, call sites below ACTIVE_LEVEL generate no code
+#define LOG_AT_LEVEL(context, level, ...)                                                   \
+    do {                                                                                    \
+        if constexpr (static_cast<int>(level) >= static_cast<int>(logging::ACTIVE_LEVEL)) { \
+            LOG(context, level, __VA_ARGS__);                                               \
+        }                                                                                   \
+    } while (0)
 
-#define LOG_WARN(context, message)                                                     \
-    if (logging::LogManager::logger()->is_enabled(context, logging::LogLevel::WARN)) { \
-        logging::LogManager::logger()->warn(context, message);                         \
-    }
-
-#define LOG_ERROR(context, message)                                                     \
-    if (logging::LogManager::logger()->is_enabled(context, logging::LogLevel::ERROR)) { \
-        logging::LogManager::logger()->error(context, message);                         \
-    }
-
-#define LOG_CRITICAL(context, message)                                                     \
-    if (logging::LogManager::logger()->is_enabled(context, logging::LogLevel::CRITICAL)) { \
-        logging::LogManager::logger()->critical(context, message);                         \
-    }
-
-// Generic log with level
-#define LOG(context, level, message)                                 \
-    if (logging::LogManager::logger()->is_enabled(context, level)) { \
-        logging::LogManager::logger()->log(context, level, message); \
-    }
+// Helper macros for convenient logging
+#define LOG_TRACE(context, ...) LOG_AT_LEVEL(context, logging::LogLevel::TRACE, __VA_ARGS__)
+#define LOG_DEBUG(context, ...) LOG_AT_LEVEL(context, logging::LogLevel::DEBUG, __VA_ARGS__)
+#define LOG_INFO(context, ...) LOG_AT_LEVEL(context, logging::LogLevel::INFO, __VA_ARGS__)
+#define LOG_WARN(context, ...) LOG_AT_LEVEL(context, logging::LogLevel::WARN, __VA_ARGS__)
+#define LOG_ERROR(context, ...) LOG_AT_LEVEL(context, logging::LogLevel::ERROR, __VA_ARGS__)
+#define LOG_CRITICAL(context, ...) LOG_AT_LEVEL(context, logging::LogLevel::CRITICAL, __VA_ARGS__)
 
 } // namespace logging
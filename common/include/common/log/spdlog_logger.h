@@ -6,6 +6,7 @@
 #include <spdlog/sinks/rotating_file_sink.h>
 #include <spdlog/sinks/stdout_color_sinks.h>
 #include <spdlog/spdlog.h>
+#include <mutex>
 #include <string>
 #include <unordered_map>
 
@@ -70,6 +71,11 @@ private:
     // Get or create a logger for a context
     std::shared_ptr<spdlog::logger> getContextLogger(const std::string& context);
 
+    // Lazily created logging infrastructure
+    std::shared_ptr<spdlog::logger> createContextLogger(const std::string& context, const ContextConfig& config);
+    std::shared_ptr<spdlog::details::thread_pool> getThreadPool();
+    std::shared_ptr<spdlog::sinks::ostream_sink<std::mutex>> getConsoleSink();
+
     // Map of context names to loggers
     std::unordered_map<std::string, std::shared_ptr<spdlog::logger>> m_loggers;
 
@@ -82,6 +88,10 @@ private:
     // Map of context names to their configurations
     std::unordered_map<std::string, ContextConfig> m_context_configs;
 
+    // Guards the lazy creation of loggers
+    std::mutex m_mutex;
+    bool m_thread_pool_started { false };
+
     // Default level
     LogLevel m_default_level;
     static constexpr const char* DEFAULT_CONTEXT = "main";
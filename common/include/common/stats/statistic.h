@@ -0,0 +1,71 @@
+#pragma once
+#include <atomic>
+#include <cstdint>
+#include <ostream>
+#include <string>
+#include <vector>
+
+namespace stats {
+
+// A named counter owned by a compiler pass, in the spirit of LLVM's STATISTIC.
+// Every Statistic registers itself with the StatisticRegistry when it is constructed,
+// counting is always on, printing is driven by the --stats command line flag.
+// The counters are process wide: they describe one compilation only while no other compilation runs at the same time.
+// Being atomic with relaxed ordering, they lose no increment, but concurrent compilations add to and reset each other's.
+class Statistic {
+public:
+    Statistic(const char* group, const char* name, const char* description);
+
+    Statistic& operator++()
+    {
+        m_value.fetch_add(1, std::memory_order_relaxed);
+        return *this;
+    }
+
+    Statistic& operator+=(uint64_t value)
+    {
+        m_value.fetch_add(value, std::memory_order_relaxed);
+        return *this;
+    }
+
+    void update_max(uint64_t value)
+    {
+        uint64_t current = m_value.load(std::memory_order_relaxed);
+        while (value > current && !m_value.compare_exchange_weak(current, value, std::memory_order_relaxed)) { }
+    }
+
+    void reset() { m_value.store(0, std::memory_order_relaxed); }
+
+    uint64_t value() const { return m_value.load(std::memory_order_relaxed); }
+    const char* group() const { return m_group; }
+    const char* name() const { return m_name; }
+    const char* description() const { return m_description; }
+
+private:
+    const char* m_group;
+    const char* m_name;
+    const char* m_description;
+    std::atomic<uint64_t> m_value { 0 };
+};
+
+class StatisticRegistry {
+public:
+    static StatisticRegistry& instance();
+
+    void add(Statistic* statistic);
+    // Statistics that have not been touched (value 0) are not printed
+    void print(std::ostream& out) const;
+    // Sets every counter back to 0, cobaltc::compile does so at entry so the counters describe the last compilation
+    void reset();
+
+    const std::vector<Statistic*>& statistics() const { return m_statistics; }
+
+private:
+    StatisticRegistry() = default;
+    std::vector<Statistic*> m_statistics;
+};
+
+}
+
+// Define a file local counter, GROUP is usually the name of the pass
+#define STATISTIC(VAR, GROUP, DESC) static stats::Statistic VAR { GROUP, #VAR, DESC }
@@ -0,0 +1,87 @@
+#include "common/log/log.h"
+#include <deque>
+#include <mutex>
+
+namespace logging {
+
+namespace detail {
+
+std::array<std::atomic<int8_t>, MAX_CONTEXTS> context_levels {};
+
+}
+
+namespace {
+
+std::mutex& registry_mutex()
+{
+    static std::mutex mutex;
+    return mutex;
+}
+
+// A deque keeps the names stable in memory while new contexts are registered
+std::deque<std::string>& registered_contexts()
+{
+    static std::deque<std::string> contexts;
+    return contexts;
+}
+
+// The lowest level for which the logger accepts messages of this context, OFF if none
+int8_t min_enabled_level(const ILogger& logger, const std::string& context)
+{
+    for (int level = static_cast<int>(LogLevel::TRACE); level < static_cast<int>(LogLevel::OFF); ++level) {
+        if (logger.is_enabled(context, static_cast<LogLevel>(level))) {
+            return static_cast<int8_t>(level);
+        }
+    }
+    return static_cast<int8_t>(LogLevel::OFF);
+}
+
+}
+
+ContextId register_context(const std::string& name)
+{
+    const ILogger& logger = *LogManager::logger();
+
+    std::lock_guard lock(registry_mutex());
+    auto& contexts = registered_contexts();
+    for (size_t i = 0; i < contexts.size(); ++i) {
+        if (contexts[i] == name) {
+            return static_cast<ContextId>(i);
+        }
+    }
+
+    if (contexts.size() >= detail::MAX_CONTEXTS) {
+        throw std::length_error("Too many log contexts registered: " + name);
+    }
+    ContextId id = static_cast<ContextId>(contexts.size());
+    contexts.push_back(name);
+    detail::context_levels[id].store(min_enabled_level(logger, name), std::memory_order_relaxed);
+    return id;
+}
+
+void LogManager::refresh_levels()
+{
+    refresh_levels(*logger());
+}
+
+void LogManager::refresh_levels(const ILogger& logger)
+{
+    std::lock_guard lock(registry_mutex());
+    auto& contexts = registered_contexts();
+    for (size_t i = 0; i < contexts.size(); ++i) {
+        detail::context_levels[i].store(min_enabled_level(logger, contexts[i]), std::memory_order_relaxed);
+    }
+}
+
+const std::string& detail::context_name(ContextId id)
+{
+    std::lock_guard lock(registry_mutex());
+    return registered_contexts().at(id);
+}
+
+void detail::write(ContextId id, LogLevel level, const std::string& message)
+{
+    LogManager::logger()->log(context_name(id), level, message);
+}
+
+} // namespace logging
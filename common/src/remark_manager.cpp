@@ -0,0 +1,79 @@
+#include "common/data/remark_manager.h"
+#include <format>
+#include <fstream>
+#include <stdexcept>
+
+namespace {
+
+// YAML single quoted scalar, the only character that needs escaping is the quote itself
+std::string yaml_quote(const std::string& str)
+{
+    std::string quoted = "'";
+    for (char c : str) {
+        if (c == '\'') {
+            quoted += "''";
+        } else if (c == '\n') {
+            quoted += ' ';
+        } else {
+            quoted += c;
+        }
+    }
+    quoted += "'";
+    return quoted;
+}
+
+}
+
+void RemarkManager::emit(RemarkKind kind, const std::string& pass_name, const std::string& function_name, std::optional<SourceLocationIndex> location, const std::string& message)
+{
+    if (!m_enabled) {
+        return;
+    }
+    std::string key = std::format("{}\n{}\n{}\n{}\n{}", static_cast<int>(kind), pass_name, function_name, location ? std::to_string(location->index) : "", message);
+    if (!m_emitted.insert(std::move(key)).second) {
+        return;
+    }
+
+    std::optional<SourceLocation> source_location;
+    if (location.has_value() && m_source_manager) {
+        source_location = m_source_manager->get_location(location.value());
+    }
+    m_remarks.push_back(Remark { kind, pass_name, function_name, source_location, message });
+}
+
+void RemarkManager::write_yaml(std::ostream& out) const
+{
+    for (const Remark& remark : m_remarks) {
+        out << "--- !" << kind_to_string(remark.kind) << "\n";
+        out << std::format("{:<17}{}\n", "Pass:", remark.pass_name);
+        if (remark.location.has_value()) {
+            const SourceLocation& loc = remark.location.value();
+            out << std::format("{:<17}{{ File: {}, Line: {}, Column: {} }}\n", "DebugLoc:", yaml_quote(loc.file_name), loc.line_number, loc.column_number);
+        }
+        out << std::format("{:<17}{}\n", "Function:", remark.function_name);
+        out << std::format("{:<17}{}\n", "Message:", yaml_quote(remark.message));
+        out << "...\n";
+    }
+}
+
+void RemarkManager::write_yaml(const std::string& file_path) const
+{
+    std::ofstream file(file_path);
+    if (!file.is_open()) {
+        throw std::runtime_error(std::format("Failed to open remarks file '{}'", file_path));
+    }
+    write_yaml(file);
+}
+
+std::string RemarkManager::kind_to_string(RemarkKind kind)
+{
+    switch (kind) {
+    case RemarkKind::PASSED:
+        return "Passed";
+    case RemarkKind::MISSED:
+        return "Missed";
+    case RemarkKind::ANALYSIS:
+        return "Analysis";
+    }
+    return "Unknown";
+}
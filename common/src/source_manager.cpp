@@ -7,15 +7,22 @@ std::string SourceManager::get_source_line(const SourceLocation& location) const
 {
     std::ostringstream result;
 
-    // Try to open the file
-    std::ifstream file(location.file_name);
-    if (!file.is_open()) {
-        return "ERROR!";
+    // In-memory sources are preferred over the file system
+    std::unique_ptr<std::istream> input;
+    auto source_it = m_sources.find(location.file_name);
+    if (source_it != m_sources.end()) {
+        input = std::make_unique<std::istringstream>(source_it->second);
+    } else {
+        auto file = std::make_unique<std::ifstream>(location.file_name);
+        if (!file->is_open()) {
+            return "ERROR!";
+        }
+        input = std::move(file);
     }
 
     // Skip to the error line
     std::string line;
-    for (size_t i = 0; i < location.line_number && std::getline(file, line); ++i) {
+    for (size_t i = 0; i < location.line_number && std::getline(*input, line); ++i) {
         // Just reading lines until we reach the target
     }
     result << std::format("{:<50} {:>5}:{:<3}\n",
@@ -40,6 +47,11 @@ std::string SourceManager::get_source_line(const SourceLocationIndex& location)
     return get_source_line(m_token_list->at(location.index).source_location());
 }
 
+SourceLocation SourceManager::get_location(const SourceLocationIndex& location) const
+{
+    return m_token_list->at(location.index).source_location();
+}
+
 SourceLocationIndex SourceManager::get_index(const Token& token) const
 {
     // Calculate index based on address
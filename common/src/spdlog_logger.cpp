@@ -19,6 +19,7 @@ LogManager::LogManager()
 
     m_logger = std::make_shared<SpdLogger>();
     m_logger->configure(log_config_file_path);
+    refresh_levels(*m_logger);
 }
 
 // Utility functions implementation
@@ -73,36 +74,22 @@ std::string log_level_to_string(LogLevel level)
 }
 
 // SpdLogger implementation
+// Nothing is created up front: the thread pool, the sinks (and so the log files) and the loggers are
+// created the first time a context actually logs something, runs that log nothing pay nothing
 SpdLogger::SpdLogger()
     : m_default_level(LogLevel::INFO)
 {
-    // Initialize thread pool for async logging
-    spdlog::init_thread_pool(8192, 1);
-    auto tp = spdlog::thread_pool();
-    // Create the console sink that will be shared by loggers that need console output
-    m_console_sink = std::make_shared<spdlog::sinks::ostream_sink<std::mutex>>(std::cout);
-    m_console_sink->set_pattern("%v");
-
-    // Create the default logger with required parameters:
-    // - logger name
-    // - sink
-    // - thread pool
-    // - overflow policy
-    auto default_logger = std::make_shared<spdlog::async_logger>(
-        DEFAULT_CONTEXT,
-        m_console_sink,
-        tp,
-        spdlog::async_overflow_policy::block);
-
-    default_logger->set_level(toSpdLogLevel(m_default_level));
-    // default_logger->set_pattern("%v"); // Only print the message
-    m_loggers[DEFAULT_CONTEXT] = default_logger;
+    // The spdlog registry is a function local static as well. Constructing it now, before the LogManager holding this
+    // logger finishes construction, makes it outlive the logger: the shutdown in the destructor needs it at exit
+    spdlog::details::registry::instance();
 }
 
 SpdLogger::~SpdLogger()
 {
-    // First shutdown spdlog (important!)
-    spdlog::shutdown();
+    // First shutdown spdlog (important!), only if we ever started it
+    if (m_thread_pool_started) {
+        spdlog::shutdown();
+    }
 
     // Then clear our local containers
     m_loggers.clear();
@@ -269,21 +256,46 @@ void SpdLogger::configure(const LoggerConfig& config)
 // Configure a specific context
 void SpdLogger::configureContext(const std::string& context_name, const ContextConfig& config)
 {
-    // Store the configuration
+    // Store the configuration, the logger itself is created on first use
     m_context_configs[context_name] = config;
 
-    // Skip further configuration if context is disabled
-    if (!config.enabled) {
-        return;
+    bool is_default_context = context_name == DEFAULT_CONTEXT;
+    if (config.enabled && !is_default_context && config.file_path.empty() && !config.console) {
+        throw LogConfigParseError(fmt::format("No output specified for context {}", context_name));
     }
+}
 
-    // Create the logger
-    auto tp = spdlog::thread_pool();
+std::shared_ptr<spdlog::details::thread_pool> SpdLogger::getThreadPool()
+{
+    // Initialize thread pool for async logging
+    if (!m_thread_pool_started) {
+        spdlog::init_thread_pool(8192, 1);
+        m_thread_pool_started = true;
+    }
+    return spdlog::thread_pool();
+}
+
+std::shared_ptr<spdlog::sinks::ostream_sink<std::mutex>> SpdLogger::getConsoleSink()
+{
+    // The console sink is shared by loggers that need console output
+    if (!m_console_sink) {
+        m_console_sink = std::make_shared<spdlog::sinks::ostream_sink<std::mutex>>(std::cout);
+        m_console_sink->set_pattern("%v");
+    }
+    return m_console_sink;
+}
 
+std::shared_ptr<spdlog::logger> SpdLogger::createContextLogger(const std::string& context_name, const ContextConfig& config)
+{
     bool is_default_context = context_name == DEFAULT_CONTEXT;
 
     std::vector<spdlog::sink_ptr> sinks;
 
+    // The default logger always writes to the console
+    if (config.console || is_default_context) {
+        sinks.push_back(getConsoleSink());
+    }
+
     // Set up logging to file if specified
     if (!config.file_path.empty()) {
         size_t max_size = config.max_size_mb * 1024 * 1024; // Convert to bytes
@@ -295,26 +307,12 @@ void SpdLogger::configureContext(const std::string& context_name, const ContextC
         }
     }
 
-    // Add console sink if configured
-    if (config.console && !is_default_context) {
-        sinks.push_back(m_console_sink);
-    }
-
-    if (sinks.size() == 0 && !is_default_context) {
-        throw LogConfigParseError(fmt::format("No output specified for context {}", context_name));
-    }
-
-    if (!is_default_context) {
-        // Create new logger and initialize it with a list of sinks
-        auto logger = std::make_shared<spdlog::async_logger>(context_name, sinks.begin(), sinks.end(), tp,
-            spdlog::async_overflow_policy::block);
-        logger->set_level(toSpdLogLevel(config.level));
-        // logger->set_pattern("%v"); // Only print the message
-        m_loggers[context_name] = logger;
-    } else if (sinks.size() > 0) {
-        assert(sinks.size() == 1);
-        m_loggers[DEFAULT_CONTEXT]->sinks().push_back(sinks.back());
-    }
+    // Create new logger and initialize it with a list of sinks
+    auto logger = std::make_shared<spdlog::async_logger>(context_name, sinks.begin(), sinks.end(), getThreadPool(),
+        spdlog::async_overflow_policy::block);
+    logger->set_level(toSpdLogLevel(config.level));
+    m_loggers[context_name] = logger;
+    return logger;
 }
 
 // Fixed version of addContextLogFile method
@@ -372,18 +370,39 @@ LogLevel SpdLogger::fromSpdLogLevel(spdlog::level::level_enum level) const
         return LogLevel::INFO;
     }
 }
-// Fixed version of getContextLogger method
+// Get the logger of a context, creating it on first use
 std::shared_ptr<spdlog::logger> SpdLogger::getContextLogger(const std::string& context)
 {
+    std::lock_guard<std::mutex> lock(m_mutex);
+
     // Check if we already have a logger for this context
     auto it = m_loggers.find(context);
     if (it != m_loggers.end()) {
         return it->second;
     }
 
-    auto default_logger = m_loggers[DEFAULT_CONTEXT];
+    auto config_it = m_context_configs.find(context);
+    if (config_it != m_context_configs.end() && config_it->second.enabled) {
+        return createContextLogger(context, config_it->second);
+    }
+
+    std::shared_ptr<spdlog::logger> default_logger;
+    auto default_it = m_loggers.find(DEFAULT_CONTEXT);
+    if (default_it != m_loggers.end()) {
+        default_logger = default_it->second;
+    } else {
+        ContextConfig default_config;
+        default_config.level = m_default_level;
+        auto default_config_it = m_context_configs.find(DEFAULT_CONTEXT);
+        if (default_config_it != m_context_configs.end()) {
+            default_config = default_config_it->second;
+        }
+        default_logger = createContextLogger(DEFAULT_CONTEXT, default_config);
+    }
 
-    default_logger->log(spdlog::level::err, fmt::format("Log context not initialized: {}", context));
+    if (context != DEFAULT_CONTEXT) {
+        default_logger->log(spdlog::level::err, fmt::format("Log context not initialized: {}", context));
+    }
 
     return default_logger;
 }
@@ -392,7 +411,9 @@ void SpdLogger::flushAll()
     for (auto pair : m_file_sinks) {
         pair.second->flush();
     }
-    m_console_sink->flush();
+    if (m_console_sink) {
+        m_console_sink->flush();
+    }
 }
 
 } // namespace logging
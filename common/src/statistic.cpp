@@ -0,0 +1,66 @@
+#include "common/stats/statistic.h"
+#include <algorithm>
+#include <cstring>
+#include <format>
+
+using namespace stats;
+
+Statistic::Statistic(const char* group, const char* name, const char* description)
+    : m_group { group }
+    , m_name { name }
+    , m_description { description }
+{
+    StatisticRegistry::instance().add(this);
+}
+
+StatisticRegistry& StatisticRegistry::instance()
+{
+    static StatisticRegistry registry;
+    return registry;
+}
+
+void StatisticRegistry::add(Statistic* statistic)
+{
+    m_statistics.push_back(statistic);
+}
+
+void StatisticRegistry::print(std::ostream& out) const
+{
+    std::vector<const Statistic*> to_print;
+    for (const Statistic* s : m_statistics) {
+        if (s->value() != 0) {
+            to_print.push_back(s);
+        }
+    }
+
+    // Sort by group and then by description, so that the output is stable between runs
+    std::sort(to_print.begin(), to_print.end(), [](const Statistic* a, const Statistic* b) {
+        int cmp = std::strcmp(a->group(), b->group());
+        if (cmp != 0) {
+            return cmp < 0;
+        }
+        return std::strcmp(a->description(), b->description()) < 0;
+    });
+
+    size_t value_width = 0;
+    size_t group_width = 0;
+    for (const Statistic* s : to_print) {
+        value_width = std::max(value_width, std::to_string(s->value()).size());
+        group_width = std::max(group_width, std::strlen(s->group()));
+    }
+
+    out << "===-------------------------------------------------------------------------===\n";
+    out << "                          ... Statistics Collected ...\n";
+    out << "===-------------------------------------------------------------------------===\n\n";
+    for (const Statistic* s : to_print) {
+        out << std::format("{:>{}} {:<{}} - {}\n", s->value(), value_width, s->group(), group_width, s->description());
+    }
+    out << std::endl;
+}
+
+void StatisticRegistry::reset()
+{
+    for (Statistic* s : m_statistics) {
+        s->reset();
+    }
+}
@@ -1,127 +1,120 @@
 #include "common/data/token_table.h"
-#include <vector>
+#include <array>
+#include <cstdint>
+#include <utility>
 
-size_t TokenTable::search(std::string_view input) const
-{
-    if (input.size() <= 0)
-        return 0;
+namespace {
 
-    char first_char = input[0];
-
-    // Check for double character tokens if input has at least 2 characters
-    if (input.size() >= 2) {
-        std::string_view double_char = input.substr(0, 2);
-        if (m_double_char_tokens.contains(double_char)) {
-            return 2;
-        }
-    }
-
-    if (m_single_char_tokens.contains(first_char)) {
-        return 1;
-    }
+struct TokenEntry {
+    std::string_view text;
+    TokenType type;
+};
 
-    for (const auto& [pattern, _] : m_constant_search_patterns) {
-        std::match_results<std::string_view::const_iterator> matches;
-        if (std::regex_search(input.begin(), input.end(), matches, pattern)) {
-            // Return the length of the matched text
-            if (matches.size() > 1) {
-                std::string_view first_group(matches[1].first, matches[1].second);
-                return first_group.size();
+// Perfect hash over a fixed set of strings, the seed is searched at compile time until no two keys
+// share a slot, so a lookup is one hash plus one string compare
+template<size_t N, size_t TableSize>
+class PerfectHashTable {
+public:
+    consteval PerfectHashTable(const std::array<TokenEntry, N>& entries)
+    {
+        for (uint32_t seed = 0; seed < MAX_SEED; ++seed) {
+            if (try_seed(entries, seed)) {
+                m_seed = seed;
+                m_found = true;
+                return;
             }
         }
     }
 
-    for (const auto& [pattern, _] : m_literal_patterns) {
-        std::match_results<std::string_view::const_iterator> matches;
-        if (std::regex_search(input.begin(), input.end(), matches, pattern)) {
-            // Return the length of the matched text
-            return matches.length();
-        }
-    }
-
-    std::match_results<std::string_view::const_iterator> matches;
-    if (std::regex_search(input.begin(), input.end(), matches, m_identifier_pattern)) {
-        // Return the length of the matched text
-        return matches.length();
-    }
-
-    return 0;
-}
-
-std::optional<TokenType> TokenTable::match(std::string_view lexeme) const
-{
-    std::optional<TokenType> res;
-    if (lexeme.size() <= 0)
-        return res;
+    constexpr bool found() const { return m_found; }
 
-    if (lexeme.size() == 1) {
-        char single_char = lexeme[0];
-        if (m_single_char_tokens.contains(single_char)) {
-            res = m_single_char_tokens.at(single_char);
-            return res;
+    constexpr std::optional<TokenType> find(std::string_view key) const
+    {
+        const Slot& slot = m_slots[hash(key, m_seed)];
+        if (slot.used && slot.text == key) {
+            return slot.type;
         }
+        return std::nullopt;
     }
 
-    if (lexeme.size() == 2) {
-        if (m_double_char_tokens.contains(lexeme)) {
-            res = m_double_char_tokens.at(lexeme);
-            return res;
-        }
-    }
+private:
+    static constexpr uint32_t MAX_SEED = 10000;
 
-    for (const auto& [pattern, type] : m_constant_match_patterns) {
-        std::match_results<std::string_view::const_iterator> matches;
-        if (std::regex_match(lexeme.begin(), lexeme.end(), matches, pattern)) {
-            res = type;
-            return res;
-        }
-    }
+    struct Slot {
+        std::string_view text;
+        TokenType type { TokenType::IDENTIFIER };
+        bool used { false };
+    };
 
-    for (const auto& [pattern, type] : m_literal_patterns) {
-        std::match_results<std::string_view::const_iterator> matches;
-        if (std::regex_match(lexeme.begin(), lexeme.end(), matches, pattern)) {
-            res = type;
-            return res;
+    // FNV-1a followed by a finalizer, without it the low bits (the only ones left by the modulo)
+    // would depend only on the low bits of the characters
+    static constexpr size_t hash(std::string_view key, uint32_t seed)
+    {
+        uint32_t h = 2166136261u ^ seed;
+        for (char c : key) {
+            h ^= static_cast<uint8_t>(c);
+            h *= 16777619u;
         }
+        h ^= h >> 15;
+        h *= 0x2c1b3c6du;
+        h ^= h >> 12;
+        return h % TableSize;
     }
 
-    std::match_results<std::string_view::const_iterator> matches;
-    if (std::regex_match(lexeme.begin(), lexeme.end(), matches, m_identifier_pattern)) {
-        res = TokenType::IDENTIFIER;
-        if (m_keywords.contains(lexeme)) {
-            res = m_keywords.at(lexeme);
+    constexpr bool try_seed(const std::array<TokenEntry, N>& entries, uint32_t seed)
+    {
+        m_slots = {};
+        for (const TokenEntry& entry : entries) {
+            Slot& slot = m_slots[hash(entry.text, seed)];
+            if (slot.used) {
+                return false;
+            }
+            slot = { entry.text, entry.type, true };
         }
-        return res;
+        return true;
     }
 
-    return res;
-}
+    std::array<Slot, TableSize> m_slots {};
+    uint32_t m_seed { 0 };
+    bool m_found { false };
+};
 
-TokenTable::TokenTable()
-{
-    // Initialize keywords
-    m_keywords = {
-        { "int", TokenType::INT_KW },
-        { "void", TokenType::VOID_KW },
-        { "return", TokenType::RETURN_KW },
-        { "if", TokenType::IF_KW },
-        { "else", TokenType::ELSE_KW },
-        { "do", TokenType::DO_KW },
-        { "while", TokenType::WHILE_KW },
-        { "for", TokenType::FOR_KW },
-        { "break", TokenType::BREAK_KW },
-        { "continue", TokenType::CONTINUE_KW },
-        { "static", TokenType::STATIC_KW },
-        { "extern", TokenType::EXTERN_KW },
-        { "long", TokenType::LONG_KW },
-        { "signed", TokenType::SIGNED_KW },
-        { "unsigned", TokenType::UNSIGNED_KW },
-        { "double", TokenType::DOUBLE_KW },
-        { "char", TokenType::CHAR_KW }
-    };
+constexpr PerfectHashTable<17, 32> KEYWORDS { std::array<TokenEntry, 17> { {
+    { "int", TokenType::INT_KW },
+    { "void", TokenType::VOID_KW },
+    { "return", TokenType::RETURN_KW },
+    { "if", TokenType::IF_KW },
+    { "else", TokenType::ELSE_KW },
+    { "do", TokenType::DO_KW },
+    { "while", TokenType::WHILE_KW },
+    { "for", TokenType::FOR_KW },
+    { "break", TokenType::BREAK_KW },
+    { "continue", TokenType::CONTINUE_KW },
+    { "static", TokenType::STATIC_KW },
+    { "extern", TokenType::EXTERN_KW },
+    { "long", TokenType::LONG_KW },
+    { "signed", TokenType::SIGNED_KW },
+    { "unsigned", TokenType::UNSIGNED_KW },
+    { "double", TokenType::DOUBLE_KW },
+    { "char", TokenType::CHAR_KW },
+} } };
+static_assert(KEYWORDS.found(), "no perfect hash seed for the keyword table");
 
-    // Initialize single-character tokens for optimization
-    m_single_char_tokens = {
+constexpr PerfectHashTable<7, 8> DOUBLE_CHAR_TOKENS { std::array<TokenEntry, 7> { {
+    { "--", TokenType::DECREMENT },
+    { "&&", TokenType::LOGICAL_AND },
+    { "||", TokenType::LOGICAL_OR },
+    { "==", TokenType::EQUAL },
+    { "!=", TokenType::NOT_EQUAL },
+    { "<=", TokenType::LESS_THAN_EQUAL },
+    { ">=", TokenType::GREATER_THAN_EQUAL },
+} } };
+static_assert(DOUBLE_CHAR_TOKENS.found(), "no perfect hash seed for the double character token table");
+
+// Single character tokens are indexed directly by the character
+constexpr std::array<std::optional<TokenType>, 256> SINGLE_CHAR_TOKENS = [] {
+    std::array<std::optional<TokenType>, 256> table {};
+    constexpr std::array<std::pair<char, TokenType>, 21> entries { {
         { '(', TokenType::OPEN_PAREN },
         { ')', TokenType::CLOSE_PAREN },
         { '{', TokenType::OPEN_BRACE },
@@ -142,38 +135,266 @@ TokenTable::TokenTable()
         { ',', TokenType::COMMA },
         { '&', TokenType::AMPERSAND },
         { '[', TokenType::OPEN_SQUARE_BRACKET },
-        { ']', TokenType::CLOSE_SQUARE_BRACKET }
-    };
+        { ']', TokenType::CLOSE_SQUARE_BRACKET },
+    } };
+    for (const auto& [c, type] : entries) {
+        table[static_cast<uint8_t>(c)] = type;
+    }
+    return table;
+}();
 
-    m_double_char_tokens = {
-        { "--", TokenType::DECREMENT },
-        { "&&", TokenType::LOGICAL_AND },
-        { "||", TokenType::LOGICAL_OR },
-        { "==", TokenType::EQUAL },
-        { "!=", TokenType::NOT_EQUAL },
-        { "<=", TokenType::LESS_THAN_EQUAL },
-        { ">=", TokenType::GREATER_THAN_EQUAL }
-    };
+constexpr std::optional<TokenType> single_char_token(char c)
+{
+    return SINGLE_CHAR_TOKENS[static_cast<uint8_t>(c)];
+}
 
-    // REMEMBER: add ^ anchor at the beginning of the string
-    // The ^ anchor ensures that regex_search() matches from the beginning of the input
-    m_literal_patterns = {
-        { std::regex(R"(^'([^'\\\n]|\\['"?\\abfnrtv])')"), TokenType::CHAR_LITERAL },
-        { std::regex(R"(^"([^"\\\n]|\\['"?\\abfnrtv])*")"), TokenType::STRING_LITERAL },
-    };
+constexpr bool is_digit(char c)
+{
+    return c >= '0' && c <= '9';
+}
 
-    std::vector<std::pair<std::string, TokenType>> base_patterns = {
-        { "^([0-9]+)", TokenType::CONSTANT },
-        { "^([0-9]+[lL])", TokenType::LONG_CONSTANT },
-        { "^([0-9]+[uU])", TokenType::UNSIGNED_CONSTANT },
-        { "^([0-9]+([uU][lL]|[lL][uU]))", TokenType::UNSIGNED_LONG_CONSTANT },
-        { "^((([0-9]*\\.[0-9]+|[0-9]+\\.?)[Ee][+-]?[0-9]+|[0-9]*\\.[0-9]+|[0-9]+\\.))", TokenType::DOUBLE_CONSTANT },
-    };
+constexpr bool is_identifier_start(char c)
+{
+    return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || c == '_';
+}
+
+// Same set as the \w regex class
+constexpr bool is_word_char(char c)
+{
+    return is_identifier_start(c) || is_digit(c);
+}
 
-    for (const auto& [base_pattern, type] : base_patterns) {
-        m_constant_search_patterns.push_back({ std::regex(base_pattern + "[^\\w.]"), type });
-        m_constant_match_patterns.push_back({ std::regex(base_pattern + "$"), type });
+constexpr size_t count_digits(std::string_view input, size_t pos)
+{
+    size_t n = 0;
+    while (pos + n < input.size() && is_digit(input[pos + n])) {
+        ++n;
+    }
+    return n;
+}
+
+constexpr bool is_escape_char(char c)
+{
+    switch (c) {
+    case '\'':
+    case '"':
+    case '?':
+    case '\\':
+    case 'a':
+    case 'b':
+    case 'f':
+    case 'n':
+    case 'r':
+    case 't':
+    case 'v':
+        return true;
+    default:
+        return false;
+    }
+}
+
+// A constant must be followed by something that cannot continue it (not a word character or a '.'),
+// when matching a whole lexeme it must end exactly at the end of the lexeme
+bool constant_ends_at(std::string_view input, size_t end, bool whole_lexeme)
+{
+    if (whole_lexeme) {
+        return end == input.size();
+    }
+    return end < input.size() && !is_word_char(input[end]) && input[end] != '.';
+}
+
+// True if text is a complete floating point constant:
+// ([0-9]*\.[0-9]+|[0-9]+\.?)[Ee][+-]?[0-9]+ | [0-9]*\.[0-9]+ | [0-9]+\.
+bool is_double_constant(std::string_view text)
+{
+    size_t pos = count_digits(text, 0);
+    size_t integer_digits = pos;
+    bool has_dot = false;
+    size_t fraction_digits = 0;
+    if (pos < text.size() && text[pos] == '.') {
+        has_dot = true;
+        fraction_digits = count_digits(text, pos + 1);
+        pos += 1 + fraction_digits;
+    }
+    if (integer_digits == 0 && fraction_digits == 0) {
+        return false;
+    }
+    if (pos == text.size()) {
+        return has_dot;
+    }
+    if (text[pos] != 'e' && text[pos] != 'E') {
+        return false;
+    }
+    ++pos;
+    if (pos < text.size() && (text[pos] == '+' || text[pos] == '-')) {
+        ++pos;
+    }
+    size_t exponent_digits = count_digits(text, pos);
+    return exponent_digits > 0 && pos + exponent_digits == text.size();
+}
+
+constexpr bool is_double_char(char c)
+{
+    return is_digit(c) || c == '.' || c == 'e' || c == 'E' || c == '+' || c == '-';
+}
+
+// Scans a numeric constant at the beginning of input, trying the integer forms before the floating point one
+std::optional<std::pair<size_t, TokenType>> scan_constant(std::string_view input, bool whole_lexeme)
+{
+    size_t digits = count_digits(input, 0);
+    if (digits > 0) {
+        if (constant_ends_at(input, digits, whole_lexeme)) {
+            return std::pair { digits, TokenType::CONSTANT };
+        }
+        char suffix = digits < input.size() ? input[digits] : '\0';
+        bool is_long_suffix = suffix == 'l' || suffix == 'L';
+        bool is_unsigned_suffix = suffix == 'u' || suffix == 'U';
+        if (is_long_suffix && constant_ends_at(input, digits + 1, whole_lexeme)) {
+            return std::pair { digits + 1, TokenType::LONG_CONSTANT };
+        }
+        if (is_unsigned_suffix && constant_ends_at(input, digits + 1, whole_lexeme)) {
+            return std::pair { digits + 1, TokenType::UNSIGNED_CONSTANT };
+        }
+        if (digits + 1 < input.size()) {
+            char next = input[digits + 1];
+            bool is_ul = is_unsigned_suffix && (next == 'l' || next == 'L');
+            bool is_lu = is_long_suffix && (next == 'u' || next == 'U');
+            if ((is_ul || is_lu) && constant_ends_at(input, digits + 2, whole_lexeme)) {
+                return std::pair { digits + 2, TokenType::UNSIGNED_LONG_CONSTANT };
+            }
+        }
+    }
+
+    if (whole_lexeme) {
+        if (is_double_constant(input)) {
+            return std::pair { input.size(), TokenType::DOUBLE_CONSTANT };
+        }
+        return std::nullopt;
+    }
+
+    // The only characters of a floating point constant that can also terminate it are the exponent signs,
+    // so try every prefix made of floating point characters and keep the first complete one
+    for (size_t end = 1; end < input.size() && is_double_char(input[end - 1]); ++end) {
+        if (constant_ends_at(input, end, false) && is_double_constant(input.substr(0, end))) {
+            return std::pair { end, TokenType::DOUBLE_CONSTANT };
+        }
+    }
+    return std::nullopt;
+}
+
+// Scans a character or string literal at the beginning of input, returns its length or 0
+size_t scan_literal(std::string_view input, char quote)
+{
+    if (input.empty() || input[0] != quote) {
+        return 0;
+    }
+    size_t pos = 1;
+    size_t chars = 0;
+    while (pos < input.size() && input[pos] != quote) {
+        if (input[pos] == '\n') {
+            return 0;
+        }
+        if (input[pos] == '\\') {
+            if (pos + 1 >= input.size() || !is_escape_char(input[pos + 1])) {
+                return 0;
+            }
+            ++pos;
+        }
+        ++pos;
+        ++chars;
+        // A character literal holds exactly one (possibly escaped) character
+        if (quote == '\'' && chars > 1) {
+            return 0;
+        }
+    }
+    if (pos >= input.size() || (quote == '\'' && chars != 1)) {
+        return 0;
+    }
+    return pos + 1;
+}
+
+size_t scan_identifier(std::string_view input)
+{
+    if (input.empty() || !is_identifier_start(input[0])) {
+        return 0;
+    }
+    size_t pos = 1;
+    while (pos < input.size() && is_word_char(input[pos])) {
+        ++pos;
+    }
+    return pos;
+}
+
+}
+
+size_t TokenTable::search(std::string_view input) const
+{
+    if (input.empty())
+        return 0;
+
+    // Check for double character tokens if input has at least 2 characters
+    if (input.size() >= 2 && DOUBLE_CHAR_TOKENS.find(input.substr(0, 2))) {
+        return 2;
+    }
+
+    if (single_char_token(input[0])) {
+        return 1;
+    }
+
+    if (is_digit(input[0]) || input[0] == '.') {
+        if (auto constant = scan_constant(input, false)) {
+            return constant->first;
+        }
+    }
+
+    if (size_t length = scan_literal(input, '\'')) {
+        return length;
+    }
+
+    if (size_t length = scan_literal(input, '"')) {
+        return length;
+    }
+
+    return scan_identifier(input);
+}
+
+std::optional<TokenType> TokenTable::match(std::string_view lexeme) const
+{
+    if (lexeme.empty())
+        return std::nullopt;
+
+    if (lexeme.size() == 1) {
+        if (auto type = single_char_token(lexeme[0])) {
+            return type;
+        }
+    }
+
+    if (lexeme.size() == 2) {
+        if (auto type = DOUBLE_CHAR_TOKENS.find(lexeme)) {
+            return type;
+        }
+    }
+
+    if (is_digit(lexeme[0]) || lexeme[0] == '.') {
+        if (auto constant = scan_constant(lexeme, true)) {
+            return constant->second;
+        }
+    }
+
+    if (scan_literal(lexeme, '\'') == lexeme.size()) {
+        return TokenType::CHAR_LITERAL;
+    }
+
+    if (scan_literal(lexeme, '"') == lexeme.size()) {
+        return TokenType::STRING_LITERAL;
+    }
+
+    if (scan_identifier(lexeme) == lexeme.size()) {
+        if (auto keyword = KEYWORDS.find(lexeme)) {
+            return keyword;
+        }
+        return TokenType::IDENTIFIER;
     }
 
-    m_identifier_pattern = std::regex("^([a-zA-Z_]\\w*\\b)");
+    return std::nullopt;
 }
@@ -0,0 +1,48 @@
+#include "common/data/remark_manager.h"
+#include <gtest/gtest.h>
+#include <sstream>
+
+TEST(RemarkManagerTest, DisabledManagerDropsRemarks)
+{
+    RemarkManager remark_manager;
+    remark_manager.emit(RemarkKind::PASSED, "pass", "main", std::nullopt, "message");
+    EXPECT_TRUE(remark_manager.remarks().empty());
+}
+
+TEST(RemarkManagerTest, RemarksAreResolvedThroughSourceManager)
+{
+    auto tokens = std::make_shared<std::vector<Token>>();
+    tokens->emplace_back(TokenType::IDENTIFIER, "x", std::monostate {}, SourceLocation("file.c", 7, 3));
+    auto source_manager = std::make_shared<SourceManager>();
+    source_manager->set_token_list(tokens);
+
+    RemarkManager remark_manager(source_manager, true);
+    remark_manager.emit(RemarkKind::MISSED, "unroll", "main", SourceLocationIndex(0), "loop isn't unrolled");
+    ASSERT_EQ(remark_manager.remarks().size(), 1u);
+    ASSERT_TRUE(remark_manager.remarks()[0].location.has_value());
+    EXPECT_EQ(remark_manager.remarks()[0].location->line_number, 7u);
+
+    std::ostringstream out;
+    remark_manager.write_yaml(out);
+    std::string expected = "--- !Missed\n"
+                           "Pass:            unroll\n"
+                           "DebugLoc:        { File: 'file.c', Line: 7, Column: 3 }\n"
+                           "Function:        main\n"
+                           "Message:         'loop isn''t unrolled'\n"
+                           "...\n";
+    EXPECT_EQ(out.str(), expected);
+}
+
+TEST(RemarkManagerTest, RepeatedRemarksAreRecordedOnce)
+{
+    auto remark_manager = std::make_shared<RemarkManager>(nullptr, true);
+    for (int i = 0; i < 3; ++i) {
+        emit_remark(remark_manager, RemarkKind::MISSED, "constant-fold", "main", SourceLocationIndex(2), "not folded, {} traps", "1 / 0");
+    }
+    emit_remark(remark_manager, RemarkKind::MISSED, "constant-fold", "main", SourceLocationIndex(3), "not folded, {} traps", "1 / 0");
+    ASSERT_EQ(remark_manager->remarks().size(), 2u);
+    EXPECT_EQ(remark_manager->remarks()[0].message, "not folded, 1 / 0 traps");
+
+    // Nothing is formatted or recorded without a manager
+    emit_remark(nullptr, RemarkKind::PASSED, "constant-fold", "main", std::nullopt, "folded to {}", 1);
+}
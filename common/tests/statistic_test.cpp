@@ -0,0 +1,63 @@
+#include "common/stats/statistic.h"
+#include <algorithm>
+#include <gtest/gtest.h>
+#include <sstream>
+#include <thread>
+#include <vector>
+
+STATISTIC(NumTestEvents, "statistic-test", "Number of test events");
+STATISTIC(MaxTestValue, "statistic-test", "Maximum test value");
+
+class StatisticTest : public ::testing::Test {
+protected:
+    void SetUp() override
+    {
+        stats::StatisticRegistry::instance().reset();
+    }
+};
+
+TEST_F(StatisticTest, CountersAreRegistered)
+{
+    const auto& all = stats::StatisticRegistry::instance().statistics();
+    EXPECT_NE(std::find(all.begin(), all.end(), &NumTestEvents), all.end());
+    EXPECT_NE(std::find(all.begin(), all.end(), &MaxTestValue), all.end());
+    EXPECT_STREQ(NumTestEvents.name(), "NumTestEvents");
+}
+
+TEST_F(StatisticTest, IncrementAndMax)
+{
+    ++NumTestEvents;
+    NumTestEvents += 4;
+    MaxTestValue.update_max(3);
+    MaxTestValue.update_max(10);
+    MaxTestValue.update_max(7);
+    EXPECT_EQ(NumTestEvents.value(), 5u);
+    EXPECT_EQ(MaxTestValue.value(), 10u);
+}
+
+TEST_F(StatisticTest, PrintSkipsZeroCounters)
+{
+    ++NumTestEvents;
+    std::ostringstream out;
+    stats::StatisticRegistry::instance().print(out);
+    EXPECT_NE(out.str().find("1 statistic-test - Number of test events"), std::string::npos);
+    EXPECT_EQ(out.str().find("Maximum test value"), std::string::npos);
+}
+
+TEST_F(StatisticTest, CountsFromSeveralThreadsAreNotLost)
+{
+    std::vector<std::thread> threads;
+    for (int t = 0; t < 4; ++t) {
+        threads.emplace_back([t] {
+            for (int i = 0; i < 10000; ++i) {
+                ++NumTestEvents;
+                MaxTestValue.update_max(t * 10000 + i);
+            }
+        });
+    }
+    for (auto& thread : threads) {
+        thread.join();
+    }
+    EXPECT_EQ(NumTestEvents.value(), 40000u);
+    EXPECT_EQ(MaxTestValue.value(), 39999u);
+}
@@ -0,0 +1,72 @@
+#include "common/data/token_table.h"
+#include <gtest/gtest.h>
+
+class TokenTableTest : public ::testing::Test {
+protected:
+    TokenTable table;
+};
+
+TEST_F(TokenTableTest, KeywordsAndIdentifiers)
+{
+    EXPECT_EQ(table.match("int"), TokenType::INT_KW);
+    EXPECT_EQ(table.match("continue"), TokenType::CONTINUE_KW);
+    EXPECT_EQ(table.match("unsigned"), TokenType::UNSIGNED_KW);
+    EXPECT_EQ(table.match("integer"), TokenType::IDENTIFIER);
+    EXPECT_EQ(table.match("_in"), TokenType::IDENTIFIER);
+    EXPECT_EQ(table.search("return0;"), 7u);
+}
+
+TEST_F(TokenTableTest, Punctuators)
+{
+    EXPECT_EQ(table.search("<= b"), 2u);
+    EXPECT_EQ(table.match("<="), TokenType::LESS_THAN_EQUAL);
+    EXPECT_EQ(table.search("<b"), 1u);
+    EXPECT_EQ(table.match("--"), TokenType::DECREMENT);
+    EXPECT_EQ(table.match("]"), TokenType::CLOSE_SQUARE_BRACKET);
+    EXPECT_EQ(table.search("|x"), 0u);
+    EXPECT_EQ(table.search("@"), 0u);
+}
+
+TEST_F(TokenTableTest, IntegerConstants)
+{
+    EXPECT_EQ(table.search("42;"), 2u);
+    EXPECT_EQ(table.search("42l;"), 3u);
+    EXPECT_EQ(table.search("42U)"), 3u);
+    EXPECT_EQ(table.search("42lu "), 4u);
+    EXPECT_EQ(table.match("42"), TokenType::CONSTANT);
+    EXPECT_EQ(table.match("42L"), TokenType::LONG_CONSTANT);
+    EXPECT_EQ(table.match("42u"), TokenType::UNSIGNED_CONSTANT);
+    EXPECT_EQ(table.match("42Ul"), TokenType::UNSIGNED_LONG_CONSTANT);
+    // A constant must not run into an identifier and must be terminated
+    EXPECT_EQ(table.search("42abc;"), 0u);
+    EXPECT_EQ(table.search("42lul;"), 0u);
+    EXPECT_EQ(table.search("42"), 0u);
+}
+
+TEST_F(TokenTableTest, DoubleConstants)
+{
+    EXPECT_EQ(table.search("1.5;"), 3u);
+    EXPECT_EQ(table.search(".5)"), 2u);
+    EXPECT_EQ(table.search("1. "), 2u);
+    EXPECT_EQ(table.search("1e+10-x"), 5u);
+    EXPECT_EQ(table.search("1.5-2"), 3u);
+    EXPECT_EQ(table.search("1.e5;"), 4u);
+    EXPECT_EQ(table.match("1.5E-3"), TokenType::DOUBLE_CONSTANT);
+    EXPECT_EQ(table.search("1.5e;"), 0u);
+    EXPECT_EQ(table.search("1.5.;"), 0u);
+    EXPECT_EQ(table.search(". "), 0u);
+    EXPECT_FALSE(table.match("1e").has_value());
+}
+
+TEST_F(TokenTableTest, Literals)
+{
+    EXPECT_EQ(table.search("'a';"), 3u);
+    EXPECT_EQ(table.search("'\\''"), 4u);
+    EXPECT_EQ(table.match("'\\n'"), TokenType::CHAR_LITERAL);
+    EXPECT_EQ(table.search("'ab'"), 0u);
+    EXPECT_EQ(table.search("'\\q'"), 0u);
+    EXPECT_EQ(table.search("\"a\\\"b\" x"), 6u);
+    EXPECT_EQ(table.match("\"\""), TokenType::STRING_LITERAL);
+    EXPECT_EQ(table.search("\"abc\n\""), 0u);
+    EXPECT_EQ(table.search("\"abc"), 0u);
+}
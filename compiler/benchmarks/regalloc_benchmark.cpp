@@ -0,0 +1,172 @@
+#include "common/data/compile_options.h"
+#include "compiler/compiler.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <format>
+#include <fstream>
+#include <string>
+#include <sys/wait.h>
+#include <vector>
+
+// Compares the register allocators on a small corpus: -O0 (every value in a stack slot), -O1 (linear scan)
+// and -O2 (graph coloring). For each program and level it reports the in-memory compile time and the run time
+// of the binary, and checks that every level computes the same exit code.
+
+namespace fs = std::filesystem;
+
+namespace {
+
+constexpr int COMPILE_RUNS = 10;
+constexpr int EXECUTE_RUNS = 5;
+
+struct Program {
+    const char* name;
+    std::string source;
+};
+
+constexpr const char* LOOPS_PROGRAM = R"(long work(long n)
+{
+    long s = 0;
+    for (long i = 0; i < n; i = i + 1) {
+        long t = i * 3 + 7;
+        if (t % 5 == 0)
+            s = s + t / 5;
+        else
+            s = s - i;
+    }
+    return s;
+}
+
+int main(void)
+{
+    return (int)(work(50000000l) % 256);
+}
+)";
+
+constexpr const char* DOUBLES_PROGRAM = R"(double dwork(int n)
+{
+    double acc = 0.0;
+    double scale = 0.5;
+    for (int i = 0; i < n; i = i + 1)
+        acc = acc * scale + i / 3.0;
+    return acc;
+}
+
+int main(void)
+{
+    return (int)dwork(50000000) % 256;
+}
+)";
+
+constexpr const char* CALLS_PROGRAM = R"(int fib(int n)
+{
+    if (n < 2)
+        return n;
+    return fib(n - 1) + fib(n - 2);
+}
+
+int main(void)
+{
+    int a = 3;
+    int b = fib(32);
+    return (a + b) % 256;
+}
+)";
+
+// One long function with many short lived values and a few long lived ones, it stresses the allocators
+// themselves more than the generated code
+std::string large_function_program(int statements)
+{
+    std::string source = "int main(void)\n{\n    long acc = 1;\n    long keep = 7;\n";
+    for (int i = 0; i < statements; ++i) {
+        source += std::format("    long v{} = acc * {} + keep;\n", i, i % 13 + 1);
+        source += std::format("    acc = (acc + v{} / {}) % 1000003;\n", i, i % 7 + 1);
+        if (i % 50 == 49) {
+            source += "    keep = keep + acc % 11;\n";
+        }
+    }
+    source += "    return (int)((acc + keep) % 256);\n}\n";
+    return source;
+}
+
+double median(std::vector<double> samples)
+{
+    std::sort(samples.begin(), samples.end());
+    return samples[samples.size() / 2];
+}
+
+// Median wall time of a command, its exit code is returned in status
+double run_ms(const std::string& command, int runs, int& status)
+{
+    std::vector<double> samples;
+    for (int i = 0; i < runs; ++i) {
+        auto start = std::chrono::steady_clock::now();
+        status = std::system(command.c_str());
+        auto end = std::chrono::steady_clock::now();
+        samples.push_back(std::chrono::duration<double, std::milli>(end - start).count());
+    }
+    return median(samples);
+}
+
+}
+
+int main()
+{
+    fs::path work_dir = fs::temp_directory_path() / "cobaltc-regalloc-benchmark";
+    fs::create_directories(work_dir);
+    fs::current_path(work_dir);
+
+    std::vector<Program> programs {
+        { "loops", LOOPS_PROGRAM },
+        { "doubles", DOUBLES_PROGRAM },
+        { "calls", CALLS_PROGRAM },
+        { "large", large_function_program(2000) },
+    };
+
+    int failures = 0;
+    std::printf("%-8s %-4s %12s %12s %10s\n", "program", "opt", "compile ms", "run ms", "exit code");
+    for (const Program& program : programs) {
+        int expected_status = -1;
+        for (int level = 0; level <= 2; ++level) {
+            CompileOptions options;
+            options.optimization_level = level;
+
+            std::vector<double> compile_samples;
+            cobaltc::CompileResult result;
+            for (int i = 0; i < COMPILE_RUNS; ++i) {
+                auto start = std::chrono::steady_clock::now();
+                result = cobaltc::compile(program.source, options);
+                auto end = std::chrono::steady_clock::now();
+                compile_samples.push_back(std::chrono::duration<double, std::milli>(end - start).count());
+            }
+            if (!result.success()) {
+                std::fprintf(stderr, "%s -O%d: compilation failed: %s\n", program.name, level, result.first_error()->message.c_str());
+                return 1;
+            }
+
+            std::string base = std::format("{}_O{}", program.name, level);
+            std::ofstream(base + ".s") << result.assembly;
+            if (std::system(std::format("gcc {}.s -o {}", base, base).c_str()) != 0) {
+                std::fprintf(stderr, "%s -O%d: assembling failed\n", program.name, level);
+                return 1;
+            }
+
+            int status = 0;
+            double run = run_ms("./" + base, EXECUTE_RUNS, status);
+            if (level == 0) {
+                expected_status = status;
+            } else if (status != expected_status) {
+                ++failures;
+            }
+            std::printf("%-8s -O%-2d %12.2f %12.2f %10d%s\n", program.name, level, median(compile_samples), run,
+                WEXITSTATUS(status), status == expected_status ? "" : "  MISMATCH");
+        }
+    }
+
+    fs::current_path(fs::temp_directory_path());
+    fs::remove_all(work_dir);
+    return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,72 @@
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <vector>
+
+// Measures the cold start of the compiler: "cobaltc-compiler file.c --lex" on a ten line file, end to end.
+// The driver always runs the preprocessor first, so "gcc -E" on the same file is timed too and subtracted,
+// what is left is the time spent loading the compiler, setting up logging and lexing.
+// The target is single digit milliseconds.
+
+namespace fs = std::filesystem;
+
+namespace {
+
+constexpr int RUNS = 50;
+
+constexpr const char* TRIVIAL_PROGRAM = R"(int add(int a, int b)
+{
+    return a + b;
+}
+
+int main(void)
+{
+    long x = 42l;
+    double d = 1.5e3;
+    return add(1, 2) + (x > 3) + (d < 2.0);
+}
+)";
+
+double median_ms(const std::string& command)
+{
+    std::vector<double> samples;
+    for (int i = 0; i < RUNS; ++i) {
+        auto start = std::chrono::steady_clock::now();
+        int res = std::system(command.c_str());
+        auto end = std::chrono::steady_clock::now();
+        if (res != 0) {
+            std::fprintf(stderr, "command failed: %s\n", command.c_str());
+            std::exit(1);
+        }
+        samples.push_back(std::chrono::duration<double, std::milli>(end - start).count());
+    }
+    std::sort(samples.begin(), samples.end());
+    return samples[samples.size() / 2];
+}
+
+}
+
+int main()
+{
+    // Run from a scratch directory, the compiler writes its logs relative to the working directory
+    fs::path work_dir = fs::temp_directory_path() / "cobaltc-startup-benchmark";
+    fs::create_directories(work_dir);
+    fs::current_path(work_dir);
+    std::ofstream("trivial.c") << TRIVIAL_PROGRAM;
+
+    double preprocessor = median_ms("gcc -E trivial.c -o trivial.i > /dev/null 2>&1");
+    double lex = median_ms(std::string(COMPILER_PATH) + " trivial.c --lex > /dev/null 2>&1");
+    double shell = median_ms("true");
+
+    std::printf("gcc -E:                        %8.2f ms\n", preprocessor - shell);
+    std::printf("cobaltc-compiler --lex:        %8.2f ms\n", lex - shell);
+    std::printf("cobaltc-compiler --lex - gcc:  %8.2f ms (median of %d runs)\n", lex - preprocessor, RUNS);
+
+    fs::current_path(fs::temp_directory_path());
+    fs::remove_all(work_dir);
+    return 0;
+}
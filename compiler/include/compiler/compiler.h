@@ -0,0 +1,65 @@
+#pragma once
+#include "backend/assembly_ast.h"
+#include "common/data/compile_options.h"
+#include "common/data/name_generator.h"
+#include "common/data/remark_manager.h"
+#include "common/data/source_location.h"
+#include "common/data/source_manager.h"
+#include "common/data/symbol_table.h"
+#include "common/data/token.h"
+#include "parser/parser_ast.h"
+#include "tacky/tacky_ast.h"
+#include <memory>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace cobaltc {
+
+struct Diagnostic {
+    enum class Severity {
+        WARNING,
+        ERROR,
+    };
+
+    Severity severity;
+    // Stage that raised the diagnostic
+    CompileStage stage;
+    std::string message;
+    // Where the error is in the source, set when the error raised by the stage knows it
+    std::optional<SourceLocation> location;
+};
+
+// Everything produced by a compilation, the intermediate results are set up to options.stop_after
+// (or up to the last stage that succeeded)
+struct CompileResult {
+    std::vector<Diagnostic> diagnostics;
+
+    std::shared_ptr<std::vector<Token>> tokens;
+    std::shared_ptr<parser::ParserAST> ast;
+    std::shared_ptr<tacky::TackyAST> tacky;
+    std::shared_ptr<backend::AssemblyAST> assembly_ast;
+    // The emitted assembly, set when stop_after is CompileStage::EMIT
+    std::string assembly;
+
+    // State shared by the stages, kept alive so that the results above can be inspected
+    std::shared_ptr<SourceManager> source_manager;
+    std::shared_ptr<SymbolTable> symbol_table;
+    std::shared_ptr<NameGenerator> name_generator;
+    std::shared_ptr<RemarkManager> remark_manager;
+
+    // True if no stage reported an error
+    bool success() const;
+    // The first error, if any
+    const Diagnostic* first_error() const;
+};
+
+// Compiles an already preprocessed translation unit held in memory. Nothing is read from or written to
+// the file system: the assembly is returned in the result and remarks are kept in the remark manager.
+// Errors do not throw, they are reported as diagnostics and the pipeline stops at the failing stage.
+// The statistics of the passes are process wide and reset on entry, they only describe a compilation when no other
+// one runs at the same time.
+CompileResult compile(std::string_view source, const CompileOptions& options = {});
+
+}
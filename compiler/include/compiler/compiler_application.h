@@ -1,4 +1,6 @@
 #pragma once
+#include "common/data/compile_options.h"
+#include "compiler/compiler.h"
 #include <optional>
 #include <stdexcept>
 #include <string>
@@ -25,12 +27,14 @@ private:
 class CompilerApplication {
 public:
     CompilerApplication();
-    void run(const std::string& input_file, const std::string& operation);
+    void run(const std::string& input_file, const std::string& operation, const CompileOptions& options = {});
 
 private:
     // Function to get the base name of a file (without directory and extension)
     int preprocess_file(const std::string& input_file, const std::string& output_file);
     int assemble_and_link(const std::string& input_file, const std::string& output_file, bool skip_linking, const std::string& lib_operation);
     bool create_stub_assembly_file(const std::string& filename);
+    // Writes the dot files of the ASTs in result to the debug directory
+    void generate_debug_files(const cobaltc::CompileResult& result, const std::string& base_name);
     static constexpr const char* LOG_CONTEXT = "compiler";
 };
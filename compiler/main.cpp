@@ -1,8 +1,12 @@
 #include "common/log/log.h"
+#include "common/stats/statistic.h"
 #include "compiler/compiler_application.h"
+#include <charconv>
 #include <format>
 #include <iostream>
+#include <optional>
 #include <string>
+#include <vector>
 
 constexpr const char* LOG_CONTEXT = "compiler";
 
@@ -13,7 +17,7 @@ void print_error(const std::string& message)
 
 void print_usage(const char* program_name)
 {
-    std::cerr << "\nUsage: " << program_name << " INPUT_FILE.c [--operation]" << std::endl;
+    std::cerr << "\nUsage: " << program_name << " INPUT_FILE.c [--operation] [-O0|-O1|-O2] [--stats] [--remarks=FILE.yaml] [--unroll-factor=N] [--unroll-budget=N]" << std::endl;
     std::cerr << "\nOperations:" << std::endl;
     std::cerr << "  --lex      Stop after lexical analysis" << std::endl;
     std::cerr << "  --parse    Stop after parsing" << std::endl;
@@ -21,15 +25,69 @@ void print_usage(const char* program_name)
     std::cerr << "  --codegen  Stop after code generation" << std::endl;
     std::cerr << "  -S         Stop after assembly generation" << std::endl;
     std::cerr << "  No option  Perform full compilation" << std::endl;
+    std::cerr << "\nOptions:" << std::endl;
+    std::cerr << "  -O0        Keep every value on the stack" << std::endl;
+    std::cerr << "  -O1        Optimize Tacky, allocate registers with linear scan" << std::endl;
+    std::cerr << "  -O2        Optimize Tacky, allocate registers with graph coloring (default)" << std::endl;
+    std::cerr << "  --stats    Print statistics collected by the compiler passes on exit" << std::endl;
+    std::cerr << "  --remarks=FILE.yaml  Write optimization remarks to FILE.yaml" << std::endl;
+    std::cerr << "  --unroll-factor=N    Copies of a loop body between two exit tests, 1 unrolls only loops with a known trip count (default 4)" << std::endl;
+    std::cerr << "  --unroll-budget=N    Tacky instructions the copies of one loop may take, 0 turns unrolling off (default 64)" << std::endl;
     std::cerr << "\nExample:" << std::endl;
     std::cerr << "  " << program_name << " myprogram.c      # Full compilation" << std::endl;
     std::cerr << "  " << program_name << " myprogram.c -S   # Generate assembly only" << std::endl;
 }
 
+// A non-negative decimal number, nothing when the text is anything else
+std::optional<int> parse_count(const std::string& text)
+{
+    int value = 0;
+    auto [end, error] = std::from_chars(text.data(), text.data() + text.size(), value);
+    if (text.empty() || error != std::errc() || end != text.data() + text.size() || value < 0) {
+        return std::nullopt;
+    }
+    return value;
+}
+
 int main(int argc, char* argv[])
 {
+    // Driver options can appear anywhere, the remaining arguments are the input file and the operation
+    bool print_statistics = false;
+    CompileOptions options;
+    std::vector<std::string> arguments;
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg == "--stats") {
+            print_statistics = true;
+        } else if (arg == "-O0" || arg == "-O1" || arg == "-O2") {
+            options.optimization_level = arg[2] - '0';
+        } else if (arg.starts_with("--remarks=")) {
+            options.remarks_file = arg.substr(std::string("--remarks=").size());
+            if (options.remarks_file.empty()) {
+                print_error("--remarks requires a file name");
+                print_usage(argv[0]);
+                return 1;
+            }
+        } else if (arg.starts_with("--unroll-factor=") || arg.starts_with("--unroll-budget=")) {
+            bool is_factor = arg.starts_with("--unroll-factor=");
+            auto value = parse_count(arg.substr(arg.find('=') + 1));
+            if (!value || (is_factor && *value == 0)) {
+                print_error(std::format("Invalid value in {}", arg));
+                print_usage(argv[0]);
+                return 1;
+            }
+            if (is_factor) {
+                options.unroll_factor = *value;
+            } else {
+                options.unroll_size_budget = *value;
+            }
+        } else {
+            arguments.push_back(arg);
+        }
+    }
+
     // Check if correct number of arguments were provided
-    if (argc < 2 || argc > 3) {
+    if (arguments.size() < 1 || arguments.size() > 2) {
         print_error("Incorrect number of arguments");
         print_usage(argv[0]);
         return 1;
@@ -39,10 +97,10 @@ int main(int argc, char* argv[])
     std::string operation;
 
     // Parse command line arguments
-    if (argc == 3) {
+    if (arguments.size() == 2) {
         // The command format is: program OPERATION INPUT_FILE
-        operation = argv[1];
-        input_file = argv[2];
+        operation = arguments[0];
+        input_file = arguments[1];
 
         // Check if the operation starts with '-' or '--'
         if (operation[0] != '-') {
@@ -51,30 +109,35 @@ int main(int argc, char* argv[])
         }
     } else {
         // Single argument must be the input file
-        input_file = argv[1];
+        input_file = arguments[0];
         operation = "";
     }
 
-    LOG_DEBUG(LOG_CONTEXT, std::format("Starting compiler with input file: '{}', operation: '{}'", input_file, operation.empty() ? "full compilation" : operation));
+    LOG_DEBUG(LOG_CONTEXT, "Starting compiler with input file: '{}', operation: '{}'", input_file, operation.empty() ? "full compilation" : operation);
 
+    int exit_code = 0;
     try {
         CompilerApplication app;
 
         // Display compilation start message
-        LOG_INFO(LOG_CONTEXT, std::format("Compiling '{}'{}\n", input_file, operation.empty() ? "" : std::format(" with operation: {}", operation)));
+        LOG_INFO(LOG_CONTEXT, "Compiling '{}'{}{}\n", input_file, operation.empty() ? "" : " with operation: ", operation);
 
-        app.run(input_file, operation);
+        app.run(input_file, operation, options);
 
         // Display compilation success message
-        LOG_INFO(LOG_CONTEXT, std::format("Successfully completed operation on '{}'\n", input_file));
+        LOG_INFO(LOG_CONTEXT, "Successfully completed operation on '{}'\n", input_file);
 
     } catch (const CompilerError& e) {
-        LOG_CRITICAL(LOG_CONTEXT, std::format("Compilation failed: {}", e.what(), input_file));
-        return 1;
+        LOG_CRITICAL(LOG_CONTEXT, "Compilation failed: {}", e.what());
+        exit_code = 1;
     } catch (const std::exception& e) {
-        LOG_CRITICAL(LOG_CONTEXT, std::format("Unexpected error: {} for file: {}", e.what(), input_file));
-        return 1;
+        LOG_CRITICAL(LOG_CONTEXT, "Unexpected error: {} for file: {}", e.what(), input_file);
+        exit_code = 1;
+    }
+
+    if (print_statistics) {
+        stats::StatisticRegistry::instance().print(std::cerr);
     }
 
-    return 0;
+    return exit_code;
 }
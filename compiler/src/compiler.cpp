@@ -0,0 +1,187 @@
+#include "compiler/compiler.h"
+#include "backend/assembly_generator.h"
+#include "backend/backend_symbol_table.h"
+#include "backend/code_emitter.h"
+#include "common/data/token_table.h"
+#include "common/data/warning_manager.h"
+#include "common/log/log.h"
+#include "common/stats/statistic.h"
+#include "lexer/lexer.h"
+#include "parser/parser.h"
+#include "parser/semantic_analyzer.h"
+#include "parser/semantic_analyzer_error.h"
+#include "parser/type_validator.h"
+#include "tacky/tacky_generator.h"
+#include "tacky/tacky_optimizer.h"
+#include <algorithm>
+#include <format>
+#include <sstream>
+
+namespace cobaltc {
+
+namespace {
+
+constexpr const char* LOG_CONTEXT = "compiler";
+
+// Records the warnings raised by the stages as diagnostics, they are still logged as before
+class DiagnosticWarningManager : public WarningManager {
+public:
+    explicit DiagnosticWarningManager(std::vector<Diagnostic>& diagnostics)
+        : m_diagnostics { diagnostics }
+    {
+    }
+
+    void set_stage(CompileStage stage) { m_stage = stage; }
+
+    void raise_warning(LexerWarningType warning_type, const std::string& message) override
+    {
+        WarningManager::raise_warning(warning_type, message);
+        m_diagnostics.push_back({ Diagnostic::Severity::WARNING, m_stage, message });
+    }
+
+    void raise_warning(ParserWarningType warning_type, const std::string& message) override
+    {
+        WarningManager::raise_warning(warning_type, message);
+        m_diagnostics.push_back({ Diagnostic::Severity::WARNING, m_stage, message });
+    }
+
+private:
+    std::vector<Diagnostic>& m_diagnostics;
+    CompileStage m_stage { CompileStage::LEX };
+};
+
+// Runs one stage, turning its errors into diagnostics, returns false if the stage failed
+template<typename StageError, typename Function>
+bool run_stage(CompileResult& result, CompileStage stage, const char* error_prefix, const char* stage_name, Function&& function)
+{
+    try {
+        function();
+        return true;
+    } catch (const StageError& e) {
+        std::optional<SourceLocation> location;
+        if constexpr (requires { e.source_location(); }) {
+            location = e.source_location();
+        }
+        result.diagnostics.push_back({ Diagnostic::Severity::ERROR, stage, std::format("{}: {}", error_prefix, e.what()), location });
+    } catch (const std::exception& e) {
+        result.diagnostics.push_back({ Diagnostic::Severity::ERROR, stage,
+            std::format("Unexpected error during {} stage: {}\n"
+                        "This may indicate a bug in the compiler - please report this issue",
+                stage_name, e.what()) });
+    }
+    return false;
+}
+
+}
+
+bool CompileResult::success() const
+{
+    return first_error() == nullptr;
+}
+
+const Diagnostic* CompileResult::first_error() const
+{
+    auto it = std::find_if(diagnostics.begin(), diagnostics.end(), [](const Diagnostic& d) {
+        return d.severity == Diagnostic::Severity::ERROR;
+    });
+    return it == diagnostics.end() ? nullptr : &*it;
+}
+
+CompileResult compile(std::string_view source, const CompileOptions& options)
+{
+    CompileResult result;
+    // The counters --stats prints describe this compilation, not the ones before it in the process. They are shared by
+    // the whole process, a compilation running at the same time on another thread would reset and add to them
+    stats::StatisticRegistry::instance().reset();
+
+    std::shared_ptr<TokenTable> token_table = std::make_shared<TokenTable>();
+    std::shared_ptr<backend::BackendSymbolTable> backend_symbol_table = std::make_shared<backend::BackendSymbolTable>();
+    std::shared_ptr<CompileOptions> compile_options = std::make_shared<CompileOptions>(options);
+    std::shared_ptr<DiagnosticWarningManager> warning_manager = std::make_shared<DiagnosticWarningManager>(result.diagnostics);
+    result.source_manager = std::make_shared<SourceManager>();
+    result.symbol_table = std::make_shared<SymbolTable>();
+    result.name_generator = std::make_shared<NameGenerator>();
+    result.remark_manager = std::make_shared<RemarkManager>(result.source_manager, !options.remarks_file.empty());
+
+    // Lexing stage
+    LOG_INFO(LOG_CONTEXT, "Lexing '{}'", options.source_name);
+    bool ok = run_stage<LexerError>(result, CompileStage::LEX, "Lexer error", "lexing", [&] {
+        LexerContext lexer_context { options.source_name, token_table, result.source_manager, warning_manager, source };
+        Lexer lexer(lexer_context);
+        result.tokens = std::make_shared<std::vector<Token>>(lexer.tokenize());
+        result.source_manager->set_token_list(result.tokens);
+        LOG_INFO(LOG_CONTEXT, "Lexing successful: {} tokens generated", result.tokens->size());
+    });
+    if (!ok || options.stop_after == CompileStage::LEX) {
+        return result;
+    }
+
+    // Parsing stage
+    LOG_INFO(LOG_CONTEXT, "Starting parsing stage");
+    warning_manager->set_stage(CompileStage::PARSE);
+    ok = run_stage<parser::Parser::ParserError>(result, CompileStage::PARSE, "Parser error", "parsing", [&] {
+        parser::Parser parser(*result.tokens, result.source_manager);
+        result.ast = parser.parse_program();
+        LOG_INFO(LOG_CONTEXT, "Parsing successful");
+    });
+    if (!ok || options.stop_after == CompileStage::PARSE) {
+        return result;
+    }
+
+    // Semantic analysis stage, it annotates the AST in place
+    LOG_INFO(LOG_CONTEXT, "Starting Semantic Analysis stage");
+    warning_manager->set_stage(CompileStage::VALIDATE);
+    ok = run_stage<parser::SemanticAnalyzerError>(result, CompileStage::VALIDATE, "Semantic Analysis error", "Semantic Analysis", [&] {
+        parser::SemanticAnalyzer semantic_analyzer(result.ast, result.name_generator, result.symbol_table, result.source_manager, warning_manager);
+        semantic_analyzer.analyze();
+        parser::TypeValidator type_validator;
+        type_validator.validate_types(*result.ast);
+        LOG_INFO(LOG_CONTEXT, "Semantic Analysis");
+    });
+    if (!ok || options.stop_after == CompileStage::VALIDATE) {
+        return result;
+    }
+
+    // Tacky generation stage
+    LOG_INFO(LOG_CONTEXT, "Starting tacky generation stage");
+    warning_manager->set_stage(CompileStage::TACKY);
+    ok = run_stage<tacky::TackyGeneratorError>(result, CompileStage::TACKY, "TackyGenerator", "tacky generation", [&] {
+        tacky::TackyGenerator tacky_generator(result.ast, result.name_generator, result.symbol_table);
+        result.tacky = tacky_generator.generate();
+    });
+    if (ok && options.optimization_level >= 1) {
+        LOG_INFO(LOG_CONTEXT, "Starting tacky optimization stage");
+        ok = run_stage<tacky::TackyOptimizerError>(result, CompileStage::TACKY, "TackyOptimizer", "tacky optimization", [&] {
+            tacky::TackyOptimizer tacky_optimizer(result.tacky, result.symbol_table, result.name_generator, compile_options, result.remark_manager);
+            tacky_optimizer.optimize();
+        });
+    }
+    if (!ok || options.stop_after == CompileStage::TACKY) {
+        return result;
+    }
+
+    // Assembly generation stage
+    LOG_INFO(LOG_CONTEXT, "Starting assembly generation stage");
+    warning_manager->set_stage(CompileStage::CODEGEN);
+    ok = run_stage<backend::AssemblyGeneratorError>(result, CompileStage::CODEGEN, "AssemblyGeneration", "assembly generation", [&] {
+        backend::AssemblyGenerator assembly_generator(result.tacky, result.symbol_table, backend_symbol_table, compile_options, result.name_generator, result.remark_manager);
+        result.assembly_ast = assembly_generator.generate();
+    });
+    if (!ok || options.stop_after == CompileStage::CODEGEN) {
+        return result;
+    }
+
+    // Code emission stage
+    LOG_INFO(LOG_CONTEXT, "Emitting assembly");
+    warning_manager->set_stage(CompileStage::EMIT);
+    run_stage<backend::CodeEmitterError>(result, CompileStage::EMIT, "CodeEmitter error", "code emission", [&] {
+        std::ostringstream out;
+        backend::CodeEmitter code_emitter(result.assembly_ast, backend_symbol_table);
+        code_emitter.emit_code(out);
+        result.assembly = std::move(out).str();
+    });
+
+    return result;
+}
+
+}
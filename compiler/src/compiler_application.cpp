@@ -1,22 +1,9 @@
 #include "compiler/compiler_application.h"
-#include "backend/assembly_generator.h"
 #include "backend/assembly_printer.h"
-#include "backend/backend_symbol_table.h"
-#include "backend/code_emitter.h"
-#include "common//data/source_manager.h"
 #include "common/data/compile_options.h"
-#include "common/data/token.h"
-#include "common/data/token_table.h"
-#include "common/data/warning_manager.h"
 #include "common/log/log.h"
-#include "lexer/lexer.h"
-#include "parser/parser.h"
+#include "compiler/compiler.h"
 #include "parser/parser_printer.h"
-#include "parser/semantic_analyzer.h"
-#include "parser/semantic_analyzer_error.h"
-#include "parser/type_check_pass.h"
-#include "parser/type_validator.h"
-#include "tacky/tacky_generator.h"
 #include "tacky/tacky_printer.h"
 #include <algorithm>
 #include <cstdlib>
@@ -25,6 +12,7 @@
 #include <fstream>
 #include <memory>
 #include <regex>
+#include <sstream>
 #include <vector>
 
 CompilerApplication::CompilerApplication()
@@ -40,7 +28,7 @@ CompilerApplication::CompilerApplication()
     }
 }
 
-void CompilerApplication::run(const std::string& input_file, const std::string& operation)
+void CompilerApplication::run(const std::string& input_file, const std::string& operation, const CompileOptions& options)
 {
     // Check if operation is valid
     std::vector<std::string> valid_operations = { "--lex", "--parse", "--validate", "--tacky", "--codegen", "-S", "-c", "" };
@@ -61,7 +49,20 @@ void CompilerApplication::run(const std::string& input_file, const std::string&
             input_file));
     }
 
-    LOG_INFO(LOG_CONTEXT, std::format("Starting compilation of '{}'", input_file));
+    LOG_INFO(LOG_CONTEXT, "Starting compilation of '{}'", input_file);
+
+    CompileStage stop_after = CompileStage::EMIT;
+    if (operation == "--lex") {
+        stop_after = CompileStage::LEX;
+    } else if (operation == "--parse") {
+        stop_after = CompileStage::PARSE;
+    } else if (operation == "--validate") {
+        stop_after = CompileStage::VALIDATE;
+    } else if (operation == "--tacky") {
+        stop_after = CompileStage::TACKY;
+    } else if (operation == "--codegen") {
+        stop_after = CompileStage::CODEGEN;
+    }
 
     // Preprocessing stage
     std::filesystem::path file_path(input_file);
@@ -70,199 +71,70 @@ void CompilerApplication::run(const std::string& input_file, const std::string&
 
     std::string preprocessed_output_file = parent_path / (base_name + ".i");
 
-    LOG_INFO(LOG_CONTEXT, std::format("Preprocessing '{}' to '{}'", input_file, preprocessed_output_file));
+    LOG_INFO(LOG_CONTEXT, "Preprocessing '{}' to '{}'", input_file, preprocessed_output_file);
 
-    int result = preprocess_file(input_file, preprocessed_output_file);
-    if (result != 0) {
+    int preprocess_result = preprocess_file(input_file, preprocessed_output_file);
+    if (preprocess_result != 0) {
         throw CompilerError(std::format(
             "Preprocessing failed for file '{}' with error code {}\n"
             "Check that the input file exists and contains valid C code",
-            input_file, result));
+            input_file, preprocess_result));
     }
 
     FileCleaner file_cleaner;
     file_cleaner.push_back(preprocessed_output_file);
 
-    std::shared_ptr<TokenTable> token_table = std::make_shared<TokenTable>();
-    std::shared_ptr<NameGenerator> name_generator = std::make_shared<NameGenerator>();
-    std::shared_ptr<SymbolTable> symbol_table = std::make_shared<SymbolTable>();
-    std::shared_ptr<backend::BackendSymbolTable> backend_symbol_table = std::make_shared<backend::BackendSymbolTable>();
-    std::shared_ptr<CompileOptions> compile_options = std::make_shared<CompileOptions>();
-    std::shared_ptr<SourceManager> source_manager = std::make_shared<SourceManager>();
-    std::shared_ptr<WarningManager> warning_manager = std::make_shared<WarningManager>();
-    std::shared_ptr<std::vector<Token>> tokens;
-
-    // HARD-CODING COMPILER OPTIONS
-    compile_options->enable_assembly_comments = true;
-
-    // Lexing stage
-    try {
-        LOG_INFO(LOG_CONTEXT, std::format("Lexing file '{}'", preprocessed_output_file));
-        LexerContext lexer_context { preprocessed_output_file, token_table, source_manager, warning_manager };
-        Lexer lexer(lexer_context);
-        tokens = std::make_shared<std::vector<Token>>(lexer.tokenize());
-        source_manager->set_token_list(tokens);
-        LOG_INFO(LOG_CONTEXT, std::format("Lexing successful: {} tokens generated", tokens->size()));
-
-        /*
-        if (logging::LogManager::logger()->is_enabled(LOG_CONTEXT, logging::LogLevel::DEBUG)) {
-            std::string token_list = "Token List:\n";
-            for (const Token& t : *tokens) {
-                token_list += t.to_string() + "\n";
-            }
-            LOG_DEBUG(LOG_CONTEXT, token_list);
-        }
-        */
-    } catch (const LexerError& e) {
-        throw CompilerError(std::format("Lexer error: {}", e.what()));
-    } catch (const std::exception& e) {
-        throw CompilerError(std::format(
-            "Unexpected error during lexing stage: {}\n"
-            "This may indicate a bug in the compiler - please report this issue",
-            e.what()));
-    }
-
-    if (operation == "--lex") {
-        LOG_INFO(LOG_CONTEXT, "Lexing operation completed successfully");
-        return;
-    }
-
-    std::shared_ptr<parser::ParserAST> parser_ast;
-    // Parsing stage
-    try {
-        LOG_INFO(LOG_CONTEXT, "Starting parsing stage");
-
-        parser::Parser parser(*tokens, source_manager);
-        parser_ast = parser.parse_program();
-
-        LOG_INFO(LOG_CONTEXT, "Parsing successful");
-
-        if (logging::LogManager::logger()->is_enabled(LOG_CONTEXT, logging::LogLevel::DEBUG)) {
-            std::string debug_str = "Parsed Program\n";
-            LOG_DEBUG(LOG_CONTEXT, debug_str);
-            parser::PrinterVisitor printer;
-            std::string base_name = file_path.stem().string();
-            printer.generate_dot_file("debug/" + base_name + "_parserAST.dot", *(parser_ast.get()));
-            LOG_DEBUG(LOG_CONTEXT, "Generated AST visualization in 'ast.dot'");
-        }
-    } catch (const parser::Parser::ParserError& e) {
-        throw CompilerError(std::format("Parser error: {}", e.what()));
-    } catch (const std::exception& e) {
-        throw CompilerError(std::format(
-            "Unexpected error during parsing stage: {}\n"
-            "This may indicate a bug in the compiler - please report this issue",
-            e.what()));
-    }
-
-    if (operation == "--parse") {
-        LOG_INFO(LOG_CONTEXT, "Parsing operation completed successfully");
-        return;
-    }
-
-    try {
-        LOG_INFO(LOG_CONTEXT, "Starting Semantic Analysis stage");
-
-        parser::SemanticAnalyzer semantic_analyzer(parser_ast, name_generator, symbol_table, source_manager, warning_manager);
-        semantic_analyzer.analyze();
-        parser::TypeValidator type_validator;
-        type_validator.validate_types(*parser_ast);
-
-        LOG_INFO(LOG_CONTEXT, "Semantic Analysis");
-
-        if (logging::LogManager::logger()->is_enabled(LOG_CONTEXT, logging::LogLevel::DEBUG)) {
-            std::string debug_str = "Parsed Program\n";
-            LOG_DEBUG(LOG_CONTEXT, debug_str);
-            parser::PrinterVisitor printer;
-            std::string base_name = file_path.stem().string();
-            printer.generate_dot_file("debug/" + base_name + "_semantic_analysisAST.dot", *(parser_ast.get()));
-            LOG_DEBUG(LOG_CONTEXT, "Generated AST visualization");
+    std::string source;
+    {
+        std::ifstream file(preprocessed_output_file, std::ios::binary);
+        if (!file.is_open()) {
+            throw CompilerError(std::format("Failed to open preprocessed file '{}'", preprocessed_output_file));
         }
-    } catch (const parser::SemanticAnalyzerError& e) {
-        throw CompilerError(std::format("Semantic Analysis error: {}", e.what()));
-    } catch (const std::exception& e) {
-        throw CompilerError(std::format(
-            "Unexpected error during Semantic Analysis stage: {}\n"
-            "This may indicate a bug in the compiler - please report this issue",
-            e.what()));
+        std::ostringstream content;
+        content << file.rdbuf();
+        source = std::move(content).str();
     }
 
-    if (operation == "--validate") {
-        LOG_INFO(LOG_CONTEXT, "Semantic Analysis operation completed successfully");
-        return;
-    }
+    CompileOptions compile_options = options;
+    compile_options.source_name = preprocessed_output_file;
+    compile_options.stop_after = stop_after;
+    // HARD-CODING COMPILER OPTIONS
+    compile_options.enable_assembly_comments = true;
 
-    // Code generation stage
-    LOG_INFO(LOG_CONTEXT, "Starting tacky generation stage");
+    cobaltc::CompileResult result = cobaltc::compile(source, compile_options);
 
-    std::shared_ptr<tacky::TackyAST> tacky_ast;
-    try {
-        tacky::TackyGenerator tacky_generator(parser_ast, name_generator, symbol_table);
-        tacky_ast = tacky_generator.generate();
-        if (logging::LogManager::logger()->is_enabled(LOG_CONTEXT, logging::LogLevel::DEBUG)) {
-            std::string debug_str = "Parsed Program\n";
-            LOG_DEBUG(LOG_CONTEXT, debug_str);
-            tacky::PrinterVisitor printer;
-            std::string base_name = file_path.stem().string();
-            printer.generate_dot_file("debug/" + base_name + "_tackyAST.dot", *(tacky_ast.get()));
-            LOG_DEBUG(LOG_CONTEXT, "Generated AST visualization in 'ast.dot'");
-        }
-    } catch (const tacky::TackyGeneratorError& e) {
-        throw CompilerError(std::format("TackyGenerator: {}", e.what()));
-    } catch (const std::exception& e) {
-        throw CompilerError(std::format(
-            "Unexpected error during tacky generation stage: {}\n"
-            "This may indicate a bug in the compiler - please report this issue",
-            e.what()));
+    if (logging::LogManager::logger()->is_enabled(LOG_CONTEXT, logging::LogLevel::DEBUG)) {
+        generate_debug_files(result, base_name);
     }
 
-    if (operation == "--tacky") {
-        LOG_INFO(LOG_CONTEXT, "Tacky generation operation completed successfully");
-        return;
+    if (const cobaltc::Diagnostic* error = result.first_error()) {
+        throw CompilerError(error->message);
     }
 
-    // Code generation stage
-    LOG_INFO(LOG_CONTEXT, "Starting assembly generation stage");
-
-    std::shared_ptr<backend::AssemblyAST> assembly_ast;
-    try {
-        backend::AssemblyGenerator assembly_generator(tacky_ast, symbol_table, backend_symbol_table, compile_options, name_generator);
-        assembly_ast = assembly_generator.generate();
-        if (logging::LogManager::logger()->is_enabled(LOG_CONTEXT, logging::LogLevel::DEBUG)) {
-            std::string debug_str = "Parsed Program\n";
-            LOG_DEBUG(LOG_CONTEXT, debug_str);
-            backend::PrinterVisitor printer;
-            std::string base_name = file_path.stem().string();
-            printer.generate_dot_file("debug/" + base_name + "_assemblyAST.dot", *(assembly_ast.get()));
-            LOG_DEBUG(LOG_CONTEXT, "Generated AssemblyAST visualization in 'ast.dot'");
+    if (result.remark_manager->is_enabled() && stop_after >= CompileStage::CODEGEN) {
+        LOG_INFO(LOG_CONTEXT, "Writing {} optimization remarks to '{}'", result.remark_manager->remarks().size(), compile_options.remarks_file);
+        try {
+            result.remark_manager->write_yaml(compile_options.remarks_file);
+        } catch (const std::exception& e) {
+            throw CompilerError(e.what());
         }
-    } catch (const backend::AssemblyGeneratorError& e) {
-        throw CompilerError(std::format("AssemblyGeneration: {}", e.what()));
-    } catch (const std::exception& e) {
-        throw CompilerError(std::format(
-            "Unexpected error during assembly generation stage: {}\n"
-            "This may indicate a bug in the compiler - please report this issue",
-            e.what()));
     }
 
-    if (operation == "--codegen") {
-        LOG_INFO(LOG_CONTEXT, "Code generation operation completed successfully");
+    if (stop_after != CompileStage::EMIT) {
+        LOG_INFO(LOG_CONTEXT, "Operation '{}' completed successfully", operation);
         return;
     }
 
     // Assembly generation
     std::string assembly_file = parent_path / (base_name + ".s");
-    LOG_INFO(LOG_CONTEXT, std::format("Generating assembly file '{}'", assembly_file));
+    LOG_INFO(LOG_CONTEXT, "Generating assembly file '{}'", assembly_file);
 
-    try {
-        backend::CodeEmitter code_emitter(assembly_file, assembly_ast, backend_symbol_table);
-        code_emitter.emit_code();
-    } catch (const backend::CodeEmitterError& e) {
-        throw CompilerError(std::format("CodeEmitter error: {}", e.what()));
-    } catch (const std::exception& e) {
-        throw CompilerError(std::format(
-            "Unexpected error during code emission stage: {}\n"
-            "This may indicate a bug in the compiler - please report this issue",
-            e.what()));
+    {
+        std::ofstream file(assembly_file, std::ios::out | std::ios::trunc);
+        if (!file.is_open()) {
+            throw CompilerError(std::format("CodeEmitter error: Failed to open '{}' for writing", assembly_file));
+        }
+        file << result.assembly;
     }
 
     if (operation == "-S") {
@@ -281,7 +153,7 @@ void CompilerApplication::run(const std::string& input_file, const std::string&
         output_file += ".o";
     }
 
-    LOG_INFO(LOG_CONTEXT, std::format("Assembling and linking '{}' to '{}'", assembly_file, output_file));
+    LOG_INFO(LOG_CONTEXT, "Assembling and linking '{}' to '{}'", assembly_file, output_file);
 
     int assemble_and_link_result = assemble_and_link(assembly_file, output_file, skip_linking, is_lib_operation ? operation : "");
     if (assemble_and_link_result) {
@@ -291,14 +163,32 @@ void CompilerApplication::run(const std::string& input_file, const std::string&
             assembly_file, output_file, assemble_and_link_result));
     }
 
-    LOG_INFO(LOG_CONTEXT, std::format("Compilation successful: Generated file '{}'", output_file));
+    LOG_INFO(LOG_CONTEXT, "Compilation successful: Generated file '{}'", output_file);
+}
+
+void CompilerApplication::generate_debug_files(const cobaltc::CompileResult& result, const std::string& base_name)
+{
+    if (result.ast) {
+        // The semantic analysis annotates the AST in place, this is the AST as the last stage left it
+        parser::PrinterVisitor printer;
+        printer.generate_dot_file("debug/" + base_name + "_parserAST.dot", *result.ast);
+    }
+    if (result.tacky) {
+        tacky::PrinterVisitor printer;
+        printer.generate_dot_file("debug/" + base_name + "_tackyAST.dot", *result.tacky);
+    }
+    if (result.assembly_ast) {
+        backend::PrinterVisitor printer;
+        printer.generate_dot_file("debug/" + base_name + "_assemblyAST.dot", *result.assembly_ast);
+    }
+    LOG_DEBUG(LOG_CONTEXT, "Generated AST visualizations in 'debug/'");
 }
 
 bool CompilerApplication::create_stub_assembly_file(const std::string& filename)
 {
     std::ofstream file(filename);
     if (!file.is_open()) {
-        LOG_ERROR(LOG_CONTEXT, std::format("Failed to create assembly file '{}'", filename));
+        LOG_ERROR(LOG_CONTEXT, "Failed to create assembly file '{}'", filename);
         return false;
     }
 
@@ -315,23 +205,24 @@ bool CompilerApplication::create_stub_assembly_file(const std::string& filename)
 
     file.close();
 
-    LOG_DEBUG(LOG_CONTEXT, std::format("Created assembly file '{}'", filename));
+    LOG_DEBUG(LOG_CONTEXT, "Created assembly file '{}'", filename);
     return true;
 }
 
 int CompilerApplication::preprocess_file(const std::string& input_file, const std::string& output_file)
 {
     // Build the command string
-    std::string command = "gcc -E -P";
+    // Keep the line markers, the lexer uses them to map tokens back to the original source file
+    std::string command = "gcc -E";
     command += " " + input_file + " -o " + output_file;
 
-    LOG_DEBUG(LOG_CONTEXT, std::format("Preprocessing command: {}", command));
+    LOG_DEBUG(LOG_CONTEXT, "Preprocessing command: {}", command);
 
     // Execute the command
     int result = std::system(command.c_str());
 
     if (result != 0) {
-        LOG_ERROR(LOG_CONTEXT, std::format("Preprocessing failed with error code {}", result));
+        LOG_ERROR(LOG_CONTEXT, "Preprocessing failed with error code {}", result);
     }
 
     return result;
@@ -351,7 +242,7 @@ int CompilerApplication::assemble_and_link(const std::string& assembly_file, con
         throw CompilerError(std::format("Output file must have .o extension"));
     }
 
-    LOG_DEBUG(LOG_CONTEXT, std::format("Assembling and linking command: {}", command));
+    LOG_DEBUG(LOG_CONTEXT, "Assembling and linking command: {}", command);
 
     // Execute the command
     int result = std::system(command.c_str());
@@ -0,0 +1,389 @@
+#include "compiler/compiler.h"
+#include "common/stats/statistic.h"
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <format>
+#include <fstream>
+#include <gtest/gtest.h>
+#include <optional>
+
+using cobaltc::CompileResult;
+using cobaltc::Diagnostic;
+
+namespace {
+
+// Assembles and links the program with gcc and returns what it prints, nothing if a step fails
+std::optional<std::string> run(const std::string& source, const CompileOptions& options = {})
+{
+    CompileResult result = cobaltc::compile(source, options);
+    if (!result.success()) {
+        return std::nullopt;
+    }
+    // ctest runs the tests in processes of their own, each gets its own files
+    std::filesystem::path directory = std::filesystem::temp_directory_path() / "cobaltc-compiler-test";
+    std::filesystem::create_directories(directory);
+    std::filesystem::path program = directory / ::testing::UnitTest::GetInstance()->current_test_info()->name();
+    std::ofstream(program.string() + ".s") << result.assembly;
+    if (std::system(std::format("gcc -o {} {}.s", program.string(), program.string()).c_str()) != 0) {
+        return std::nullopt;
+    }
+    FILE* pipe = popen(program.c_str(), "r");
+    if (!pipe) {
+        return std::nullopt;
+    }
+    std::string output;
+    char buffer[256];
+    while (size_t read = std::fread(buffer, 1, sizeof(buffer), pipe)) {
+        output.append(buffer, read);
+    }
+    return pclose(pipe) == 0 ? std::optional(output) : std::nullopt;
+}
+
+// Prints f(n) for n from 0 to 9, one per line
+std::string print_first_ten(const std::string& function)
+{
+    return "int putchar(int c);\n"
+           "int print(long n) { if (n < 0) { putchar(45); n = -n; } if (n >= 10) print(n / 10); putchar(48 + n % 10); return 0; }\n"
+        + function + "\nint main(void) { for (int n = 0; n < 10; n = n + 1) { print(f(n)); putchar(10); } return 0; }\n";
+}
+
+// The unroll factors of the tests, 1 leaves the loops with a trip count known only at run time alone
+const std::vector<int> UNROLL_FACTORS { 1, 2, 3, 4, 8 };
+
+}
+
+TEST(CompilerTest, CompilesToAssemblyInMemory)
+{
+    CompileResult result = cobaltc::compile("int main(void) { return 2; }\n");
+    ASSERT_TRUE(result.success());
+    EXPECT_NE(result.assembly.find("main:"), std::string::npos);
+    EXPECT_NE(result.assembly.find("ret"), std::string::npos);
+    EXPECT_TRUE(result.tokens);
+    EXPECT_TRUE(result.ast);
+    EXPECT_TRUE(result.tacky);
+    EXPECT_TRUE(result.assembly_ast);
+}
+
+TEST(CompilerTest, DoubleToUnsignedLongHandlesValuesAboveLongRange)
+{
+    CompileResult result = cobaltc::compile("unsigned long f(double d) { return d; }\n");
+    ASSERT_TRUE(result.success());
+    // d is compared with 2^63 as a double, and the high bit is added from a register set to it
+    EXPECT_NE(result.assembly.find("comisd"), std::string::npos);
+    EXPECT_EQ(result.assembly.find("cmpq"), std::string::npos);
+    EXPECT_NE(result.assembly.find("movq $9223372036854775808, %"), std::string::npos);
+    EXPECT_EQ(result.assembly.find("andq"), std::string::npos);
+}
+
+TEST(CompilerTest, ExtensionsIntoStackSlotsStoreTheirWidth)
+{
+    // At -O0 every value is in a stack slot, so the extended values are stored from R11
+    CompileOptions options;
+    options.optimization_level = 0;
+    CompileResult result = cobaltc::compile("int f(char c) { return c; }\n", options);
+    ASSERT_TRUE(result.success());
+    // Four bytes, eight overwrote the neighbouring slot
+    EXPECT_NE(result.assembly.find("movl %r11d, -"), std::string::npos);
+    EXPECT_EQ(result.assembly.find("movq %r11, -"), std::string::npos);
+
+    result = cobaltc::compile("long f(unsigned char c) { return c; }\n", options);
+    ASSERT_TRUE(result.success());
+    // Eight bytes, four left the upper half of the slot unset
+    EXPECT_NE(result.assembly.find("movq %r11, -"), std::string::npos);
+}
+
+TEST(CompilerTest, StopsAfterRequestedStage)
+{
+    CompileOptions options;
+    options.stop_after = CompileStage::LEX;
+    CompileResult result = cobaltc::compile("int main(void) { return 2; }\n", options);
+    ASSERT_TRUE(result.success());
+    ASSERT_TRUE(result.tokens);
+    EXPECT_EQ(result.tokens->size(), 10u);
+    EXPECT_FALSE(result.ast);
+
+    options.stop_after = CompileStage::TACKY;
+    result = cobaltc::compile("int main(void) { return 2; }\n", options);
+    ASSERT_TRUE(result.success());
+    EXPECT_TRUE(result.tacky);
+    EXPECT_FALSE(result.assembly_ast);
+    EXPECT_TRUE(result.assembly.empty());
+}
+
+TEST(CompilerTest, ErrorsAreReportedAsDiagnostics)
+{
+    CompileResult result = cobaltc::compile("int main(void) { return 2 }\n");
+    EXPECT_FALSE(result.success());
+    ASSERT_NE(result.first_error(), nullptr);
+    EXPECT_EQ(result.first_error()->stage, CompileStage::PARSE);
+    EXPECT_TRUE(result.first_error()->message.starts_with("Parser error"));
+    EXPECT_FALSE(result.tacky);
+
+    result = cobaltc::compile("int main(void) { return x; }\n");
+    ASSERT_NE(result.first_error(), nullptr);
+    EXPECT_EQ(result.first_error()->stage, CompileStage::VALIDATE);
+
+    result = cobaltc::compile("int main(void) { return 2 @ 3; }\n");
+    ASSERT_NE(result.first_error(), nullptr);
+    EXPECT_EQ(result.first_error()->stage, CompileStage::LEX);
+    EXPECT_NE(result.first_error()->message.find("<source>"), std::string::npos);
+
+    result = cobaltc::compile("");
+    ASSERT_NE(result.first_error(), nullptr);
+    EXPECT_EQ(result.first_error()->stage, CompileStage::LEX);
+}
+
+TEST(CompilerTest, OptimizerErrorsKeepTheirCategory)
+{
+    CompileOptions options;
+    options.unroll_factor = 0;
+    CompileResult result = cobaltc::compile("int main(void) { return 2; }\n", options);
+    ASSERT_NE(result.first_error(), nullptr);
+    EXPECT_EQ(result.first_error()->stage, CompileStage::TACKY);
+    EXPECT_TRUE(result.first_error()->message.starts_with("TackyOptimizer: "));
+    EXPECT_EQ(result.first_error()->message.find("Unexpected error"), std::string::npos);
+    EXPECT_FALSE(result.assembly_ast);
+
+    // Without optimizations the optimizer does not run and the options it checks do not matter
+    options.optimization_level = 0;
+    result = cobaltc::compile("int main(void) { return 2; }\n", options);
+    EXPECT_TRUE(result.success());
+}
+
+TEST(CompilerTest, ErrorDiagnosticsCarryTheirLocation)
+{
+    CompileResult result = cobaltc::compile("int main(void) {\n    return 2 @ 3;\n}\n");
+    ASSERT_NE(result.first_error(), nullptr);
+    ASSERT_TRUE(result.first_error()->location.has_value());
+    EXPECT_EQ(result.first_error()->location->line_number, 2u);
+    EXPECT_EQ(result.first_error()->location->column_number, 14u);
+
+    result = cobaltc::compile("int main(void) {\n    return 2\n}\n");
+    ASSERT_NE(result.first_error(), nullptr);
+    EXPECT_EQ(result.first_error()->stage, CompileStage::PARSE);
+    ASSERT_TRUE(result.first_error()->location.has_value());
+    EXPECT_EQ(result.first_error()->location->line_number, 3u);
+
+    result = cobaltc::compile("int main(void) {\n    double d = 1.0;\n    return ~d;\n}\n");
+    ASSERT_NE(result.first_error(), nullptr);
+    EXPECT_EQ(result.first_error()->stage, CompileStage::VALIDATE);
+    ASSERT_TRUE(result.first_error()->location.has_value());
+    EXPECT_EQ(result.first_error()->location->line_number, 3u);
+
+    // An empty input has no place to point at
+    result = cobaltc::compile("");
+    ASSERT_NE(result.first_error(), nullptr);
+    EXPECT_FALSE(result.first_error()->location.has_value());
+}
+
+TEST(CompilerTest, WarningsAreReportedAsDiagnostics)
+{
+    CompileResult result = cobaltc::compile("int main(void) { long x = 5000000000; return 0; }\n");
+    ASSERT_TRUE(result.success());
+    ASSERT_FALSE(result.diagnostics.empty());
+    EXPECT_EQ(result.diagnostics[0].severity, Diagnostic::Severity::WARNING);
+    EXPECT_EQ(result.diagnostics[0].stage, CompileStage::LEX);
+}
+
+TEST(CompilerTest, RepeatedCompilationsAreIndependent)
+{
+    // The statistics are counted again for each compilation
+    auto statistics = [] {
+        std::vector<uint64_t> values;
+        for (const stats::Statistic* statistic : stats::StatisticRegistry::instance().statistics()) {
+            values.push_back(statistic->value());
+        }
+        return values;
+    };
+    std::string first;
+    std::vector<uint64_t> first_statistics;
+    for (int i = 0; i < 50; ++i) {
+        CompileResult result = cobaltc::compile("static int counter = 1;\nint main(void) { return counter + 1; }\n");
+        ASSERT_TRUE(result.success());
+        if (i == 0) {
+            first = result.assembly;
+            first_statistics = statistics();
+        }
+        EXPECT_EQ(result.assembly, first);
+        EXPECT_EQ(statistics(), first_statistics);
+    }
+}
+
+TEST(CompilerTest, ComparisonFeedingBranchCompilesToCompareAndJump)
+{
+    CompileResult result = cobaltc::compile("int f(int a, int b, unsigned u) { if (a < b && u > 3u) return 1; return 2; }\n");
+    ASSERT_TRUE(result.success());
+    EXPECT_EQ(result.assembly.find("set"), std::string::npos);
+    EXPECT_NE(result.assembly.find("jge"), std::string::npos);
+    EXPECT_NE(result.assembly.find("jbe"), std::string::npos);
+}
+
+TEST(CompilerTest, DoubleEqualityBranchChecksForNaN)
+{
+    CompileResult result = cobaltc::compile("int f(double a, double b) { if (a == b) return 1; return 2; }\n");
+    ASSERT_TRUE(result.success());
+    EXPECT_EQ(result.assembly.find("set"), std::string::npos);
+    EXPECT_NE(result.assembly.find("jp"), std::string::npos);
+}
+
+TEST(CompilerTest, MultiplyByConstantAvoidsImul)
+{
+    CompileResult result = cobaltc::compile("long f(long a, int b) { return a * 40 + b * 9 + b * -8; }\n");
+    ASSERT_TRUE(result.success());
+    EXPECT_EQ(result.assembly.find("imul"), std::string::npos);
+    EXPECT_NE(result.assembly.find("lea"), std::string::npos);
+    EXPECT_NE(result.assembly.find("shl"), std::string::npos);
+}
+
+TEST(CompilerTest, DivisionByConstantAvoidsDiv)
+{
+    CompileResult result = cobaltc::compile("long f(long a, unsigned b, int c) { return a / 10 + b % 7u + c / 8 + c % -3; }\n");
+    ASSERT_TRUE(result.success());
+    EXPECT_EQ(result.assembly.find("div"), std::string::npos);
+    EXPECT_NE(result.assembly.find("imulq\t"), std::string::npos);
+    EXPECT_NE(result.assembly.find("mull\t"), std::string::npos);
+    EXPECT_NE(result.assembly.find("sarl"), std::string::npos);
+}
+
+TEST(CompilerTest, ArraySubscriptsFoldIntoAddressingModes)
+{
+    CompileResult result = cobaltc::compile("int f(int *a, long i) { int b[4]; b[2] = a[i]; return b[2]; }\n");
+    ASSERT_TRUE(result.success());
+    // a[i] is one indexed load, b[2] a frame slot, no address is computed on its own
+    EXPECT_NE(result.assembly.find(", 4), %"), std::string::npos);
+    EXPECT_EQ(result.assembly.find("lea"), std::string::npos);
+}
+
+TEST(CompilerTest, CheapConditionalExpressionsUseCmov)
+{
+    CompileResult result = cobaltc::compile("int f(int a, int b) { return a > b ? a : b; }\n"
+                                            "double g(double a, double b) { return a > b ? a : b; }\n"
+                                            "int h(int a, int b) { return a ? b / a : 0; }\n");
+    ASSERT_TRUE(result.success());
+    EXPECT_NE(result.assembly.find("cmovgl"), std::string::npos);
+    EXPECT_NE(result.assembly.find("andnpd"), std::string::npos);
+    // The division might trap, its branch stays
+    EXPECT_NE(result.assembly.find("idivl"), std::string::npos);
+    EXPECT_NE(result.assembly.find("je"), std::string::npos);
+}
+
+TEST(CompilerTest, LoopsAreRotated)
+{
+    CompileResult result = cobaltc::compile("long f(int *a, int n) { long s = 0; for (int i = 0; i < n; i = i + 1) s = s + a[i]; return s; }\n"
+                                            "int g(int n) { int s = 0; while (n > 0) { s = s + n; n = n - 1; } return s; }\n");
+    ASSERT_TRUE(result.success());
+    // The test at the bottom jumps back, no unconditional jump is left, neither in the unrolled copies nor in the loop
+    // running the remaining iterations
+    EXPECT_EQ(result.assembly.find("jmp"), std::string::npos);
+    // The counter of f gave way to the pointer into a, compared unsigned against the end of the array
+    EXPECT_NE(result.assembly.find("jb \t.Lfor_start"), std::string::npos);
+    EXPECT_NE(result.assembly.find("jg \t.Lwhile_start"), std::string::npos);
+    EXPECT_NE(result.assembly.find("jb \t.Lunrolled_body"), std::string::npos);
+    EXPECT_NE(result.assembly.find("jg \t.Lunrolled_body"), std::string::npos);
+}
+
+TEST(CompilerTest, LoopsAreUnrolled)
+{
+    const char* source = "int f(int n) { int s = 0; for (int i = 0; i < n; i = i + 1) s = s + i * i; return s; }\n"
+                         "int g(void) { int s = 0; for (int i = 0; i < 4; i = i + 1) s = s + i * i; return s; }\n";
+    CompileResult result = cobaltc::compile(source);
+    ASSERT_TRUE(result.success());
+    // Four copies of the body ahead of the loop left for the remaining iterations
+    size_t multiplies = 0;
+    for (size_t position = result.assembly.find("imul"); position != std::string::npos; position = result.assembly.find("imul", position + 1)) {
+        ++multiplies;
+    }
+    EXPECT_EQ(multiplies, 5u);
+    // The loop of g is gone, its sum is known
+    EXPECT_NE(result.assembly.find("$14, %eax"), std::string::npos);
+
+    CompileOptions options;
+    options.unroll_factor = 1;
+    result = cobaltc::compile(source, options);
+    ASSERT_TRUE(result.success());
+    EXPECT_EQ(result.assembly.find("imul", result.assembly.find("imul") + 1), std::string::npos);
+}
+
+TEST(CompilerTest, CleanupIterationLimitIsCounted)
+{
+    auto limit_hits = [] {
+        for (const stats::Statistic* statistic : stats::StatisticRegistry::instance().statistics()) {
+            if (std::string(statistic->name()) == "NumIterationLimitHits") {
+                return statistic->value();
+            }
+        }
+        return uint64_t { 0 };
+    };
+
+    ASSERT_TRUE(cobaltc::compile("int main(void) { int a = 1; return a + 1; }\n").success());
+    EXPECT_EQ(limit_hits(), 0u);
+
+    // Each iteration of the cleanup passes settles only a few links of the chain, behind the branches the earlier links decide
+    std::string source = "int main(void) {\n    int a0 = 1;\n";
+    for (int i = 1; i < 60; ++i) {
+        source += std::format("    int a{} = a{} + 1;\n    if (a{} < 0) return {};\n", i, i - 1, i, i);
+    }
+    source += "    return a59;\n}\n";
+    CompileResult result = cobaltc::compile(source);
+    ASSERT_TRUE(result.success());
+    EXPECT_EQ(limit_hits(), 1u);
+}
+
+TEST(CompilerTest, UnrolledLoopsComputeEveryTripCount)
+{
+    // Zero to nine iterations cross the boundary between the unrolled copies and the loop left for the others
+    std::string source = print_first_ten("long f(int n) { long s = 0; for (int i = 0; i < n; i = i + 1) s = s + i * i; return s; }");
+    std::string expected;
+    for (long n = 0, s = 0; n < 10; s += n * n, ++n) {
+        expected += std::format("{}\n", s);
+    }
+    for (int factor : UNROLL_FACTORS) {
+        CompileOptions options;
+        options.unroll_factor = factor;
+        EXPECT_EQ(run(source, options), expected) << "unroll factor " << factor;
+    }
+}
+
+TEST(CompilerTest, UnrolledLoopsCarrySwappedValues)
+{
+    // The copies of the back edge update a and b at once, copy propagation then reads a variable in the instruction
+    // writing it (b = a + b), which the assembly must read before it writes
+    struct Case {
+        std::string function;
+        std::vector<long> expected;
+    };
+    std::vector<Case> cases {
+        { "int f(int n) { int a = 1; int b = 2; int t; int i; for (i = 0; i < n; i = i + 1) { t = a; a = b; b = t + b; } return a * 1000 + b; }",
+            { 1002, 2003, 3005, 5008, 8013, 13021, 21034, 34055, 55089, 89144 } },
+        { "int f(int n) { int a = 1; int b = 2; int t; int i = 0; do { t = a; a = b; b = t + b; i = i + 1; } while (i < n); return a + b; }",
+            { 5, 5, 8, 13, 21, 34, 55, 89, 144, 233 } },
+        { "int f(int n) { int a = 1; int b = 2; int t; int i; for (i = 0; i < n; i = i + 1) { t = a; a = b; b = t - b; } return a * 1000 + b; }",
+            { 1002, 1999, -997, 2996, -3993, 6989, -10982, 17971, -28953, 46924 } },
+        { "double g(int n) { double a = 3.0; double b = 2.0; double t; int i; for (i = 0; i < n; i = i + 1) { t = a; a = b; b = t / b; } return a * 64.0 + b; }\n"
+          "long f(int n) { return (long)(g(n) * 1000.0); }",
+            {} },
+    };
+    // The division is checked against the same loop run by the compiler
+    for (int n = 0; n < 10; ++n) {
+        double a = 3.0, b = 2.0;
+        for (int i = 0; i < n; ++i) {
+            double t = a;
+            a = b;
+            b = t / b;
+        }
+        cases.back().expected.push_back(static_cast<long>((a * 64.0 + b) * 1000.0));
+    }
+
+    for (const Case& test_case : cases) {
+        std::string expected;
+        for (long value : test_case.expected) {
+            expected += std::format("{}\n", value);
+        }
+        for (int factor : UNROLL_FACTORS) {
+            CompileOptions options;
+            options.unroll_factor = factor;
+            EXPECT_EQ(run(print_first_ten(test_case.function), options), expected) << test_case.function << " unroll factor " << factor;
+        }
+    }
+}
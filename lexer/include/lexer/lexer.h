@@ -5,15 +5,24 @@
 #include "common/data/token_table.h"
 #include "common/data/warning_manager.h"
 #include <memory>
+#include <optional>
 #include <stdexcept>
+#include <string_view>
 #include <vector>
 
 class LexerError : public std::runtime_error {
 public:
-    explicit LexerError(const std::string& message)
+    explicit LexerError(const std::string& message, std::optional<SourceLocation> source_location = std::nullopt)
         : std::runtime_error(message)
+        , m_source_location { source_location }
     {
     }
+
+    // Where in the source the error is, nothing for errors about the input as a whole
+    const std::optional<SourceLocation>& source_location() const { return m_source_location; }
+
+private:
+    std::optional<SourceLocation> m_source_location;
 };
 
 class LocationTracker {
@@ -55,6 +64,9 @@ struct LexerContext {
     std::shared_ptr<TokenTable> token_table;
     std::shared_ptr<SourceManager> source_manager;
     std::shared_ptr<WarningManager> warning_manager;
+    // When set the lexer tokenizes this buffer and never touches the file system,
+    // file_path is then only the name used in source locations
+    std::optional<std::string_view> source;
 };
 
 class Lexer {
@@ -28,6 +28,15 @@ Lexer::Lexer(const LexerContext& lexer_context)
     , m_warning_manager(lexer_context.warning_manager)
     , m_curr_location_tracker { m_file_path }
 {
+    if (lexer_context.source.has_value()) {
+        m_file_content = std::string(*lexer_context.source);
+        if (m_file_content.empty()) {
+            throw LexerError(std::format("Empty source: '{}' - Input contains no content to tokenize", m_file_path));
+        }
+        m_source_manager->add_source(m_file_path, m_file_content);
+        return;
+    }
+
     // Check if file exists
     if (!fs::exists(m_file_path)) {
         throw LexerError(std::format("File not found: '{}' - Please check the path and try again", m_file_path));
@@ -67,7 +76,8 @@ std::vector<Token> Lexer::tokenize()
     std::vector<Token> res;
     size_t i = 0;
 
-    static const std::regex line_directive_pattern("^#\\s*(\\d+)\\s+\"([^\"]*)\"\\s*(.*?)$");
+    // gcc line markers: # linenum "filename" flags...
+    static const std::regex line_directive_pattern("^#\\s*(\\d+)\\s+\"([^\"]*)\"[^\\n]*$");
 
     while (i < input.size()) {
         // Skip whitespace but track line numbers and columns
@@ -82,21 +92,24 @@ std::vector<Token> Lexer::tokenize()
             while (input[j] != '\n') {
                 j++;
                 if (j >= input.size()) {
-                    throw LexerError(("Unexpected EOF"));
+                    throw LexerError("Unexpected EOF", m_curr_location_tracker.current());
                 }
             }
-            std::string line = input.substr(i, j - i + 1);
+            std::string line = input.substr(i, j - i);
             std::smatch matches;
 
             if (!std::regex_match(line, matches, line_directive_pattern)) {
-                throw LexerError(("Line starting with # does not match a line directive pattern"));
+                throw LexerError("Line starting with # does not match a line directive pattern", m_curr_location_tracker.current());
             }
             try {
+                // The line following the marker has the given line number, so the marker consumes its own newline
                 int line_num = std::stoi(matches[1].str());
                 m_curr_location_tracker.reset(matches[2].str(), line_num);
             } catch (std::exception& e) {
-                throw LexerError(std::format("Failed parsing line directive: {}", e.what()));
+                throw LexerError(std::format("Failed parsing line directive: {}", e.what()), m_curr_location_tracker.current());
             }
+            i = j + 1;
+            continue;
         }
 
         if (input[i] == '\n') {
@@ -109,7 +122,7 @@ std::vector<Token> Lexer::tokenize()
         size_t search_res = m_token_table->search(curr_str);
         if (search_res == 0) {
             auto err = m_source_manager->get_source_line(m_curr_location_tracker.current());
-            throw LexerError(std::format("Failed matching a token \n{}", err));
+            throw LexerError(std::format("Failed matching a token \n{}", err), m_curr_location_tracker.current());
         }
 
         std::string lexeme = input.substr(i, search_res);
@@ -170,7 +183,7 @@ std::pair<TokenType, Token::LiteralType> Lexer::convert_literal_value(const std:
             }
         } catch (const std::exception& e) {
             auto err_line = m_source_manager->get_source_line(m_curr_location_tracker.current());
-            throw LexerError(std::format("Error parsing integer constant '{}' {} at:\n{}", lexeme, e.what(), err_line));
+            throw LexerError(std::format("Error parsing integer constant '{}' {} at:\n{}", lexeme, e.what(), err_line), m_curr_location_tracker.current());
         }
     } else if (type == TokenType::UNSIGNED_CONSTANT) {
         try {
@@ -195,7 +208,7 @@ std::pair<TokenType, Token::LiteralType> Lexer::convert_literal_value(const std:
             }
         } catch (const std::exception& e) {
             auto err_line = m_source_manager->get_source_line(m_curr_location_tracker.current());
-            throw LexerError(std::format("Error parsing unsigned constant '{} {}' at:\n{}", lexeme, e.what(), err_line));
+            throw LexerError(std::format("Error parsing unsigned constant '{} {}' at:\n{}", lexeme, e.what(), err_line), m_curr_location_tracker.current());
         }
     } else if (type == TokenType::LONG_CONSTANT) {
         try {
@@ -205,7 +218,7 @@ std::pair<TokenType, Token::LiteralType> Lexer::convert_literal_value(const std:
             constant_literal = num;
         } catch (const std::exception& e) {
             auto err_line = m_source_manager->get_source_line(m_curr_location_tracker.current());
-            throw LexerError(std::format("Error parsing long constant '{}' {} at:\n{}", lexeme, e.what(), err_line));
+            throw LexerError(std::format("Error parsing long constant '{}' {} at:\n{}", lexeme, e.what(), err_line), m_curr_location_tracker.current());
         }
     } else if (type == TokenType::UNSIGNED_LONG_CONSTANT) {
         try {
@@ -227,7 +240,7 @@ std::pair<TokenType, Token::LiteralType> Lexer::convert_literal_value(const std:
             constant_literal = num;
         } catch (const std::exception& e) {
             auto err_line = m_source_manager->get_source_line(m_curr_location_tracker.current());
-            throw LexerError(std::format("Error parsing unsigned long constant '{}' {} at:\n{}", lexeme, e.what(), err_line));
+            throw LexerError(std::format("Error parsing unsigned long constant '{}' {} at:\n{}", lexeme, e.what(), err_line), m_curr_location_tracker.current());
         }
     } else if (type == TokenType::DOUBLE_CONSTANT) {
         try {
@@ -235,26 +248,26 @@ std::pair<TokenType, Token::LiteralType> Lexer::convert_literal_value(const std:
             constant_literal = num;
         } catch (const std::exception& e) {
             auto err_line = m_source_manager->get_source_line(m_curr_location_tracker.current());
-            throw LexerError(std::format("Error parsing double constant '{}' {} at:\n{}", lexeme, e.what(), err_line));
+            throw LexerError(std::format("Error parsing double constant '{}' {} at:\n{}", lexeme, e.what(), err_line), m_curr_location_tracker.current());
         }
     } else if (type == TokenType::CHAR_LITERAL) {
         std::string unescaped_string = unescape(lexeme);
         // empty character constants are not valid
         if (unescaped_string.size() != 3) {
-            throw LexerError("Error while parsing char literal! A char literal can't be empty");
+            throw LexerError("Error while parsing char literal! A char literal can't be empty", m_curr_location_tracker.current());
         }
         if (unescaped_string[0] != '\'' || unescaped_string.back() != '\'') {
-            throw LexerError("Error while parsing char literal! A char literal must start and end with \'");
+            throw LexerError("Error while parsing char literal! A char literal must start and end with \'", m_curr_location_tracker.current());
         }
         int c = unescaped_string[1];
         constant_literal = c;
     } else if (type == TokenType::STRING_LITERAL) {
         std::string unescaped_string = unescape(lexeme);
         if (unescaped_string.size() < 2) {
-            throw LexerError("Error while parsing string literal!");
+            throw LexerError("Error while parsing string literal!", m_curr_location_tracker.current());
         }
         if (unescaped_string[0] != '\"' || unescaped_string.back() != '\"') {
-            throw LexerError("Error while parsing string literal!");
+            throw LexerError("Error while parsing string literal!", m_curr_location_tracker.current());
         }
         string_literal = unescaped_string.substr(1, unescaped_string.size() - 2);
     }
@@ -292,12 +305,12 @@ std::string Lexer::unescape(const std::string& str)
         if (c == '\\') {
             size_t j = i + 1;
             if (j >= str.size()) {
-                throw LexerError("Invalid escape sequence, expected character after backslash");
+                throw LexerError("Invalid escape sequence, expected character after backslash", m_curr_location_tracker.current());
             }
             char escape_sequence;
             bool res = is_valid_escape_sequence(str[j], escape_sequence);
             if (!res) {
-                throw LexerError("Invalid escape sequence");
+                throw LexerError("Invalid escape sequence", m_curr_location_tracker.current());
             }
             new_string.push_back(escape_sequence);
             ++i;
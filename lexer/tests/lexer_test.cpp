@@ -848,3 +848,18 @@ TEST_F(LexerTest, LoopKeywords)
     EXPECT_TRUE(found_break);
     EXPECT_TRUE(found_continue);
 }
+
+TEST_F(LexerTest, LineMarkersUpdateSourceLocation)
+{
+    std::string filepath = create_test_file("# 1 \"main.c\"\n# 1 \"<built-in>\" 1\n# 12 \"main.c\" 2\nint x;\n\n  return");
+
+    auto lexer = create_lexer(filepath);
+    auto tokens = lexer.tokenize();
+
+    ASSERT_EQ(tokens.size(), 4);
+    EXPECT_EQ(tokens[0].source_location().file_name, "main.c");
+    EXPECT_EQ(tokens[0].source_location().line_number, 12);
+    EXPECT_EQ(tokens[0].source_location().column_number, 1);
+    EXPECT_EQ(tokens[3].source_location().line_number, 14);
+    EXPECT_EQ(tokens[3].source_location().column_number, 3);
+}
@@ -2,6 +2,7 @@
 #include "common/data/source_location.h"
 #include <optional>
 #include <stdexcept>
+#include <string>
 #include <vector>
 
 #define ENTER_CONTEXT(name) ContextGuard context_guard(m_context_stack, name, std::nullopt)
@@ -11,10 +12,16 @@ namespace parser {
 class ContextStackProvider {
 public:
     virtual std::string context_stack_to_string() const;
+    // Location of the innermost context entered with one
+    std::optional<SourceLocation> innermost_source_location() const;
     virtual ~ContextStackProvider() = default;
 
 protected:
-    using ContextStack = std::vector<std::string>;
+    struct Context {
+        std::string name;
+        std::optional<SourceLocation> source_location;
+    };
+    using ContextStack = std::vector<Context>;
 
     ContextStack m_context_stack;
 
@@ -29,12 +36,20 @@ protected:
     };
 };
 
+// Error carrying the context stack in its message. Its location is the one given, or else the innermost context
+// location, nothing when no context has one
 class ContextStackError : public std::runtime_error {
 public:
-    explicit ContextStackError(ContextStackProvider* context_provider, const std::string& message)
+    explicit ContextStackError(ContextStackProvider* context_provider, const std::string& message, std::optional<SourceLocation> source_location = std::nullopt)
         : std::runtime_error(message + context_provider->context_stack_to_string())
+        , m_source_location { source_location ? source_location : context_provider->innermost_source_location() }
     {
     }
+
+    const std::optional<SourceLocation>& source_location() const { return m_source_location; }
+
+private:
+    std::optional<SourceLocation> m_source_location;
 };
 
 } // namespace parser
@@ -109,8 +109,8 @@ class Parser : public ContextStackProvider {
 public:
     class ParserError : public ContextStackError {
     public:
-        explicit ParserError(ContextStackProvider* context_provider, const std::string& message)
-            : ContextStackError(context_provider, message)
+        explicit ParserError(ContextStackProvider* context_provider, const std::string& message, std::optional<SourceLocation> source_location = std::nullopt)
+            : ContextStackError(context_provider, message, source_location)
         {
         }
     };
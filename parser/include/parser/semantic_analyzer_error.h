@@ -5,8 +5,8 @@ namespace parser {
 
 class SemanticAnalyzerError : public ContextStackError {
 public:
-    explicit SemanticAnalyzerError(ContextStackProvider* context_provider, const std::string& message)
-        : ContextStackError(context_provider, message)
+    explicit SemanticAnalyzerError(ContextStackProvider* context_provider, const std::string& message, std::optional<SourceLocation> source_location = std::nullopt)
+        : ContextStackError(context_provider, message, source_location)
     {
     }
 };
@@ -6,11 +6,24 @@ namespace parser {
 std::string ContextStackProvider::context_stack_to_string() const
 {
     std::string context_string = std::format("\n==================\nContext Stack:\n");
-    for (size_t i = 0; i < m_context_stack.size(); ++i) {
-        const auto& str = m_context_stack.at(i);
-        context_string += std::format("{}\n", str);
+    for (const Context& context : m_context_stack) {
+        if (context.source_location.has_value()) {
+            context_string += std::format("{:<35} line: {:<5} column: {:<3}\n", context.name, context.source_location->line_number, context.source_location->column_number);
+        } else {
+            context_string += std::format("{}\n", context.name);
+        }
     }
     return context_string;
 }
 
+std::optional<SourceLocation> ContextStackProvider::innermost_source_location() const
+{
+    for (auto it = m_context_stack.rbegin(); it != m_context_stack.rend(); ++it) {
+        if (it->source_location.has_value()) {
+            return it->source_location;
+        }
+    }
+    return std::nullopt;
+}
+
 }
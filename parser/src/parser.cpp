@@ -9,6 +9,7 @@
 #include <format>
 #include <memory>
 #include <string>
+#include <unordered_map>
 #include <unordered_set>
 #include <vector>
 
@@ -184,7 +185,7 @@ std::unique_ptr<Declarator> Parser::parse_simple_declarator()
         expect(TokenType::CLOSE_PAREN);
         return decl;
     } else {
-        throw ParserError(this, std::format("Error in parse_simple_declarator at\n{}", m_source_manager->get_source_line(loc)));
+        throw ParserError(this, std::format("Error in parse_simple_declarator at\n{}", m_source_manager->get_source_line(loc)), m_source_manager->get_location(loc));
     }
 }
 
@@ -239,7 +240,7 @@ std::unique_ptr<AbstractDeclarator> Parser::parse_direct_abstract_declarator()
         }
 
     } else {
-        throw ParserError(this, std::format("Expected '(' or '[' at\n{}", m_source_manager->get_source_line(loc)));
+        throw ParserError(this, std::format("Expected '(' or '[' at\n{}", m_source_manager->get_source_line(loc)), m_source_manager->get_location(loc));
     }
 
     return decl;
@@ -256,7 +257,8 @@ std::unique_ptr<ForInit> Parser::parse_for_init()
 
         if (!dynamic_cast<VariableDeclaration*>(decl.get())) {
             throw ParserError(this,
-                std::format("In parse_for_init: got FunctionDeclaration, expected VariableDeclaration at:\n{}", m_source_manager->get_source_line(peek().source_location())));
+                std::format("In parse_for_init: got FunctionDeclaration, expected VariableDeclaration at:\n{}", m_source_manager->get_source_line(peek().source_location())),
+                peek().source_location());
         }
 
         // Release from original unique_ptr and wrap in new one
@@ -395,7 +397,7 @@ std::unique_ptr<Initializer> Parser::parse_initializer()
             }
         }
         if (inits.size() == 0) {
-            throw ParserError(this, std::format("Initializer list cant be empty at:\n{}", m_source_manager->get_source_line(start_loc)));
+            throw ParserError(this, std::format("Initializer list cant be empty at:\n{}", m_source_manager->get_source_line(start_loc)), m_source_manager->get_location(start_loc));
         }
         expect(TokenType::CLOSE_BRACE);
         return std::make_unique<CompoundInitializer>(start_loc, std::move(inits));
@@ -524,7 +526,7 @@ std::unique_ptr<Expression> Parser::parse_primary_expression()
             return std::make_unique<FunctionCallExpression>(loc, identifier_token.lexeme(), std::move(args));
         }
     } else {
-        throw ParserError(this, std::format("Invalid primary expression at\n{}", m_source_manager->get_source_line(next_token.source_location())));
+        throw ParserError(this, std::format("Invalid primary expression at\n{}", m_source_manager->get_source_line(next_token.source_location())), next_token.source_location());
     }
 }
 
@@ -577,20 +579,20 @@ std::unique_ptr<Type> Parser::parse_type_specifier_list(const std::vector<TokenT
         auto res = type_specifiers_set.insert(tt);
 
         if (!res.second) {
-            throw ParserError(this, std::format("Multiple Type Specifier {} at\n{}", Token::type_to_string(tt), m_source_manager->get_source_line(last_token().source_location())));
+            throw ParserError(this, std::format("Multiple Type Specifier {} at\n{}", Token::type_to_string(tt), m_source_manager->get_source_line(last_token().source_location())), last_token().source_location());
         }
 
         if (!is_type_specificer(tt)) {
-            throw ParserError(this, std::format("Type specifier contains invalid type:\n{}", m_source_manager->get_source_line(last_token().source_location())));
+            throw ParserError(this, std::format("Type specifier contains invalid type:\n{}", m_source_manager->get_source_line(last_token().source_location())), last_token().source_location());
         }
     }
 
     if (type_specifiers_set.empty()) {
-        throw ParserError(this, std::format("Missing type at:\n{}", m_source_manager->get_source_line(last_token().source_location())));
+        throw ParserError(this, std::format("Missing type at:\n{}", m_source_manager->get_source_line(last_token().source_location())), last_token().source_location());
     }
 
     if (type_specifiers_set.contains(TokenType::SIGNED_KW) && type_specifiers_set.contains(TokenType::UNSIGNED_KW)) {
-        throw ParserError(this, std::format("Type specifier with both signed and unsigned at:\n{}", m_source_manager->get_source_line(last_token().source_location())));
+        throw ParserError(this, std::format("Type specifier with both signed and unsigned at:\n{}", m_source_manager->get_source_line(last_token().source_location())), last_token().source_location());
     }
 
     // CHAR
@@ -604,14 +606,14 @@ std::unique_ptr<Type> Parser::parse_type_specifier_list(const std::vector<TokenT
         if (type_specifiers_set.contains(TokenType::UNSIGNED_KW)) {
             return std::make_unique<UnsignedCharType>();
         }
-        throw ParserError(this, std::format("Wrong Char Type specifier:\n{}", m_source_manager->get_source_line(last_token().source_location())));
+        throw ParserError(this, std::format("Wrong Char Type specifier:\n{}", m_source_manager->get_source_line(last_token().source_location())), last_token().source_location());
     }
 
     // DOUBLE
     if (type_specifiers_set.size() == 1 && type_specifiers_set.contains(TokenType::DOUBLE_KW)) {
         return std::make_unique<DoubleType>();
     } else if (type_specifiers_set.contains(TokenType::DOUBLE_KW)) {
-        throw ParserError(this, std::format("Can't combine double with other type specifiers at:\n{}", m_source_manager->get_source_line(last_token().source_location())));
+        throw ParserError(this, std::format("Can't combine double with other type specifiers at:\n{}", m_source_manager->get_source_line(last_token().source_location())), last_token().source_location());
     }
 
     // INTS
@@ -712,7 +714,7 @@ const Token& Parser::expect(TokenType expected)
 
     const Token& actual = m_tokens[i++];
     if (actual.type() != expected) {
-        throw ParserError(this, std::format("Syntax error: Expected '{}' but found '{}' at:\n{}", Token::type_to_string(expected), actual.lexeme(), m_source_manager->get_source_line(actual.source_location())));
+        throw ParserError(this, std::format("Syntax error: Expected '{}' but found '{}' at:\n{}", Token::type_to_string(expected), actual.lexeme(), m_source_manager->get_source_line(actual.source_location())), actual.source_location());
     }
     return actual;
 }
@@ -915,7 +917,7 @@ std::pair<std::unique_ptr<Type>, StorageClass> Parser::parse_type_and_storage_cl
     std::unique_ptr<Type> type = parse_type_specifier_list(type_specifiers);
 
     if (storage_classes.size() > 1) {
-        throw ParserError(this, std::format("Specified too many storage_classes {} at:\n{}", storage_classes.size(), m_source_manager->get_source_line(last_token().source_location())));
+        throw ParserError(this, std::format("Specified too many storage_classes {} at:\n{}", storage_classes.size(), m_source_manager->get_source_line(last_token().source_location())), last_token().source_location());
     }
 
     StorageClass storage_class = StorageClass::NONE;
@@ -931,15 +933,7 @@ std::pair<std::unique_ptr<Type>, StorageClass> Parser::parse_type_and_storage_cl
 Parser::ContextGuard::ContextGuard(ContextStack& context_stack, const std::string& context, std::optional<SourceLocation> source_location)
     : m_context_stack(context_stack)
 {
-    if (source_location.has_value()) {
-        m_context_stack.push_back(std::format("{:<35} line: {:<5} column: {:<3}",
-            context,
-            source_location.value().line_number,
-            source_location.value().column_number));
-    } else {
-        m_context_stack.push_back(std::format("{}",
-            context));
-    }
+    m_context_stack.push_back({ context, source_location });
 }
 
 Parser::ContextGuard::~ContextGuard()
@@ -1005,7 +999,7 @@ size_t Parser::parse_array_size()
     if (next_token.type() == TokenType::CONSTANT) {
         auto constant_size = next_token.literal<int>();
         if (constant_size <= 0) {
-            throw ParserError(this, std::format("Array dimension should be > 0 at\n{}", m_source_manager->get_source_line(loc)));
+            throw ParserError(this, std::format("Array dimension should be > 0 at\n{}", m_source_manager->get_source_line(loc)), m_source_manager->get_location(loc));
         }
         size = constant_size;
     } else if (next_token.type() == TokenType::UNSIGNED_CONSTANT) {
@@ -1013,7 +1007,7 @@ size_t Parser::parse_array_size()
     } else if (next_token.type() == TokenType::LONG_CONSTANT) {
         auto constant_size = next_token.literal<long>();
         if (constant_size <= 0) {
-            throw ParserError(this, std::format("Array dimension should be > 0 at\n{}", m_source_manager->get_source_line(loc)));
+            throw ParserError(this, std::format("Array dimension should be > 0 at\n{}", m_source_manager->get_source_line(loc)), m_source_manager->get_location(loc));
         }
         size = constant_size;
     } else if (next_token.type() == TokenType::UNSIGNED_LONG_CONSTANT) {
@@ -1022,7 +1016,7 @@ size_t Parser::parse_array_size()
         // char constants are (promoted) stored as int
         size = next_token.literal<int>();
     } else {
-        throw ParserError(this, std::format("Expected integer constant at\n{}", m_source_manager->get_source_line(loc)));
+        throw ParserError(this, std::format("Expected integer constant at\n{}", m_source_manager->get_source_line(loc)), m_source_manager->get_location(loc));
     }
     take_token();
     return size;
@@ -95,7 +95,7 @@ void TypeCheckPass::typecheck_constant_expression(ConstantExpression& node)
     } else if (std::holds_alternative<double>(node.value)) {
         node.type = std::make_unique<DoubleType>();
     } else {
-        throw SemanticAnalyzerError(this, std::format("Unsupported ConstantExpression at:\n{}", m_source_manager->get_source_line(node.source_location)));
+        throw SemanticAnalyzerError(this, std::format("Unsupported ConstantExpression at:\n{}", m_source_manager->get_source_line(node.source_location)), m_source_manager->get_location(node.source_location));
     }
 }
 
@@ -106,7 +106,7 @@ void TypeCheckPass::typecheck_variable_expression(VariableExpression& node)
     std::string& variable_name = node.identifier.name;
     auto& type = m_symbol_table->symbol_at(variable_name).type;
     if (dynamic_cast<FunctionType*>(type.get())) {
-        throw SemanticAnalyzerError(this, std::format("Function name {} used as variable at:\n{}", variable_name, m_source_manager->get_source_line(node.source_location)));
+        throw SemanticAnalyzerError(this, std::format("Function name {} used as variable at:\n{}", variable_name, m_source_manager->get_source_line(node.source_location)), m_source_manager->get_location(node.source_location));
     }
 
     node.type = type->clone();
@@ -126,15 +126,15 @@ void TypeCheckPass::typecheck_unary_expression(UnaryExpression& unary_expression
     }
 
     if (unary_expression.unary_operator == UnaryOperator::COMPLEMENT && is_type<DoubleType>(*unary_expression.expression->type)) {
-        throw SemanticAnalyzerError(this, std::format("Bitwise complement operator does not accept double operands at:\n{}", m_source_manager->get_source_line(unary_expression.source_location)));
+        throw SemanticAnalyzerError(this, std::format("Bitwise complement operator does not accept double operands at:\n{}", m_source_manager->get_source_line(unary_expression.source_location)), m_source_manager->get_location(unary_expression.source_location));
     }
 
     if (unary_expression.unary_operator == UnaryOperator::NEGATE && is_type<PointerType>(*unary_expression.expression->type)) {
-        throw SemanticAnalyzerError(this, std::format("Cannot apply negate operator to pointers at:\n{}", m_source_manager->get_source_line(unary_expression.source_location)));
+        throw SemanticAnalyzerError(this, std::format("Cannot apply negate operator to pointers at:\n{}", m_source_manager->get_source_line(unary_expression.source_location)), m_source_manager->get_location(unary_expression.source_location));
     }
 
     if (unary_expression.unary_operator == UnaryOperator::COMPLEMENT && is_type<PointerType>(*unary_expression.expression->type)) {
-        throw SemanticAnalyzerError(this, std::format("Cannot apply complement operator to pointers at:\n{}", m_source_manager->get_source_line(unary_expression.source_location)));
+        throw SemanticAnalyzerError(this, std::format("Cannot apply complement operator to pointers at:\n{}", m_source_manager->get_source_line(unary_expression.source_location)), m_source_manager->get_location(unary_expression.source_location));
     }
 
     if (unary_expression.unary_operator == UnaryOperator::NEGATE || unary_expression.unary_operator == UnaryOperator::COMPLEMENT) {
@@ -173,7 +173,7 @@ void TypeCheckPass::typecheck_binary_expression(BinaryExpression& node)
                 convert_expression_to<LongType>(node.left_expression);
                 node.type = right_type->clone();
             } else {
-                throw SemanticAnalyzerError(this, std::format("Invalid operands for pointer addition at:\n{}", m_source_manager->get_source_line(node.source_location)));
+                throw SemanticAnalyzerError(this, std::format("Invalid operands for pointer addition at:\n{}", m_source_manager->get_source_line(node.source_location)), m_source_manager->get_location(node.source_location));
             }
             return;
         }
@@ -186,7 +186,7 @@ void TypeCheckPass::typecheck_binary_expression(BinaryExpression& node)
                 // when subtracting two pointers both openrds must have the same type
                 node.type = std::make_unique<LongType>();
             } else {
-                throw SemanticAnalyzerError(this, std::format("Invalid operands for pointer subtraction at:\n{}", m_source_manager->get_source_line(node.source_location)));
+                throw SemanticAnalyzerError(this, std::format("Invalid operands for pointer subtraction at:\n{}", m_source_manager->get_source_line(node.source_location)), m_source_manager->get_location(node.source_location));
             }
             return;
         }
@@ -196,17 +196,17 @@ void TypeCheckPass::typecheck_binary_expression(BinaryExpression& node)
         case BinaryOperator::LESS_OR_EQUAL: {
             // Pointer relational operators must have same type and return an int,
             if (!left_type->equals(*right_type)) {
-                throw SemanticAnalyzerError(this, std::format("Invalid operands for pointer relational operator at:\n{}", m_source_manager->get_source_line(node.source_location)));
+                throw SemanticAnalyzerError(this, std::format("Invalid operands for pointer relational operator at:\n{}", m_source_manager->get_source_line(node.source_location)), m_source_manager->get_location(node.source_location));
             }
             node.type = std::make_unique<IntType>();
             return;
         }
         case BinaryOperator::MULTIPLY:
-            throw SemanticAnalyzerError(this, std::format("Multiply operator does not accept pointer operands at:\n{}", m_source_manager->get_source_line(node.source_location)));
+            throw SemanticAnalyzerError(this, std::format("Multiply operator does not accept pointer operands at:\n{}", m_source_manager->get_source_line(node.source_location)), m_source_manager->get_location(node.source_location));
         case BinaryOperator::DIVIDE:
-            throw SemanticAnalyzerError(this, std::format("Divide operator does not accept pointer operands at:\n{}", m_source_manager->get_source_line(node.source_location)));
+            throw SemanticAnalyzerError(this, std::format("Divide operator does not accept pointer operands at:\n{}", m_source_manager->get_source_line(node.source_location)), m_source_manager->get_location(node.source_location));
         case BinaryOperator::REMAINDER:
-            throw SemanticAnalyzerError(this, std::format("Remainder operator does not accept pointer operands at:\n{}", m_source_manager->get_source_line(node.source_location)));
+            throw SemanticAnalyzerError(this, std::format("Remainder operator does not accept pointer operands at:\n{}", m_source_manager->get_source_line(node.source_location)), m_source_manager->get_location(node.source_location));
         default:
             break;
         }
@@ -231,7 +231,7 @@ void TypeCheckPass::typecheck_binary_expression(BinaryExpression& node)
     }
 
     if (node.binary_operator == BinaryOperator::REMAINDER && is_type<DoubleType>(*node.type)) {
-        throw SemanticAnalyzerError(this, std::format("Remainder operator does not accept double operands at:\n{}", m_source_manager->get_source_line(node.source_location)));
+        throw SemanticAnalyzerError(this, std::format("Remainder operator does not accept double operands at:\n{}", m_source_manager->get_source_line(node.source_location)), m_source_manager->get_location(node.source_location));
     }
 }
 
@@ -242,14 +242,14 @@ void TypeCheckPass::typecheck_assignment_expression(AssignmentExpression& node)
     // Process the left operand before checking if it's an value, to detect if we are tryin to assign to an array, as typecheck_expression_and_convert will wrap it in an AddressOfExpression
     typecheck_expression_and_convert(node.left_expression);
     if (!is_lvalue(*node.left_expression)) {
-        throw SemanticAnalyzerError(this, std::format("In AssignmentExpression left expression is not an lvalue at:\n{}", m_source_manager->get_source_line(node.left_expression->source_location)));
+        throw SemanticAnalyzerError(this, std::format("In AssignmentExpression left expression is not an lvalue at:\n{}", m_source_manager->get_source_line(node.left_expression->source_location)), m_source_manager->get_location(node.left_expression->source_location));
     }
 
     typecheck_expression_and_convert(node.right_expression);
 
     auto left_type = node.left_expression->type->clone();
     if (!convert_expression_by_assignment(node.right_expression, *left_type)) {
-        throw SemanticAnalyzerError(this, std::format("In AssignmentExpression cannot convert type for assignment at:\n{}", m_source_manager->get_source_line(node.source_location)));
+        throw SemanticAnalyzerError(this, std::format("In AssignmentExpression cannot convert type for assignment at:\n{}", m_source_manager->get_source_line(node.source_location)), m_source_manager->get_location(node.source_location));
     }
     node.type = std::move(left_type);
 }
@@ -281,12 +281,12 @@ void TypeCheckPass::typecheck_function_call_expression(FunctionCallExpression& n
     std::string& function_name = node.name.name;
     auto& type = m_symbol_table->symbol_at(function_name).type;
     if (!dynamic_cast<FunctionType*>(type.get())) {
-        throw SemanticAnalyzerError(this, std::format("Variable {} used as function name at:\n{}", function_name, m_source_manager->get_source_line(node.source_location)));
+        throw SemanticAnalyzerError(this, std::format("Variable {} used as function name at:\n{}", function_name, m_source_manager->get_source_line(node.source_location)), m_source_manager->get_location(node.source_location));
     }
 
     FunctionType* fun_type = dynamic_cast<FunctionType*>(type.get());
     if (fun_type->parameters_type.size() != node.arguments.size()) {
-        throw SemanticAnalyzerError(this, std::format("Function {} called with the wrong number of arguments {} expected {} at:\n{}", function_name, node.arguments.size(), fun_type->parameters_type.size(), m_source_manager->get_source_line(node.source_location)));
+        throw SemanticAnalyzerError(this, std::format("Function {} called with the wrong number of arguments {} expected {} at:\n{}", function_name, node.arguments.size(), fun_type->parameters_type.size(), m_source_manager->get_source_line(node.source_location)), m_source_manager->get_location(node.source_location));
     }
 
     // Visit arguments
@@ -295,7 +295,7 @@ void TypeCheckPass::typecheck_function_call_expression(FunctionCallExpression& n
         auto& arg_type = fun_type->parameters_type[i];
         typecheck_expression_and_convert(arg);
         if (!convert_expression_by_assignment(arg, *arg_type)) {
-            throw SemanticAnalyzerError(this, std::format("In function call cannot convert type for assignment at:\n{}", m_source_manager->get_source_line(node.source_location)));
+            throw SemanticAnalyzerError(this, std::format("In function call cannot convert type for assignment at:\n{}", m_source_manager->get_source_line(node.source_location)), m_source_manager->get_location(node.source_location));
         }
     }
     node.type = fun_type->return_type->clone();
@@ -310,15 +310,15 @@ void TypeCheckPass::typecheck_cast_expression(CastExpression& node)
     node.type = node.target_type->clone();
 
     if (is_type<PointerType>(*node.target_type) && is_type<DoubleType>(*node.expression->type)) {
-        throw SemanticAnalyzerError(this, std::format("Cannot convert double to pointer at:\n{}", m_source_manager->get_source_line(node.source_location)));
+        throw SemanticAnalyzerError(this, std::format("Cannot convert double to pointer at:\n{}", m_source_manager->get_source_line(node.source_location)), m_source_manager->get_location(node.source_location));
     }
 
     if (is_type<DoubleType>(*node.target_type) && is_type<PointerType>(*node.expression->type)) {
-        throw SemanticAnalyzerError(this, std::format("Cannot convert pointer to double at:\n{}", m_source_manager->get_source_line(node.source_location)));
+        throw SemanticAnalyzerError(this, std::format("Cannot convert pointer to double at:\n{}", m_source_manager->get_source_line(node.source_location)), m_source_manager->get_location(node.source_location));
     }
 
     if (is_type<ArrayType>(*node.target_type)) {
-        throw SemanticAnalyzerError(this, std::format("Cannot cast to array at:\n{}", m_source_manager->get_source_line(node.source_location)));
+        throw SemanticAnalyzerError(this, std::format("Cannot cast to array at:\n{}", m_source_manager->get_source_line(node.source_location)), m_source_manager->get_location(node.source_location));
     }
 }
 
@@ -331,7 +331,7 @@ void TypeCheckPass::typecheck_dereference_expression(DereferenceExpression& node
     if (auto ptr_type = dynamic_cast<PointerType*>(node.expression->type.get())) {
         node.type = ptr_type->referenced_type->clone();
     } else {
-        throw SemanticAnalyzerError(this, std::format("Cannot deference non-pointer type at:\n{}", m_source_manager->get_source_line(node.source_location)));
+        throw SemanticAnalyzerError(this, std::format("Cannot deference non-pointer type at:\n{}", m_source_manager->get_source_line(node.source_location)), m_source_manager->get_location(node.source_location));
     }
 }
 
@@ -342,7 +342,7 @@ void TypeCheckPass::typecheck_address_of_expression(AddressOfExpression& node)
         typecheck_expression(*node.expression);
         node.type = std::make_unique<PointerType>(node.expression->type->clone());
     } else {
-        throw SemanticAnalyzerError(this, std::format("Can't take the address of a non-lvalue at:\n{}", m_source_manager->get_source_line(node.source_location)));
+        throw SemanticAnalyzerError(this, std::format("Can't take the address of a non-lvalue at:\n{}", m_source_manager->get_source_line(node.source_location)), m_source_manager->get_location(node.source_location));
     }
 }
 
@@ -361,7 +361,7 @@ void TypeCheckPass::typecheck_subscript_expression(SubscriptExpression& node)
     } else if (t1->is_integer() && is_type<PointerType>(*t2)) {
         convert_expression_to<LongType>(node.expression1);
     } else {
-        throw SemanticAnalyzerError(this, std::format("Invalid operands for SubscriptExpression at:\n{}", m_source_manager->get_source_line(node.source_location)));
+        throw SemanticAnalyzerError(this, std::format("Invalid operands for SubscriptExpression at:\n{}", m_source_manager->get_source_line(node.source_location)), m_source_manager->get_location(node.source_location));
     }
 
     auto ptr_type = dynamic_cast<PointerType*>(ptr_type_ref.get());
@@ -391,10 +391,10 @@ void TypeCheckPass::typecheck_initializer(const Type& target_type, Initializer&
             // We call typecheck_expression to at least assign a type to the inner expression
             typecheck_expression(*single_init->expression);
             if (!arr_type->element_type->is_char()) {
-                throw SemanticAnalyzerError(this, std::format("Cannot initialize a non character with a string literal:\n{}", m_source_manager->get_source_line(init.source_location)));
+                throw SemanticAnalyzerError(this, std::format("Cannot initialize a non character with a string literal:\n{}", m_source_manager->get_source_line(init.source_location)), m_source_manager->get_location(init.source_location));
             }
             if (string_expr->value.size() > arr_type->size()) {
-                throw SemanticAnalyzerError(this, std::format("Too many characters in string literal:\n{}", m_source_manager->get_source_line(single_init->expression->source_location)));
+                throw SemanticAnalyzerError(this, std::format("Too many characters in string literal:\n{}", m_source_manager->get_source_line(single_init->expression->source_location)), m_source_manager->get_location(single_init->expression->source_location));
             }
             single_init->type = target_type.clone();
             return;
@@ -402,7 +402,7 @@ void TypeCheckPass::typecheck_initializer(const Type& target_type, Initializer&
 
         typecheck_expression_and_convert(single_init->expression);
         if (!convert_expression_by_assignment(single_init->expression, target_type)) {
-            throw SemanticAnalyzerError(this, std::format("Cannot convert type for assignment at:\n{}", m_source_manager->get_source_line(init.source_location)));
+            throw SemanticAnalyzerError(this, std::format("Cannot convert type for assignment at:\n{}", m_source_manager->get_source_line(init.source_location)), m_source_manager->get_location(init.source_location));
         }
         single_init->type = target_type.clone();
         return;
@@ -411,7 +411,7 @@ void TypeCheckPass::typecheck_initializer(const Type& target_type, Initializer&
     if (auto compound_init = dynamic_cast<CompoundInitializer*>(&init)) {
         if (auto arr_type = dynamic_cast<const ArrayType*>(&target_type)) {
             if (compound_init->initializer_list.size() > arr_type->array_size) {
-                throw SemanticAnalyzerError(this, std::format("Too many initializers at:\n{}", m_source_manager->get_source_line(init.source_location)));
+                throw SemanticAnalyzerError(this, std::format("Too many initializers at:\n{}", m_source_manager->get_source_line(init.source_location)), m_source_manager->get_location(init.source_location));
             }
             for (auto& inner_init : compound_init->initializer_list) {
                 typecheck_initializer(*arr_type->element_type, *inner_init);
@@ -424,7 +424,7 @@ void TypeCheckPass::typecheck_initializer(const Type& target_type, Initializer&
             return;
         }
 
-        throw SemanticAnalyzerError(this, std::format("Can't initialize scalar object with a compound initializer at:\n{}", m_source_manager->get_source_line(init.source_location)));
+        throw SemanticAnalyzerError(this, std::format("Can't initialize scalar object with a compound initializer at:\n{}", m_source_manager->get_source_line(init.source_location)), m_source_manager->get_location(init.source_location));
     }
 
     throw InternalCompilerError("Unsupported type in typecheck_initializer");
@@ -463,10 +463,10 @@ StaticInitialValue TypeCheckPass::convert_static_initializer(const Type& target_
                 // We call typecheck_expression to at least assign a type to the inner expression
                 typecheck_expression(*single_init->expression);
                 if (!arr_type->element_type->is_char()) {
-                    throw SemanticAnalyzerError(this, std::format("Cannot initialize a non character with a string literal:\n{}", m_source_manager->get_source_line(init.source_location)));
+                    throw SemanticAnalyzerError(this, std::format("Cannot initialize a non character with a string literal:\n{}", m_source_manager->get_source_line(init.source_location)), m_source_manager->get_location(init.source_location));
                 }
                 if (string_expr->value.size() > arr_type->size()) {
-                    throw SemanticAnalyzerError(this, std::format("Too many characters in string literal:\n{}", m_source_manager->get_source_line(single_init->expression->source_location)));
+                    throw SemanticAnalyzerError(this, std::format("Too many characters in string literal:\n{}", m_source_manager->get_source_line(single_init->expression->source_location)), m_source_manager->get_location(single_init->expression->source_location));
                 }
                 int diff = arr_type->size() - string_expr->value.size();
                 // diff can't be < 0
@@ -484,7 +484,7 @@ StaticInitialValue TypeCheckPass::convert_static_initializer(const Type& target_
                 typecheck_expression(*single_init->expression);
                 if (!is_type<CharType>(*ptr_type->referenced_type)) {
                     // this is consistent with pointer conversion
-                    throw SemanticAnalyzerError(this, std::format("A string literal can only initialize a char pointer:\n{}", m_source_manager->get_source_line(init.source_location)));
+                    throw SemanticAnalyzerError(this, std::format("A string literal can only initialize a char pointer:\n{}", m_source_manager->get_source_line(init.source_location)), m_source_manager->get_location(init.source_location));
                 }
                 auto label = m_symbol_table->add_constant_string(string_expr->value);
                 single_init->type = target_type.clone();
@@ -498,7 +498,7 @@ StaticInitialValue TypeCheckPass::convert_static_initializer(const Type& target_
 
         auto const_expr = dynamic_cast<ConstantExpression*>(single_init->expression.get());
         if (!const_expr) {
-            throw SemanticAnalyzerError(this, std::format("Static variable declaration has non-constant initializer! at:\n{}", m_source_manager->get_source_line(init.source_location)));
+            throw SemanticAnalyzerError(this, std::format("Static variable declaration has non-constant initializer! at:\n{}", m_source_manager->get_source_line(init.source_location)), m_source_manager->get_location(init.source_location));
         }
         single_init->type = target_type.clone();
         return convert_constant_type_by_assignment(const_expr->value, target_type, init.source_location, warning_callback);
@@ -507,7 +507,7 @@ StaticInitialValue TypeCheckPass::convert_static_initializer(const Type& target_
     if (auto compound_init = dynamic_cast<CompoundInitializer*>(&init)) {
         if (auto arr_type = dynamic_cast<const ArrayType*>(&target_type)) {
             if (compound_init->initializer_list.size() > arr_type->array_size) {
-                throw SemanticAnalyzerError(this, std::format("Too many initializers at:\n{}", m_source_manager->get_source_line(init.source_location)));
+                throw SemanticAnalyzerError(this, std::format("Too many initializers at:\n{}", m_source_manager->get_source_line(init.source_location)), m_source_manager->get_location(init.source_location));
             }
 
             std::vector<StaticInitialValueType> initial_values;
@@ -537,7 +537,7 @@ StaticInitialValue TypeCheckPass::convert_static_initializer(const Type& target_
             return res;
         }
 
-        throw SemanticAnalyzerError(this, std::format("Can't initialize scalar object with a compound initializer at:\n{}", m_source_manager->get_source_line(init.source_location)));
+        throw SemanticAnalyzerError(this, std::format("Can't initialize scalar object with a compound initializer at:\n{}", m_source_manager->get_source_line(init.source_location)), m_source_manager->get_location(init.source_location));
     }
 
     throw InternalCompilerError("Unsupported type in typecheck_initializer");
@@ -580,7 +580,7 @@ void TypeCheckPass::visit(ReturnStatement& node)
     auto& type = m_symbol_table->symbol_at(function_name).type;
     if (FunctionType* fun_type = dynamic_cast<FunctionType*>(type.get())) {
         if (!convert_expression_by_assignment(node.expression, *fun_type->return_type)) {
-            throw SemanticAnalyzerError(this, std::format("In return statement cannot convert type for assignment at:\n{}", m_source_manager->get_source_line(node.source_location)));
+            throw SemanticAnalyzerError(this, std::format("In return statement cannot convert type for assignment at:\n{}", m_source_manager->get_source_line(node.source_location)), m_source_manager->get_location(node.source_location));
         }
     } else {
         throw InternalCompilerError("m_current_function_declaration is not a function pointer");
@@ -593,7 +593,7 @@ void TypeCheckPass::visit(FunctionDeclaration& function_declaration)
     const auto& function_type = dynamic_cast<FunctionType*>(function_declaration.type.get());
     const std::string& function_name = function_declaration.name.name;
     if (is_type<ArrayType>(*function_type->return_type)) {
-        throw SemanticAnalyzerError(this, std::format("Function {} cant return an array at:\n{}", function_name, m_source_manager->get_source_line(function_declaration.source_location)));
+        throw SemanticAnalyzerError(this, std::format("Function {} cant return an array at:\n{}", function_name, m_source_manager->get_source_line(function_declaration.source_location)), m_source_manager->get_location(function_declaration.source_location));
     }
 
     for (auto& param : function_type->parameters_type) {
@@ -613,15 +613,15 @@ void TypeCheckPass::visit(FunctionDeclaration& function_declaration)
         FunctionType* prev_function_type = dynamic_cast<FunctionType*>(prev_decl.type.get());
 
         if (!prev_function_type || !function_type->equals(*prev_function_type)) {
-            throw SemanticAnalyzerError(this, std::format("Incompatible function declaration of {} at:\n{}", function_name, m_source_manager->get_source_line(function_declaration.source_location)));
+            throw SemanticAnalyzerError(this, std::format("Incompatible function declaration of {} at:\n{}", function_name, m_source_manager->get_source_line(function_declaration.source_location)), m_source_manager->get_location(function_declaration.source_location));
         }
         already_defined = std::get<FunctionAttribute>(prev_decl.attribute).defined;
         if (already_defined && has_body) {
-            throw SemanticAnalyzerError(this, std::format("Function {} defined more than once at:\n{}", function_name, m_source_manager->get_source_line(function_declaration.source_location)));
+            throw SemanticAnalyzerError(this, std::format("Function {} defined more than once at:\n{}", function_name, m_source_manager->get_source_line(function_declaration.source_location)), m_source_manager->get_location(function_declaration.source_location));
         }
 
         if (std::get<FunctionAttribute>(prev_decl.attribute).global && !global) {
-            throw SemanticAnalyzerError(this, std::format("Function {} declared as static follows a non-static declaration at:\n{}", function_name, m_source_manager->get_source_line(function_declaration.source_location)));
+            throw SemanticAnalyzerError(this, std::format("Function {} declared as static follows a non-static declaration at:\n{}", function_name, m_source_manager->get_source_line(function_declaration.source_location)), m_source_manager->get_location(function_declaration.source_location));
         }
         global = std::get<FunctionAttribute>(prev_decl.attribute).global;
     }
@@ -776,24 +776,24 @@ void TypeCheckPass::typecheck_file_scope_variable_declaration(VariableDeclaratio
 
         auto& old_decl = m_symbol_table->symbol_at(variable_name);
         if (!std::holds_alternative<StaticAttribute>(old_decl.attribute)) {
-            throw SemanticAnalyzerError(this, std::format("Prev. file scope variable declaration of {} does not have a StaticAttribute! at:\n{}", variable_name, m_source_manager->get_source_line(variable_declaration.source_location)));
+            throw SemanticAnalyzerError(this, std::format("Prev. file scope variable declaration of {} does not have a StaticAttribute! at:\n{}", variable_name, m_source_manager->get_source_line(variable_declaration.source_location)), m_source_manager->get_location(variable_declaration.source_location));
         }
 
         if (!variable_declaration.type->equals(*old_decl.type)) {
-            throw SemanticAnalyzerError(this, std::format("Conflicting variable declaration at:\n{}", m_source_manager->get_source_line(variable_declaration.source_location)));
+            throw SemanticAnalyzerError(this, std::format("Conflicting variable declaration at:\n{}", m_source_manager->get_source_line(variable_declaration.source_location)), m_source_manager->get_location(variable_declaration.source_location));
         }
 
         StaticAttribute& old_attr = std::get<StaticAttribute>(old_decl.attribute);
         if (variable_declaration.storage_class == StorageClass::EXTERN) {
             global = old_attr.global;
         } else if (old_attr.global != global) {
-            throw SemanticAnalyzerError(this, std::format("Conflicting variable linkage for {} at:\n{}", variable_name, m_source_manager->get_source_line(variable_declaration.source_location)));
+            throw SemanticAnalyzerError(this, std::format("Conflicting variable linkage for {} at:\n{}", variable_name, m_source_manager->get_source_line(variable_declaration.source_location)), m_source_manager->get_location(variable_declaration.source_location));
         }
 
         // Check prev initialization
         if (std::holds_alternative<StaticInitialValue>(old_attr.init)) {
             if (std::holds_alternative<StaticInitialValue>(initial_value)) {
-                throw SemanticAnalyzerError(this, std::format("Conflicting file scope variable definitions for {} at:\n{}", variable_name, m_source_manager->get_source_line(variable_declaration.source_location)));
+                throw SemanticAnalyzerError(this, std::format("Conflicting file scope variable definitions for {} at:\n{}", variable_name, m_source_manager->get_source_line(variable_declaration.source_location)), m_source_manager->get_location(variable_declaration.source_location));
             } else {
                 initial_value = old_attr.init;
             }
@@ -816,13 +816,13 @@ void TypeCheckPass::typecheck_local_variable_declaration(VariableDeclaration& va
 
     if (variable_declaration.storage_class == StorageClass::EXTERN) {
         if (variable_declaration.expression.has_value()) {
-            throw SemanticAnalyzerError(this, std::format("StaticInitializer on local extern variable declaration for {} at:\n{}", variable_name, m_source_manager->get_source_line(variable_declaration.source_location)));
+            throw SemanticAnalyzerError(this, std::format("StaticInitializer on local extern variable declaration for {} at:\n{}", variable_name, m_source_manager->get_source_line(variable_declaration.source_location)), m_source_manager->get_location(variable_declaration.source_location));
         }
         if (m_symbol_table->contains_symbol(variable_name)) {
             auto& old_decl = m_symbol_table->symbol_at(variable_name);
 
             if (!variable_declaration.type->equals(*old_decl.type)) {
-                throw SemanticAnalyzerError(this, std::format("Conflicting variable declaration at:\n{}", m_source_manager->get_source_line(variable_declaration.source_location)));
+                throw SemanticAnalyzerError(this, std::format("Conflicting variable declaration at:\n{}", m_source_manager->get_source_line(variable_declaration.source_location)), m_source_manager->get_location(variable_declaration.source_location));
             }
             // a local extern declaration will never change the initial value or linkage we have already recorded
         } else {
@@ -954,7 +954,7 @@ StaticInitialValue TypeCheckPass::convert_constant_type_by_assignment(const Cons
     StaticInitialValue static_init;
     auto res = SymbolTable::convert_constant_type(value, target_type, warning_callback);
     if (!res) {
-        throw SemanticAnalyzerError(this, std::format("Failed convert_constant_type {}  at:\n{}", res.error(), m_source_manager->get_source_line(loc)));
+        throw SemanticAnalyzerError(this, std::format("Failed convert_constant_type {}  at:\n{}", res.error(), m_source_manager->get_source_line(loc)), m_source_manager->get_location(loc));
     }
 
     static_init.values = { StaticInitialValueType(res.value()) };
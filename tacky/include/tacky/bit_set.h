@@ -0,0 +1,76 @@
+#pragma once
+#include <bit>
+#include <cstdint>
+#include <vector>
+
+namespace tacky {
+
+// Fixed size set of small integers, the facts of the dataflow analyses
+class BitSet {
+public:
+    explicit BitSet(size_t size = 0, bool value = false)
+        : m_size { size }
+        , m_words((size + 63) / 64, value ? ~uint64_t(0) : 0)
+    {
+        clear_padding();
+    }
+
+    size_t size() const { return m_size; }
+
+    void set(size_t i) { m_words[i / 64] |= uint64_t(1) << (i % 64); }
+    void reset(size_t i) { m_words[i / 64] &= ~(uint64_t(1) << (i % 64)); }
+    bool test(size_t i) const { return m_words[i / 64] & (uint64_t(1) << (i % 64)); }
+
+    // Returns true if the set changed
+    bool union_with(const BitSet& other)
+    {
+        bool changed = false;
+        for (size_t i = 0; i < m_words.size(); ++i) {
+            uint64_t word = m_words[i] | other.m_words[i];
+            changed |= word != m_words[i];
+            m_words[i] = word;
+        }
+        return changed;
+    }
+
+    void intersect_with(const BitSet& other)
+    {
+        for (size_t i = 0; i < m_words.size(); ++i) {
+            m_words[i] &= other.m_words[i];
+        }
+    }
+
+    void subtract(const BitSet& other)
+    {
+        for (size_t i = 0; i < m_words.size(); ++i) {
+            m_words[i] &= ~other.m_words[i];
+        }
+    }
+
+    template<typename Function>
+    void for_each(Function&& function) const
+    {
+        for (size_t i = 0; i < m_words.size(); ++i) {
+            uint64_t word = m_words[i];
+            while (word) {
+                function(i * 64 + std::countr_zero(word));
+                word &= word - 1;
+            }
+        }
+    }
+
+    bool operator==(const BitSet& other) const = default;
+
+private:
+    void clear_padding()
+    {
+        if (m_size % 64 != 0) {
+            m_words.back() &= (uint64_t(1) << (m_size % 64)) - 1;
+        }
+    }
+
+    size_t m_size;
+    std::vector<uint64_t> m_words;
+};
+
+}
@@ -0,0 +1,59 @@
+#pragma once
+#include "common/data/remark_manager.h"
+#include "common/data/symbol_table.h"
+#include "common/data/type.h"
+#include "tacky/tacky_ast.h"
+#include <memory>
+#include <optional>
+#include <string>
+
+namespace tacky {
+
+// Value of a constant after the conversion C performs to the given type, nothing when the result is undefined
+// (a double out of the range of an integer type)
+std::optional<ConstantType> convert_constant(const ConstantType& value, const Type& target_type);
+
+// Result of an operation on constants of the same type, nothing when it would trap or is not defined for the type
+std::optional<ConstantType> evaluate_unary(UnaryOperator op, const ConstantType& value);
+std::optional<ConstantType> evaluate_binary(BinaryOperator op, const ConstantType& a, const ConstantType& b);
+
+// Constant as the remarks show it
+std::string constant_to_string(const ConstantType& value);
+
+// Folds the instructions of a function whose operands are all constants, with the semantics C gives every type:
+// unsigned arithmetic wraps, signed arithmetic is evaluated as the hardware does, and operations that are undefined
+// or trap at run time (division by zero, INT_MIN / -1, out of range double conversions) are left alone.
+// Algebraic identities (x + 0, x * 1, x - x, ...) become copies, conditional jumps on a constant become
+// unconditional jumps or disappear, and so do selects on a constant.
+// Every fold is reported as a passed remark, and constant operands left alone because the result is undefined as a
+// missed one.
+class ConstantFolding {
+public:
+    explicit ConstantFolding(std::shared_ptr<SymbolTable> symbol_table, std::shared_ptr<RemarkManager> remark_manager = nullptr);
+
+    // Returns true if the function changed
+    bool run(FunctionDefinition& function);
+
+private:
+    std::unique_ptr<Instruction> fold(Instruction& instruction, bool& remove);
+    std::unique_ptr<Instruction> fold_unary(UnaryInstruction& instruction);
+    std::unique_ptr<Instruction> fold_binary(BinaryInstruction& instruction);
+    std::unique_ptr<Instruction> simplify_binary(BinaryInstruction& instruction);
+    std::unique_ptr<Instruction> fold_select(SelectInstruction& instruction);
+    std::unique_ptr<Instruction> fold_conversion(const Instruction& instruction, Value& source, Value& destination);
+
+    const Type& type_of(const Value& value) const;
+
+    // Remark about the decision taken on instruction, in the function being folded
+    template<typename... Args>
+    void remark(RemarkKind kind, const Instruction& instruction, std::format_string<Args...> format, Args&&... args)
+    {
+        emit_remark(m_remark_manager, kind, "constant-fold", m_function_name, instruction.source_location, format, std::forward<Args>(args)...);
+    }
+
+    std::shared_ptr<SymbolTable> m_symbol_table;
+    std::shared_ptr<RemarkManager> m_remark_manager;
+    std::string m_function_name;
+};
+
+}
@@ -0,0 +1,55 @@
+#pragma once
+#include "common/data/remark_manager.h"
+#include "tacky/tacky_ast.h"
+#include <cstdint>
+#include <memory>
+#include <optional>
+#include <string>
+#include <vector>
+
+namespace tacky {
+
+// Basic blocks of a Tacky function with their edges. The graph takes the instructions out of the function, a pass
+// transforms them block by block and write_back puts them back in block order.
+// A block starts at a label or after a jump or a return and ends with the first jump, return or label that follows.
+class ControlFlowGraph {
+public:
+    // Pseudo nodes, ENTRY precedes the first block and EXIT follows every block that returns
+    static constexpr size_t ENTRY = SIZE_MAX - 1;
+    static constexpr size_t EXIT = SIZE_MAX;
+
+    struct BasicBlock {
+        std::vector<std::unique_ptr<Instruction>> instructions;
+        std::vector<size_t> predecessors;
+        std::vector<size_t> successors;
+    };
+
+    explicit ControlFlowGraph(FunctionDefinition& function);
+
+    std::vector<BasicBlock>& blocks() { return m_blocks; }
+    const std::vector<BasicBlock>& blocks() const { return m_blocks; }
+
+    // Blocks that can be reached from ENTRY
+    std::vector<bool> reachable_blocks() const;
+
+    // Blocks reachable from ENTRY in reverse postorder, every block comes before its successors except along back edges
+    std::vector<size_t> reverse_postorder() const;
+
+    // Immediate dominator of every block, ENTRY for the first block and the unreachable ones
+    std::vector<size_t> immediate_dominators() const;
+
+    // Moves the instructions of every block back into the function, in block order
+    void write_back(FunctionDefinition& function);
+
+    // Label a jump instruction goes to, nothing for any other instruction
+    static std::optional<std::string> jump_target(const Instruction& instruction);
+
+private:
+    std::vector<BasicBlock> m_blocks;
+};
+
+// Passed remark about a block a pass removes, at the first of its instructions with a location
+void remark_block_removed(const std::shared_ptr<RemarkManager>& remark_manager, const std::string& pass_name, const std::string& function_name,
+    const ControlFlowGraph::BasicBlock& block, const std::string& reason);
+
+}
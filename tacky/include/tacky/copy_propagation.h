@@ -0,0 +1,23 @@
+#pragma once
+#include "common/data/symbol_table.h"
+#include "tacky/tacky_ast.h"
+#include <memory>
+
+namespace tacky {
+
+// Replaces a variable by the value copied into it when that copy reaches the use on every path (reaching copies
+// analysis) and removes copies of a value the destination already holds.
+// Stores through a pointer and function calls kill every copy that involves an aliased variable, one with static
+// storage or whose address is taken. Copies between types that are represented differently are never propagated.
+class CopyPropagation {
+public:
+    explicit CopyPropagation(std::shared_ptr<SymbolTable> symbol_table);
+
+    // Returns true if the function changed
+    bool run(FunctionDefinition& function);
+
+private:
+    std::shared_ptr<SymbolTable> m_symbol_table;
+};
+
+}
@@ -0,0 +1,22 @@
+#pragma once
+#include "common/data/symbol_table.h"
+#include "tacky/tacky_ast.h"
+#include <memory>
+
+namespace tacky {
+
+// Removes the instructions without side effects whose destination is not live afterwards (backward liveness).
+// Function calls and stores through a pointer always stay, and so do the writes to variables that might be read
+// through a pointer or by another function (static storage or address taken).
+class DeadStoreElimination {
+public:
+    explicit DeadStoreElimination(std::shared_ptr<SymbolTable> symbol_table);
+
+    // Returns true if the function changed
+    bool run(FunctionDefinition& function);
+
+private:
+    std::shared_ptr<SymbolTable> m_symbol_table;
+};
+
+}
@@ -0,0 +1,26 @@
+#pragma once
+#include "common/data/symbol_table.h"
+#include "tacky/ssa_form.h"
+#include "tacky/tacky_ast.h"
+#include <memory>
+
+namespace tacky {
+
+// Dominator based global value numbering on a function in SSA form. Walking the dominator tree, a pure instruction
+// (arithmetic, comparison, conversion, AddPointer, GetAddress) that computes the same operation on the same values
+// as an instruction in a dominating block becomes a copy of that earlier result, and the uses of its destination
+// read the earlier result directly.
+// Loads are only numbered within a block up to the next store, call or write to a variable that is not in SSA form,
+// any of which can change the memory the load reads.
+class GlobalValueNumbering {
+public:
+    explicit GlobalValueNumbering(std::shared_ptr<SymbolTable> symbol_table);
+
+    // Returns true if the function changed
+    bool run(SsaForm& ssa);
+
+private:
+    std::shared_ptr<SymbolTable> m_symbol_table;
+};
+
+}
@@ -0,0 +1,26 @@
+#pragma once
+#include "common/data/name_generator.h"
+#include "common/data/symbol_table.h"
+#include "tacky/tacky_ast.h"
+#include <memory>
+
+namespace tacky {
+
+// Turns the branches whose arms are short and free of side effects into straight-line code: both arms run, each
+// writing fresh temporaries, and a SelectInstruction per variable they assign picks the result on the condition.
+// Handles the triangle (if without else) and the diamond (if-else, conditional expression) shapes. Arms that might
+// trap (integer division by a variable), touch memory or call a function keep their branch, and so do the branches a
+// cost model expects to be cheaper than running both arms.
+class IfConversion {
+public:
+    IfConversion(std::shared_ptr<SymbolTable> symbol_table, std::shared_ptr<NameGenerator> name_generator);
+
+    // Returns true if the function changed
+    bool run(FunctionDefinition& function);
+
+private:
+    std::shared_ptr<SymbolTable> m_symbol_table;
+    std::shared_ptr<NameGenerator> m_name_generator;
+};
+
+}
@@ -0,0 +1,33 @@
+#pragma once
+#include "common/data/name_generator.h"
+#include "common/data/symbol_table.h"
+#include "tacky/tacky_ast.h"
+#include <memory>
+
+namespace tacky {
+
+// Strength reduction of the induction variables of natural loops. A basic induction variable changes by the same
+// constant once per iteration: i = i + c, or i = t with t = i + c as leaving SSA form writes it. Two kinds of
+// variables derived from one get an induction variable of their own, set in the preheader and stepped right after i:
+// the address of an array element indexed by i (or by its sign extension) becomes a pointer incremented by the
+// element size, and a product of i by a constant becomes a sum.
+// Linear function test replacement then rewrites the exit test on i into a test on the pointer, against the address
+// of the element where the loop stops, when comparing addresses cannot wrap around where comparing integers did not:
+// the test is for (in)equality and i steps by one, or i counts up by one and the loop is only entered when its
+// condition holds. The counter goes away when nothing else reads it.
+class InductionVariableStrengthReduction {
+public:
+    InductionVariableStrengthReduction(std::shared_ptr<SymbolTable> symbol_table, std::shared_ptr<NameGenerator> name_generator);
+
+    // Returns true if the function changed
+    bool run(FunctionDefinition& function);
+
+private:
+    // Reduces the induction variables of the first loop that has any to reduce, returns false if none has
+    bool reduce_next_loop(FunctionDefinition& function);
+
+    std::shared_ptr<SymbolTable> m_symbol_table;
+    std::shared_ptr<NameGenerator> m_name_generator;
+};
+
+}
@@ -0,0 +1,56 @@
+#pragma once
+#include "common/data/name_generator.h"
+#include "tacky/control_flow_graph.h"
+#include <memory>
+#include <optional>
+#include <string>
+#include <vector>
+
+namespace tacky {
+
+// Natural loops of a control flow graph. An edge to a block that dominates its source is a back edge, the loop of a
+// header is the header and every block that reaches one of its back edges without passing through it. Loops of
+// irreducible graphs have no such header and are not found.
+// The labels LoopLabelingPass gave the loop statements are matched with the loops: a loop carries the name of the
+// statement whose continue_ label is inside it and whose break_ label is where it exits. Loops written with goto and
+// loops whose labels the optimizations removed have none.
+class LoopInfo {
+public:
+    struct Loop {
+        size_t header;
+        // In block order, the header included
+        std::vector<size_t> blocks;
+        // Blocks with a back edge to the header
+        std::vector<size_t> latches;
+        // Blocks with a successor outside the loop
+        std::vector<size_t> exiting_blocks;
+        // Name of the loop statement, without the continue_ or break_ prefix
+        std::optional<std::string> label;
+
+        bool contains(size_t block) const;
+    };
+
+    explicit LoopInfo(const ControlFlowGraph& cfg);
+
+    // Innermost loops first, a loop always comes before the loops containing it
+    const std::vector<Loop>& loops() const { return m_loops; }
+    const std::vector<size_t>& immediate_dominators() const { return m_immediate_dominators; }
+    bool dominates(size_t dominator, size_t block) const;
+
+private:
+    void match_labels(const ControlFlowGraph& cfg);
+
+    std::vector<size_t> m_immediate_dominators;
+    std::vector<Loop> m_loops;
+};
+
+// Whether code can be placed in front of the loop header: the header has a label the jumps entering the loop can be
+// moved to, and no block of the loop falls through into it
+bool can_insert_preheader(const ControlFlowGraph& cfg, const LoopInfo::Loop& loop);
+
+// Places the instructions where they run once each time the loop is entered: at the end of the block that is the only
+// way into the header when there is one, in a new labeled block in front of the header otherwise. The edges of the
+// graph are left as they were, it is only good for writing back afterwards
+void insert_in_preheader(ControlFlowGraph& cfg, const LoopInfo::Loop& loop, std::vector<std::unique_ptr<Instruction>> instructions, NameGenerator& name_generator);
+
+}
@@ -0,0 +1,31 @@
+#pragma once
+#include "common/data/name_generator.h"
+#include "common/data/symbol_table.h"
+#include "tacky/tacky_ast.h"
+#include <memory>
+
+namespace tacky {
+
+// Moves the instructions that compute the same value on every iteration of a natural loop to a preheader, a block
+// that runs once before the loop. Inner loops go first, so an instruction can leave a whole nest over several runs.
+// An instruction moves when its operands are not written in the loop and it is the only definition of a variable that
+// is only read where it dominates, so that running it once before the loop, even on a path that would have skipped
+// it, changes nothing else. Only instructions that cannot trap or have side effects move (no call, no store, no
+// integer division by a variable); a load moves when nothing in the loop writes memory (stores, calls, writes to
+// address taken variables) and it runs on every iteration that leaves the loop.
+class LoopInvariantCodeMotion {
+public:
+    LoopInvariantCodeMotion(std::shared_ptr<SymbolTable> symbol_table, std::shared_ptr<NameGenerator> name_generator);
+
+    // Returns true if the function changed
+    bool run(FunctionDefinition& function);
+
+private:
+    // Hoists the invariant instructions of the first loop that has any, returns false if none has
+    bool hoist_from_next_loop(FunctionDefinition& function);
+
+    std::shared_ptr<SymbolTable> m_symbol_table;
+    std::shared_ptr<NameGenerator> m_name_generator;
+};
+
+}
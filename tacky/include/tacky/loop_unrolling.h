@@ -0,0 +1,43 @@
+#pragma once
+#include "common/data/name_generator.h"
+#include "common/data/remark_manager.h"
+#include "common/data/symbol_table.h"
+#include "tacky/tacky_ast.h"
+#include <memory>
+#include <string>
+#include <unordered_set>
+
+namespace tacky {
+
+// Unrolls the innermost loops whose exit test compares an induction variable (an int, an unsigned int or a pointer
+// stepped by a constant once per iteration) with a bound the loop does not change. A loop whose trip count is known at
+// compile time is unrolled completely when its copies fit the size budget. Any other loop runs factor copies of its
+// body with the exit tests between them removed, behind a check that factor more iterations remain; the original loop
+// follows and runs the remaining iterations.
+// Every copy of the body has its own copies of the labels inside the loop, so continue goes to the end of its own copy,
+// and the jumps out of the loop, break among them, are left as they are.
+// Every innermost loop is reported as a passed remark with the factor used, or as a missed one with the reason it was
+// left alone.
+class LoopUnrolling {
+public:
+    // At most factor copies of a body, and at most size_budget instructions in the copies of one loop
+    LoopUnrolling(std::shared_ptr<SymbolTable> symbol_table, std::shared_ptr<NameGenerator> name_generator, size_t factor, size_t size_budget,
+        std::shared_ptr<RemarkManager> remark_manager = nullptr);
+
+    // Returns true if the function changed
+    bool run(FunctionDefinition& function);
+
+private:
+    // Unrolls the first loop that can be unrolled, returns false if none can
+    bool unroll_next_loop(FunctionDefinition& function);
+
+    std::shared_ptr<SymbolTable> m_symbol_table;
+    std::shared_ptr<NameGenerator> m_name_generator;
+    size_t m_factor;
+    size_t m_size_budget;
+    std::shared_ptr<RemarkManager> m_remark_manager;
+    // Headers of the unrolled loops and of the loops running their remaining iterations, they are not unrolled again
+    std::unordered_set<std::string> m_unrolled_headers;
+};
+
+}
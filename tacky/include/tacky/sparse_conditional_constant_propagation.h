@@ -0,0 +1,27 @@
+#pragma once
+#include "common/data/remark_manager.h"
+#include "common/data/symbol_table.h"
+#include "tacky/ssa_form.h"
+#include "tacky/tacky_ast.h"
+#include <memory>
+
+namespace tacky {
+
+// Sparse conditional constant propagation (Wegman and Zadeck) on a function in SSA form. Values are only evaluated
+// along the edges found executable so far, so a constant that makes a branch go one way keeps the other way from
+// lowering the values it merges. Every use of a version found constant is replaced by the constant, conditional
+// jumps on a constant become unconditional jumps or disappear and the blocks found not executable are removed.
+// The branches resolved, the instructions folded and the blocks removed are reported as passed remarks.
+class SparseConditionalConstantPropagation {
+public:
+    explicit SparseConditionalConstantPropagation(std::shared_ptr<SymbolTable> symbol_table, std::shared_ptr<RemarkManager> remark_manager = nullptr);
+
+    // Returns true if the function changed
+    bool run(SsaForm& ssa);
+
+private:
+    std::shared_ptr<SymbolTable> m_symbol_table;
+    std::shared_ptr<RemarkManager> m_remark_manager;
+};
+
+}
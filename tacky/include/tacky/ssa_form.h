@@ -0,0 +1,86 @@
+#pragma once
+#include "common/data/name_generator.h"
+#include "common/data/symbol_table.h"
+#include "tacky/control_flow_graph.h"
+#include "tacky/tacky_ast.h"
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+namespace tacky {
+
+// SSA form of a function. Every scalar local variable only the function can access (not static, not address taken)
+// is renamed so that each definition writes a new version, and phi nodes placed on the dominance frontiers of the
+// definitions (Cytron et al.) merge the versions that reach a block from its predecessors. Only variables live across
+// blocks get phi nodes (semi-pruned form).
+// The phi nodes are kept beside the instructions of each block, destruct turns them back into copies.
+// A variable read before any definition, like a parameter, keeps its original name as its first version.
+class SsaForm {
+public:
+    struct Phi {
+        // Variable the phi node merges, before renaming
+        std::string variable;
+        std::string destination;
+        // Value flowing in from each predecessor, in the order of the block predecessors
+        std::vector<std::unique_ptr<Value>> arguments;
+    };
+
+    // Takes the instructions of the function, destruct gives them back
+    SsaForm(FunctionDefinition& function, std::shared_ptr<SymbolTable> symbol_table, std::shared_ptr<NameGenerator> name_generator);
+
+    ControlFlowGraph& cfg() { return m_cfg; }
+    const std::string& function_name() const { return m_function_name; }
+    std::vector<Phi>& phis(size_t block) { return m_phis[block]; }
+
+    // Immediate dominator of every block, ControlFlowGraph::ENTRY for the first block and the unreachable ones
+    const std::vector<size_t>& immediate_dominators() const { return m_immediate_dominators; }
+    // Blocks immediately dominated by each block
+    const std::vector<std::vector<size_t>>& dominator_tree() const { return m_dominator_tree; }
+
+    // True if the variable was renamed, versions of renamed variables are defined exactly once
+    bool is_ssa_variable(const std::string& name) const { return m_original_names.contains(name); }
+    // True if the variable holds the same value wherever it is read: a version, or a renamed variable that is only
+    // read before its first definition (a parameter)
+    bool is_ssa_value(const std::string& name) const { return m_original_names.contains(name) || m_candidates.contains(name); }
+    // Variable a version was created for
+    const std::string& original_name(const std::string& version) const { return m_original_names.at(version); }
+
+    // Removes the edge between two blocks with the phi arguments flowing along it. The jump of the predecessor must
+    // no longer lead to the successor
+    void remove_edge(size_t from, size_t to);
+    // Removes the instructions and phi nodes of a block no path reaches anymore, with its outgoing edges
+    void remove_block(size_t block);
+
+    // Moves the instructions back into the function. The phi nodes of a block become copies at the end of its
+    // predecessors, performed as one parallel copy; an edge out of a conditional jump gets a block of its own so that
+    // the copies only run along that edge, unless they are dead along the other one (the back edge of a loop)
+    void destruct(FunctionDefinition& function);
+
+    // Sequence of copies with the effect of performing all of them at once, the destinations are distinct.
+    // Cycles (a swap) go through a new temporary
+    std::vector<std::unique_ptr<Instruction>> sequentialize_copies(std::vector<std::pair<std::string, std::unique_ptr<Value>>> copies);
+
+private:
+    void compute_dominators();
+    void place_phis(const std::vector<std::string>& variables);
+    void rename(size_t block, std::unordered_map<std::string, std::vector<std::string>>& stacks);
+    std::string new_version(const std::string& variable);
+
+    std::string m_function_name;
+    // Computed before the graph takes the instructions of the function
+    std::unordered_set<std::string> m_aliased;
+    ControlFlowGraph m_cfg;
+    std::shared_ptr<SymbolTable> m_symbol_table;
+    std::shared_ptr<NameGenerator> m_name_generator;
+    std::vector<std::vector<Phi>> m_phis;
+    std::vector<size_t> m_immediate_dominators;
+    std::vector<std::vector<size_t>> m_dominator_tree;
+    std::vector<bool> m_reachable;
+    // Variables being renamed
+    std::unordered_set<std::string> m_candidates;
+    std::unordered_map<std::string, std::string> m_original_names;
+};
+
+}
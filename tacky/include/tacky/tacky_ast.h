@@ -1,6 +1,8 @@
 #pragma once
+#include "common/data/source_location.h"
 #include "common/data/symbol_table.h"
 #include <memory>
+#include <optional>
 #include <string>
 #include <vector>
 
@@ -21,6 +23,7 @@ class ReturnInstruction;
 class UnaryInstruction;
 class BinaryInstruction;
 class CopyInstruction;
+class SelectInstruction;
 class JumpInstruction;
 class JumpIfZeroInstruction;
 class JumpIfNotZeroInstruction;
@@ -60,6 +63,7 @@ public:
     virtual void visit(UnaryInstruction& node) = 0;
     virtual void visit(BinaryInstruction& node) = 0;
     virtual void visit(CopyInstruction& node) = 0;
+    virtual void visit(SelectInstruction& node) = 0;
     virtual void visit(GetAddressInstruction& node) = 0;
     virtual void visit(LoadInstruction& node) = 0;
     virtual void visit(StoreInstruction& node) = 0;
@@ -155,6 +159,18 @@ public:
 class Instruction : public TackyAST {
 public:
     virtual ~Instruction() = default;
+    // Copy with copies of the values, at the same source location
+    virtual std::unique_ptr<Instruction> clone() const = 0;
+
+    // Location of the statement that generated this instruction, used for diagnostics and remarks
+    std::optional<SourceLocationIndex> source_location;
+
+protected:
+    std::unique_ptr<Instruction> located(std::unique_ptr<Instruction> copy) const
+    {
+        copy->source_location = source_location;
+        return copy;
+    }
 };
 
 class ReturnInstruction : public Instruction {
@@ -169,6 +185,11 @@ public:
         visitor.visit(*this);
     }
 
+    std::unique_ptr<Instruction> clone() const override
+    {
+        return located(std::make_unique<ReturnInstruction>(value ? value->clone() : nullptr));
+    }
+
     std::unique_ptr<Value> value;
 };
 
@@ -185,6 +206,11 @@ public:
         visitor.visit(*this);
     }
 
+    std::unique_ptr<Instruction> clone() const override
+    {
+        return located(std::make_unique<SignExtendInstruction>(source->clone(), destination->clone()));
+    }
+
     std::unique_ptr<Value> source;
     std::unique_ptr<Value> destination;
 };
@@ -202,6 +228,11 @@ public:
         visitor.visit(*this);
     }
 
+    std::unique_ptr<Instruction> clone() const override
+    {
+        return located(std::make_unique<TruncateInstruction>(source->clone(), destination->clone()));
+    }
+
     std::unique_ptr<Value> source;
     std::unique_ptr<Value> destination;
 };
@@ -219,6 +250,11 @@ public:
         visitor.visit(*this);
     }
 
+    std::unique_ptr<Instruction> clone() const override
+    {
+        return located(std::make_unique<ZeroExtendInstruction>(source->clone(), destination->clone()));
+    }
+
     std::unique_ptr<Value> source;
     std::unique_ptr<Value> destination;
 };
@@ -236,6 +272,11 @@ public:
         visitor.visit(*this);
     }
 
+    std::unique_ptr<Instruction> clone() const override
+    {
+        return located(std::make_unique<DoubleToIntIntruction>(source->clone(), destination->clone()));
+    }
+
     std::unique_ptr<Value> source;
     std::unique_ptr<Value> destination;
 };
@@ -253,6 +294,11 @@ public:
         visitor.visit(*this);
     }
 
+    std::unique_ptr<Instruction> clone() const override
+    {
+        return located(std::make_unique<DoubleToUIntIntruction>(source->clone(), destination->clone()));
+    }
+
     std::unique_ptr<Value> source;
     std::unique_ptr<Value> destination;
 };
@@ -270,6 +316,11 @@ public:
         visitor.visit(*this);
     }
 
+    std::unique_ptr<Instruction> clone() const override
+    {
+        return located(std::make_unique<IntToDoubleIntruction>(source->clone(), destination->clone()));
+    }
+
     std::unique_ptr<Value> source;
     std::unique_ptr<Value> destination;
 };
@@ -287,6 +338,11 @@ public:
         visitor.visit(*this);
     }
 
+    std::unique_ptr<Instruction> clone() const override
+    {
+        return located(std::make_unique<UIntToDoubleIntruction>(source->clone(), destination->clone()));
+    }
+
     std::unique_ptr<Value> source;
     std::unique_ptr<Value> destination;
 };
@@ -305,6 +361,11 @@ public:
         visitor.visit(*this);
     }
 
+    std::unique_ptr<Instruction> clone() const override
+    {
+        return located(std::make_unique<UnaryInstruction>(unary_operator, source->clone(), destination->clone()));
+    }
+
     UnaryOperator unary_operator;
     std::unique_ptr<Value> source;
     std::unique_ptr<Value> destination;
@@ -325,6 +386,11 @@ public:
         visitor.visit(*this);
     }
 
+    std::unique_ptr<Instruction> clone() const override
+    {
+        return located(std::make_unique<BinaryInstruction>(binary_operator, source1->clone(), source2->clone(), destination->clone()));
+    }
+
     BinaryOperator binary_operator;
     std::unique_ptr<Value> source1;
     std::unique_ptr<Value> source2;
@@ -344,10 +410,43 @@ public:
         visitor.visit(*this);
     }
 
+    std::unique_ptr<Instruction> clone() const override
+    {
+        return located(std::make_unique<CopyInstruction>(source->clone(), destination->clone()));
+    }
+
     std::unique_ptr<Value> source;
     std::unique_ptr<Value> destination;
 };
 
+// destination = condition != 0 ? true_value : false_value, both values are evaluated before the instruction.
+// Formed by IfConversion out of branches whose arms are cheap enough to run unconditionally
+class SelectInstruction : public Instruction {
+public:
+    SelectInstruction(std::unique_ptr<Value> condition, std::unique_ptr<Value> true_value, std::unique_ptr<Value> false_value, std::unique_ptr<Value> destination)
+        : condition(std::move(condition))
+        , true_value(std::move(true_value))
+        , false_value(std::move(false_value))
+        , destination(std::move(destination))
+    {
+    }
+
+    void accept(TackyVisitor& visitor) override
+    {
+        visitor.visit(*this);
+    }
+
+    std::unique_ptr<Instruction> clone() const override
+    {
+        return located(std::make_unique<SelectInstruction>(condition->clone(), true_value->clone(), false_value->clone(), destination->clone()));
+    }
+
+    std::unique_ptr<Value> condition;
+    std::unique_ptr<Value> true_value;
+    std::unique_ptr<Value> false_value;
+    std::unique_ptr<Value> destination;
+};
+
 class GetAddressInstruction : public Instruction {
 public:
     GetAddressInstruction(std::unique_ptr<Value> source, std::unique_ptr<Value> destination)
@@ -361,6 +460,11 @@ public:
         visitor.visit(*this);
     }
 
+    std::unique_ptr<Instruction> clone() const override
+    {
+        return located(std::make_unique<GetAddressInstruction>(source->clone(), destination->clone()));
+    }
+
     std::unique_ptr<Value> source;
     std::unique_ptr<Value> destination;
 };
@@ -378,6 +482,11 @@ public:
         visitor.visit(*this);
     }
 
+    std::unique_ptr<Instruction> clone() const override
+    {
+        return located(std::make_unique<LoadInstruction>(source_pointer->clone(), destination->clone()));
+    }
+
     std::unique_ptr<Value> source_pointer;
     std::unique_ptr<Value> destination;
 };
@@ -395,6 +504,11 @@ public:
         visitor.visit(*this);
     }
 
+    std::unique_ptr<Instruction> clone() const override
+    {
+        return located(std::make_unique<StoreInstruction>(source->clone(), destination_pointer->clone()));
+    }
+
     std::unique_ptr<Value> source;
     std::unique_ptr<Value> destination_pointer;
 };
@@ -414,6 +528,11 @@ public:
         visitor.visit(*this);
     }
 
+    std::unique_ptr<Instruction> clone() const override
+    {
+        return located(std::make_unique<AddPointerInstruction>(source_pointer->clone(), index->clone(), scale, destination->clone()));
+    }
+
     std::unique_ptr<Value> source_pointer;
     std::unique_ptr<Value> index;
     size_t scale;
@@ -434,6 +553,11 @@ public:
         visitor.visit(*this);
     }
 
+    std::unique_ptr<Instruction> clone() const override
+    {
+        return located(std::make_unique<CopyToOffsetInstruction>(source->clone(), identifier.name, offset));
+    }
+
     std::unique_ptr<Value> source;
     Identifier identifier;
     size_t offset;
@@ -451,6 +575,11 @@ public:
         visitor.visit(*this);
     }
 
+    std::unique_ptr<Instruction> clone() const override
+    {
+        return located(std::make_unique<JumpInstruction>(identifier.name));
+    }
+
     Identifier identifier;
 };
 
@@ -467,6 +596,11 @@ public:
         visitor.visit(*this);
     }
 
+    std::unique_ptr<Instruction> clone() const override
+    {
+        return located(std::make_unique<JumpIfZeroInstruction>(condition->clone(), identifier.name));
+    }
+
     std::unique_ptr<Value> condition;
     Identifier identifier;
 };
@@ -484,6 +618,11 @@ public:
         visitor.visit(*this);
     }
 
+    std::unique_ptr<Instruction> clone() const override
+    {
+        return located(std::make_unique<JumpIfNotZeroInstruction>(condition->clone(), identifier.name));
+    }
+
     std::unique_ptr<Value> condition;
     Identifier identifier;
 };
@@ -500,6 +639,11 @@ public:
         visitor.visit(*this);
     }
 
+    std::unique_ptr<Instruction> clone() const override
+    {
+        return located(std::make_unique<LabelInstruction>(identifier.name));
+    }
+
     Identifier identifier;
 };
 
@@ -517,6 +661,15 @@ public:
         visitor.visit(*this);
     }
 
+    std::unique_ptr<Instruction> clone() const override
+    {
+        std::vector<std::unique_ptr<Value>> argument_copies;
+        for (const auto& argument : arguments) {
+            argument_copies.push_back(argument->clone());
+        }
+        return located(std::make_unique<FunctionCallInstruction>(name.name, std::move(argument_copies), destination ? destination->clone() : nullptr));
+    }
+
     Identifier name;
     std::vector<std::unique_ptr<Value>> arguments;
     std::unique_ptr<Value> destination;
@@ -546,6 +699,7 @@ public:
     bool global;
     std::vector<Identifier> parameters;
     std::vector<std::unique_ptr<Instruction>> body;
+    std::optional<SourceLocationIndex> source_location;
 };
 
 class StaticVariable : public TopLevel {
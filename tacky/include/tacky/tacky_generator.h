@@ -72,6 +72,9 @@ private:
     std::unique_ptr<ExpressionResult> transform_string_expression(parser::StringExpression& string_expression, std::vector<std::unique_ptr<Instruction>>& instructions);
 
     std::unique_ptr<Value> emit_tacky_and_convert(parser::Expression& expr, std::vector<std::unique_ptr<Instruction>>& instructions);
+    // Jumps to target when the condition is (jump_if_true) or is not true. && || and ! turn into jumps instead of
+    // materializing 0 or 1, each comparison then feeds the conditional jump on its result directly
+    void emit_condition_jump(parser::Expression& condition, bool jump_if_true, const std::string& target, std::vector<std::unique_ptr<Instruction>>& instructions);
 
     // Main statement transformation dispatcher
     void transform_statement(parser::Statement& statement, std::vector<std::unique_ptr<Instruction>>& instructions);
@@ -105,6 +108,7 @@ private:
     // to determine operand size and stack space
     std::string make_and_add_temporary(const Type& type, const IdentifierAttribute& attr = LocalAttribute {});
     std::unique_ptr<TemporaryVariable> make_temporary_variable(const Type& type, const IdentifierAttribute& attr = LocalAttribute {});
+    void set_source_location(std::vector<std::unique_ptr<Instruction>>& instructions, size_t first, const SourceLocationIndex& location);
 
     std::shared_ptr<parser::ParserAST> m_ast;
     std::shared_ptr<NameGenerator> m_name_generator;
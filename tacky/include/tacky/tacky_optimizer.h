@@ -0,0 +1,42 @@
+#pragma once
+#include "common/data/compile_options.h"
+#include "common/data/name_generator.h"
+#include "common/data/remark_manager.h"
+#include "common/data/symbol_table.h"
+#include "tacky/tacky_ast.h"
+#include <memory>
+#include <stdexcept>
+
+namespace tacky {
+
+class TackyOptimizerError : public std::runtime_error {
+public:
+    explicit TackyOptimizerError(const std::string& message)
+        : std::runtime_error(message)
+    {
+    }
+};
+
+// Machine independent optimizations on Tacky, run on each function until none of the passes changes it anymore.
+// Each pass only sees one function, globals and static variables are left untouched.
+// The passes on SSA form run once between two rounds of the cheaper passes, which clean up after them.
+class TackyOptimizer {
+public:
+    TackyOptimizer(std::shared_ptr<TackyAST> ast, std::shared_ptr<SymbolTable> symbol_table, std::shared_ptr<NameGenerator> name_generator, std::shared_ptr<CompileOptions> compile_options,
+        std::shared_ptr<RemarkManager> remark_manager = nullptr);
+
+    void optimize();
+
+private:
+    void optimize_function(FunctionDefinition& function);
+    // Returns the number of iterations
+    size_t run_cleanup_passes(FunctionDefinition& function);
+
+    std::shared_ptr<TackyAST> m_ast;
+    std::shared_ptr<SymbolTable> m_symbol_table;
+    std::shared_ptr<NameGenerator> m_name_generator;
+    std::shared_ptr<CompileOptions> m_compile_options;
+    std::shared_ptr<RemarkManager> m_remark_manager;
+};
+
+}
@@ -27,6 +27,7 @@ public:
     void visit(UnaryInstruction& node) override;
     void visit(BinaryInstruction& node) override;
     void visit(CopyInstruction& node) override;
+    void visit(SelectInstruction& node) override;
     void visit(GetAddressInstruction& node) override;
     void visit(LoadInstruction& node) override;
     void visit(StoreInstruction& node) override;
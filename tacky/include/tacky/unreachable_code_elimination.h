@@ -0,0 +1,22 @@
+#pragma once
+#include "common/data/remark_manager.h"
+#include "tacky/tacky_ast.h"
+#include <memory>
+
+namespace tacky {
+
+// Removes the blocks no path from the function entry reaches (code after a return or a break, branches resolved by
+// constant folding), jumps to the block that follows anyway and labels no jump refers to.
+// Every unreachable block removed is reported as a passed remark.
+class UnreachableCodeElimination {
+public:
+    explicit UnreachableCodeElimination(std::shared_ptr<RemarkManager> remark_manager = nullptr);
+
+    // Returns true if the function changed
+    bool run(FunctionDefinition& function);
+
+private:
+    std::shared_ptr<RemarkManager> m_remark_manager;
+};
+
+}
@@ -0,0 +1,30 @@
+#pragma once
+#include "common/data/symbol_table.h"
+#include "tacky/tacky_ast.h"
+#include <memory>
+#include <optional>
+#include <string>
+#include <unordered_set>
+#include <vector>
+
+namespace tacky {
+
+// Slots of the values an instruction reads, so that a pass can replace them. The source of a GetAddressInstruction
+// is not read, only its address is taken
+std::vector<std::unique_ptr<Value>*> used_values(Instruction& instruction);
+
+// Variable an instruction writes, writes through a pointer (StoreInstruction) are not included
+std::optional<std::string> defined_variable(const Instruction& instruction);
+
+// Slot of the value an instruction writes as a whole, nullptr when it writes nothing or only part of an array
+std::unique_ptr<Value>* defined_value(Instruction& instruction);
+
+// True if the instruction can run where the program would not have run it: it neither traps (integer division by
+// a variable or by -1) nor touches memory or calls a function, it only writes its destination
+bool is_speculatable(const Instruction& instruction, const SymbolTable& symbol_table);
+
+// Variables of a function that pointers or other functions can read and write behind its back: variables with static
+// storage and variables whose address the function takes
+std::unordered_set<std::string> aliased_variables(const FunctionDefinition& function, const SymbolTable& symbol_table);
+
+}
@@ -0,0 +1,475 @@
+#include "tacky/constant_folding.h"
+#include "common/data/symbol_table.h"
+#include "common/data/type.h"
+#include "common/error/internal_compiler_error.h"
+#include "common/stats/statistic.h"
+#include "tacky/tacky_ast.h"
+#include <cmath>
+#include <format>
+#include <limits>
+#include <type_traits>
+#include <variant>
+
+using namespace tacky;
+
+STATISTIC(NumInstructionsFolded, "constant-fold", "Number of instructions with constant operands folded");
+STATISTIC(NumIdentitiesSimplified, "constant-fold", "Number of algebraic identities simplified");
+STATISTIC(NumBranchesFolded, "constant-fold", "Number of conditional jumps on constants resolved");
+
+namespace {
+
+template<typename T>
+constexpr bool is_arithmetic_constant_v = std::is_same_v<T, int> || std::is_same_v<T, long> || std::is_same_v<T, unsigned int>
+    || std::is_same_v<T, unsigned long> || std::is_same_v<T, double>;
+
+template<typename T>
+constexpr bool is_integer_constant_v = std::is_integral_v<T>;
+
+Constant* as_constant(const std::unique_ptr<Value>& value)
+{
+    return dynamic_cast<Constant*>(value.get());
+}
+
+TemporaryVariable* as_variable(const std::unique_ptr<Value>& value)
+{
+    return dynamic_cast<TemporaryVariable*>(value.get());
+}
+
+bool is_zero(const ConstantType& value)
+{
+    return std::visit([](auto v) {
+        if constexpr (std::is_same_v<decltype(v), std::monostate>) {
+            return false;
+        } else {
+            // -0.0 compares equal to 0.0 and NaN is not zero, as for a C condition
+            return v == 0;
+        }
+    },
+        value);
+}
+
+bool is_one(const ConstantType& value)
+{
+    return std::visit([](auto v) {
+        if constexpr (std::is_same_v<decltype(v), std::monostate>) {
+            return false;
+        } else {
+            return v == 1;
+        }
+    },
+        value);
+}
+
+bool is_integer(const ConstantType& value)
+{
+    return std::visit([](auto v) { return is_integer_constant_v<decltype(v)>; }, value);
+}
+
+// Zero with the type of value
+ConstantType zero_like(const ConstantType& value)
+{
+    return std::visit([](auto v) -> ConstantType {
+        if constexpr (std::is_same_v<decltype(v), std::monostate>) {
+            return v;
+        } else {
+            return decltype(v) { 0 };
+        }
+    },
+        value);
+}
+
+template<typename T>
+std::optional<ConstantType> apply_binary(BinaryOperator op, T a, T b)
+{
+    switch (op) {
+    case BinaryOperator::EQUAL:
+        return static_cast<int>(a == b);
+    case BinaryOperator::NOT_EQUAL:
+        return static_cast<int>(a != b);
+    case BinaryOperator::LESS_THAN:
+        return static_cast<int>(a < b);
+    case BinaryOperator::LESS_OR_EQUAL:
+        return static_cast<int>(a <= b);
+    case BinaryOperator::GREATER_THAN:
+        return static_cast<int>(a > b);
+    case BinaryOperator::GREATER_OR_EQUAL:
+        return static_cast<int>(a >= b);
+    default:
+        break;
+    }
+
+    if constexpr (std::is_floating_point_v<T>) {
+        // IEEE 754 arithmetic, division by zero gives an infinity or NaN as it does at run time
+        switch (op) {
+        case BinaryOperator::ADD:
+            return a + b;
+        case BinaryOperator::SUBTRACT:
+            return a - b;
+        case BinaryOperator::MULTIPLY:
+            return a * b;
+        case BinaryOperator::DIVIDE:
+            return a / b;
+        default:
+            return std::nullopt;
+        }
+    } else {
+        // Signed overflow wraps, as the generated add/sub/imul do
+        using Unsigned = std::make_unsigned_t<T>;
+        switch (op) {
+        case BinaryOperator::ADD:
+            return static_cast<T>(static_cast<Unsigned>(a) + static_cast<Unsigned>(b));
+        case BinaryOperator::SUBTRACT:
+            return static_cast<T>(static_cast<Unsigned>(a) - static_cast<Unsigned>(b));
+        case BinaryOperator::MULTIPLY:
+            return static_cast<T>(static_cast<Unsigned>(a) * static_cast<Unsigned>(b));
+        case BinaryOperator::DIVIDE:
+        case BinaryOperator::REMAINDER:
+            // Both trap at run time, keep the instruction
+            if (b == 0 || (std::is_signed_v<T> && a == std::numeric_limits<T>::min() && b == static_cast<T>(-1))) {
+                return std::nullopt;
+            }
+            return op == BinaryOperator::DIVIDE ? a / b : a % b;
+        default:
+            return std::nullopt;
+        }
+    }
+}
+
+template<typename Target>
+std::optional<ConstantType> convert_to(const ConstantType& value)
+{
+    return std::visit([](auto v) -> std::optional<ConstantType> {
+        using T = decltype(v);
+        if constexpr (std::is_same_v<T, std::monostate>) {
+            return std::nullopt;
+        } else if constexpr (std::is_floating_point_v<T> && std::is_integral_v<Target>) {
+            // Undefined unless the truncated value fits in the target type
+            double truncated = std::trunc(v);
+            double low = static_cast<double>(std::numeric_limits<Target>::min());
+            double high = std::ldexp(1.0, std::numeric_limits<Target>::digits);
+            if (!(truncated >= low && truncated < high)) {
+                return std::nullopt;
+            }
+            return static_cast<Target>(v);
+        } else {
+            // Integer conversions are modular, integer to double rounds to nearest
+            return static_cast<Target>(v);
+        }
+    },
+        value);
+}
+
+}
+
+std::optional<ConstantType> tacky::convert_constant(const ConstantType& value, const Type& target_type)
+{
+    if (is_type<IntType>(target_type)) {
+        return convert_to<int>(value);
+    } else if (is_type<LongType>(target_type)) {
+        return convert_to<long>(value);
+    } else if (is_type<UnsignedIntType>(target_type)) {
+        return convert_to<unsigned int>(value);
+    } else if (is_type<UnsignedLongType>(target_type) || is_type<PointerType>(target_type)) {
+        return convert_to<unsigned long>(value);
+    } else if (is_type<DoubleType>(target_type)) {
+        return convert_to<double>(value);
+    } else if (is_type<CharType>(target_type) || is_type<SignedCharType>(target_type)) {
+        return convert_to<char>(value);
+    } else if (is_type<UnsignedCharType>(target_type)) {
+        return convert_to<unsigned char>(value);
+    }
+    return std::nullopt;
+}
+
+std::optional<ConstantType> tacky::evaluate_binary(BinaryOperator op, const ConstantType& a, const ConstantType& b)
+{
+    if (a.index() != b.index()) {
+        return std::nullopt;
+    }
+    return std::visit([&](auto x) -> std::optional<ConstantType> {
+        using T = decltype(x);
+        if constexpr (is_arithmetic_constant_v<T>) {
+            return apply_binary<T>(op, x, std::get<T>(b));
+        } else {
+            return std::nullopt;
+        }
+    },
+        a);
+}
+
+std::optional<ConstantType> tacky::evaluate_unary(UnaryOperator op, const ConstantType& value)
+{
+    return std::visit([&](auto x) -> std::optional<ConstantType> {
+        using T = decltype(x);
+        if constexpr (std::is_same_v<T, std::monostate>) {
+            return std::nullopt;
+        } else if (op == UnaryOperator::NOT) {
+            return static_cast<int>(x == 0);
+        } else if constexpr (!is_arithmetic_constant_v<T>) {
+            return std::nullopt;
+        } else if constexpr (std::is_floating_point_v<T>) {
+            if (op == UnaryOperator::NEGATE) {
+                return -x;
+            }
+            return std::nullopt;
+        } else {
+            using Unsigned = std::make_unsigned_t<T>;
+            if (op == UnaryOperator::NEGATE) {
+                return static_cast<T>(-static_cast<Unsigned>(x));
+            }
+            return static_cast<T>(~x);
+        }
+    },
+        value);
+}
+
+std::string tacky::constant_to_string(const ConstantType& value)
+{
+    return std::visit([](auto v) -> std::string {
+        if constexpr (std::is_same_v<decltype(v), std::monostate>) {
+            return "?";
+        } else {
+            return std::format("{}", v);
+        }
+    },
+        value);
+}
+
+ConstantFolding::ConstantFolding(std::shared_ptr<SymbolTable> symbol_table, std::shared_ptr<RemarkManager> remark_manager)
+    : m_symbol_table { symbol_table }
+    , m_remark_manager { remark_manager }
+{
+}
+
+bool ConstantFolding::run(FunctionDefinition& function)
+{
+    m_function_name = function.name.name;
+    bool changed = false;
+    std::vector<std::unique_ptr<Instruction>> instructions;
+    instructions.reserve(function.body.size());
+    for (auto& instruction : function.body) {
+        bool remove = false;
+        std::unique_ptr<Instruction> replacement = fold(*instruction, remove);
+        if (remove) {
+            changed = true;
+        } else if (replacement) {
+            replacement->source_location = instruction->source_location;
+            instructions.push_back(std::move(replacement));
+            changed = true;
+        } else {
+            instructions.push_back(std::move(instruction));
+        }
+    }
+    function.body = std::move(instructions);
+    return changed;
+}
+
+std::unique_ptr<Instruction> ConstantFolding::fold(Instruction& instruction, bool& remove)
+{
+    if (auto unary = dynamic_cast<UnaryInstruction*>(&instruction)) {
+        return fold_unary(*unary);
+    } else if (auto binary = dynamic_cast<BinaryInstruction*>(&instruction)) {
+        if (auto folded = fold_binary(*binary)) {
+            return folded;
+        }
+        return simplify_binary(*binary);
+    } else if (auto select = dynamic_cast<SelectInstruction*>(&instruction)) {
+        return fold_select(*select);
+    } else if (auto sign_extend = dynamic_cast<SignExtendInstruction*>(&instruction)) {
+        return fold_conversion(instruction, *sign_extend->source, *sign_extend->destination);
+    } else if (auto truncate = dynamic_cast<TruncateInstruction*>(&instruction)) {
+        return fold_conversion(instruction, *truncate->source, *truncate->destination);
+    } else if (auto zero_extend = dynamic_cast<ZeroExtendInstruction*>(&instruction)) {
+        return fold_conversion(instruction, *zero_extend->source, *zero_extend->destination);
+    } else if (auto double_to_int = dynamic_cast<DoubleToIntIntruction*>(&instruction)) {
+        return fold_conversion(instruction, *double_to_int->source, *double_to_int->destination);
+    } else if (auto double_to_uint = dynamic_cast<DoubleToUIntIntruction*>(&instruction)) {
+        return fold_conversion(instruction, *double_to_uint->source, *double_to_uint->destination);
+    } else if (auto int_to_double = dynamic_cast<IntToDoubleIntruction*>(&instruction)) {
+        return fold_conversion(instruction, *int_to_double->source, *int_to_double->destination);
+    } else if (auto uint_to_double = dynamic_cast<UIntToDoubleIntruction*>(&instruction)) {
+        return fold_conversion(instruction, *uint_to_double->source, *uint_to_double->destination);
+    } else if (auto add_pointer = dynamic_cast<AddPointerInstruction*>(&instruction)) {
+        // p + 0 is p, the induction variable pointers of loops starting at index 0 are set this way
+        if (auto index = as_constant(add_pointer->index); index && is_zero(index->value)) {
+            ++NumIdentitiesSimplified;
+            remark(RemarkKind::PASSED, instruction, "pointer plus 0 simplified to a copy");
+            return std::make_unique<CopyInstruction>(add_pointer->source_pointer->clone(), add_pointer->destination->clone());
+        }
+    } else if (auto jump_if_zero = dynamic_cast<JumpIfZeroInstruction*>(&instruction)) {
+        if (auto condition = as_constant(jump_if_zero->condition)) {
+            ++NumBranchesFolded;
+            if (is_zero(condition->value)) {
+                remark(RemarkKind::PASSED, instruction, "branch to {} on a constant is always taken, it became a jump", jump_if_zero->identifier.name);
+                return std::make_unique<JumpInstruction>(jump_if_zero->identifier.name);
+            }
+            remark(RemarkKind::PASSED, instruction, "branch to {} on a constant is never taken, it was removed", jump_if_zero->identifier.name);
+            remove = true;
+        }
+    } else if (auto jump_if_not_zero = dynamic_cast<JumpIfNotZeroInstruction*>(&instruction)) {
+        if (auto condition = as_constant(jump_if_not_zero->condition)) {
+            ++NumBranchesFolded;
+            if (!is_zero(condition->value)) {
+                remark(RemarkKind::PASSED, instruction, "branch to {} on a constant is always taken, it became a jump", jump_if_not_zero->identifier.name);
+                return std::make_unique<JumpInstruction>(jump_if_not_zero->identifier.name);
+            }
+            remark(RemarkKind::PASSED, instruction, "branch to {} on a constant is never taken, it was removed", jump_if_not_zero->identifier.name);
+            remove = true;
+        }
+    }
+    return nullptr;
+}
+
+std::unique_ptr<Instruction> ConstantFolding::fold_unary(UnaryInstruction& instruction)
+{
+    auto source = as_constant(instruction.source);
+    if (!source) {
+        return nullptr;
+    }
+    auto result = evaluate_unary(instruction.unary_operator, source->value);
+    if (!result) {
+        remark(RemarkKind::MISSED, instruction, "operation on {} not folded, its result is undefined", constant_to_string(source->value));
+        return nullptr;
+    }
+    ++NumInstructionsFolded;
+    remark(RemarkKind::PASSED, instruction, "operation on {} folded to {}", constant_to_string(source->value), constant_to_string(*result));
+    return std::make_unique<CopyInstruction>(std::make_unique<Constant>(*result), instruction.destination->clone());
+}
+
+std::unique_ptr<Instruction> ConstantFolding::fold_binary(BinaryInstruction& instruction)
+{
+    auto source1 = as_constant(instruction.source1);
+    auto source2 = as_constant(instruction.source2);
+    if (!source1 || !source2) {
+        return nullptr;
+    }
+    auto result = evaluate_binary(instruction.binary_operator, source1->value, source2->value);
+    if (!result) {
+        remark(RemarkKind::MISSED, instruction, "operation on {} and {} not folded, it traps or its result is undefined", constant_to_string(source1->value),
+            constant_to_string(source2->value));
+        return nullptr;
+    }
+    ++NumInstructionsFolded;
+    remark(RemarkKind::PASSED, instruction, "operation on {} and {} folded to {}", constant_to_string(source1->value), constant_to_string(source2->value),
+        constant_to_string(*result));
+    return std::make_unique<CopyInstruction>(std::make_unique<Constant>(*result), instruction.destination->clone());
+}
+
+std::unique_ptr<Instruction> ConstantFolding::simplify_binary(BinaryInstruction& instruction)
+{
+    auto constant1 = as_constant(instruction.source1);
+    auto constant2 = as_constant(instruction.source2);
+    auto variable1 = as_variable(instruction.source1);
+    auto variable2 = as_variable(instruction.source2);
+    bool same_variable = variable1 && variable2 && variable1->identifier.name == variable2->identifier.name;
+    // Floating point identities only hold for a few operations, x + 0.0 is not x when x is -0.0 and x * 0.0 is not
+    // 0.0 when x is NaN
+    bool integer_operands = (constant1 && is_integer(constant1->value)) || (constant2 && is_integer(constant2->value))
+        || (same_variable && !is_type<DoubleType>(type_of(*variable1)));
+
+    std::unique_ptr<Value> result;
+    switch (instruction.binary_operator) {
+    case BinaryOperator::ADD:
+        if (integer_operands && constant2 && is_zero(constant2->value)) {
+            result = instruction.source1->clone();
+        } else if (integer_operands && constant1 && is_zero(constant1->value)) {
+            result = instruction.source2->clone();
+        }
+        break;
+    case BinaryOperator::SUBTRACT:
+        if (constant2 && is_zero(constant2->value) && (integer_operands || !std::signbit(std::get<double>(constant2->value)))) {
+            result = instruction.source1->clone();
+        } else if (same_variable && integer_operands) {
+            auto zero = convert_constant(0, type_of(*instruction.destination));
+            if (zero) {
+                result = std::make_unique<Constant>(*zero);
+            }
+        }
+        break;
+    case BinaryOperator::MULTIPLY:
+        if (constant2 && is_one(constant2->value)) {
+            result = instruction.source1->clone();
+        } else if (constant1 && is_one(constant1->value)) {
+            result = instruction.source2->clone();
+        } else if (integer_operands && constant2 && is_zero(constant2->value)) {
+            result = constant2->clone();
+        } else if (integer_operands && constant1 && is_zero(constant1->value)) {
+            result = constant1->clone();
+        }
+        break;
+    case BinaryOperator::DIVIDE:
+        if (constant2 && is_one(constant2->value)) {
+            result = instruction.source1->clone();
+        }
+        break;
+    case BinaryOperator::REMAINDER:
+        if (constant2 && is_one(constant2->value)) {
+            result = std::make_unique<Constant>(zero_like(constant2->value));
+        }
+        break;
+    case BinaryOperator::EQUAL:
+    case BinaryOperator::LESS_OR_EQUAL:
+    case BinaryOperator::GREATER_OR_EQUAL:
+        if (same_variable && integer_operands) {
+            result = std::make_unique<Constant>(1);
+        }
+        break;
+    case BinaryOperator::NOT_EQUAL:
+    case BinaryOperator::LESS_THAN:
+    case BinaryOperator::GREATER_THAN:
+        if (same_variable && integer_operands) {
+            result = std::make_unique<Constant>(0);
+        }
+        break;
+    }
+
+    if (!result) {
+        return nullptr;
+    }
+    ++NumIdentitiesSimplified;
+    remark(RemarkKind::PASSED, instruction, "algebraic identity simplified to a copy");
+    return std::make_unique<CopyInstruction>(std::move(result), instruction.destination->clone());
+}
+
+std::unique_ptr<Instruction> ConstantFolding::fold_select(SelectInstruction& instruction)
+{
+    if (auto condition = as_constant(instruction.condition)) {
+        ++NumInstructionsFolded;
+        remark(RemarkKind::PASSED, instruction, "select on a constant folded to a copy");
+        auto& chosen = is_zero(condition->value) ? instruction.false_value : instruction.true_value;
+        return std::make_unique<CopyInstruction>(chosen->clone(), instruction.destination->clone());
+    }
+    auto variable1 = as_variable(instruction.true_value);
+    auto variable2 = as_variable(instruction.false_value);
+    if (variable1 && variable2 && variable1->identifier.name == variable2->identifier.name) {
+        ++NumIdentitiesSimplified;
+        remark(RemarkKind::PASSED, instruction, "select between the same values simplified to a copy");
+        return std::make_unique<CopyInstruction>(instruction.true_value->clone(), instruction.destination->clone());
+    }
+    return nullptr;
+}
+
+std::unique_ptr<Instruction> ConstantFolding::fold_conversion(const Instruction& instruction, Value& source, Value& destination)
+{
+    auto constant = dynamic_cast<Constant*>(&source);
+    if (!constant) {
+        return nullptr;
+    }
+    auto result = convert_constant(constant->value, type_of(destination));
+    if (!result) {
+        remark(RemarkKind::MISSED, instruction, "conversion of {} not folded, it is out of the range of the destination type", constant_to_string(constant->value));
+        return nullptr;
+    }
+    ++NumInstructionsFolded;
+    remark(RemarkKind::PASSED, instruction, "conversion of {} folded to {}", constant_to_string(constant->value), constant_to_string(*result));
+    return std::make_unique<CopyInstruction>(std::make_unique<Constant>(*result), destination.clone());
+}
+
+const Type& ConstantFolding::type_of(const Value& value) const
+{
+    auto variable = dynamic_cast<const TemporaryVariable*>(&value);
+    if (!variable || !m_symbol_table->contains_symbol(variable->identifier.name)) {
+        throw InternalCompilerError("ConstantFolding: destination is not a variable in the symbol table");
+    }
+    return *m_symbol_table->symbol_at(variable->identifier.name).type;
+}
@@ -0,0 +1,204 @@
+#include "tacky/control_flow_graph.h"
+#include "common/error/internal_compiler_error.h"
+#include <algorithm>
+#include <format>
+#include <limits>
+#include <unordered_map>
+
+using namespace tacky;
+
+ControlFlowGraph::ControlFlowGraph(FunctionDefinition& function)
+{
+    // Partition the body, a label starts a block and a jump or a return ends it
+    bool block_ended = true;
+    for (auto& instruction : function.body) {
+        if (dynamic_cast<LabelInstruction*>(instruction.get()) || block_ended) {
+            if (m_blocks.empty() || !m_blocks.back().instructions.empty()) {
+                m_blocks.emplace_back();
+            }
+        }
+        bool ends_block = jump_target(*instruction) || dynamic_cast<ReturnInstruction*>(instruction.get());
+        m_blocks.back().instructions.push_back(std::move(instruction));
+        block_ended = ends_block;
+    }
+    function.body.clear();
+
+    std::unordered_map<std::string, size_t> label_blocks;
+    for (size_t b = 0; b < m_blocks.size(); ++b) {
+        if (auto label = dynamic_cast<LabelInstruction*>(m_blocks[b].instructions.front().get())) {
+            label_blocks.emplace(label->identifier.name, b);
+        }
+    }
+
+    auto add_edge = [&](size_t from, size_t to) {
+        auto& successors = m_blocks[from].successors;
+        if (std::ranges::find(successors, to) != successors.end()) {
+            return;
+        }
+        successors.push_back(to);
+        if (to != EXIT) {
+            m_blocks[to].predecessors.push_back(from);
+        }
+    };
+
+    if (!m_blocks.empty()) {
+        m_blocks[0].predecessors.push_back(ENTRY);
+    }
+    for (size_t b = 0; b < m_blocks.size(); ++b) {
+        const Instruction& last = *m_blocks[b].instructions.back();
+        size_t next = b + 1 < m_blocks.size() ? b + 1 : EXIT;
+        if (dynamic_cast<const ReturnInstruction*>(&last)) {
+            add_edge(b, EXIT);
+            continue;
+        }
+        if (auto target = jump_target(last)) {
+            auto it = label_blocks.find(*target);
+            if (it == label_blocks.end()) {
+                throw InternalCompilerError("ControlFlowGraph: jump to unknown label " + *target);
+            }
+            add_edge(b, it->second);
+            if (dynamic_cast<const JumpInstruction*>(&last)) {
+                continue;
+            }
+        }
+        add_edge(b, next);
+    }
+}
+
+std::vector<bool> ControlFlowGraph::reachable_blocks() const
+{
+    std::vector<bool> reachable(m_blocks.size(), false);
+    std::vector<size_t> worklist;
+    if (!m_blocks.empty()) {
+        reachable[0] = true;
+        worklist.push_back(0);
+    }
+    while (!worklist.empty()) {
+        size_t block = worklist.back();
+        worklist.pop_back();
+        for (size_t successor : m_blocks[block].successors) {
+            if (successor != EXIT && !reachable[successor]) {
+                reachable[successor] = true;
+                worklist.push_back(successor);
+            }
+        }
+    }
+    return reachable;
+}
+
+std::vector<size_t> ControlFlowGraph::reverse_postorder() const
+{
+    std::vector<size_t> order;
+    if (m_blocks.empty()) {
+        return order;
+    }
+    // Iterative depth first search, each entry is a block and the index of the next successor to visit
+    std::vector<bool> visited(m_blocks.size(), false);
+    std::vector<std::pair<size_t, size_t>> stack { { 0, 0 } };
+    visited[0] = true;
+    while (!stack.empty()) {
+        auto& [block, next] = stack.back();
+        const auto& successors = m_blocks[block].successors;
+        if (next < successors.size()) {
+            size_t successor = successors[next++];
+            if (successor != EXIT && !visited[successor]) {
+                visited[successor] = true;
+                stack.emplace_back(successor, 0);
+            }
+        } else {
+            order.push_back(block);
+            stack.pop_back();
+        }
+    }
+    std::ranges::reverse(order);
+    return order;
+}
+
+std::vector<size_t> ControlFlowGraph::immediate_dominators() const
+{
+    // Cooper, Harvey and Kennedy, "A Simple, Fast Dominance Algorithm"
+    constexpr size_t NONE = std::numeric_limits<size_t>::max();
+    std::vector<size_t> order = reverse_postorder();
+    std::vector<size_t> position(m_blocks.size(), NONE);
+    for (size_t i = 0; i < order.size(); ++i) {
+        position[order[i]] = i;
+    }
+
+    std::vector<size_t> dominators(m_blocks.size(), NONE);
+    if (!order.empty()) {
+        dominators[order[0]] = order[0];
+    }
+    auto intersect = [&](size_t a, size_t b) {
+        while (a != b) {
+            while (position[a] > position[b]) {
+                a = dominators[a];
+            }
+            while (position[b] > position[a]) {
+                b = dominators[b];
+            }
+        }
+        return a;
+    };
+
+    bool changed = true;
+    while (changed) {
+        changed = false;
+        for (size_t i = 1; i < order.size(); ++i) {
+            size_t block = order[i];
+            size_t new_dominator = NONE;
+            for (size_t predecessor : m_blocks[block].predecessors) {
+                if (predecessor == ENTRY || dominators[predecessor] == NONE) {
+                    continue;
+                }
+                new_dominator = new_dominator == NONE ? predecessor : intersect(predecessor, new_dominator);
+            }
+            if (dominators[block] != new_dominator) {
+                dominators[block] = new_dominator;
+                changed = true;
+            }
+        }
+    }
+
+    std::vector<size_t> immediate_dominators(m_blocks.size(), ENTRY);
+    for (size_t i = 1; i < order.size(); ++i) {
+        immediate_dominators[order[i]] = dominators[order[i]];
+    }
+    return immediate_dominators;
+}
+
+void ControlFlowGraph::write_back(FunctionDefinition& function)
+{
+    function.body.clear();
+    for (auto& block : m_blocks) {
+        for (auto& instruction : block.instructions) {
+            function.body.push_back(std::move(instruction));
+        }
+        block.instructions.clear();
+    }
+}
+
+std::optional<std::string> ControlFlowGraph::jump_target(const Instruction& instruction)
+{
+    if (auto jump = dynamic_cast<const JumpInstruction*>(&instruction)) {
+        return jump->identifier.name;
+    } else if (auto jump_if_zero = dynamic_cast<const JumpIfZeroInstruction*>(&instruction)) {
+        return jump_if_zero->identifier.name;
+    } else if (auto jump_if_not_zero = dynamic_cast<const JumpIfNotZeroInstruction*>(&instruction)) {
+        return jump_if_not_zero->identifier.name;
+    }
+    return std::nullopt;
+}
+
+void tacky::remark_block_removed(const std::shared_ptr<RemarkManager>& remark_manager, const std::string& pass_name, const std::string& function_name,
+    const ControlFlowGraph::BasicBlock& block, const std::string& reason)
+{
+    if (!remark_manager || !remark_manager->is_enabled() || block.instructions.empty()) {
+        return;
+    }
+    auto located = std::ranges::find_if(block.instructions, [](const auto& instruction) { return instruction->source_location.has_value(); });
+    std::optional<SourceLocationIndex> location = located != block.instructions.end() ? (*located)->source_location : std::nullopt;
+    auto label = dynamic_cast<const LabelInstruction*>(block.instructions.front().get());
+    size_t count = block.instructions.size() - (label ? 1 : 0);
+    remark_manager->emit(RemarkKind::PASSED, pass_name, function_name, location,
+        std::format("{} of {} instructions removed, {}", label ? std::format("block {}", label->identifier.name) : std::string("block"), count, reason));
+}
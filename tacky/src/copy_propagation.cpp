@@ -0,0 +1,340 @@
+#include "tacky/copy_propagation.h"
+#include "common/stats/statistic.h"
+#include "tacky/bit_set.h"
+#include "tacky/constant_folding.h"
+#include "tacky/control_flow_graph.h"
+#include "tacky/use_def.h"
+#include <deque>
+#include <format>
+#include <optional>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+using namespace tacky;
+
+STATISTIC(NumUsesReplaced, "copy-propagation", "Number of variable uses replaced by the copied value");
+STATISTIC(NumCopiesRemoved, "copy-propagation", "Number of redundant copies removed");
+
+namespace {
+
+bool same_variable(const Value& a, const Value& b)
+{
+    auto variable_a = dynamic_cast<const TemporaryVariable*>(&a);
+    auto variable_b = dynamic_cast<const TemporaryVariable*>(&b);
+    return variable_a && variable_b && variable_a->identifier.name == variable_b->identifier.name;
+}
+
+// Identifies a copy by its destination and its source, constants of different types or bit patterns (0.0 and -0.0)
+// are different sources
+std::string copy_key(const std::string& destination, const Value& source)
+{
+    if (auto variable = dynamic_cast<const TemporaryVariable*>(&source)) {
+        return std::format("{}={}", destination, variable->identifier.name);
+    }
+    const ConstantType& value = dynamic_cast<const Constant&>(source).value;
+    return std::visit([&](auto v) {
+        if constexpr (std::is_same_v<decltype(v), std::monostate>) {
+            return std::format("{}=$", destination);
+        } else {
+            return std::format("{}=${}:{}", destination, value.index(), +v);
+        }
+    },
+        value);
+}
+
+// The copies of a function, numbered so that a set of them is a BitSet. Two copy instructions of the same value into
+// the same variable share their number, so the copy survives the meet of paths that both perform it
+class ReachingCopies {
+public:
+    struct CopyFact {
+        std::string destination;
+        std::unique_ptr<Value> source;
+    };
+
+    // Numbers of a copy instruction, the copy itself and the opposite copy (source = destination)
+    struct CopyIds {
+        std::optional<size_t> id;
+        std::optional<size_t> reverse_id;
+    };
+
+    ReachingCopies(ControlFlowGraph& cfg, const SymbolTable& symbol_table, const std::unordered_set<std::string>& aliased)
+        : m_cfg { cfg }
+    {
+        std::vector<CopyInstruction*> copies;
+        for (auto& block : cfg.blocks()) {
+            for (auto& instruction : block.instructions) {
+                auto copy = dynamic_cast<CopyInstruction*>(instruction.get());
+                if (copy && is_candidate(*copy, symbol_table)) {
+                    copies.push_back(copy);
+                    m_copy_ids[copy].id = find_or_add(variable(*copy->destination), *copy->source);
+                }
+            }
+        }
+        for (CopyInstruction* copy : copies) {
+            if (auto source = dynamic_cast<TemporaryVariable*>(copy->source.get())) {
+                m_copy_ids[copy].reverse_id = find(source->identifier.name, *copy->destination);
+            }
+        }
+
+        m_aliased_copies = BitSet(m_copies.size());
+        for (size_t id = 0; id < m_copies.size(); ++id) {
+            const CopyFact& copy = m_copies[id];
+            m_copies_involving[copy.destination].push_back(id);
+            auto source = dynamic_cast<const TemporaryVariable*>(copy.source.get());
+            if (source) {
+                m_copies_involving[source->identifier.name].push_back(id);
+            }
+            if (aliased.contains(copy.destination) || (source && aliased.contains(source->identifier.name))) {
+                m_aliased_copies.set(id);
+            }
+        }
+    }
+
+
+    // Copy into the variable that belongs to the set
+    std::optional<size_t> reaching_copy(const std::string& destination, const BitSet& copies) const
+    {
+        auto it = m_copies_by_destination.find(destination);
+        if (it != m_copies_by_destination.end()) {
+            for (size_t id : it->second) {
+                if (copies.test(id)) {
+                    return id;
+                }
+            }
+        }
+        return std::nullopt;
+    }
+
+    // Value the variable holds according to the copies, following chains of copies (y = x after x = 5 gives 5)
+    const Value* resolve(const std::string& variable, const BitSet& copies) const
+    {
+        const Value* value = nullptr;
+        std::string current = variable;
+        // A copy kills the copies out of its destination, so the chain has no cycle and at most one link per copy
+        for (size_t links = 0; links < m_copies.size(); ++links) {
+            auto id = reaching_copy(current, copies);
+            if (!id) {
+                break;
+            }
+            value = m_copies[*id].source.get();
+            auto source = dynamic_cast<const TemporaryVariable*>(value);
+            if (!source) {
+                break;
+            }
+            current = source->identifier.name;
+        }
+        return value;
+    }
+
+    // True if the instruction copies a value its destination already holds
+    bool is_redundant(const Instruction& instruction, const BitSet& copies) const
+    {
+        auto copy = dynamic_cast<const CopyInstruction*>(&instruction);
+        if (!copy) {
+            return false;
+        }
+        if (same_variable(*copy->source, *copy->destination)) {
+            return true;
+        }
+        auto it = m_copy_ids.find(copy);
+        if (it == m_copy_ids.end()) {
+            return false;
+        }
+        const CopyIds& ids = it->second;
+        return (ids.id && copies.test(*ids.id)) || (ids.reverse_id && copies.test(*ids.reverse_id));
+    }
+
+    void transfer(const Instruction& instruction, BitSet& copies) const
+    {
+        if (is_redundant(instruction, copies)) {
+            return;
+        }
+        if (dynamic_cast<const FunctionCallInstruction*>(&instruction) || dynamic_cast<const StoreInstruction*>(&instruction)) {
+            copies.subtract(m_aliased_copies);
+        }
+        if (auto destination = defined_variable(instruction)) {
+            auto it = m_copies_involving.find(*destination);
+            if (it != m_copies_involving.end()) {
+                for (size_t id : it->second) {
+                    copies.reset(id);
+                }
+            }
+        }
+        if (auto copy = dynamic_cast<const CopyInstruction*>(&instruction)) {
+            auto it = m_copy_ids.find(copy);
+            if (it != m_copy_ids.end()) {
+                copies.set(*it->second.id);
+            }
+        }
+    }
+
+    // Copies reaching the start of a block
+    BitSet block_input(size_t block, const std::vector<BitSet>& outputs) const
+    {
+        const auto& predecessors = m_cfg.blocks()[block].predecessors;
+        if (predecessors.empty()) {
+            return BitSet(m_copies.size());
+        }
+        BitSet input(m_copies.size(), true);
+        for (size_t predecessor : predecessors) {
+            if (predecessor == ControlFlowGraph::ENTRY) {
+                return BitSet(m_copies.size());
+            }
+            input.intersect_with(outputs[predecessor]);
+        }
+        return input;
+    }
+
+    // Copies reaching the end of every block
+    std::vector<BitSet> solve() const
+    {
+        const auto& blocks = m_cfg.blocks();
+        std::vector<BitSet> outputs(blocks.size(), BitSet(m_copies.size(), true));
+        std::deque<size_t> worklist;
+        std::vector<bool> queued(blocks.size(), true);
+        for (size_t b = 0; b < blocks.size(); ++b) {
+            worklist.push_back(b);
+        }
+        while (!worklist.empty()) {
+            size_t b = worklist.front();
+            worklist.pop_front();
+            queued[b] = false;
+
+            BitSet copies = block_input(b, outputs);
+            for (const auto& instruction : blocks[b].instructions) {
+                transfer(*instruction, copies);
+            }
+            if (copies == outputs[b]) {
+                continue;
+            }
+            outputs[b] = std::move(copies);
+            for (size_t successor : blocks[b].successors) {
+                if (successor != ControlFlowGraph::EXIT && !queued[successor]) {
+                    queued[successor] = true;
+                    worklist.push_back(successor);
+                }
+            }
+        }
+        return outputs;
+    }
+
+private:
+    static const std::string& variable(const Value& value)
+    {
+        return dynamic_cast<const TemporaryVariable&>(value).identifier.name;
+    }
+
+    // Only copies into a scalar variable of a value with the same representation can replace the variable
+    static bool is_candidate(const CopyInstruction& copy, const SymbolTable& symbol_table)
+    {
+        auto destination = dynamic_cast<const TemporaryVariable*>(copy.destination.get());
+        if (!destination) {
+            return false;
+        }
+        const Type& destination_type = *symbol_table.symbol_at(destination->identifier.name).type;
+        if (!destination_type.is_scalar()) {
+            return false;
+        }
+        auto source = dynamic_cast<const TemporaryVariable*>(copy.source.get());
+        if (!source) {
+            return true;
+        }
+        const Type& source_type = *symbol_table.symbol_at(source->identifier.name).type;
+        return source_type.equals(destination_type) || (is_type<PointerType>(source_type) && is_type<PointerType>(destination_type));
+    }
+
+    std::optional<size_t> find(const std::string& destination, const Value& source) const
+    {
+        auto it = m_copy_by_key.find(copy_key(destination, source));
+        if (it != m_copy_by_key.end()) {
+            return it->second;
+        }
+        return std::nullopt;
+    }
+
+    size_t find_or_add(const std::string& destination, Value& source)
+    {
+        auto [it, inserted] = m_copy_by_key.emplace(copy_key(destination, source), m_copies.size());
+        if (inserted) {
+            m_copies.push_back({ destination, source.clone() });
+            m_copies_by_destination[destination].push_back(it->second);
+        }
+        return it->second;
+    }
+
+    ControlFlowGraph& m_cfg;
+    std::vector<CopyFact> m_copies;
+    std::unordered_map<std::string, size_t> m_copy_by_key;
+    std::unordered_map<const CopyInstruction*, CopyIds> m_copy_ids;
+    std::unordered_map<std::string, std::vector<size_t>> m_copies_by_destination;
+    // Copies a write to the variable kills, those into it and those out of it
+    std::unordered_map<std::string, std::vector<size_t>> m_copies_involving;
+    BitSet m_aliased_copies;
+};
+
+}
+
+CopyPropagation::CopyPropagation(std::shared_ptr<SymbolTable> symbol_table)
+    : m_symbol_table { symbol_table }
+{
+}
+
+bool CopyPropagation::run(FunctionDefinition& function)
+{
+    std::unordered_set<std::string> aliased = aliased_variables(function, *m_symbol_table);
+    ControlFlowGraph cfg(function);
+    ReachingCopies reaching_copies(cfg, *m_symbol_table, aliased);
+    std::vector<BitSet> outputs = reaching_copies.solve();
+
+    bool changed = false;
+    auto& blocks = cfg.blocks();
+    for (size_t b = 0; b < blocks.size(); ++b) {
+        BitSet copies = reaching_copies.block_input(b, outputs);
+        std::vector<std::unique_ptr<Instruction>> instructions;
+        for (auto& instruction : blocks[b].instructions) {
+            if (reaching_copies.is_redundant(*instruction, copies)) {
+                ++NumCopiesRemoved;
+                changed = true;
+                continue;
+            }
+
+            // Replacements are chosen with the copies reaching the instruction, the transfer still sees the
+            // instruction as the analysis did
+            std::vector<std::pair<std::unique_ptr<Value>*, std::unique_ptr<Value>>> replacements;
+            for (auto slot : used_values(*instruction)) {
+                auto variable = dynamic_cast<TemporaryVariable*>(slot->get());
+                if (!variable) {
+                    continue;
+                }
+                const Value* source = reaching_copies.resolve(variable->identifier.name, copies);
+                if (!source) {
+                    continue;
+                }
+                if (auto constant = dynamic_cast<const Constant*>(source)) {
+                    // The constant takes the type of the variable it replaces, an int copied into an unsigned int
+                    // must still compare as unsigned
+                    auto value = convert_constant(constant->value, *m_symbol_table->symbol_at(variable->identifier.name).type);
+                    if (value) {
+                        replacements.emplace_back(slot, std::make_unique<Constant>(*value));
+                    }
+                } else {
+                    replacements.emplace_back(slot, std::make_unique<TemporaryVariable>(dynamic_cast<const TemporaryVariable&>(*source).identifier.name));
+                }
+            }
+
+            reaching_copies.transfer(*instruction, copies);
+            for (auto& [slot, value] : replacements) {
+                *slot = std::move(value);
+                ++NumUsesReplaced;
+                changed = true;
+            }
+            instructions.push_back(std::move(instruction));
+        }
+        blocks[b].instructions = std::move(instructions);
+    }
+
+    cfg.write_back(function);
+    return changed;
+}
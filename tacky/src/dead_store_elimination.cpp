@@ -0,0 +1,165 @@
+#include "tacky/dead_store_elimination.h"
+#include "common/stats/statistic.h"
+#include "tacky/bit_set.h"
+#include "tacky/control_flow_graph.h"
+#include "tacky/use_def.h"
+#include <deque>
+#include <optional>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+using namespace tacky;
+
+STATISTIC(NumDeadStoresRemoved, "dead-store", "Number of instructions removed because their result is never read");
+
+namespace {
+
+// Liveness of the variables only this function can access, the only ones whose writes can be removed
+class LiveVariables {
+public:
+    LiveVariables(ControlFlowGraph& cfg, const std::unordered_set<std::string>& aliased)
+        : m_cfg { cfg }
+    {
+        for (auto& block : cfg.blocks()) {
+            for (auto& instruction : block.instructions) {
+                if (auto destination = defined_variable(*instruction)) {
+                    add(*destination, aliased);
+                }
+                for (auto value : used_values(*instruction)) {
+                    if (auto variable = dynamic_cast<TemporaryVariable*>(value->get())) {
+                        add(variable->identifier.name, aliased);
+                    }
+                }
+            }
+        }
+    }
+
+    size_t size() const { return m_index.size(); }
+
+    std::optional<size_t> index(const std::string& variable) const
+    {
+        auto it = m_index.find(variable);
+        if (it != m_index.end()) {
+            return it->second;
+        }
+        return std::nullopt;
+    }
+
+    void transfer(Instruction& instruction, BitSet& live) const
+    {
+        if (auto destination = defined_variable(instruction)) {
+            // A write to part of an array leaves the rest of it live
+            if (auto i = index(*destination); i && !dynamic_cast<CopyToOffsetInstruction*>(&instruction)) {
+                live.reset(*i);
+            }
+        }
+        for (auto value : used_values(instruction)) {
+            if (auto variable = dynamic_cast<TemporaryVariable*>(value->get())) {
+                if (auto i = index(variable->identifier.name)) {
+                    live.set(*i);
+                }
+            }
+        }
+    }
+
+    // Variables live at the end of a block, none of them outlives the function
+    BitSet block_output(size_t block, const std::vector<BitSet>& inputs) const
+    {
+        BitSet live(size());
+        for (size_t successor : m_cfg.blocks()[block].successors) {
+            if (successor != ControlFlowGraph::EXIT) {
+                live.union_with(inputs[successor]);
+            }
+        }
+        return live;
+    }
+
+    // Variables live at the start of every block
+    std::vector<BitSet> solve() const
+    {
+        const auto& blocks = m_cfg.blocks();
+        std::vector<BitSet> inputs(blocks.size(), BitSet(size()));
+        std::deque<size_t> worklist;
+        std::vector<bool> queued(blocks.size(), true);
+        for (size_t b = blocks.size(); b-- > 0;) {
+            worklist.push_back(b);
+        }
+        while (!worklist.empty()) {
+            size_t b = worklist.front();
+            worklist.pop_front();
+            queued[b] = false;
+
+            BitSet live = block_output(b, inputs);
+            for (auto it = blocks[b].instructions.rbegin(); it != blocks[b].instructions.rend(); ++it) {
+                transfer(**it, live);
+            }
+            if (live == inputs[b]) {
+                continue;
+            }
+            inputs[b] = std::move(live);
+            for (size_t predecessor : blocks[b].predecessors) {
+                if (predecessor != ControlFlowGraph::ENTRY && !queued[predecessor]) {
+                    queued[predecessor] = true;
+                    worklist.push_back(predecessor);
+                }
+            }
+        }
+        return inputs;
+    }
+
+private:
+    void add(const std::string& variable, const std::unordered_set<std::string>& aliased)
+    {
+        if (!aliased.contains(variable)) {
+            m_index.emplace(variable, m_index.size());
+        }
+    }
+
+    ControlFlowGraph& m_cfg;
+    std::unordered_map<std::string, size_t> m_index;
+};
+
+bool has_side_effects(const Instruction& instruction)
+{
+    return dynamic_cast<const FunctionCallInstruction*>(&instruction) || dynamic_cast<const StoreInstruction*>(&instruction)
+        || dynamic_cast<const CopyToOffsetInstruction*>(&instruction);
+}
+
+}
+
+DeadStoreElimination::DeadStoreElimination(std::shared_ptr<SymbolTable> symbol_table)
+    : m_symbol_table { symbol_table }
+{
+}
+
+bool DeadStoreElimination::run(FunctionDefinition& function)
+{
+    std::unordered_set<std::string> aliased = aliased_variables(function, *m_symbol_table);
+    ControlFlowGraph cfg(function);
+    LiveVariables live_variables(cfg, aliased);
+    std::vector<BitSet> inputs = live_variables.solve();
+
+    bool changed = false;
+    auto& blocks = cfg.blocks();
+    for (size_t b = 0; b < blocks.size(); ++b) {
+        BitSet live = live_variables.block_output(b, inputs);
+        auto& instructions = blocks[b].instructions;
+        for (size_t i = instructions.size(); i-- > 0;) {
+            auto destination = defined_variable(*instructions[i]);
+            auto index = destination ? live_variables.index(*destination) : std::nullopt;
+            if (index && !live.test(*index) && !has_side_effects(*instructions[i])) {
+                instructions[i].reset();
+                ++NumDeadStoresRemoved;
+                changed = true;
+                continue;
+            }
+            live_variables.transfer(*instructions[i], live);
+        }
+        std::erase(instructions, nullptr);
+    }
+
+    cfg.write_back(function);
+    return changed;
+}
@@ -0,0 +1,286 @@
+#include "tacky/global_value_numbering.h"
+#include "common/stats/statistic.h"
+#include "tacky/use_def.h"
+#include <algorithm>
+#include <bit>
+#include <cstdint>
+#include <format>
+#include <optional>
+#include <unordered_map>
+#include <variant>
+
+using namespace tacky;
+
+STATISTIC(NumRedundantInstructions, "gvn", "Number of pure instructions replaced by a dominating instruction computing the same value");
+STATISTIC(NumRedundantLoads, "gvn", "Number of loads replaced by an earlier load of the same address");
+
+namespace {
+
+const TemporaryVariable* as_variable(const std::unique_ptr<Value>& value)
+{
+    return dynamic_cast<const TemporaryVariable*>(value.get());
+}
+
+std::string constant_key(const ConstantType& value)
+{
+    return std::visit([&](auto v) {
+        using T = decltype(v);
+        if constexpr (std::is_same_v<T, std::monostate>) {
+            return std::string("#");
+        } else if constexpr (std::is_same_v<T, double>) {
+            // By representation, 0.0 and -0.0 are different values
+            return std::format("#{}:{}", value.index(), std::bit_cast<uint64_t>(v));
+        } else if constexpr (std::is_signed_v<T>) {
+            return std::format("#{}:{}", value.index(), static_cast<long long>(v));
+        } else {
+            return std::format("#{}:{}", value.index(), static_cast<unsigned long long>(v));
+        }
+    },
+        value);
+}
+
+bool is_commutative(BinaryOperator op)
+{
+    return op == BinaryOperator::ADD || op == BinaryOperator::MULTIPLY || op == BinaryOperator::EQUAL || op == BinaryOperator::NOT_EQUAL;
+}
+
+class Numbering {
+public:
+    Numbering(SsaForm& ssa, const SymbolTable& symbol_table)
+        : m_ssa { ssa }
+        , m_symbol_table { symbol_table }
+    {
+    }
+
+    bool run()
+    {
+        auto& blocks = m_ssa.cfg().blocks();
+        if (blocks.empty()) {
+            return false;
+        }
+
+        // Explicit stack over the dominator tree, a block is visited when entering it and when leaving it, which
+        // takes its expressions out of scope
+        struct Visit {
+            size_t block;
+            bool leaving;
+        };
+        std::vector<Visit> visits { { 0, false } };
+        std::vector<std::vector<std::string>> scoped_keys(blocks.size());
+        while (!visits.empty()) {
+            Visit visit = visits.back();
+            visits.pop_back();
+            size_t block = visit.block;
+            if (visit.leaving) {
+                for (const auto& key : scoped_keys[block]) {
+                    m_leaders.erase(key);
+                }
+                continue;
+            }
+
+            number_block(block, scoped_keys[block]);
+            for (size_t successor : blocks[block].successors) {
+                if (successor == ControlFlowGraph::EXIT) {
+                    continue;
+                }
+                const auto& predecessors = blocks[successor].predecessors;
+                size_t index = std::ranges::find(predecessors, block) - predecessors.begin();
+                for (auto& phi : m_ssa.phis(successor)) {
+                    replace_operand(phi.arguments[index]);
+                }
+            }
+
+            visits.push_back({ block, true });
+            for (size_t child : m_ssa.dominator_tree()[block]) {
+                visits.push_back({ child, false });
+            }
+        }
+        return m_changed;
+    }
+
+private:
+    void number_block(size_t block, std::vector<std::string>& scoped_keys)
+    {
+        // Loads of the block by address, forgotten whenever memory may change
+        std::unordered_map<std::string, std::string> loads;
+        for (auto& instruction : m_ssa.cfg().blocks()[block].instructions) {
+            for (auto slot : used_values(*instruction)) {
+                replace_operand(*slot);
+            }
+            if (dynamic_cast<StoreInstruction*>(instruction.get()) || dynamic_cast<FunctionCallInstruction*>(instruction.get())
+                || dynamic_cast<CopyToOffsetInstruction*>(instruction.get())) {
+                loads.clear();
+            }
+
+            auto slot = defined_value(*instruction);
+            auto destination = slot ? as_variable(*slot) : nullptr;
+            if (!destination) {
+                continue;
+            }
+            const std::string& name = destination->identifier.name;
+            if (!m_ssa.is_ssa_variable(name)) {
+                // May be read through a pointer
+                loads.clear();
+                continue;
+            }
+
+            if (auto copy = dynamic_cast<CopyInstruction*>(instruction.get())) {
+                auto source = as_variable(copy->source);
+                if (source && m_ssa.is_ssa_value(source->identifier.name) && type_of(source->identifier.name).equals(type_of(name))) {
+                    m_replacements.emplace(name, source->identifier.name);
+                }
+                continue;
+            }
+            if (auto load = dynamic_cast<LoadInstruction*>(instruction.get())) {
+                auto pointer = value_key(load->source_pointer);
+                if (!pointer) {
+                    continue;
+                }
+                auto [it, inserted] = loads.emplace(std::format("{}:{}", *pointer, type_of(name).to_string()), name);
+                if (!inserted) {
+                    replace_with_copy(instruction, it->second, name);
+                    ++NumRedundantLoads;
+                }
+                continue;
+            }
+
+            auto key = expression_key(*instruction, name);
+            if (!key) {
+                continue;
+            }
+            auto [it, inserted] = m_leaders.emplace(*key, name);
+            if (inserted) {
+                scoped_keys.push_back(*key);
+            } else {
+                replace_with_copy(instruction, it->second, name);
+                ++NumRedundantInstructions;
+            }
+        }
+    }
+
+    void replace_with_copy(std::unique_ptr<Instruction>& instruction, const std::string& leader, const std::string& destination)
+    {
+        auto copy = std::make_unique<CopyInstruction>(std::make_unique<TemporaryVariable>(leader), std::make_unique<TemporaryVariable>(destination));
+        copy->source_location = instruction->source_location;
+        // The destination name may belong to the instruction being replaced, record it while it is alive
+        m_replacements.emplace(destination, leader);
+        instruction = std::move(copy);
+        m_changed = true;
+    }
+
+    void replace_operand(std::unique_ptr<Value>& value)
+    {
+        auto variable = as_variable(value);
+        if (!variable) {
+            return;
+        }
+        auto it = m_replacements.find(variable->identifier.name);
+        if (it != m_replacements.end()) {
+            value = std::make_unique<TemporaryVariable>(it->second);
+            m_changed = true;
+        }
+    }
+
+    // Name of the value, nothing if it can change between two reads
+    std::optional<std::string> value_key(const std::unique_ptr<Value>& value) const
+    {
+        if (auto constant = dynamic_cast<const Constant*>(value.get())) {
+            return constant_key(constant->value);
+        }
+        auto variable = as_variable(value);
+        if (variable && m_ssa.is_ssa_value(variable->identifier.name)) {
+            return variable->identifier.name;
+        }
+        return std::nullopt;
+    }
+
+    std::optional<std::string> conversion_key(const char* kind, const std::unique_ptr<Value>& source, const std::string& destination) const
+    {
+        auto operand = value_key(source);
+        if (!operand) {
+            return std::nullopt;
+        }
+        return std::format("{}:{}:{}", kind, *operand, type_of(destination).to_string());
+    }
+
+    // Operation and operands of a pure instruction, with the type of its result
+    std::optional<std::string> expression_key(Instruction& instruction, const std::string& destination) const
+    {
+        if (auto unary = dynamic_cast<UnaryInstruction*>(&instruction)) {
+            return conversion_key(std::format("unary{}", static_cast<int>(unary->unary_operator)).c_str(), unary->source, destination);
+        } else if (auto binary = dynamic_cast<BinaryInstruction*>(&instruction)) {
+            auto operand1 = value_key(binary->source1);
+            auto operand2 = value_key(binary->source2);
+            if (!operand1 || !operand2) {
+                return std::nullopt;
+            }
+            if (is_commutative(binary->binary_operator) && *operand2 < *operand1) {
+                std::swap(operand1, operand2);
+            }
+            return std::format("binary{}:{}:{}:{}", static_cast<int>(binary->binary_operator), *operand1, *operand2, type_of(destination).to_string());
+        } else if (auto sign_extend = dynamic_cast<SignExtendInstruction*>(&instruction)) {
+            return conversion_key("sign_extend", sign_extend->source, destination);
+        } else if (auto truncate = dynamic_cast<TruncateInstruction*>(&instruction)) {
+            return conversion_key("truncate", truncate->source, destination);
+        } else if (auto zero_extend = dynamic_cast<ZeroExtendInstruction*>(&instruction)) {
+            return conversion_key("zero_extend", zero_extend->source, destination);
+        } else if (auto double_to_int = dynamic_cast<DoubleToIntIntruction*>(&instruction)) {
+            return conversion_key("double_to_int", double_to_int->source, destination);
+        } else if (auto double_to_uint = dynamic_cast<DoubleToUIntIntruction*>(&instruction)) {
+            return conversion_key("double_to_uint", double_to_uint->source, destination);
+        } else if (auto int_to_double = dynamic_cast<IntToDoubleIntruction*>(&instruction)) {
+            return conversion_key("int_to_double", int_to_double->source, destination);
+        } else if (auto uint_to_double = dynamic_cast<UIntToDoubleIntruction*>(&instruction)) {
+            return conversion_key("uint_to_double", uint_to_double->source, destination);
+        } else if (auto get_address = dynamic_cast<GetAddressInstruction*>(&instruction)) {
+            // The address of a variable never changes, whatever the variable holds
+            auto source = as_variable(get_address->source);
+            if (!source) {
+                return std::nullopt;
+            }
+            return std::format("address:{}:{}", source->identifier.name, type_of(destination).to_string());
+        } else if (auto add_pointer = dynamic_cast<AddPointerInstruction*>(&instruction)) {
+            auto pointer = value_key(add_pointer->source_pointer);
+            auto index = value_key(add_pointer->index);
+            if (!pointer || !index) {
+                return std::nullopt;
+            }
+            return std::format("add_pointer:{}:{}:{}:{}", *pointer, *index, add_pointer->scale, type_of(destination).to_string());
+        } else if (auto select = dynamic_cast<SelectInstruction*>(&instruction)) {
+            auto condition = value_key(select->condition);
+            auto true_value = value_key(select->true_value);
+            auto false_value = value_key(select->false_value);
+            if (!condition || !true_value || !false_value) {
+                return std::nullopt;
+            }
+            return std::format("select:{}:{}:{}:{}", *condition, *true_value, *false_value, type_of(destination).to_string());
+        }
+        return std::nullopt;
+    }
+
+    const Type& type_of(const std::string& variable) const
+    {
+        return *m_symbol_table.symbol_at(variable).type;
+    }
+
+    SsaForm& m_ssa;
+    const SymbolTable& m_symbol_table;
+    // Expressions available in the current block, from the blocks that dominate it, and the variable holding them
+    std::unordered_map<std::string, std::string> m_leaders;
+    // Variables found equal to an earlier one, their uses read the earlier one
+    std::unordered_map<std::string, std::string> m_replacements;
+    bool m_changed = false;
+};
+
+}
+
+GlobalValueNumbering::GlobalValueNumbering(std::shared_ptr<SymbolTable> symbol_table)
+    : m_symbol_table { symbol_table }
+{
+}
+
+bool GlobalValueNumbering::run(SsaForm& ssa)
+{
+    Numbering numbering(ssa, *m_symbol_table);
+    return numbering.run();
+}
@@ -0,0 +1,338 @@
+#include "tacky/if_conversion.h"
+#include "common/data/type.h"
+#include "common/stats/statistic.h"
+#include "tacky/control_flow_graph.h"
+#include "tacky/use_def.h"
+#include <algorithm>
+#include <optional>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+using namespace tacky;
+
+STATISTIC(NumBranchesConverted, "if-conversion", "Number of branches turned into selects");
+STATISTIC(NumSelectsFormed, "if-conversion", "Number of select instructions formed");
+STATISTIC(NumBranchesKeptByCost, "if-conversion", "Number of convertible branches kept because running both arms costs more");
+
+namespace {
+
+// Arms longer than this keep their branch whatever the costs
+constexpr size_t MAX_ARM_INSTRUCTIONS = 8;
+// Cost of the compare and jumps a branch needs, plus what a misprediction costs on average
+constexpr size_t BRANCH_COST = 2;
+constexpr size_t MISPREDICTION_COST = 6;
+// A mov and a cmov for integers, the mask and the blend for doubles
+constexpr size_t INTEGER_SELECT_COST = 2;
+constexpr size_t DOUBLE_SELECT_COST = 6;
+
+using Body = std::vector<std::unique_ptr<Instruction>>;
+
+// Instructions [begin, end) of the body
+struct Arm {
+    size_t begin = 0;
+    size_t end = 0;
+
+    size_t size() const { return end - begin; }
+};
+
+// A branch that both arms join after, the instructions [first, last] of the body are replaced
+struct Branch {
+    Value* condition = nullptr;
+    Arm true_arm;
+    Arm false_arm;
+    size_t first = 0;
+    size_t last = 0;
+};
+
+bool is_control_flow(const Instruction& instruction)
+{
+    return dynamic_cast<const LabelInstruction*>(&instruction) || dynamic_cast<const JumpInstruction*>(&instruction)
+        || dynamic_cast<const JumpIfZeroInstruction*>(&instruction) || dynamic_cast<const JumpIfNotZeroInstruction*>(&instruction)
+        || dynamic_cast<const ReturnInstruction*>(&instruction);
+}
+
+const std::string* label_name(const Instruction& instruction)
+{
+    auto label = dynamic_cast<const LabelInstruction*>(&instruction);
+    return label ? &label->identifier.name : nullptr;
+}
+
+// First instruction at or after begin that changes the control flow
+size_t straight_line_end(const Body& body, size_t begin)
+{
+    while (begin < body.size() && !is_control_flow(*body[begin])) {
+        ++begin;
+    }
+    return begin;
+}
+
+class Converter {
+public:
+    Converter(Body& body, SymbolTable& symbol_table, NameGenerator& name_generator, std::unordered_set<std::string> aliased)
+        : m_body { body }
+        , m_symbol_table { symbol_table }
+        , m_name_generator { name_generator }
+        , m_aliased { std::move(aliased) }
+    {
+        count_references();
+    }
+
+    // Converts the branch that starts at the i-th instruction, returns true if it did
+    bool try_convert(size_t i)
+    {
+        auto branch = match(i);
+        if (!branch || !is_convertible(branch->true_arm) || !is_convertible(branch->false_arm)) {
+            return false;
+        }
+
+        // Variables written in an arm and read after it need a select, the others are temporaries of the arm
+        std::vector<std::string> outputs;
+        for (const Arm& arm : { branch->true_arm, branch->false_arm }) {
+            for (size_t k = arm.begin; k < arm.end; ++k) {
+                auto destination = defined_variable(*m_body[k]);
+                if (destination && std::ranges::find(outputs, *destination) == outputs.end() && !is_local(*destination, arm)) {
+                    outputs.push_back(*destination);
+                }
+            }
+        }
+        // The selects read the condition, the one that writes it goes last
+        const std::string& condition = dynamic_cast<TemporaryVariable&>(*branch->condition).identifier.name;
+        if (auto it = std::ranges::find(outputs, condition); it != outputs.end()) {
+            std::rotate(it, it + 1, outputs.end());
+        }
+
+        size_t true_cost = cost(branch->true_arm);
+        size_t false_cost = cost(branch->false_arm);
+        size_t select_cost = 0;
+        for (const auto& output : outputs) {
+            select_cost += is_type<DoubleType>(*m_symbol_table.symbol_at(output).type) ? DOUBLE_SELECT_COST : INTEGER_SELECT_COST;
+        }
+        if (true_cost + false_cost + select_cost > std::max(true_cost, false_cost) + BRANCH_COST + MISPREDICTION_COST) {
+            ++NumBranchesKeptByCost;
+            return false;
+        }
+
+        auto location = m_body[i]->source_location;
+        Body converted;
+        auto true_names = rename_outputs(branch->true_arm, outputs, converted);
+        auto false_names = rename_outputs(branch->false_arm, outputs, converted);
+        auto chosen = [](const std::unordered_map<std::string, std::string>& names, const std::string& output) {
+            auto it = names.find(output);
+            return std::make_unique<TemporaryVariable>(it != names.end() ? it->second : output);
+        };
+        for (const auto& output : outputs) {
+            converted.push_back(std::make_unique<SelectInstruction>(branch->condition->clone(), chosen(true_names, output), chosen(false_names, output), std::make_unique<TemporaryVariable>(output)));
+            converted.back()->source_location = location;
+            ++NumSelectsFormed;
+        }
+
+        m_body.erase(m_body.begin() + branch->first, m_body.begin() + branch->last + 1);
+        m_body.insert(m_body.begin() + branch->first, std::make_move_iterator(converted.begin()), std::make_move_iterator(converted.end()));
+        ++NumBranchesConverted;
+        count_references();
+        return true;
+    }
+
+private:
+    void count_references()
+    {
+        m_label_references.clear();
+        m_use_counts.clear();
+        m_definition_counts.clear();
+        for (auto& instruction : m_body) {
+            if (auto target = ControlFlowGraph::jump_target(*instruction)) {
+                ++m_label_references[*target];
+            }
+            for (auto value : used_values(*instruction)) {
+                if (auto variable = dynamic_cast<TemporaryVariable*>(value->get())) {
+                    ++m_use_counts[variable->identifier.name];
+                }
+            }
+            if (auto destination = defined_variable(*instruction)) {
+                ++m_definition_counts[*destination];
+            }
+        }
+    }
+
+    // Triangle: jz c, L1; arm; L1:
+    // Diamond: jz c, L1; arm; jmp L2; L1: arm; L2:
+    // with no other jump to L1 or L2
+    std::optional<Branch> match(size_t i)
+    {
+        Value* condition = nullptr;
+        bool jump_if_zero = false;
+        if (auto jump_if_zero_instruction = dynamic_cast<JumpIfZeroInstruction*>(m_body[i].get())) {
+            condition = jump_if_zero_instruction->condition.get();
+            jump_if_zero = true;
+        } else if (auto jump_if_not_zero_instruction = dynamic_cast<JumpIfNotZeroInstruction*>(m_body[i].get())) {
+            condition = jump_if_not_zero_instruction->condition.get();
+        } else {
+            return std::nullopt;
+        }
+        // A constant condition is the job of ConstantFolding
+        if (!dynamic_cast<TemporaryVariable*>(condition)) {
+            return std::nullopt;
+        }
+        std::string else_label = *ControlFlowGraph::jump_target(*m_body[i]);
+        if (m_label_references[else_label] != 1) {
+            return std::nullopt;
+        }
+
+        Branch branch { condition };
+        Arm fall_through { i + 1, straight_line_end(m_body, i + 1) };
+        Arm taken;
+        size_t k = fall_through.end;
+        if (k >= m_body.size()) {
+            return std::nullopt;
+        }
+        if (auto label = label_name(*m_body[k]); label && *label == else_label) {
+            taken = { k, k };
+            branch.last = k;
+        } else if (auto jump = dynamic_cast<JumpInstruction*>(m_body[k].get())) {
+            const std::string& join_label = jump->identifier.name;
+            auto label = k + 1 < m_body.size() ? label_name(*m_body[k + 1]) : nullptr;
+            if (!label || *label != else_label || m_label_references[join_label] != 1) {
+                return std::nullopt;
+            }
+            taken = { k + 2, straight_line_end(m_body, k + 2) };
+            auto join = taken.end < m_body.size() ? label_name(*m_body[taken.end]) : nullptr;
+            if (!join || *join != join_label) {
+                return std::nullopt;
+            }
+            branch.last = taken.end;
+        } else {
+            return std::nullopt;
+        }
+        branch.first = i;
+        // The fall through arm runs when the condition is not zero
+        branch.true_arm = jump_if_zero ? fall_through : taken;
+        branch.false_arm = jump_if_zero ? taken : fall_through;
+        return branch;
+    }
+
+    bool is_convertible(const Arm& arm) const
+    {
+        if (arm.size() > MAX_ARM_INSTRUCTIONS) {
+            return false;
+        }
+        for (size_t k = arm.begin; k < arm.end; ++k) {
+            if (!is_speculatable(*m_body[k], m_symbol_table)) {
+                return false;
+            }
+            auto destination = defined_variable(*m_body[k]);
+            if (!destination || m_aliased.contains(*destination) || !m_symbol_table.contains_symbol(*destination)) {
+                return false;
+            }
+            // cmov has no byte form
+            const Type& type = *m_symbol_table.symbol_at(*destination).type;
+            if (!type.is_scalar() || (type.size() != 4 && type.size() != 8)) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    // Written only in the arm and read only after that inside it
+    bool is_local(const std::string& variable, const Arm& arm)
+    {
+        size_t definitions = 0;
+        size_t uses = 0;
+        for (size_t k = arm.begin; k < arm.end; ++k) {
+            for (auto value : used_values(*m_body[k])) {
+                auto used = dynamic_cast<TemporaryVariable*>(value->get());
+                if (used && used->identifier.name == variable) {
+                    if (definitions == 0) {
+                        return false;
+                    }
+                    ++uses;
+                }
+            }
+            if (auto destination = defined_variable(*m_body[k]); destination && *destination == variable) {
+                ++definitions;
+            }
+        }
+        return definitions == m_definition_counts[variable] && uses == m_use_counts[variable];
+    }
+
+    size_t cost(const Arm& arm) const
+    {
+        size_t total = 0;
+        for (size_t k = arm.begin; k < arm.end; ++k) {
+            const Instruction& instruction = *m_body[k];
+            if (dynamic_cast<const CopyInstruction*>(&instruction)) {
+                // Usually coalesced away
+                continue;
+            } else if (auto binary = dynamic_cast<const BinaryInstruction*>(&instruction)) {
+                bool is_division = binary->binary_operator == BinaryOperator::DIVIDE || binary->binary_operator == BinaryOperator::REMAINDER;
+                total += binary->binary_operator == BinaryOperator::MULTIPLY ? 3 : is_division ? 8 : 1;
+            } else if (auto select = dynamic_cast<const SelectInstruction*>(&instruction)) {
+                auto destination = defined_variable(*select);
+                total += is_type<DoubleType>(*m_symbol_table.symbol_at(*destination).type) ? DOUBLE_SELECT_COST : INTEGER_SELECT_COST;
+            } else if (dynamic_cast<const IntToDoubleIntruction*>(&instruction) || dynamic_cast<const DoubleToIntIntruction*>(&instruction)) {
+                total += 2;
+            } else if (dynamic_cast<const UIntToDoubleIntruction*>(&instruction) || dynamic_cast<const DoubleToUIntIntruction*>(&instruction)) {
+                // Branches of their own in the backend
+                total += 4;
+            } else {
+                total += 1;
+            }
+        }
+        return total;
+    }
+
+    // Moves the arm into converted with its outputs written to fresh temporaries, returns the new names
+    std::unordered_map<std::string, std::string> rename_outputs(const Arm& arm, const std::vector<std::string>& outputs, Body& converted)
+    {
+        std::unordered_map<std::string, std::string> names;
+        for (size_t k = arm.begin; k < arm.end; ++k) {
+            auto& instruction = m_body[k];
+            for (auto value : used_values(*instruction)) {
+                if (auto used = dynamic_cast<TemporaryVariable*>(value->get())) {
+                    if (auto it = names.find(used->identifier.name); it != names.end()) {
+                        *value = std::make_unique<TemporaryVariable>(it->second);
+                    }
+                }
+            }
+            auto destination = defined_variable(*instruction);
+            if (destination && std::ranges::find(outputs, *destination) != outputs.end()) {
+                auto [it, inserted] = names.try_emplace(*destination);
+                if (inserted) {
+                    it->second = m_name_generator.make_temporary(*destination);
+                    m_symbol_table.insert_symbol(it->second, m_symbol_table.symbol_at(*destination).type->clone(), LocalAttribute {});
+                }
+                *defined_value(*instruction) = std::make_unique<TemporaryVariable>(it->second);
+            }
+            converted.push_back(std::move(instruction));
+        }
+        return names;
+    }
+
+    Body& m_body;
+    SymbolTable& m_symbol_table;
+    NameGenerator& m_name_generator;
+    std::unordered_set<std::string> m_aliased;
+    std::unordered_map<std::string, size_t> m_label_references;
+    std::unordered_map<std::string, size_t> m_use_counts;
+    std::unordered_map<std::string, size_t> m_definition_counts;
+};
+
+}
+
+IfConversion::IfConversion(std::shared_ptr<SymbolTable> symbol_table, std::shared_ptr<NameGenerator> name_generator)
+    : m_symbol_table { symbol_table }
+    , m_name_generator { name_generator }
+{
+}
+
+bool IfConversion::run(FunctionDefinition& function)
+{
+    Converter converter(function.body, *m_symbol_table, *m_name_generator, aliased_variables(function, *m_symbol_table));
+    bool changed = false;
+    // Backwards, so that a branch nested in an arm is converted before the branch around it is considered
+    for (size_t i = function.body.size(); i-- > 0;) {
+        changed |= converter.try_convert(i);
+    }
+    return changed;
+}
@@ -0,0 +1,717 @@
+#include "tacky/induction_variable_strength_reduction.h"
+#include "common/data/type.h"
+#include "common/stats/statistic.h"
+#include "tacky/constant_folding.h"
+#include "tacky/control_flow_graph.h"
+#include "tacky/loop_info.h"
+#include "tacky/use_def.h"
+#include <algorithm>
+#include <cstdint>
+#include <map>
+#include <optional>
+#include <string>
+#include <type_traits>
+#include <unordered_map>
+#include <unordered_set>
+#include <utility>
+#include <variant>
+#include <vector>
+
+using namespace tacky;
+
+STATISTIC(NumBasicInductionVariables, "indvars", "Number of basic induction variables found");
+STATISTIC(NumAddressesReduced, "indvars", "Number of element addresses turned into pointer increments");
+STATISTIC(NumMultipliesReduced, "indvars", "Number of multiplications of an induction variable turned into additions");
+STATISTIC(NumExitTestsReplaced, "indvars", "Number of loop exit tests rewritten on a pointer induction variable");
+STATISTIC(NumCountersRemoved, "indvars", "Number of induction variables removed after their exit test was replaced");
+
+namespace {
+
+// Blocks walked back from the loop looking for the test that guards it
+constexpr size_t MAX_GUARD_DISTANCE = 4;
+
+// Block and index in the block
+using Position = std::pair<size_t, size_t>;
+using Instructions = std::vector<std::unique_ptr<Instruction>>;
+
+const std::string* variable_name(const std::unique_ptr<Value>& value)
+{
+    auto variable = dynamic_cast<const TemporaryVariable*>(value.get());
+    return variable ? &variable->identifier.name : nullptr;
+}
+
+std::unique_ptr<Value> variable(const std::string& name)
+{
+    return std::make_unique<TemporaryVariable>(name);
+}
+
+std::optional<int64_t> integer_value(const ConstantType& value)
+{
+    return std::visit([](auto v) -> std::optional<int64_t> {
+        if constexpr (std::is_integral_v<decltype(v)>) {
+            return static_cast<int64_t>(v);
+        } else {
+            return std::nullopt;
+        }
+    },
+        value);
+}
+
+bool is_relational(BinaryOperator op)
+{
+    return op == BinaryOperator::EQUAL || op == BinaryOperator::NOT_EQUAL || op == BinaryOperator::LESS_THAN
+        || op == BinaryOperator::LESS_OR_EQUAL || op == BinaryOperator::GREATER_THAN || op == BinaryOperator::GREATER_OR_EQUAL;
+}
+
+// The operator that gives the same result with the operands swapped
+BinaryOperator swapped(BinaryOperator op)
+{
+    switch (op) {
+    case BinaryOperator::LESS_THAN:
+        return BinaryOperator::GREATER_THAN;
+    case BinaryOperator::LESS_OR_EQUAL:
+        return BinaryOperator::GREATER_OR_EQUAL;
+    case BinaryOperator::GREATER_THAN:
+        return BinaryOperator::LESS_THAN;
+    case BinaryOperator::GREATER_OR_EQUAL:
+        return BinaryOperator::LESS_OR_EQUAL;
+    default:
+        return op;
+    }
+}
+
+bool same_value(const std::unique_ptr<Value>& a, const std::unique_ptr<Value>& b)
+{
+    auto constant_a = dynamic_cast<const Constant*>(a.get());
+    auto constant_b = dynamic_cast<const Constant*>(b.get());
+    if (constant_a || constant_b) {
+        return constant_a && constant_b && constant_a->value == constant_b->value;
+    }
+    return *variable_name(a) == *variable_name(b);
+}
+
+// i = i + step, or i = next with next = i + step
+struct BasicInductionVariable {
+    std::string name;
+    std::optional<std::string> next;
+    // The instruction that writes i, the induction variables derived from it are stepped right after
+    Position update;
+    // ADD or SUBTRACT
+    BinaryOperator op;
+    // Of the type of i
+    ConstantType step;
+};
+
+// base + scale * i, or base + scale * sext(i)
+struct PointerInductionVariable {
+    std::string pointer;
+    const BasicInductionVariable* basic;
+    std::string base;
+    size_t scale;
+    bool sign_extended;
+    // The instruction computing the address, pointer arithmetic out of the array is undefined so the addresses the
+    // pointer takes where this runs are valid ones
+    Position address;
+};
+
+class Reducer {
+public:
+    Reducer(ControlFlowGraph& cfg, const LoopInfo& loop_info, const LoopInfo::Loop& loop, SymbolTable& symbol_table, NameGenerator& name_generator,
+        const std::unordered_set<std::string>& aliased)
+        : m_blocks { cfg.blocks() }
+        , m_loop_info { loop_info }
+        , m_loop { loop }
+        , m_symbol_table { symbol_table }
+        , m_name_generator { name_generator }
+        , m_aliased { aliased }
+    {
+        for (size_t b = 0; b < m_blocks.size(); ++b) {
+            for (size_t k = 0; k < m_blocks[b].instructions.size(); ++k) {
+                auto& instruction = *m_blocks[b].instructions[k];
+                for (auto value : used_values(instruction)) {
+                    if (auto name = variable_name(*value)) {
+                        ++m_use_counts[*name];
+                    }
+                }
+                if (auto destination = defined_variable(instruction)) {
+                    m_definitions[*destination].emplace_back(b, k);
+                    if (m_loop.contains(b)) {
+                        ++m_loop_definitions[*destination];
+                    }
+                }
+            }
+        }
+    }
+
+    // Returns true if the loop changed, the instructions for its preheader are in preheader()
+    bool reduce()
+    {
+        find_basic_variables();
+        if (m_basic_variables.empty()) {
+            return false;
+        }
+        bool changed = false;
+        for (size_t b : m_loop.blocks) {
+            for (size_t k = 0; k < m_blocks[b].instructions.size(); ++k) {
+                changed |= reduce_address({ b, k }) || reduce_multiply({ b, k });
+            }
+        }
+        if (!changed) {
+            return false;
+        }
+        for (const auto& pointer : m_pointers) {
+            replace_exit_test(pointer);
+        }
+        remove_dead_instructions();
+        insert_steps();
+        return true;
+    }
+
+    Instructions& preheader() { return m_preheader; }
+
+private:
+    Instruction& at(Position position) { return *m_blocks[position.first].instructions[position.second]; }
+
+    // The only instruction writing a variable in the whole function
+    Instruction* single_definition(const std::string& name)
+    {
+        auto it = m_definitions.find(name);
+        return it != m_definitions.end() && it->second.size() == 1 ? &at(it->second.front()) : nullptr;
+    }
+
+    bool is_local(const std::string& name) const
+    {
+        return !m_aliased.contains(name) && m_symbol_table.contains_symbol(name);
+    }
+
+    bool is_invariant(const std::unique_ptr<Value>& value)
+    {
+        auto name = variable_name(value);
+        return !name || (!m_aliased.contains(*name) && loop_definitions(*name) == 0);
+    }
+
+    size_t loop_definitions(const std::string& name) const
+    {
+        auto it = m_loop_definitions.find(name);
+        return it != m_loop_definitions.end() ? it->second : 0;
+    }
+
+    bool dominates(Position a, Position b) const
+    {
+        return a.first == b.first ? a.second < b.second : m_loop_info.dominates(a.first, b.first);
+    }
+
+    std::string make_variable(const std::string& name, std::unique_ptr<Type> type)
+    {
+        std::string temporary = m_name_generator.make_temporary(name);
+        m_symbol_table.insert_symbol(temporary, std::move(type), LocalAttribute {});
+        return temporary;
+    }
+
+    void emit(Instructions& instructions, std::unique_ptr<Instruction> instruction, const Instruction& origin)
+    {
+        instruction->source_location = origin.source_location;
+        instructions.push_back(std::move(instruction));
+    }
+
+    // The step of an i = i + c (or i - c) that writes destination, nothing when it is something else
+    std::optional<std::pair<BinaryOperator, ConstantType>> match_step(Instruction& instruction, const std::string& name)
+    {
+        auto binary = dynamic_cast<BinaryInstruction*>(&instruction);
+        if (!binary || (binary->binary_operator != BinaryOperator::ADD && binary->binary_operator != BinaryOperator::SUBTRACT)) {
+            return std::nullopt;
+        }
+        auto source1 = variable_name(binary->source1);
+        auto source2 = variable_name(binary->source2);
+        auto constant = dynamic_cast<Constant*>((source1 ? binary->source2 : binary->source1).get());
+        bool reads_name = (source1 && *source1 == name) || (source2 && *source2 == name && binary->binary_operator == BinaryOperator::ADD);
+        if (!reads_name || !constant || integer_value(constant->value).value_or(0) == 0) {
+            return std::nullopt;
+        }
+        return std::pair { binary->binary_operator, constant->value };
+    }
+
+    void find_basic_variables()
+    {
+        for (const auto& [name, count] : m_loop_definitions) {
+            if (count != 1 || !is_local(name)) {
+                continue;
+            }
+            Position update = *std::ranges::find_if(m_definitions[name], [&](Position position) { return m_loop.contains(position.first); });
+            BasicInductionVariable basic { name, std::nullopt, update, BinaryOperator::ADD, 0 };
+            Instruction& definition = at(update);
+            std::optional<std::pair<BinaryOperator, ConstantType>> step = match_step(definition, name);
+            if (auto copy = dynamic_cast<CopyInstruction*>(&definition); copy && !step) {
+                // next is computed from i before every copy, the copy never runs twice on the same next
+                auto next = variable_name(copy->source);
+                Instruction* next_definition = next && is_local(*next) && loop_definitions(*next) == 1 ? single_definition(*next) : nullptr;
+                Position next_position = next_definition ? m_definitions[*next].front() : update;
+                if (next_definition && next_position.first == update.first && next_position.second < update.second) {
+                    step = match_step(*next_definition, name);
+                    basic.next = *next;
+                }
+            }
+            if (!step) {
+                continue;
+            }
+            basic.op = step->first;
+            basic.step = step->second;
+            m_basic_variables.emplace(name, std::move(basic));
+            ++NumBasicInductionVariables;
+        }
+    }
+
+    const BasicInductionVariable* basic_variable(const std::unique_ptr<Value>& value)
+    {
+        auto name = variable_name(value);
+        auto it = name ? m_basic_variables.find(*name) : m_basic_variables.end();
+        return it != m_basic_variables.end() ? &it->second : nullptr;
+    }
+
+    void add_step(const BasicInductionVariable& basic, std::unique_ptr<Instruction> instruction)
+    {
+        instruction->source_location = at(basic.update).source_location;
+        m_steps[basic.update].push_back(std::move(instruction));
+    }
+
+    // p = AddPointer(base, i, scale) or p = AddPointer(base, sext(i), scale) becomes p = q, with q stepped with i
+    bool reduce_address(Position position)
+    {
+        auto add_pointer = dynamic_cast<AddPointerInstruction*>(&at(position));
+        if (!add_pointer || !variable_name(add_pointer->source_pointer) || !is_invariant(add_pointer->source_pointer)) {
+            return false;
+        }
+        const std::string& destination = *variable_name(add_pointer->destination);
+        if (!is_local(destination) || m_definitions[destination].size() != 1) {
+            return false;
+        }
+
+        const BasicInductionVariable* basic = basic_variable(add_pointer->index);
+        bool sign_extended = false;
+        if (!basic) {
+            // The extension is read where it was made, before i changes
+            auto index = variable_name(add_pointer->index);
+            auto sign_extend = index ? dynamic_cast<SignExtendInstruction*>(single_definition(*index)) : nullptr;
+            basic = sign_extend ? basic_variable(sign_extend->source) : nullptr;
+            if (!basic) {
+                return false;
+            }
+            Position extension = m_definitions[*index].front();
+            bool updated_between = basic->update.first == position.first && basic->update.second > extension.second && basic->update.second < position.second;
+            if (extension.first != position.first || extension.second > position.second || updated_between) {
+                return false;
+            }
+            sign_extended = true;
+        }
+        auto step = convert_constant(basic->step, LongType());
+        if (basic->op == BinaryOperator::SUBTRACT && step) {
+            step = evaluate_unary(UnaryOperator::NEGATE, *step);
+        }
+        if (!step) {
+            return false;
+        }
+
+        std::string pointer = make_variable(destination, m_symbol_table.symbol_at(destination).type->clone());
+        std::string base = *variable_name(add_pointer->source_pointer);
+        std::unique_ptr<Value> index = variable(basic->name);
+        if (sign_extended) {
+            std::string extended = make_variable(basic->name, std::make_unique<LongType>());
+            emit(m_preheader, std::make_unique<SignExtendInstruction>(std::move(index), variable(extended)), *add_pointer);
+            index = variable(extended);
+        }
+        emit(m_preheader, std::make_unique<AddPointerInstruction>(variable(base), std::move(index), add_pointer->scale, variable(pointer)), *add_pointer);
+        add_step(*basic, std::make_unique<AddPointerInstruction>(variable(pointer), std::make_unique<Constant>(*step), add_pointer->scale, variable(pointer)));
+        m_pointers.push_back({ pointer, basic, base, add_pointer->scale, sign_extended, position });
+
+        auto copy = std::make_unique<CopyInstruction>(variable(pointer), variable(destination));
+        copy->source_location = add_pointer->source_location;
+        m_blocks[position.first].instructions[position.second] = std::move(copy);
+        ++NumAddressesReduced;
+        return true;
+    }
+
+    // d = i * c becomes d = m, with m stepped by c times the step of i
+    bool reduce_multiply(Position position)
+    {
+        auto binary = dynamic_cast<BinaryInstruction*>(&at(position));
+        if (!binary || binary->binary_operator != BinaryOperator::MULTIPLY) {
+            return false;
+        }
+        const BasicInductionVariable* basic = basic_variable(binary->source1);
+        auto factor = dynamic_cast<Constant*>(binary->source2.get());
+        if (!basic) {
+            basic = basic_variable(binary->source2);
+            factor = dynamic_cast<Constant*>(binary->source1.get());
+        }
+        const std::string& destination = *variable_name(binary->destination);
+        if (!basic || !factor || !is_local(destination) || m_definitions[destination].size() != 1) {
+            return false;
+        }
+        auto step = evaluate_binary(BinaryOperator::MULTIPLY, factor->value, basic->step);
+        if (!step) {
+            return false;
+        }
+
+        std::string product = make_variable(destination, m_symbol_table.symbol_at(destination).type->clone());
+        emit(m_preheader, std::make_unique<BinaryInstruction>(BinaryOperator::MULTIPLY, variable(basic->name), std::make_unique<Constant>(factor->value), variable(product)), *binary);
+        add_step(*basic, std::make_unique<BinaryInstruction>(basic->op, variable(product), std::make_unique<Constant>(*step), variable(product)));
+
+        auto copy = std::make_unique<CopyInstruction>(variable(product), variable(destination));
+        copy->source_location = binary->source_location;
+        m_blocks[position.first].instructions[position.second] = std::move(copy);
+        ++NumMultipliesReduced;
+        return true;
+    }
+
+    // cond = i < n; jump on cond becomes cond = q < end, with end = base + scale * sext(n) computed in the preheader
+    void replace_exit_test(const PointerInductionVariable& pointer)
+    {
+        const BasicInductionVariable& basic = *pointer.basic;
+        // Addresses of ints are far from wrapping around, the sign extension keeps the counter in the int range
+        std::optional<int64_t> step = integer_value(basic.step);
+        if (!pointer.sign_extended || !step || (*step != 1 && *step != -1)) {
+            return;
+        }
+        bool counts_up = (*step == 1) == (basic.op == BinaryOperator::ADD);
+
+        for (size_t exiting : m_loop.exiting_blocks) {
+            auto& instructions = m_blocks[exiting].instructions;
+            if (instructions.size() < 2 || !instructions[instructions.size() - 2]) {
+                continue;
+            }
+            Value* condition = nullptr;
+            if (auto jump_if_zero = dynamic_cast<JumpIfZeroInstruction*>(instructions.back().get())) {
+                condition = jump_if_zero->condition.get();
+            } else if (auto jump_if_not_zero = dynamic_cast<JumpIfNotZeroInstruction*>(instructions.back().get())) {
+                condition = jump_if_not_zero->condition.get();
+            }
+            Position test { exiting, instructions.size() - 2 };
+            auto compare = dynamic_cast<BinaryInstruction*>(instructions[test.second].get());
+            auto condition_variable = dynamic_cast<TemporaryVariable*>(condition);
+            if (!compare || !condition_variable || !is_relational(compare->binary_operator) || *variable_name(compare->destination) != condition_variable->identifier.name
+                || m_use_counts[condition_variable->identifier.name] != 1 || !dominates(pointer.address, test)) {
+                continue;
+            }
+
+            // The counter on the left, the bound on the right
+            BinaryOperator op = compare->binary_operator;
+            bool counter_on_left = reads_counter(compare->source1, basic, test);
+            if (!counter_on_left) {
+                if (!reads_counter(compare->source2, basic, test)) {
+                    continue;
+                }
+                op = swapped(op);
+            }
+            std::unique_ptr<Value>& bound = counter_on_left ? compare->source2 : compare->source1;
+            if (!is_invariant(bound)) {
+                continue;
+            }
+            bool is_equality = op == BinaryOperator::EQUAL || op == BinaryOperator::NOT_EQUAL;
+            bool is_upper_bound = counts_up && (op == BinaryOperator::LESS_THAN || op == BinaryOperator::LESS_OR_EQUAL);
+            if (!is_equality && !(is_upper_bound && is_entered_only_if(basic.name, op, bound))) {
+                continue;
+            }
+
+            std::string end = make_variable("end", m_symbol_table.symbol_at(pointer.pointer).type->clone());
+            std::unique_ptr<Value> index;
+            if (auto constant = dynamic_cast<Constant*>(bound.get())) {
+                auto extended = convert_constant(constant->value, LongType());
+                if (!extended) {
+                    continue;
+                }
+                index = std::make_unique<Constant>(*extended);
+            } else {
+                std::string extended = make_variable(*variable_name(bound), std::make_unique<LongType>());
+                emit(m_preheader, std::make_unique<SignExtendInstruction>(bound->clone(), variable(extended)), *compare);
+                index = variable(extended);
+            }
+            emit(m_preheader, std::make_unique<AddPointerInstruction>(variable(pointer.base), std::move(index), pointer.scale, variable(end)), *compare);
+
+            compare->binary_operator = op;
+            compare->source1 = variable(pointer.pointer);
+            compare->source2 = variable(end);
+            ++NumExitTestsReplaced;
+            return;
+        }
+    }
+
+    // Whether the value reads the counter where it equals i, so where the pointer is base + scale * sext(i)
+    bool reads_counter(const std::unique_ptr<Value>& value, const BasicInductionVariable& basic, Position test)
+    {
+        auto name = variable_name(value);
+        if (!name) {
+            return false;
+        }
+        if (*name == basic.name) {
+            return true;
+        }
+        return basic.next && *name == *basic.next && basic.update.first == test.first && basic.update.second < test.second;
+    }
+
+    // Whether the loop is only entered when i op bound holds for the value i has on entry: a constant test, or a
+    // conditional jump guarding the way to the header. Only the blocks that lead to the header one after the other are
+    // walked, from the header backwards
+    bool is_entered_only_if(const std::string& counter, BinaryOperator op, const std::unique_ptr<Value>& bound)
+    {
+        std::vector<size_t> outside;
+        std::ranges::copy_if(m_blocks[m_loop.header].predecessors, std::back_inserter(outside), [&](size_t predecessor) { return !m_loop.contains(predecessor); });
+        if (outside.size() != 1 || outside.front() == ControlFlowGraph::ENTRY) {
+            return false;
+        }
+        auto bound_name = variable_name(bound);
+        // What i is on entry, once a definition of it is found on the way
+        bool counter_defined = false;
+        std::optional<ConstantType> entry_value;
+        bool bound_defined = false;
+
+        size_t next = m_loop.header;
+        size_t block = outside.front();
+        for (size_t distance = 0; distance < MAX_GUARD_DISTANCE; ++distance) {
+            auto& instructions = m_blocks[block].instructions;
+            // The guard is a jump on a condition that leaves when it is zero
+            std::optional<std::string> guard;
+            auto jump_if_zero = dynamic_cast<JumpIfZeroInstruction*>(instructions.back().get());
+            auto jump_if_not_zero = dynamic_cast<JumpIfNotZeroInstruction*>(instructions.back().get());
+            auto target = ControlFlowGraph::jump_target(*instructions.back());
+            bool targets_next = target && dynamic_cast<LabelInstruction*>(m_blocks[next].instructions.front().get())
+                && dynamic_cast<LabelInstruction&>(*m_blocks[next].instructions.front()).identifier.name == *target;
+            if (jump_if_zero && !targets_next) {
+                guard = variable_name(jump_if_zero->condition) ? std::optional(*variable_name(jump_if_zero->condition)) : std::nullopt;
+            } else if (jump_if_not_zero && targets_next) {
+                guard = variable_name(jump_if_not_zero->condition) ? std::optional(*variable_name(jump_if_not_zero->condition)) : std::nullopt;
+            }
+
+            for (size_t k = instructions.size(); k-- > 0;) {
+                auto destination = defined_variable(*instructions[k]);
+                if (!destination) {
+                    continue;
+                }
+                if (guard && *destination == *guard) {
+                    auto compare = dynamic_cast<BinaryInstruction*>(instructions[k].get());
+                    if (compare && guarantees(*compare, counter, counter_defined, entry_value, op, bound, bound_defined)) {
+                        return true;
+                    }
+                    guard.reset();
+                }
+                if (*destination == counter && !counter_defined) {
+                    counter_defined = true;
+                    auto copy = dynamic_cast<CopyInstruction*>(instructions[k].get());
+                    auto constant = copy ? dynamic_cast<Constant*>(copy->source.get()) : nullptr;
+                    if (constant) {
+                        entry_value = constant->value;
+                    }
+                    // Nothing to look for once both are known constants
+                    auto bound_constant = dynamic_cast<Constant*>(bound.get());
+                    if (constant && bound_constant) {
+                        auto holds = evaluate_binary(op, constant->value, bound_constant->value);
+                        return holds && integer_value(*holds).value_or(0) != 0;
+                    }
+                }
+                if (bound_name && *destination == *bound_name) {
+                    bound_defined = true;
+                }
+            }
+
+            const auto& predecessors = m_blocks[block].predecessors;
+            if (predecessors.size() != 1 || predecessors.front() == ControlFlowGraph::ENTRY) {
+                return false;
+            }
+            next = block;
+            block = predecessors.front();
+        }
+        return false;
+    }
+
+    // Whether the guard compare tests i op bound with the values they have on entry
+    static bool guarantees(const BinaryInstruction& compare, const std::string& counter, bool counter_defined, const std::optional<ConstantType>& entry_value,
+        BinaryOperator op, const std::unique_ptr<Value>& bound, bool bound_defined)
+    {
+        auto is_entry_value = [&](const std::unique_ptr<Value>& value) {
+            if (counter_defined) {
+                auto constant = dynamic_cast<const Constant*>(value.get());
+                return entry_value && constant && constant->value == *entry_value;
+            }
+            auto name = variable_name(value);
+            return name && *name == counter;
+        };
+        auto is_bound = [&](const std::unique_ptr<Value>& value) {
+            return !bound_defined && same_value(value, bound);
+        };
+        return (compare.binary_operator == op && is_entry_value(compare.source1) && is_bound(compare.source2))
+            || (compare.binary_operator == swapped(op) && is_bound(compare.source1) && is_entry_value(compare.source2));
+    }
+
+    // Whether a value written in the loop can be read in the preheader, on a way from an exit back to the loop that
+    // does not write the variable again first
+    bool reaches_loop_entry(const std::string& name)
+    {
+        auto writes = [&](size_t block) {
+            return std::ranges::any_of(m_blocks[block].instructions, [&](const auto& instruction) {
+                auto destination = instruction ? defined_variable(*instruction) : std::nullopt;
+                return destination && *destination == name;
+            });
+        };
+        std::vector<bool> visited(m_blocks.size(), false);
+        std::vector<size_t> worklist;
+        for (size_t exiting : m_loop.exiting_blocks) {
+            for (size_t successor : m_blocks[exiting].successors) {
+                if (successor != ControlFlowGraph::EXIT && !m_loop.contains(successor) && !visited[successor]) {
+                    visited[successor] = true;
+                    worklist.push_back(successor);
+                }
+            }
+        }
+        while (!worklist.empty()) {
+            size_t block = worklist.back();
+            worklist.pop_back();
+            if (writes(block)) {
+                continue;
+            }
+            for (size_t successor : m_blocks[block].successors) {
+                if (successor == m_loop.header) {
+                    return true;
+                }
+                if (successor != ControlFlowGraph::EXIT && !visited[successor]) {
+                    visited[successor] = true;
+                    worklist.push_back(successor);
+                }
+            }
+        }
+        return false;
+    }
+
+    // Removes the instructions of the loop whose values are only read by each other, like a counter whose test was
+    // replaced: it reads itself and nothing else reads it
+    void remove_dead_instructions()
+    {
+        std::unordered_map<std::string, std::vector<Position>> removable;
+        std::vector<std::string> worklist;
+        std::unordered_set<std::string> needed;
+        auto need = [&](const std::string& name) {
+            if (needed.insert(name).second) {
+                worklist.push_back(name);
+            }
+        };
+        auto need_operands = [&](Instruction& instruction) {
+            for (auto value : used_values(instruction)) {
+                if (auto name = variable_name(*value)) {
+                    need(*name);
+                }
+            }
+        };
+
+        for (size_t b = 0; b < m_blocks.size(); ++b) {
+            for (size_t k = 0; k < m_blocks[b].instructions.size(); ++k) {
+                auto& instruction = *m_blocks[b].instructions[k];
+                auto destination = defined_variable(instruction);
+                if (m_loop.contains(b) && destination && is_local(*destination) && is_speculatable(instruction, m_symbol_table)) {
+                    removable[*destination].emplace_back(b, k);
+                } else {
+                    need_operands(instruction);
+                }
+            }
+        }
+        for (auto& instruction : m_preheader) {
+            for (auto value : used_values(*instruction)) {
+                auto name = variable_name(*value);
+                if (name && (loop_definitions(*name) == 0 || reaches_loop_entry(*name))) {
+                    need(*name);
+                }
+            }
+        }
+        // The steps are inserted later, they only read the variables they step
+        while (!worklist.empty()) {
+            std::string name = worklist.back();
+            worklist.pop_back();
+            auto it = removable.find(name);
+            if (it == removable.end()) {
+                continue;
+            }
+            for (Position position : it->second) {
+                need_operands(at(position));
+            }
+        }
+
+        for (const auto& [name, positions] : removable) {
+            if (needed.contains(name)) {
+                continue;
+            }
+            NumCountersRemoved += m_basic_variables.contains(name);
+            for (Position position : positions) {
+                m_blocks[position.first].instructions[position.second].reset();
+            }
+        }
+    }
+
+    void insert_steps()
+    {
+        for (size_t b : m_loop.blocks) {
+            Instructions instructions;
+            for (size_t k = 0; k < m_blocks[b].instructions.size(); ++k) {
+                if (m_blocks[b].instructions[k]) {
+                    instructions.push_back(std::move(m_blocks[b].instructions[k]));
+                }
+                if (auto it = m_steps.find({ b, k }); it != m_steps.end()) {
+                    std::ranges::move(it->second, std::back_inserter(instructions));
+                }
+            }
+            m_blocks[b].instructions = std::move(instructions);
+        }
+    }
+
+    std::vector<ControlFlowGraph::BasicBlock>& m_blocks;
+    const LoopInfo& m_loop_info;
+    const LoopInfo::Loop& m_loop;
+    SymbolTable& m_symbol_table;
+    NameGenerator& m_name_generator;
+    const std::unordered_set<std::string>& m_aliased;
+
+    std::unordered_map<std::string, std::vector<Position>> m_definitions;
+    std::unordered_map<std::string, size_t> m_loop_definitions;
+    std::unordered_map<std::string, size_t> m_use_counts;
+    // Ordered by name so that the new variables do not depend on hashing
+    std::map<std::string, BasicInductionVariable> m_basic_variables;
+    std::vector<PointerInductionVariable> m_pointers;
+    std::map<Position, Instructions> m_steps;
+    Instructions m_preheader;
+};
+
+}
+
+InductionVariableStrengthReduction::InductionVariableStrengthReduction(std::shared_ptr<SymbolTable> symbol_table, std::shared_ptr<NameGenerator> name_generator)
+    : m_symbol_table { symbol_table }
+    , m_name_generator { name_generator }
+{
+}
+
+bool InductionVariableStrengthReduction::run(FunctionDefinition& function)
+{
+    bool changed = false;
+    // A reduced loop has no multiplication or address left to reduce, every round gets further
+    while (reduce_next_loop(function)) {
+        changed = true;
+    }
+    return changed;
+}
+
+bool InductionVariableStrengthReduction::reduce_next_loop(FunctionDefinition& function)
+{
+    std::unordered_set<std::string> aliased = aliased_variables(function, *m_symbol_table);
+    ControlFlowGraph cfg(function);
+    LoopInfo loop_info(cfg);
+
+    for (const LoopInfo::Loop& loop : loop_info.loops()) {
+        if (!can_insert_preheader(cfg, loop)) {
+            continue;
+        }
+        Reducer reducer(cfg, loop_info, loop, *m_symbol_table, *m_name_generator, aliased);
+        if (reducer.reduce()) {
+            insert_in_preheader(cfg, loop, std::move(reducer.preheader()), *m_name_generator);
+            cfg.write_back(function);
+            return true;
+        }
+    }
+
+    cfg.write_back(function);
+    return false;
+}
@@ -0,0 +1,187 @@
+#include "tacky/loop_info.h"
+#include "common/stats/statistic.h"
+#include <algorithm>
+#include <map>
+#include <iterator>
+#include <set>
+#include <unordered_map>
+
+using namespace tacky;
+
+STATISTIC(NumNaturalLoops, "loop-info", "Number of natural loops found");
+STATISTIC(NumLabeledLoops, "loop-info", "Number of natural loops matched with the labels of their loop statement");
+STATISTIC(NumMismatchedLoopLabels, "loop-info", "Number of natural loops whose labels belong to more than one loop statement");
+STATISTIC(NumPreheadersInserted, "loop-info", "Number of preheader blocks inserted in front of a loop");
+
+namespace {
+
+const std::string CONTINUE_PREFIX = "continue_";
+const std::string BREAK_PREFIX = "break_";
+
+}
+
+bool LoopInfo::Loop::contains(size_t block) const
+{
+    return std::ranges::binary_search(blocks, block);
+}
+
+LoopInfo::LoopInfo(const ControlFlowGraph& cfg)
+    : m_immediate_dominators { cfg.immediate_dominators() }
+{
+    const auto& blocks = cfg.blocks();
+    std::vector<bool> reachable = cfg.reachable_blocks();
+
+    // Back edges grouped by header, in block order so that the result does not depend on hashing
+    std::map<size_t, std::vector<size_t>> latches;
+    for (size_t b = 0; b < blocks.size(); ++b) {
+        if (!reachable[b]) {
+            continue;
+        }
+        for (size_t successor : blocks[b].successors) {
+            if (successor != ControlFlowGraph::EXIT && dominates(successor, b)) {
+                latches[successor].push_back(b);
+            }
+        }
+    }
+
+    for (auto& [header, header_latches] : latches) {
+        std::set<size_t> body { header };
+        std::vector<size_t> worklist;
+        for (size_t latch : header_latches) {
+            if (body.insert(latch).second) {
+                worklist.push_back(latch);
+            }
+        }
+        while (!worklist.empty()) {
+            size_t block = worklist.back();
+            worklist.pop_back();
+            for (size_t predecessor : blocks[block].predecessors) {
+                if (predecessor != ControlFlowGraph::ENTRY && body.insert(predecessor).second) {
+                    worklist.push_back(predecessor);
+                }
+            }
+        }
+
+        Loop loop { header, std::vector<size_t>(body.begin(), body.end()), header_latches, {}, std::nullopt };
+        for (size_t block : loop.blocks) {
+            if (std::ranges::any_of(blocks[block].successors, [&](size_t successor) { return !body.contains(successor); })) {
+                loop.exiting_blocks.push_back(block);
+            }
+        }
+        m_loops.push_back(std::move(loop));
+    }
+    // A loop nested in another one has fewer blocks
+    std::ranges::stable_sort(m_loops, {}, [](const Loop& loop) { return loop.blocks.size(); });
+    NumNaturalLoops += m_loops.size();
+
+    match_labels(cfg);
+}
+
+bool LoopInfo::dominates(size_t dominator, size_t block) const
+{
+    for (size_t runner = block; runner != ControlFlowGraph::ENTRY; runner = m_immediate_dominators[runner]) {
+        if (runner == dominator) {
+            return true;
+        }
+    }
+    return false;
+}
+
+void LoopInfo::match_labels(const ControlFlowGraph& cfg)
+{
+    const auto& blocks = cfg.blocks();
+    std::unordered_map<std::string, size_t> label_blocks;
+    for (size_t b = 0; b < blocks.size(); ++b) {
+        if (auto label = dynamic_cast<const LabelInstruction*>(blocks[b].instructions.front().get())) {
+            label_blocks.emplace(label->identifier.name, b);
+        }
+    }
+    auto innermost_loop = [&](size_t block) -> const Loop* {
+        auto it = std::ranges::find_if(m_loops, [&](const Loop& loop) { return loop.contains(block); });
+        return it != m_loops.end() ? &*it : nullptr;
+    };
+
+    // Statement names each loop has evidence for: its continue_ label is in the loop and no deeper one, its break_
+    // label is where the loop exits to
+    std::vector<std::set<std::string>> names(m_loops.size());
+    for (const auto& [label, block] : label_blocks) {
+        if (label.starts_with(CONTINUE_PREFIX)) {
+            std::string name = label.substr(CONTINUE_PREFIX.size());
+            auto break_block = label_blocks.find(BREAK_PREFIX + name);
+            const Loop* loop = innermost_loop(block);
+            if (loop && (break_block == label_blocks.end() || !loop->contains(break_block->second))) {
+                names[loop - m_loops.data()].insert(name);
+            }
+        } else if (label.starts_with(BREAK_PREFIX)) {
+            for (size_t l = 0; l < m_loops.size(); ++l) {
+                const Loop& loop = m_loops[l];
+                bool exits_here = !loop.contains(block) && std::ranges::any_of(loop.exiting_blocks, [&](size_t exiting) {
+                    return std::ranges::find(blocks[exiting].successors, block) != blocks[exiting].successors.end();
+                });
+                if (exits_here) {
+                    names[l].insert(label.substr(BREAK_PREFIX.size()));
+                    break;
+                }
+            }
+        }
+    }
+
+    for (size_t l = 0; l < m_loops.size(); ++l) {
+        if (names[l].size() == 1) {
+            m_loops[l].label = *names[l].begin();
+            ++NumLabeledLoops;
+        } else if (names[l].size() > 1) {
+            ++NumMismatchedLoopLabels;
+        }
+    }
+}
+
+bool tacky::can_insert_preheader(const ControlFlowGraph& cfg, const LoopInfo::Loop& loop)
+{
+    const auto& blocks = cfg.blocks();
+    size_t header = loop.header;
+    if (!dynamic_cast<const LabelInstruction*>(blocks[header].instructions.front().get())) {
+        return false;
+    }
+    // The preheader goes right before the header, a block of the loop falling through into it would run it
+    const auto& predecessors = blocks[header].predecessors;
+    return header == 0 || !loop.contains(header - 1) || std::ranges::find(predecessors, header - 1) == predecessors.end()
+        || dynamic_cast<const JumpInstruction*>(blocks[header - 1].instructions.back().get());
+}
+
+void tacky::insert_in_preheader(ControlFlowGraph& cfg, const LoopInfo::Loop& loop, std::vector<std::unique_ptr<Instruction>> instructions, NameGenerator& name_generator)
+{
+    auto& blocks = cfg.blocks();
+    size_t header = loop.header;
+    std::vector<size_t> outside;
+    std::ranges::copy_if(blocks[header].predecessors, std::back_inserter(outside), [&](size_t predecessor) { return !loop.contains(predecessor); });
+
+    // A block outside the loop that only leads to the header already is a preheader
+    if (outside.size() == 1 && outside.front() != ControlFlowGraph::ENTRY && blocks[outside.front()].successors == std::vector<size_t> { header }) {
+        auto& block_instructions = blocks[outside.front()].instructions;
+        auto position = ControlFlowGraph::jump_target(*block_instructions.back()) ? block_instructions.end() - 1 : block_instructions.end();
+        block_instructions.insert(position, std::make_move_iterator(instructions.begin()), std::make_move_iterator(instructions.end()));
+        return;
+    }
+
+    // A new block in front of the header, the jumps from outside the loop go there instead
+    const std::string& header_label = dynamic_cast<LabelInstruction&>(*blocks[header].instructions.front()).identifier.name;
+    std::string preheader_label = name_generator.make_label("preheader");
+    for (size_t predecessor : outside) {
+        if (predecessor == ControlFlowGraph::ENTRY) {
+            continue;
+        }
+        Instruction* last = blocks[predecessor].instructions.back().get();
+        if (auto jump = dynamic_cast<JumpInstruction*>(last); jump && jump->identifier.name == header_label) {
+            jump->identifier.name = preheader_label;
+        } else if (auto jump_if_zero = dynamic_cast<JumpIfZeroInstruction*>(last); jump_if_zero && jump_if_zero->identifier.name == header_label) {
+            jump_if_zero->identifier.name = preheader_label;
+        } else if (auto jump_if_not_zero = dynamic_cast<JumpIfNotZeroInstruction*>(last); jump_if_not_zero && jump_if_not_zero->identifier.name == header_label) {
+            jump_if_not_zero->identifier.name = preheader_label;
+        }
+    }
+    instructions.insert(instructions.begin(), std::make_unique<LabelInstruction>(preheader_label));
+    auto& header_instructions = blocks[header].instructions;
+    header_instructions.insert(header_instructions.begin(), std::make_move_iterator(instructions.begin()), std::make_move_iterator(instructions.end()));
+    ++NumPreheadersInserted;
+}
@@ -0,0 +1,165 @@
+#include "tacky/loop_invariant_code_motion.h"
+#include "common/stats/statistic.h"
+#include "tacky/control_flow_graph.h"
+#include "tacky/loop_info.h"
+#include "tacky/use_def.h"
+#include <algorithm>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <utility>
+#include <vector>
+
+using namespace tacky;
+
+STATISTIC(NumInstructionsHoisted, "licm", "Number of loop invariant instructions moved to a preheader");
+STATISTIC(NumLoadsHoisted, "licm", "Number of loop invariant loads moved to a preheader");
+
+namespace {
+
+const std::string* variable_name(const std::unique_ptr<Value>& value)
+{
+    auto variable = dynamic_cast<const TemporaryVariable*>(value.get());
+    return variable ? &variable->identifier.name : nullptr;
+}
+
+// Position of an instruction: block and index in the block
+using Position = std::pair<size_t, size_t>;
+
+bool writes_memory(const Instruction& instruction, const std::unordered_set<std::string>& aliased)
+{
+    if (dynamic_cast<const StoreInstruction*>(&instruction) || dynamic_cast<const FunctionCallInstruction*>(&instruction)
+        || dynamic_cast<const CopyToOffsetInstruction*>(&instruction)) {
+        return true;
+    }
+    auto destination = defined_variable(instruction);
+    return destination && aliased.contains(*destination);
+}
+
+}
+
+LoopInvariantCodeMotion::LoopInvariantCodeMotion(std::shared_ptr<SymbolTable> symbol_table, std::shared_ptr<NameGenerator> name_generator)
+    : m_symbol_table { symbol_table }
+    , m_name_generator { name_generator }
+{
+}
+
+bool LoopInvariantCodeMotion::run(FunctionDefinition& function)
+{
+    bool changed = false;
+    // Every round moves instructions out of one loop, the next one finds the loops again on the new code
+    while (hoist_from_next_loop(function)) {
+        changed = true;
+    }
+    return changed;
+}
+
+bool LoopInvariantCodeMotion::hoist_from_next_loop(FunctionDefinition& function)
+{
+    std::unordered_set<std::string> aliased = aliased_variables(function, *m_symbol_table);
+    ControlFlowGraph cfg(function);
+    LoopInfo loop_info(cfg);
+    auto& blocks = cfg.blocks();
+
+    std::unordered_map<std::string, size_t> definition_counts;
+    std::unordered_map<std::string, std::vector<Position>> uses;
+    for (size_t b = 0; b < blocks.size(); ++b) {
+        for (size_t k = 0; k < blocks[b].instructions.size(); ++k) {
+            auto& instruction = *blocks[b].instructions[k];
+            for (auto value : used_values(instruction)) {
+                if (auto name = variable_name(*value)) {
+                    uses[*name].emplace_back(b, k);
+                }
+            }
+            if (auto destination = defined_variable(instruction)) {
+                ++definition_counts[*destination];
+            }
+        }
+    }
+
+    for (const LoopInfo::Loop& loop : loop_info.loops()) {
+        if (!can_insert_preheader(cfg, loop)) {
+            continue;
+        }
+
+        bool loop_writes_memory = false;
+        std::unordered_map<std::string, size_t> loop_definitions;
+        for (size_t b : loop.blocks) {
+            for (auto& instruction : blocks[b].instructions) {
+                loop_writes_memory |= writes_memory(*instruction, aliased);
+                if (auto destination = defined_variable(*instruction)) {
+                    ++loop_definitions[*destination];
+                }
+            }
+        }
+
+        auto is_invariant_operand = [&](const std::unique_ptr<Value>& value) {
+            auto name = variable_name(value);
+            if (!name) {
+                return true;
+            }
+            return loop_definitions[*name] == 0 && (!aliased.contains(*name) || !loop_writes_memory);
+        };
+        auto runs_before_every_exit = [&](size_t block) {
+            return !loop.exiting_blocks.empty() && std::ranges::all_of(loop.exiting_blocks, [&](size_t exiting) { return loop_info.dominates(block, exiting); });
+        };
+        auto dominates_uses = [&](const std::string& variable, size_t block, size_t index) {
+            return std::ranges::all_of(uses[variable], [&](const Position& use) {
+                return use.first == block ? use.second > index : loop_info.dominates(block, use.first);
+            });
+        };
+
+        // Hoisting an instruction can make the ones reading it invariant, the order found is a valid order to run them
+        std::vector<Position> hoisted;
+        std::vector<std::vector<bool>> is_hoisted(blocks.size());
+        bool found = true;
+        while (found) {
+            found = false;
+            for (size_t b : loop.blocks) {
+                is_hoisted[b].resize(blocks[b].instructions.size(), false);
+                for (size_t k = 0; k < blocks[b].instructions.size(); ++k) {
+                    auto& instruction = *blocks[b].instructions[k];
+                    if (is_hoisted[b][k]) {
+                        continue;
+                    }
+                    bool is_load = dynamic_cast<LoadInstruction*>(&instruction) != nullptr;
+                    if (!is_speculatable(instruction, *m_symbol_table) && !(is_load && !loop_writes_memory && runs_before_every_exit(b))) {
+                        continue;
+                    }
+                    auto destination = defined_variable(instruction);
+                    if (!destination || aliased.contains(*destination) || definition_counts[*destination] != 1 || !dominates_uses(*destination, b, k)) {
+                        continue;
+                    }
+                    auto operands = used_values(instruction);
+                    if (!std::ranges::all_of(operands, [&](auto value) { return is_invariant_operand(*value); })) {
+                        continue;
+                    }
+                    is_hoisted[b][k] = true;
+                    hoisted.emplace_back(b, k);
+                    --loop_definitions[*destination];
+                    NumLoadsHoisted += is_load;
+                    found = true;
+                }
+            }
+        }
+        if (hoisted.empty()) {
+            continue;
+        }
+
+        std::vector<std::unique_ptr<Instruction>> preheader;
+        for (auto [b, k] : hoisted) {
+            preheader.push_back(std::move(blocks[b].instructions[k]));
+        }
+        for (size_t b : loop.blocks) {
+            std::erase(blocks[b].instructions, nullptr);
+        }
+        NumInstructionsHoisted += hoisted.size();
+
+        insert_in_preheader(cfg, loop, std::move(preheader), *m_name_generator);
+        cfg.write_back(function);
+        return true;
+    }
+
+    cfg.write_back(function);
+    return false;
+}
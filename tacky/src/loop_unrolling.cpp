@@ -0,0 +1,757 @@
+#include "tacky/loop_unrolling.h"
+#include "common/data/type.h"
+#include "common/stats/statistic.h"
+#include "tacky/constant_folding.h"
+#include "tacky/control_flow_graph.h"
+#include "tacky/loop_info.h"
+#include "tacky/use_def.h"
+#include <algorithm>
+#include <cstdint>
+#include <format>
+#include <optional>
+#include <string>
+#include <type_traits>
+#include <unordered_map>
+#include <unordered_set>
+#include <utility>
+#include <variant>
+#include <vector>
+
+using namespace tacky;
+
+STATISTIC(NumLoopsUnrolled, "loop-unroll", "Number of loops unrolled in front of a loop running the remaining iterations");
+STATISTIC(NumLoopsFullyUnrolled, "loop-unroll", "Number of loops with a known trip count unrolled completely");
+STATISTIC(NumBodiesCopied, "loop-unroll", "Number of copies of loop bodies made");
+
+namespace {
+
+// Blocks walked back from the loop looking for the value the counter has on entry
+constexpr size_t MAX_ENTRY_DISTANCE = 4;
+
+// Block and index in the block
+using Position = std::pair<size_t, size_t>;
+using Instructions = std::vector<std::unique_ptr<Instruction>>;
+
+const std::string* variable_name(const std::unique_ptr<Value>& value)
+{
+    auto variable = dynamic_cast<const TemporaryVariable*>(value.get());
+    return variable ? &variable->identifier.name : nullptr;
+}
+
+std::unique_ptr<Value> variable(const std::string& name)
+{
+    return std::make_unique<TemporaryVariable>(name);
+}
+
+std::optional<int64_t> integer_value(const ConstantType& value)
+{
+    return std::visit([](auto v) -> std::optional<int64_t> {
+        if constexpr (std::is_integral_v<decltype(v)>) {
+            return static_cast<int64_t>(v);
+        } else {
+            return std::nullopt;
+        }
+    },
+        value);
+}
+
+const std::string* label_name(const ControlFlowGraph::BasicBlock& block)
+{
+    auto label = dynamic_cast<const LabelInstruction*>(block.instructions.front().get());
+    return label ? &label->identifier.name : nullptr;
+}
+
+std::string* jump_label(Instruction& instruction)
+{
+    if (auto jump = dynamic_cast<JumpInstruction*>(&instruction)) {
+        return &jump->identifier.name;
+    }
+    if (auto jump_if_zero = dynamic_cast<JumpIfZeroInstruction*>(&instruction)) {
+        return &jump_if_zero->identifier.name;
+    }
+    if (auto jump_if_not_zero = dynamic_cast<JumpIfNotZeroInstruction*>(&instruction)) {
+        return &jump_if_not_zero->identifier.name;
+    }
+    return nullptr;
+}
+
+bool falls_through(const Instruction& instruction)
+{
+    return !dynamic_cast<const JumpInstruction*>(&instruction) && !dynamic_cast<const ReturnInstruction*>(&instruction);
+}
+
+std::unique_ptr<Value>* jump_condition(Instruction& instruction)
+{
+    if (auto jump_if_zero = dynamic_cast<JumpIfZeroInstruction*>(&instruction)) {
+        return &jump_if_zero->condition;
+    }
+    if (auto jump_if_not_zero = dynamic_cast<JumpIfNotZeroInstruction*>(&instruction)) {
+        return &jump_if_not_zero->condition;
+    }
+    return nullptr;
+}
+
+// A conditional jump over a jump to the label right after it, jcc A; jmp B; A:, becomes the opposite jump to B
+void invert_jumps_over_jumps(Instructions& instructions)
+{
+    for (size_t k = 0; k + 2 < instructions.size(); ++k) {
+        auto condition = jump_condition(*instructions[k]);
+        auto jump = dynamic_cast<JumpInstruction*>(instructions[k + 1].get());
+        auto label = dynamic_cast<LabelInstruction*>(instructions[k + 2].get());
+        if (!condition || !jump || !label || *jump_label(*instructions[k]) != label->identifier.name) {
+            continue;
+        }
+        std::unique_ptr<Instruction> inverted;
+        if (dynamic_cast<JumpIfZeroInstruction*>(instructions[k].get())) {
+            inverted = std::make_unique<JumpIfNotZeroInstruction>(std::move(*condition), jump->identifier.name);
+        } else {
+            inverted = std::make_unique<JumpIfZeroInstruction>(std::move(*condition), jump->identifier.name);
+        }
+        inverted->source_location = instructions[k]->source_location;
+        instructions[k] = std::move(inverted);
+        instructions.erase(instructions.begin() + static_cast<std::ptrdiff_t>(k) + 1);
+    }
+}
+
+// The operator that gives the same result with the operands swapped
+BinaryOperator swapped(BinaryOperator op)
+{
+    switch (op) {
+    case BinaryOperator::LESS_THAN:
+        return BinaryOperator::GREATER_THAN;
+    case BinaryOperator::LESS_OR_EQUAL:
+        return BinaryOperator::GREATER_OR_EQUAL;
+    case BinaryOperator::GREATER_THAN:
+        return BinaryOperator::LESS_THAN;
+    case BinaryOperator::GREATER_OR_EQUAL:
+        return BinaryOperator::LESS_OR_EQUAL;
+    default:
+        return op;
+    }
+}
+
+// The operator that gives the opposite result, integers and pointers have no unordered values
+BinaryOperator negated(BinaryOperator op)
+{
+    switch (op) {
+    case BinaryOperator::EQUAL:
+        return BinaryOperator::NOT_EQUAL;
+    case BinaryOperator::NOT_EQUAL:
+        return BinaryOperator::EQUAL;
+    case BinaryOperator::LESS_THAN:
+        return BinaryOperator::GREATER_OR_EQUAL;
+    case BinaryOperator::LESS_OR_EQUAL:
+        return BinaryOperator::GREATER_THAN;
+    case BinaryOperator::GREATER_THAN:
+        return BinaryOperator::LESS_OR_EQUAL;
+    case BinaryOperator::GREATER_OR_EQUAL:
+        return BinaryOperator::LESS_THAN;
+    default:
+        return op;
+    }
+}
+
+// i + c, c + i, i - c or AddPointer(i, c, scale), with c a constant other than zero
+struct Step {
+    std::string source;
+    BinaryOperator op;
+    ConstantType constant;
+    // What the instruction adds to i, in elements for a pointer
+    int64_t amount;
+    // Zero for an integer
+    size_t scale;
+};
+
+std::optional<Step> match_step(Instruction& instruction)
+{
+    if (auto add_pointer = dynamic_cast<AddPointerInstruction*>(&instruction)) {
+        auto source = variable_name(add_pointer->source_pointer);
+        auto index = dynamic_cast<Constant*>(add_pointer->index.get());
+        auto amount = index ? integer_value(index->value) : std::nullopt;
+        if (!source || !amount || *amount == 0) {
+            return std::nullopt;
+        }
+        return Step { *source, BinaryOperator::ADD, index->value, *amount, add_pointer->scale };
+    }
+    auto binary = dynamic_cast<BinaryInstruction*>(&instruction);
+    if (!binary || (binary->binary_operator != BinaryOperator::ADD && binary->binary_operator != BinaryOperator::SUBTRACT)) {
+        return std::nullopt;
+    }
+    auto source = variable_name(binary->source1);
+    auto constant = dynamic_cast<Constant*>(binary->source2.get());
+    if (!source && binary->binary_operator == BinaryOperator::ADD) {
+        source = variable_name(binary->source2);
+        constant = dynamic_cast<Constant*>(binary->source1.get());
+    }
+    auto amount = constant ? integer_value(constant->value) : std::nullopt;
+    if (!source || !amount || *amount == 0) {
+        return std::nullopt;
+    }
+    return Step { *source, binary->binary_operator, constant->value, binary->binary_operator == BinaryOperator::ADD ? *amount : -*amount, 0 };
+}
+
+struct Counter {
+    std::string name;
+    Step step;
+    // Times the counter was stepped in the iteration when the test reads it
+    size_t updates;
+};
+
+// The exit test of a loop: counter op bound keeps it going
+struct ExitTest {
+    // The block ending with the test, it runs in every iteration
+    size_t exiting;
+    // Where the test goes when it holds and when it does not
+    size_t inside;
+    size_t outside;
+    Counter counter;
+    BinaryOperator op;
+    Value* bound;
+};
+
+class Unroller {
+public:
+    Unroller(ControlFlowGraph& cfg, const LoopInfo& loop_info, const LoopInfo::Loop& loop, SymbolTable& symbol_table, NameGenerator& name_generator,
+        const std::unordered_set<std::string>& aliased)
+        : m_blocks { cfg.blocks() }
+        , m_loop_info { loop_info }
+        , m_loop { loop }
+        , m_symbol_table { symbol_table }
+        , m_name_generator { name_generator }
+        , m_aliased { aliased }
+    {
+        for (size_t b = 0; b < m_blocks.size(); ++b) {
+            if (auto label = label_name(m_blocks[b])) {
+                m_label_blocks.emplace(*label, b);
+            }
+        }
+        for (size_t b : m_loop.blocks) {
+            for (size_t k = 0; k < m_blocks[b].instructions.size(); ++k) {
+                if (auto destination = defined_variable(*m_blocks[b].instructions[k])) {
+                    m_loop_definitions[*destination].emplace_back(b, k);
+                }
+            }
+        }
+        for (auto& block : m_blocks) {
+            for (auto& instruction : block.instructions) {
+                for (auto slot : used_values(*instruction)) {
+                    if (auto name = variable_name(*slot)) {
+                        ++m_use_counts[*name];
+                    }
+                }
+            }
+        }
+    }
+
+    // Instructions in the body, labels aside
+    size_t size() const
+    {
+        size_t size = 0;
+        for (size_t b : m_loop.blocks) {
+            size += std::ranges::count_if(m_blocks[b].instructions, [](const auto& instruction) { return !dynamic_cast<LabelInstruction*>(instruction.get()); });
+        }
+        return size;
+    }
+
+    // Looks for a test on an induction variable that decides whether the loop goes on, returns false if there is none
+    // and rejection() tells why
+    bool find_exit_test()
+    {
+        m_rejection = "no exit test compares an induction variable with a bound";
+        size_t latch = m_loop.latches.front();
+        for (size_t exiting : m_loop.exiting_blocks) {
+            auto& instructions = m_blocks[exiting].instructions;
+            const auto& successors = m_blocks[exiting].successors;
+            if (instructions.size() < 2 || successors.size() != 2 || !m_loop_info.dominates(exiting, latch)) {
+                continue;
+            }
+            Value* condition = nullptr;
+            bool jumps_if_true = false;
+            if (auto jump_if_zero = dynamic_cast<JumpIfZeroInstruction*>(instructions.back().get())) {
+                condition = jump_if_zero->condition.get();
+            } else if (auto jump_if_not_zero = dynamic_cast<JumpIfNotZeroInstruction*>(instructions.back().get())) {
+                condition = jump_if_not_zero->condition.get();
+                jumps_if_true = true;
+            }
+            auto condition_variable = dynamic_cast<TemporaryVariable*>(condition);
+            auto compare = dynamic_cast<BinaryInstruction*>(instructions[instructions.size() - 2].get());
+            if (!condition_variable || !compare || *variable_name(compare->destination) != condition_variable->identifier.name) {
+                continue;
+            }
+
+            size_t target = m_label_blocks.at(*jump_label(*instructions.back()));
+            size_t fall_through = target == successors[0] ? successors[1] : successors[0];
+            bool stays_on_jump = m_loop.contains(target);
+            if (stays_on_jump == m_loop.contains(fall_through)) {
+                continue;
+            }
+            // The operator that keeps the loop going, with the counter on the left
+            BinaryOperator op = stays_on_jump == jumps_if_true ? compare->binary_operator : negated(compare->binary_operator);
+            Position test { exiting, instructions.size() - 2 };
+            bool counter_on_left = true;
+            auto counter = find_counter(compare->source1, test);
+            if (!counter) {
+                counter = find_counter(compare->source2, test);
+                counter_on_left = false;
+                op = swapped(op);
+            }
+            if (!counter) {
+                continue;
+            }
+            const std::unique_ptr<Value>& bound = counter_on_left ? compare->source2 : compare->source1;
+            // The counter moves toward the bound, comparing the counter a few steps ahead tells whether it gets there
+            bool counts_up = counter->step.amount > 0;
+            bool moves_toward_bound = op == BinaryOperator::NOT_EQUAL
+                || (counts_up ? op == BinaryOperator::LESS_THAN || op == BinaryOperator::LESS_OR_EQUAL
+                              : op == BinaryOperator::GREATER_THAN || op == BinaryOperator::GREATER_OR_EQUAL);
+            if (!moves_toward_bound) {
+                m_rejection = std::format("the counter '{}' moves away from the bound of the exit test", counter->name);
+                continue;
+            }
+            if (!is_invariant(bound)) {
+                m_rejection = std::format("the bound of the exit test on '{}' is not loop-invariant", counter->name);
+                continue;
+            }
+            m_exit_test = ExitTest { exiting, stays_on_jump ? target : fall_through, stays_on_jump ? fall_through : target, *counter, op, bound.get() };
+            return true;
+        }
+        return false;
+    }
+
+    const std::string& rejection() const { return m_rejection; }
+
+    // Number of iterations of the loop when it is known at compile time and at most max_trips
+    std::optional<size_t> trip_count(size_t max_trips)
+    {
+        const ExitTest& exit_test = *m_exit_test;
+        auto bound = dynamic_cast<const Constant*>(exit_test.bound);
+        std::optional<ConstantType> counter = entry_value(exit_test.counter.name);
+        if (exit_test.counter.step.scale != 0 || !bound || !counter) {
+            return std::nullopt;
+        }
+        // The counter as the test of each iteration sees it, stepped like the program does
+        for (size_t update = 0; update < exit_test.counter.updates && counter; ++update) {
+            counter = evaluate_binary(exit_test.counter.step.op, *counter, exit_test.counter.step.constant);
+        }
+        for (size_t trips = 1; trips <= max_trips && counter; ++trips) {
+            auto holds = evaluate_binary(exit_test.op, *counter, bound->value);
+            if (!holds) {
+                return std::nullopt;
+            }
+            if (integer_value(*holds).value_or(1) == 0) {
+                return trips;
+            }
+            counter = evaluate_binary(exit_test.counter.step.op, *counter, exit_test.counter.step.constant);
+        }
+        return std::nullopt;
+    }
+
+    // The body once per iteration, the loop is left in place with no way in
+    Instructions unroll_completely(size_t trips)
+    {
+        return copy_bodies(trips, *label_name(m_blocks[m_loop.header]), true);
+    }
+
+    // Factor copies of the body with one exit test at the end, run while factor more iterations remain, the loop runs
+    // the ones left after them. Like the loop, the copies are rotated: a check in front of them decides whether they
+    // run at all, the one after them whether they run again, otherwise the code falls through into the loop
+    Instructions unroll(size_t factor, const std::string& body_label)
+    {
+        std::string check_label = m_name_generator.make_label("unroll_check");
+        Instructions instructions = factor_check(factor, false, *label_name(m_blocks[m_loop.header]));
+        instructions.push_back(std::make_unique<LabelInstruction>(body_label));
+        std::ranges::move(copy_bodies(factor, check_label, false), std::back_inserter(instructions));
+        instructions.push_back(std::make_unique<LabelInstruction>(check_label));
+        std::ranges::move(factor_check(factor, true, body_label), std::back_inserter(instructions));
+        invert_jumps_over_jumps(instructions);
+        return instructions;
+    }
+
+private:
+    Instruction& at(Position position) { return *m_blocks[position.first].instructions[position.second]; }
+
+    // Whether factor more iterations remain, jumps to target when they do (jump_if_remain) or when they do not
+    Instructions factor_check(size_t factor, bool jump_if_remain, const std::string& target)
+    {
+        const ExitTest& exit_test = *m_exit_test;
+        const Instruction& origin = *m_blocks[exit_test.exiting].instructions[m_blocks[exit_test.exiting].instructions.size() - 2];
+        Instructions instructions;
+        auto emit = [&](std::unique_ptr<Instruction> instruction) {
+            instruction->source_location = origin.source_location;
+            instructions.push_back(std::move(instruction));
+        };
+
+        // The test of copy factor - 1 is the last one left out, it would see the counter stepped this many times
+        int64_t ahead = exit_test.counter.step.amount * static_cast<int64_t>(factor - 2 + exit_test.counter.updates);
+        const Type& counter_type = *m_symbol_table.symbol_at(exit_test.counter.name).type;
+        std::string limit = make_variable("unroll_limit", counter_type.is_integer() ? std::make_unique<LongType>() : counter_type.clone());
+        std::unique_ptr<Value> bound;
+        if (counter_type.is_integer()) {
+            // In long the counter a few steps ahead cannot wrap around where the counter of the loop did not
+            auto widen = [&](const Value& value) -> std::unique_ptr<Value> {
+                if (auto constant = dynamic_cast<const Constant*>(&value)) {
+                    return std::make_unique<Constant>(*convert_constant(constant->value, LongType()));
+                }
+                const std::string& name = dynamic_cast<const TemporaryVariable&>(value).identifier.name;
+                std::string widened = make_variable(name, std::make_unique<LongType>());
+                if (counter_type.is_signed()) {
+                    emit(std::make_unique<SignExtendInstruction>(variable(name), variable(widened)));
+                } else {
+                    emit(std::make_unique<ZeroExtendInstruction>(variable(name), variable(widened)));
+                }
+                return variable(widened);
+            };
+            std::unique_ptr<Value> counter = widen(TemporaryVariable(exit_test.counter.name));
+            bound = widen(*exit_test.bound);
+            emit(std::make_unique<BinaryInstruction>(BinaryOperator::ADD, std::move(counter), std::make_unique<Constant>(ahead), variable(limit)));
+        } else {
+            bound = exit_test.bound->clone();
+            emit(std::make_unique<AddPointerInstruction>(variable(exit_test.counter.name), std::make_unique<Constant>(ahead), exit_test.counter.step.scale, variable(limit)));
+        }
+        // A counter that stops where it equals the bound does not pass it on the way
+        BinaryOperator op = exit_test.op;
+        if (op == BinaryOperator::NOT_EQUAL) {
+            op = exit_test.counter.step.amount > 0 ? BinaryOperator::LESS_THAN : BinaryOperator::GREATER_THAN;
+        }
+        std::string check = make_variable("unroll_check", std::make_unique<IntType>());
+        emit(std::make_unique<BinaryInstruction>(op, variable(limit), std::move(bound), variable(check)));
+        if (jump_if_remain) {
+            emit(std::make_unique<JumpIfNotZeroInstruction>(variable(check), target));
+        } else {
+            emit(std::make_unique<JumpIfZeroInstruction>(variable(check), target));
+        }
+        return instructions;
+    }
+
+    // Name of the variable instruction k of a block computes for the conditional jump right after it and for nothing
+    // else. Every copy gets a variable of its own, the assembly then tests the flags of the comparison directly
+    const std::string* branch_condition(const Instructions& instructions, size_t k) const
+    {
+        if (k + 1 >= instructions.size()) {
+            return nullptr;
+        }
+        auto condition = jump_condition(*instructions[k + 1]);
+        auto name = condition ? variable_name(*condition) : nullptr;
+        auto destination = defined_variable(*instructions[k]);
+        if (!name || !destination || *destination != *name || !is_local(*name) || m_use_counts.at(*name) != 1) {
+            return nullptr;
+        }
+        return name;
+    }
+
+    bool dominates(Position a, Position b) const
+    {
+        return a.first == b.first ? a.second < b.second : m_loop_info.dominates(a.first, b.first);
+    }
+
+    bool is_local(const std::string& name) const
+    {
+        return !m_aliased.contains(name) && m_symbol_table.contains_symbol(name);
+    }
+
+    bool is_invariant(const std::unique_ptr<Value>& value) const
+    {
+        auto name = variable_name(value);
+        return !name || (!m_aliased.contains(*name) && !m_loop_definitions.contains(*name));
+    }
+
+    // The only instruction of the loop writing a local variable
+    std::optional<Position> single_loop_definition(const std::string& name) const
+    {
+        auto it = m_loop_definitions.find(name);
+        if (!is_local(name) || it == m_loop_definitions.end() || it->second.size() != 1) {
+            return std::nullopt;
+        }
+        return it->second.front();
+    }
+
+    std::string make_variable(const std::string& name, std::unique_ptr<Type> type)
+    {
+        std::string temporary = m_name_generator.make_temporary(name);
+        m_symbol_table.insert_symbol(temporary, std::move(type), LocalAttribute {});
+        return temporary;
+    }
+
+    // A counter stepped once per iteration by an instruction writing it, or by a copy of next = i + c, and read by the
+    // test as i or as next
+    std::optional<Counter> find_counter(const std::unique_ptr<Value>& value, Position test)
+    {
+        auto name = variable_name(value);
+        auto definition = name ? single_loop_definition(*name) : std::nullopt;
+        if (!definition) {
+            return std::nullopt;
+        }
+        Counter counter { *name, {}, 0 };
+        std::optional<Step> step = match_step(at(*definition));
+        if (step && step->source != *name) {
+            // The test reads next, computed from i before i is stepped
+            counter.name = step->source;
+            auto update = single_loop_definition(counter.name);
+            auto copy = update ? dynamic_cast<CopyInstruction*>(&at(*update)) : nullptr;
+            if (!copy || !variable_name(copy->source) || *variable_name(copy->source) != *name || !dominates(*definition, *update) || !dominates(*definition, test)) {
+                return std::nullopt;
+            }
+            counter.updates = 1;
+            definition = update;
+        } else {
+            if (!step) {
+                // i = next, with next = i + c computed before
+                auto copy = dynamic_cast<CopyInstruction*>(&at(*definition));
+                auto next = copy ? variable_name(copy->source) : nullptr;
+                auto next_definition = next ? single_loop_definition(*next) : std::nullopt;
+                step = next_definition ? match_step(at(*next_definition)) : std::nullopt;
+                if (!step || step->source != counter.name || !dominates(*next_definition, *definition)) {
+                    return std::nullopt;
+                }
+            }
+            if (dominates(*definition, test)) {
+                counter.updates = 1;
+            } else if (!dominates(test, *definition)) {
+                return std::nullopt;
+            }
+        }
+        counter.step = *step;
+
+        // Stepped exactly once in every iteration that goes on
+        const Type& type = *m_symbol_table.symbol_at(counter.name).type;
+        bool is_counter_type = dynamic_cast<const IntType*>(&type) || dynamic_cast<const UnsignedIntType*>(&type) || dynamic_cast<const PointerType*>(&type);
+        if (!is_counter_type) {
+            m_rejection = std::format("the counter '{}' is not an int, an unsigned int or a pointer", counter.name);
+            return std::nullopt;
+        }
+        if (!m_loop_info.dominates(definition->first, m_loop.latches.front())) {
+            return std::nullopt;
+        }
+        return counter;
+    }
+
+    // The constant the counter has when the loop is entered, if it is set to one on the only way into the loop. Only
+    // the blocks that lead to the header one after the other are walked, from the header backwards
+    std::optional<ConstantType> entry_value(const std::string& counter) const
+    {
+        std::vector<size_t> outside;
+        std::ranges::copy_if(m_blocks[m_loop.header].predecessors, std::back_inserter(outside), [&](size_t predecessor) { return !m_loop.contains(predecessor); });
+        if (outside.size() != 1) {
+            return std::nullopt;
+        }
+        size_t block = outside.front();
+        for (size_t distance = 0; distance < MAX_ENTRY_DISTANCE && block != ControlFlowGraph::ENTRY; ++distance) {
+            const auto& instructions = m_blocks[block].instructions;
+            for (size_t k = instructions.size(); k-- > 0;) {
+                auto destination = defined_variable(*instructions[k]);
+                if (destination && *destination == counter) {
+                    auto copy = dynamic_cast<const CopyInstruction*>(instructions[k].get());
+                    auto constant = copy ? dynamic_cast<const Constant*>(copy->source.get()) : nullptr;
+                    return constant ? std::optional(constant->value) : std::nullopt;
+                }
+            }
+            const auto& predecessors = m_blocks[block].predecessors;
+            if (predecessors.size() != 1) {
+                return std::nullopt;
+            }
+            block = predecessors.front();
+        }
+        return std::nullopt;
+    }
+
+    // Label of a block out of the loop the copies jump to, a block only fallen into gets one
+    std::string outside_label(size_t block)
+    {
+        if (auto label = label_name(m_blocks[block])) {
+            return *label;
+        }
+        std::string label = m_name_generator.make_label("loop_exit");
+        auto& instructions = m_blocks[block].instructions;
+        instructions.insert(instructions.begin(), std::make_unique<LabelInstruction>(label));
+        m_label_blocks.emplace(label, block);
+        return label;
+    }
+
+    // Copies of the body one after the other, each starting at its copy of the header. Where an iteration goes on, a
+    // copy goes to the next one and the last copy to last_target. The exit test is left out of every copy but the last,
+    // where it stays or, with exits_after_last, becomes a jump out of the loop
+    Instructions copy_bodies(size_t copies, const std::string& last_target, bool exits_after_last)
+    {
+        const ExitTest& exit_test = *m_exit_test;
+        std::vector<size_t> order { m_loop.header };
+        std::ranges::copy_if(m_loop.blocks, std::back_inserter(order), [&](size_t block) { return block != m_loop.header; });
+        std::vector<std::unordered_map<size_t, std::string>> labels(copies);
+        for (size_t copy = 0; copy < copies; ++copy) {
+            for (size_t block : order) {
+                auto label = label_name(m_blocks[block]);
+                labels[copy].emplace(block, m_name_generator.make_label(label ? *label : "unrolled"));
+            }
+        }
+        // Where a jump of a copy to the block goes
+        auto target = [&](size_t block, size_t copy) -> std::string {
+            if (!m_loop.contains(block)) {
+                return outside_label(block);
+            }
+            if (block == m_loop.header) {
+                return copy + 1 < copies ? labels[copy + 1].at(block) : last_target;
+            }
+            return labels[copy].at(block);
+        };
+
+        Instructions instructions;
+        for (size_t copy = 0; copy < copies; ++copy) {
+            bool is_last = copy + 1 == copies;
+            for (size_t block : order) {
+                const auto& block_instructions = m_blocks[block].instructions;
+                instructions.push_back(std::make_unique<LabelInstruction>(labels[copy].at(block)));
+                std::optional<std::string> condition;
+                for (size_t k = 0; k < block_instructions.size(); ++k) {
+                    const auto& instruction = block_instructions[k];
+                    bool is_exit_test = block == exit_test.exiting && instruction == block_instructions.back();
+                    if (dynamic_cast<LabelInstruction*>(instruction.get()) || (is_exit_test && (!is_last || exits_after_last))) {
+                        continue;
+                    }
+                    std::unique_ptr<Instruction> clone = instruction->clone();
+                    if (auto label = jump_label(*clone); label && m_label_blocks.contains(*label)) {
+                        *label = target(m_label_blocks.at(*label), copy);
+                    }
+                    bool keeps_jump = !(block == exit_test.exiting && k + 2 == block_instructions.size() && (!is_last || exits_after_last));
+                    if (auto name = branch_condition(block_instructions, k); name && keeps_jump) {
+                        const Type& type = *m_symbol_table.symbol_at(*name).type;
+                        condition = make_variable(*name, type.clone());
+                        *defined_value(*clone) = variable(*condition);
+                    } else if (auto slot = jump_condition(*clone); slot && condition) {
+                        *slot = variable(*condition);
+                        condition.reset();
+                    }
+                    instructions.push_back(std::move(clone));
+                }
+
+                std::optional<std::string> next;
+                if (block == exit_test.exiting && !is_last) {
+                    next = target(exit_test.inside, copy);
+                } else if (block == exit_test.exiting && exits_after_last) {
+                    next = outside_label(exit_test.outside);
+                } else if (falls_through(*block_instructions.back()) && block + 1 < m_blocks.size()) {
+                    next = target(block + 1, copy);
+                }
+                if (next) {
+                    instructions.push_back(std::make_unique<JumpInstruction>(*next));
+                    instructions.back()->source_location = block_instructions.back()->source_location;
+                }
+            }
+        }
+        return instructions;
+    }
+
+    std::vector<ControlFlowGraph::BasicBlock>& m_blocks;
+    const LoopInfo& m_loop_info;
+    const LoopInfo::Loop& m_loop;
+    SymbolTable& m_symbol_table;
+    NameGenerator& m_name_generator;
+    const std::unordered_set<std::string>& m_aliased;
+
+    std::unordered_map<std::string, size_t> m_label_blocks;
+    std::unordered_map<std::string, std::vector<Position>> m_loop_definitions;
+    // Reads of each variable in the function
+    std::unordered_map<std::string, size_t> m_use_counts;
+    std::optional<ExitTest> m_exit_test;
+    // Why find_exit_test found none, the last candidate rejected for a reason worth reporting
+    std::string m_rejection;
+};
+
+// Location of the first instruction of the loop that has one, the header first
+std::optional<SourceLocationIndex> loop_location(const std::vector<ControlFlowGraph::BasicBlock>& blocks, const LoopInfo::Loop& loop)
+{
+    std::vector<size_t> order { loop.header };
+    std::ranges::copy_if(loop.blocks, std::back_inserter(order), [&](size_t block) { return block != loop.header; });
+    for (size_t block : order) {
+        for (const auto& instruction : blocks[block].instructions) {
+            if (instruction->source_location) {
+                return instruction->source_location;
+            }
+        }
+    }
+    return std::nullopt;
+}
+
+}
+
+LoopUnrolling::LoopUnrolling(std::shared_ptr<SymbolTable> symbol_table, std::shared_ptr<NameGenerator> name_generator, size_t factor, size_t size_budget,
+    std::shared_ptr<RemarkManager> remark_manager)
+    : m_symbol_table { symbol_table }
+    , m_name_generator { name_generator }
+    , m_factor { factor }
+    , m_size_budget { size_budget }
+    , m_remark_manager { remark_manager }
+{
+}
+
+bool LoopUnrolling::run(FunctionDefinition& function)
+{
+    bool changed = false;
+    // Every round unrolls one loop, the next one finds the loops again on the new code
+    while (unroll_next_loop(function)) {
+        changed = true;
+    }
+    return changed;
+}
+
+bool LoopUnrolling::unroll_next_loop(FunctionDefinition& function)
+{
+    std::unordered_set<std::string> aliased = aliased_variables(function, *m_symbol_table);
+    ControlFlowGraph cfg(function);
+    LoopInfo loop_info(cfg);
+    auto& blocks = cfg.blocks();
+
+    for (const LoopInfo::Loop& loop : loop_info.loops()) {
+        // The copies of an inner loop would each need an exit test of their own
+        bool is_innermost = std::ranges::none_of(loop_info.loops(), [&](const LoopInfo::Loop& other) { return &other != &loop && loop.contains(other.header); });
+        if (!is_innermost || loop.latches.size() != 1 || !can_insert_preheader(cfg, loop)) {
+            continue;
+        }
+        const std::string& header = dynamic_cast<LabelInstruction&>(*blocks[loop.header].instructions.front()).identifier.name;
+        if (m_unrolled_headers.contains(header)) {
+            continue;
+        }
+        // Every round sees the loops left alone again, the remark manager reports each remark once
+        std::optional<SourceLocationIndex> location = loop_location(blocks, loop);
+        Unroller unroller(cfg, loop_info, loop, *m_symbol_table, *m_name_generator, aliased);
+        size_t size = unroller.size();
+        size_t max_copies = m_size_budget / size;
+        if (max_copies < 2) {
+            emit_remark(m_remark_manager, RemarkKind::MISSED, "loop-unroll", function.name.name, location,
+                "loop not unrolled, two copies of its {} instructions exceed the size budget of {}", size, m_size_budget);
+            continue;
+        }
+        if (!unroller.find_exit_test()) {
+            emit_remark(m_remark_manager, RemarkKind::MISSED, "loop-unroll", function.name.name, location, "loop not unrolled, {}", unroller.rejection());
+            continue;
+        }
+
+        std::vector<std::unique_ptr<Instruction>> instructions;
+        if (auto trips = unroller.trip_count(max_copies)) {
+            instructions = unroller.unroll_completely(*trips);
+            ++NumLoopsFullyUnrolled;
+            NumBodiesCopied += *trips;
+            emit_remark(m_remark_manager, RemarkKind::PASSED, "loop-unroll", function.name.name, location, "loop fully unrolled, {} copies of its body", *trips);
+        } else {
+            size_t factor = std::min(m_factor, max_copies);
+            if (factor < 2) {
+                emit_remark(m_remark_manager, RemarkKind::MISSED, "loop-unroll", function.name.name, location,
+                    "loop not unrolled, its trip count is unknown and the unroll factor is {}", factor);
+                continue;
+            }
+            std::string body = m_name_generator->make_label("unrolled_body");
+            instructions = unroller.unroll(factor, body);
+            m_unrolled_headers.insert(body);
+            ++NumLoopsUnrolled;
+            NumBodiesCopied += factor;
+            emit_remark(m_remark_manager, RemarkKind::PASSED, "loop-unroll", function.name.name, location,
+                "loop unrolled by a factor of {}, the loop runs the remaining iterations", factor);
+        }
+        m_unrolled_headers.insert(header);
+
+        insert_in_preheader(cfg, loop, std::move(instructions), *m_name_generator);
+        cfg.write_back(function);
+        return true;
+    }
+
+    cfg.write_back(function);
+    return false;
+}
@@ -0,0 +1,437 @@
+#include "tacky/sparse_conditional_constant_propagation.h"
+#include "common/stats/statistic.h"
+#include "tacky/constant_folding.h"
+#include "tacky/use_def.h"
+#include <bit>
+#include <cstdint>
+#include <set>
+#include <unordered_map>
+#include <variant>
+
+using namespace tacky;
+
+STATISTIC(NumUsesReplaced, "sccp", "Number of uses of a variable replaced by the constant it always holds");
+STATISTIC(NumInstructionsFolded, "sccp", "Number of instructions replaced by a copy of the constant they compute");
+STATISTIC(NumBranchesResolved, "sccp", "Number of conditional jumps whose direction is known at compile time");
+STATISTIC(NumBlocksRemoved, "sccp", "Number of blocks found not executable and removed");
+
+namespace {
+
+// TOP: no executable definition seen yet, BOTTOM: not a compile time constant
+struct LatticeValue {
+    enum class State {
+        TOP,
+        CONSTANT,
+        BOTTOM
+    };
+
+    State state = State::TOP;
+    ConstantType constant;
+};
+
+const LatticeValue BOTTOM { LatticeValue::State::BOTTOM, {} };
+
+// Doubles compare by representation, 0.0 and -0.0 are different constants and NaN is the same as itself
+bool same_constant(const ConstantType& a, const ConstantType& b)
+{
+    if (a.index() != b.index()) {
+        return false;
+    }
+    return std::visit([&](auto x) {
+        using T = decltype(x);
+        if constexpr (std::is_same_v<T, double>) {
+            return std::bit_cast<uint64_t>(x) == std::bit_cast<uint64_t>(std::get<double>(b));
+        } else {
+            return x == std::get<T>(b);
+        }
+    },
+        a);
+}
+
+LatticeValue meet(const LatticeValue& a, const LatticeValue& b)
+{
+    if (a.state == LatticeValue::State::TOP) {
+        return b;
+    }
+    if (b.state == LatticeValue::State::TOP) {
+        return a;
+    }
+    if (a.state == LatticeValue::State::CONSTANT && b.state == LatticeValue::State::CONSTANT && same_constant(a.constant, b.constant)) {
+        return a;
+    }
+    return BOTTOM;
+}
+
+bool is_zero(const ConstantType& value)
+{
+    return std::visit([](auto v) {
+        if constexpr (std::is_same_v<decltype(v), std::monostate>) {
+            return false;
+        } else {
+            return v == 0;
+        }
+    },
+        value);
+}
+
+const TemporaryVariable* as_variable(const std::unique_ptr<Value>& value)
+{
+    return dynamic_cast<const TemporaryVariable*>(value.get());
+}
+
+struct Use {
+    size_t block;
+    size_t index;
+    bool phi;
+};
+
+class Solver {
+public:
+    Solver(SsaForm& ssa, const SymbolTable& symbol_table, std::shared_ptr<RemarkManager> remark_manager)
+        : m_ssa { ssa }
+        , m_symbol_table { symbol_table }
+        , m_remark_manager { remark_manager }
+    {
+        auto& blocks = m_ssa.cfg().blocks();
+        m_executable_blocks.assign(blocks.size(), false);
+        for (size_t b = 0; b < blocks.size(); ++b) {
+            if (blocks[b].instructions.empty()) {
+                continue;
+            }
+            if (auto label = dynamic_cast<LabelInstruction*>(blocks[b].instructions.front().get())) {
+                m_label_blocks.emplace(label->identifier.name, b);
+            }
+            auto& phis = m_ssa.phis(b);
+            for (size_t p = 0; p < phis.size(); ++p) {
+                for (const auto& argument : phis[p].arguments) {
+                    add_use(argument, { b, p, true });
+                }
+            }
+            for (size_t i = 0; i < blocks[b].instructions.size(); ++i) {
+                for (auto slot : used_values(*blocks[b].instructions[i])) {
+                    add_use(*slot, { b, i, false });
+                }
+            }
+        }
+    }
+
+    void solve()
+    {
+        if (m_ssa.cfg().blocks().empty()) {
+            return;
+        }
+        m_edge_worklist.emplace_back(ControlFlowGraph::ENTRY, 0);
+        while (!m_edge_worklist.empty() || !m_variable_worklist.empty()) {
+            while (!m_edge_worklist.empty()) {
+                auto [from, to] = m_edge_worklist.back();
+                m_edge_worklist.pop_back();
+                visit_edge(from, to);
+            }
+            while (!m_variable_worklist.empty()) {
+                std::string variable = std::move(m_variable_worklist.back());
+                m_variable_worklist.pop_back();
+                for (const Use& use : m_uses[variable]) {
+                    if (!m_executable_blocks[use.block]) {
+                        continue;
+                    }
+                    if (use.phi) {
+                        visit_phi(use.block, use.index);
+                    } else {
+                        visit_instruction(use.block, use.index);
+                    }
+                }
+            }
+        }
+    }
+
+    bool rewrite()
+    {
+        auto& blocks = m_ssa.cfg().blocks();
+        bool changed = false;
+
+        for (size_t b = 0; b < blocks.size(); ++b) {
+            if (!m_executable_blocks[b] && !blocks[b].instructions.empty()) {
+                remark_block_removed(m_remark_manager, "sccp", m_ssa.function_name(), blocks[b], "no executable edge reaches it");
+                m_ssa.remove_block(b);
+                ++NumBlocksRemoved;
+                changed = true;
+            }
+        }
+
+        for (size_t b = 0; b < blocks.size(); ++b) {
+            if (!m_executable_blocks[b]) {
+                continue;
+            }
+            for (size_t successor : std::vector<size_t>(blocks[b].successors)) {
+                if (successor != ControlFlowGraph::EXIT && !m_executable_edges.contains({ b, successor })) {
+                    m_ssa.remove_edge(b, successor);
+                }
+            }
+
+            auto& phis = m_ssa.phis(b);
+            changed |= std::erase_if(phis, [&](const SsaForm::Phi& phi) { return constant_of(phi.destination) != nullptr; }) > 0;
+            for (auto& phi : phis) {
+                for (auto& argument : phi.arguments) {
+                    changed |= replace_use(argument);
+                }
+            }
+
+            auto& instructions = blocks[b].instructions;
+            for (auto& instruction : instructions) {
+                auto slot = defined_value(*instruction);
+                auto destination = slot ? as_variable(*slot) : nullptr;
+                auto constant = destination ? constant_of(destination->identifier.name) : nullptr;
+                auto copy = dynamic_cast<CopyInstruction*>(instruction.get());
+                if (constant && !(copy && dynamic_cast<Constant*>(copy->source.get()))) {
+                    auto replacement = std::make_unique<CopyInstruction>(std::make_unique<Constant>(*constant), (*slot)->clone());
+                    replacement->source_location = instruction->source_location;
+                    instruction = std::move(replacement);
+                    ++NumInstructionsFolded;
+                    emit_remark(m_remark_manager, RemarkKind::PASSED, "sccp", m_ssa.function_name(), instruction->source_location, "value is always {}, the instruction became a copy of it",
+                        constant_to_string(*constant));
+                    changed = true;
+                    continue;
+                }
+                for (auto use : used_values(*instruction)) {
+                    changed |= replace_use(*use);
+                }
+            }
+
+            if (instructions.empty()) {
+                continue;
+            }
+            auto& last = instructions.back();
+            std::unique_ptr<Value>* condition = nullptr;
+            bool jump_if_zero = false;
+            if (auto instruction = dynamic_cast<JumpIfZeroInstruction*>(last.get())) {
+                condition = &instruction->condition;
+                jump_if_zero = true;
+            } else if (auto instruction = dynamic_cast<JumpIfNotZeroInstruction*>(last.get())) {
+                condition = &instruction->condition;
+            }
+            if (auto constant = condition ? dynamic_cast<Constant*>(condition->get()) : nullptr) {
+                std::string target = *ControlFlowGraph::jump_target(*last);
+                if (is_zero(constant->value) == jump_if_zero) {
+                    emit_remark(m_remark_manager, RemarkKind::PASSED, "sccp", m_ssa.function_name(), last->source_location, "branch to {} is always taken, it became a jump", target);
+                    auto jump = std::make_unique<JumpInstruction>(target);
+                    jump->source_location = last->source_location;
+                    last = std::move(jump);
+                } else {
+                    emit_remark(m_remark_manager, RemarkKind::PASSED, "sccp", m_ssa.function_name(), last->source_location, "branch to {} is never taken, it was removed", target);
+                    instructions.pop_back();
+                }
+                ++NumBranchesResolved;
+                changed = true;
+            }
+        }
+        return changed;
+    }
+
+private:
+    void add_use(const std::unique_ptr<Value>& value, Use use)
+    {
+        auto variable = as_variable(value);
+        if (variable && m_ssa.is_ssa_variable(variable->identifier.name)) {
+            m_uses[variable->identifier.name].push_back(use);
+        }
+    }
+
+    void visit_edge(size_t from, size_t to)
+    {
+        if (to == ControlFlowGraph::EXIT || !m_executable_edges.insert({ from, to }).second) {
+            return;
+        }
+        for (size_t p = 0; p < m_ssa.phis(to).size(); ++p) {
+            visit_phi(to, p);
+        }
+        if (m_executable_blocks[to]) {
+            return;
+        }
+        m_executable_blocks[to] = true;
+        for (size_t i = 0; i < m_ssa.cfg().blocks()[to].instructions.size(); ++i) {
+            visit_instruction(to, i);
+        }
+    }
+
+    void visit_phi(size_t block, size_t index)
+    {
+        const auto& predecessors = m_ssa.cfg().blocks()[block].predecessors;
+        const auto& phi = m_ssa.phis(block)[index];
+        LatticeValue result;
+        for (size_t i = 0; i < predecessors.size(); ++i) {
+            if (m_executable_edges.contains({ predecessors[i], block })) {
+                result = meet(result, convert(value_of(phi.arguments[i]), phi.destination));
+            }
+        }
+        lower(phi.destination, result);
+    }
+
+    void visit_instruction(size_t block, size_t index)
+    {
+        const auto& instructions = m_ssa.cfg().blocks()[block].instructions;
+        Instruction& instruction = *instructions[index];
+        if (auto slot = defined_value(instruction)) {
+            auto destination = as_variable(*slot);
+            if (destination && m_ssa.is_ssa_variable(destination->identifier.name)) {
+                lower(destination->identifier.name, evaluate(instruction, destination->identifier.name));
+            }
+        }
+        if (index + 1 != instructions.size()) {
+            return;
+        }
+
+        size_t fall_through = block + 1 < m_ssa.cfg().blocks().size() ? block + 1 : ControlFlowGraph::EXIT;
+        std::unique_ptr<Value>* condition = nullptr;
+        bool jump_if_zero = false;
+        if (dynamic_cast<ReturnInstruction*>(&instruction)) {
+            return;
+        } else if (auto jump = dynamic_cast<JumpInstruction*>(&instruction)) {
+            m_edge_worklist.emplace_back(block, m_label_blocks.at(jump->identifier.name));
+            return;
+        } else if (auto jump = dynamic_cast<JumpIfZeroInstruction*>(&instruction)) {
+            condition = &jump->condition;
+            jump_if_zero = true;
+        } else if (auto jump = dynamic_cast<JumpIfNotZeroInstruction*>(&instruction)) {
+            condition = &jump->condition;
+        } else {
+            m_edge_worklist.emplace_back(block, fall_through);
+            return;
+        }
+
+        size_t target = m_label_blocks.at(*ControlFlowGraph::jump_target(instruction));
+        LatticeValue value = value_of(*condition);
+        if (value.state == LatticeValue::State::BOTTOM) {
+            m_edge_worklist.emplace_back(block, target);
+            m_edge_worklist.emplace_back(block, fall_through);
+        } else if (value.state == LatticeValue::State::CONSTANT) {
+            m_edge_worklist.emplace_back(block, is_zero(value.constant) == jump_if_zero ? target : fall_through);
+        }
+    }
+
+    LatticeValue evaluate(Instruction& instruction, const std::string& destination)
+    {
+        if (auto copy = dynamic_cast<CopyInstruction*>(&instruction)) {
+            return convert(value_of(copy->source), destination);
+        } else if (auto unary = dynamic_cast<UnaryInstruction*>(&instruction)) {
+            LatticeValue source = value_of(unary->source);
+            if (source.state != LatticeValue::State::CONSTANT) {
+                return source;
+            }
+            auto result = evaluate_unary(unary->unary_operator, source.constant);
+            return result ? convert({ LatticeValue::State::CONSTANT, *result }, destination) : BOTTOM;
+        } else if (auto binary = dynamic_cast<BinaryInstruction*>(&instruction)) {
+            LatticeValue source1 = value_of(binary->source1);
+            LatticeValue source2 = value_of(binary->source2);
+            if (source1.state == LatticeValue::State::BOTTOM || source2.state == LatticeValue::State::BOTTOM) {
+                return BOTTOM;
+            }
+            if (source1.state == LatticeValue::State::TOP || source2.state == LatticeValue::State::TOP) {
+                return {};
+            }
+            auto result = evaluate_binary(binary->binary_operator, source1.constant, source2.constant);
+            return result ? convert({ LatticeValue::State::CONSTANT, *result }, destination) : BOTTOM;
+        } else if (auto select = dynamic_cast<SelectInstruction*>(&instruction)) {
+            LatticeValue condition = value_of(select->condition);
+            if (condition.state != LatticeValue::State::CONSTANT) {
+                return condition;
+            }
+            return convert(value_of(is_zero(condition.constant) ? select->false_value : select->true_value), destination);
+        } else if (auto sign_extend = dynamic_cast<SignExtendInstruction*>(&instruction)) {
+            return convert(value_of(sign_extend->source), destination);
+        } else if (auto truncate = dynamic_cast<TruncateInstruction*>(&instruction)) {
+            return convert(value_of(truncate->source), destination);
+        } else if (auto zero_extend = dynamic_cast<ZeroExtendInstruction*>(&instruction)) {
+            return convert(value_of(zero_extend->source), destination);
+        } else if (auto double_to_int = dynamic_cast<DoubleToIntIntruction*>(&instruction)) {
+            return convert(value_of(double_to_int->source), destination);
+        } else if (auto double_to_uint = dynamic_cast<DoubleToUIntIntruction*>(&instruction)) {
+            return convert(value_of(double_to_uint->source), destination);
+        } else if (auto int_to_double = dynamic_cast<IntToDoubleIntruction*>(&instruction)) {
+            return convert(value_of(int_to_double->source), destination);
+        } else if (auto uint_to_double = dynamic_cast<UIntToDoubleIntruction*>(&instruction)) {
+            return convert(value_of(uint_to_double->source), destination);
+        }
+        // Loads, calls and addresses are never known
+        return BOTTOM;
+    }
+
+    LatticeValue value_of(const std::unique_ptr<Value>& value) const
+    {
+        if (auto constant = dynamic_cast<const Constant*>(value.get())) {
+            return { LatticeValue::State::CONSTANT, constant->value };
+        }
+        auto variable = as_variable(value);
+        if (!variable || !m_ssa.is_ssa_variable(variable->identifier.name)) {
+            // Parameters and variables read before any definition
+            return BOTTOM;
+        }
+        auto it = m_values.find(variable->identifier.name);
+        return it == m_values.end() ? LatticeValue {} : it->second;
+    }
+
+    // Value with the representation of the variable it is stored in
+    LatticeValue convert(const LatticeValue& value, const std::string& variable) const
+    {
+        if (value.state != LatticeValue::State::CONSTANT) {
+            return value;
+        }
+        auto converted = convert_constant(value.constant, *m_symbol_table.symbol_at(variable).type);
+        return converted ? LatticeValue { LatticeValue::State::CONSTANT, *converted } : BOTTOM;
+    }
+
+    // Values only go down the lattice, which bounds the number of times each variable is revisited
+    void lower(const std::string& variable, const LatticeValue& value)
+    {
+        LatticeValue& current = m_values[variable];
+        LatticeValue lowered = meet(current, value);
+        if (lowered.state == current.state && (lowered.state != LatticeValue::State::CONSTANT || same_constant(lowered.constant, current.constant))) {
+            return;
+        }
+        current = lowered;
+        m_variable_worklist.push_back(variable);
+    }
+
+    const ConstantType* constant_of(const std::string& variable) const
+    {
+        auto it = m_values.find(variable);
+        return it != m_values.end() && it->second.state == LatticeValue::State::CONSTANT ? &it->second.constant : nullptr;
+    }
+
+    bool replace_use(std::unique_ptr<Value>& value)
+    {
+        auto variable = as_variable(value);
+        auto constant = variable ? constant_of(variable->identifier.name) : nullptr;
+        if (!constant) {
+            return false;
+        }
+        value = std::make_unique<Constant>(*constant);
+        ++NumUsesReplaced;
+        return true;
+    }
+
+    SsaForm& m_ssa;
+    const SymbolTable& m_symbol_table;
+    std::shared_ptr<RemarkManager> m_remark_manager;
+    std::unordered_map<std::string, size_t> m_label_blocks;
+    std::unordered_map<std::string, std::vector<Use>> m_uses;
+    std::unordered_map<std::string, LatticeValue> m_values;
+    std::set<std::pair<size_t, size_t>> m_executable_edges;
+    std::vector<bool> m_executable_blocks;
+    std::vector<std::pair<size_t, size_t>> m_edge_worklist;
+    std::vector<std::string> m_variable_worklist;
+};
+
+}
+
+SparseConditionalConstantPropagation::SparseConditionalConstantPropagation(std::shared_ptr<SymbolTable> symbol_table, std::shared_ptr<RemarkManager> remark_manager)
+    : m_symbol_table { symbol_table }
+    , m_remark_manager { remark_manager }
+{
+}
+
+bool SparseConditionalConstantPropagation::run(SsaForm& ssa)
+{
+    Solver solver(ssa, *m_symbol_table, m_remark_manager);
+    solver.solve();
+    return solver.rewrite();
+}
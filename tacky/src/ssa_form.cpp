@@ -0,0 +1,539 @@
+#include "tacky/ssa_form.h"
+#include "common/error/internal_compiler_error.h"
+#include "common/stats/statistic.h"
+#include "tacky/use_def.h"
+#include <algorithm>
+#include <limits>
+#include <unordered_set>
+
+using namespace tacky;
+
+STATISTIC(NumPhisInserted, "ssa", "Number of phi nodes inserted");
+STATISTIC(NumPhiCopies, "ssa", "Number of copies inserted to leave SSA form");
+STATISTIC(NumEdgesSplit, "ssa", "Number of edges split to hold the copies of phi nodes");
+STATISTIC(NumCopiesBeforeJump, "ssa", "Number of conditional jumps with the copies of their edge placed before them");
+
+namespace {
+
+constexpr size_t NONE = std::numeric_limits<size_t>::max();
+
+const std::string* variable_name(const std::unique_ptr<Value>& value)
+{
+    if (auto variable = dynamic_cast<const TemporaryVariable*>(value.get())) {
+        return &variable->identifier.name;
+    }
+    return nullptr;
+}
+
+using CopyList = std::vector<std::pair<std::string, std::unique_ptr<Value>>>;
+
+// True if the copies can move across the instruction: it neither reads what they write nor writes what they read
+bool is_independent_of(Instruction& instruction, const CopyList& copies)
+{
+    auto defined = defined_variable(instruction);
+    for (const auto& [destination, source] : copies) {
+        auto source_name = variable_name(source);
+        if (defined && ((source_name && *source_name == *defined) || destination == *defined)) {
+            return false;
+        }
+        for (auto slot : used_values(instruction)) {
+            if (auto name = variable_name(*slot); name && *name == destination) {
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+}
+
+SsaForm::SsaForm(FunctionDefinition& function, std::shared_ptr<SymbolTable> symbol_table, std::shared_ptr<NameGenerator> name_generator)
+    : m_function_name { function.name.name }
+    , m_aliased { aliased_variables(function, *symbol_table) }
+    , m_cfg { function }
+    , m_symbol_table { symbol_table }
+    , m_name_generator { name_generator }
+{
+    auto& blocks = m_cfg.blocks();
+    m_phis.resize(blocks.size());
+    m_reachable = m_cfg.reachable_blocks();
+    compute_dominators();
+
+    auto is_candidate = [&](const std::string& name) {
+        if (m_aliased.contains(name) || !m_symbol_table->contains_symbol(name)) {
+            return false;
+        }
+        const auto& symbol = m_symbol_table->symbol_at(name);
+        return std::holds_alternative<LocalAttribute>(symbol.attribute) && symbol.type->is_scalar();
+    };
+
+    // Variables read in a block before the block writes them need phi nodes, the others never live across blocks
+    std::vector<std::string> global_variables;
+    std::unordered_set<std::string> seen_global;
+    for (size_t b = 0; b < blocks.size(); ++b) {
+        if (!m_reachable[b]) {
+            continue;
+        }
+        std::unordered_set<std::string> defined;
+        for (auto& instruction : blocks[b].instructions) {
+            for (auto slot : used_values(*instruction)) {
+                auto name = variable_name(*slot);
+                if (name && !defined.contains(*name) && is_candidate(*name) && seen_global.insert(*name).second) {
+                    global_variables.push_back(*name);
+                }
+            }
+            if (auto slot = defined_value(*instruction)) {
+                if (auto name = variable_name(*slot); name && is_candidate(*name)) {
+                    m_candidates.insert(*name);
+                    defined.insert(*name);
+                }
+            }
+        }
+    }
+    for (const auto& name : global_variables) {
+        m_candidates.insert(name);
+    }
+
+    place_phis(global_variables);
+
+    // Renaming walks the dominator tree, the definitions of a block are visible in the blocks it dominates
+    std::unordered_map<std::string, std::vector<std::string>> stacks;
+    for (const auto& name : m_candidates) {
+        stacks[name].push_back(name);
+    }
+    if (!blocks.empty()) {
+        rename(0, stacks);
+    }
+}
+
+void SsaForm::compute_dominators()
+{
+    m_immediate_dominators = m_cfg.immediate_dominators();
+    m_dominator_tree.assign(m_cfg.blocks().size(), {});
+    for (size_t block : m_cfg.reverse_postorder()) {
+        if (m_immediate_dominators[block] != ControlFlowGraph::ENTRY) {
+            m_dominator_tree[m_immediate_dominators[block]].push_back(block);
+        }
+    }
+}
+
+void SsaForm::place_phis(const std::vector<std::string>& variables)
+{
+    const auto& blocks = m_cfg.blocks();
+
+    std::vector<std::vector<size_t>> frontiers(blocks.size());
+    for (size_t b = 0; b < blocks.size(); ++b) {
+        const auto& predecessors = blocks[b].predecessors;
+        if (!m_reachable[b] || predecessors.size() < 2) {
+            continue;
+        }
+        for (size_t predecessor : predecessors) {
+            if (predecessor == ControlFlowGraph::ENTRY || !m_reachable[predecessor]) {
+                continue;
+            }
+            for (size_t runner = predecessor; runner != ControlFlowGraph::ENTRY && runner != m_immediate_dominators[b];
+                runner = m_immediate_dominators[runner]) {
+                if (frontiers[runner].empty() || frontiers[runner].back() != b) {
+                    frontiers[runner].push_back(b);
+                }
+            }
+        }
+    }
+
+    std::unordered_map<std::string, std::vector<size_t>> definition_blocks;
+    std::unordered_set<std::string> wanted(variables.begin(), variables.end());
+    for (size_t b = 0; b < blocks.size(); ++b) {
+        if (!m_reachable[b]) {
+            continue;
+        }
+        for (const auto& instruction : blocks[b].instructions) {
+            if (auto slot = defined_value(*instruction)) {
+                auto name = variable_name(*slot);
+                if (name && wanted.contains(*name)) {
+                    auto& definitions = definition_blocks[*name];
+                    if (definitions.empty() || definitions.back() != b) {
+                        definitions.push_back(b);
+                    }
+                }
+            }
+        }
+    }
+
+    std::vector<size_t> has_phi(blocks.size(), NONE);
+    std::vector<size_t> queued(blocks.size(), NONE);
+    for (size_t v = 0; v < variables.size(); ++v) {
+        const std::string& variable = variables[v];
+        std::vector<size_t> worklist = definition_blocks[variable];
+        for (size_t b : worklist) {
+            queued[b] = v;
+        }
+        while (!worklist.empty()) {
+            size_t block = worklist.back();
+            worklist.pop_back();
+            for (size_t frontier : frontiers[block]) {
+                if (has_phi[frontier] == v) {
+                    continue;
+                }
+                has_phi[frontier] = v;
+                Phi phi { variable, variable, {} };
+                for (size_t i = 0; i < blocks[frontier].predecessors.size(); ++i) {
+                    phi.arguments.push_back(std::make_unique<TemporaryVariable>(variable));
+                }
+                m_phis[frontier].push_back(std::move(phi));
+                ++NumPhisInserted;
+                if (queued[frontier] != v) {
+                    queued[frontier] = v;
+                    worklist.push_back(frontier);
+                }
+            }
+        }
+    }
+}
+
+void SsaForm::rename(size_t entry_block, std::unordered_map<std::string, std::vector<std::string>>& stacks)
+{
+    auto& blocks = m_cfg.blocks();
+    auto rename_definition = [&](const std::string& variable, std::vector<std::string>& pushed) {
+        std::string version = new_version(variable);
+        stacks[variable].push_back(version);
+        pushed.push_back(variable);
+        return version;
+    };
+
+    // Explicit stack instead of recursion, long chains of blocks make the dominator tree deep. A block is visited
+    // twice: to rename it and push its children, then to pop the versions it defined
+    struct Visit {
+        size_t block;
+        bool leaving;
+    };
+    std::vector<Visit> visits { { entry_block, false } };
+    std::vector<std::vector<std::string>> pushed(blocks.size());
+    while (!visits.empty()) {
+        Visit visit = visits.back();
+        visits.pop_back();
+        size_t block = visit.block;
+        if (visit.leaving) {
+            for (const auto& variable : pushed[block]) {
+                stacks[variable].pop_back();
+            }
+            continue;
+        }
+
+        for (Phi& phi : m_phis[block]) {
+            phi.destination = rename_definition(phi.variable, pushed[block]);
+        }
+        for (auto& instruction : blocks[block].instructions) {
+            for (auto slot : used_values(*instruction)) {
+                auto name = variable_name(*slot);
+                if (name && m_candidates.contains(*name)) {
+                    *slot = std::make_unique<TemporaryVariable>(stacks[*name].back());
+                }
+            }
+            if (auto slot = defined_value(*instruction)) {
+                auto name = variable_name(*slot);
+                if (name && m_candidates.contains(*name)) {
+                    *slot = std::make_unique<TemporaryVariable>(rename_definition(*name, pushed[block]));
+                }
+            }
+        }
+        for (size_t successor : blocks[block].successors) {
+            if (successor == ControlFlowGraph::EXIT) {
+                continue;
+            }
+            const auto& predecessors = blocks[successor].predecessors;
+            size_t index = std::ranges::find(predecessors, block) - predecessors.begin();
+            for (Phi& phi : m_phis[successor]) {
+                phi.arguments[index] = std::make_unique<TemporaryVariable>(stacks[phi.variable].back());
+            }
+        }
+
+        visits.push_back({ block, true });
+        for (size_t child : m_dominator_tree[block]) {
+            visits.push_back({ child, false });
+        }
+    }
+}
+
+std::string SsaForm::new_version(const std::string& variable)
+{
+    std::string version = m_name_generator->make_temporary(variable);
+    m_symbol_table->insert_symbol(version, m_symbol_table->symbol_at(variable).type->clone(), LocalAttribute {});
+    m_original_names.emplace(version, variable);
+    return version;
+}
+
+void SsaForm::remove_edge(size_t from, size_t to)
+{
+    auto& blocks = m_cfg.blocks();
+    std::erase(blocks[from].successors, to);
+    if (to == ControlFlowGraph::EXIT) {
+        return;
+    }
+    auto& predecessors = blocks[to].predecessors;
+    auto it = std::ranges::find(predecessors, from);
+    if (it == predecessors.end()) {
+        return;
+    }
+    size_t index = it - predecessors.begin();
+    predecessors.erase(it);
+    for (Phi& phi : m_phis[to]) {
+        phi.arguments.erase(phi.arguments.begin() + index);
+    }
+}
+
+void SsaForm::remove_block(size_t block)
+{
+    auto& blocks = m_cfg.blocks();
+    for (size_t successor : std::vector<size_t>(blocks[block].successors)) {
+        remove_edge(block, successor);
+    }
+    blocks[block].instructions.clear();
+    m_phis[block].clear();
+    m_reachable[block] = false;
+}
+
+void SsaForm::destruct(FunctionDefinition& function)
+{
+    auto& blocks = m_cfg.blocks();
+
+    // Where the copies of each edge go: in front of the first block for ENTRY, at the end of a predecessor that
+    // only has this successor, or in a block of their own after a conditional jump. The copies of a jump back to
+    // the start of a loop go before the jump when nothing reads their destinations on the way out of the loop
+    CopyList entry_copies;
+    std::vector<CopyList> end_copies(blocks.size());
+    std::vector<CopyList> fall_through_copies(blocks.size());
+    std::vector<CopyList> jump_copies(blocks.size());
+    std::vector<CopyList> before_jump_copies(blocks.size());
+
+    // Blocks reading each variable, a phi argument is read at the end of its predecessor and in the block of the phi
+    std::unordered_map<std::string, std::vector<size_t>> reading_blocks;
+    for (size_t b = 0; b < blocks.size(); ++b) {
+        if (!m_reachable[b]) {
+            continue;
+        }
+        for (auto& instruction : blocks[b].instructions) {
+            for (auto slot : used_values(*instruction)) {
+                if (auto name = variable_name(*slot)) {
+                    reading_blocks[*name].push_back(b);
+                }
+            }
+        }
+        for (Phi& phi : m_phis[b]) {
+            for (size_t i = 0; i < phi.arguments.size(); ++i) {
+                if (auto name = variable_name(phi.arguments[i])) {
+                    reading_blocks[*name].push_back(b);
+                    reading_blocks[*name].push_back(blocks[b].predecessors[i]);
+                }
+            }
+        }
+    }
+    // The loop of the edge from -> to: to and the blocks reaching from without passing through to. When every read
+    // of the copied variables is inside, the fall through successor reaches them only after the phi nodes of to
+    // redefine them, the copies can run on both edges
+    auto are_dead_on_fall_through = [&](size_t from, size_t to, const CopyList& copies) {
+        size_t fall_through = from + 1;
+        if (fall_through >= blocks.size() || fall_through == to) {
+            return false;
+        }
+        std::vector<bool> in_loop(blocks.size(), false);
+        in_loop[to] = true;
+        in_loop[from] = true;
+        std::vector<size_t> worklist { from };
+        while (!worklist.empty()) {
+            size_t block = worklist.back();
+            worklist.pop_back();
+            for (size_t predecessor : blocks[block].predecessors) {
+                if (predecessor != ControlFlowGraph::ENTRY && !in_loop[predecessor]) {
+                    in_loop[predecessor] = true;
+                    worklist.push_back(predecessor);
+                }
+            }
+        }
+        if (in_loop[fall_through]) {
+            return false;
+        }
+        for (const auto& [destination, _] : copies) {
+            auto it = reading_blocks.find(destination);
+            if (it != reading_blocks.end() && std::ranges::any_of(it->second, [&](size_t reader) { return reader == ControlFlowGraph::ENTRY || !in_loop[reader]; })) {
+                return false;
+            }
+            // The jump itself reads its condition before the copies would run
+            for (auto slot : used_values(*blocks[from].instructions.back())) {
+                if (auto name = variable_name(*slot); name && *name == destination) {
+                    return false;
+                }
+            }
+            // A phi argument naming its own destination keeps the value of the loop, it has no copy
+            for (Phi& phi : m_phis[to]) {
+                if (phi.destination == destination && std::ranges::any_of(phi.arguments, [&](const auto& argument) {
+                        auto name = variable_name(argument);
+                        return name && *name == destination;
+                    })) {
+                    return false;
+                }
+            }
+        }
+        return true;
+    };
+
+    for (size_t b = 0; b < blocks.size(); ++b) {
+        if (!m_reachable[b] || m_phis[b].empty()) {
+            continue;
+        }
+        const auto& predecessors = blocks[b].predecessors;
+        auto label = dynamic_cast<LabelInstruction*>(blocks[b].instructions.front().get());
+        for (size_t i = 0; i < predecessors.size(); ++i) {
+            size_t predecessor = predecessors[i];
+            if (predecessor != ControlFlowGraph::ENTRY && !m_reachable[predecessor]) {
+                continue;
+            }
+            CopyList copies;
+            for (Phi& phi : m_phis[b]) {
+                auto source = variable_name(phi.arguments[i]);
+                if (!source || *source != phi.destination) {
+                    copies.emplace_back(phi.destination, phi.arguments[i]->clone());
+                }
+            }
+            if (copies.empty()) {
+                continue;
+            }
+
+            if (predecessor == ControlFlowGraph::ENTRY) {
+                entry_copies = std::move(copies);
+                continue;
+            }
+            const Instruction& last = *blocks[predecessor].instructions.back();
+            auto target = ControlFlowGraph::jump_target(last);
+            if (!target || dynamic_cast<const JumpInstruction*>(&last)) {
+                end_copies[predecessor] = std::move(copies);
+                continue;
+            }
+            // Both edges of a conditional jump can lead to this block
+            bool jumps_here = label && label->identifier.name == *target;
+            bool falls_through = predecessor + 1 == b;
+            if (!jumps_here && !falls_through) {
+                throw InternalCompilerError("SsaForm: predecessor does not lead to the block of a phi node");
+            }
+            if (jumps_here && !falls_through && are_dead_on_fall_through(predecessor, b, copies)) {
+                before_jump_copies[predecessor] = std::move(copies);
+                ++NumCopiesBeforeJump;
+                continue;
+            }
+            if (jumps_here) {
+                for (auto& [destination, source] : copies) {
+                    jump_copies[predecessor].emplace_back(destination, source->clone());
+                }
+                ++NumEdgesSplit;
+            }
+            if (falls_through) {
+                fall_through_copies[predecessor] = std::move(copies);
+                ++NumEdgesSplit;
+            }
+        }
+    }
+
+    function.body.clear();
+    auto append = [&](std::vector<std::unique_ptr<Instruction>> instructions) {
+        NumPhiCopies += instructions.size();
+        for (auto& instruction : instructions) {
+            function.body.push_back(std::move(instruction));
+        }
+    };
+
+    append(sequentialize_copies(std::move(entry_copies)));
+    std::vector<std::unique_ptr<Instruction>> split_blocks;
+    for (size_t b = 0; b < blocks.size(); ++b) {
+        auto& instructions = blocks[b].instructions;
+        std::unique_ptr<Instruction> jump;
+        if ((!end_copies[b].empty() && dynamic_cast<JumpInstruction*>(instructions.back().get())) || !before_jump_copies[b].empty()) {
+            jump = std::move(instructions.back());
+            instructions.pop_back();
+        }
+        if (!jump_copies[b].empty()) {
+            // Retarget the conditional jump to a new block holding the copies, which then jumps to the old target
+            std::string edge_label = m_name_generator->make_label("ssa_edge");
+            Identifier* target = nullptr;
+            if (auto jump_if_zero = dynamic_cast<JumpIfZeroInstruction*>(instructions.back().get())) {
+                target = &jump_if_zero->identifier;
+            } else if (auto jump_if_not_zero = dynamic_cast<JumpIfNotZeroInstruction*>(instructions.back().get())) {
+                target = &jump_if_not_zero->identifier;
+            } else {
+                throw InternalCompilerError("SsaForm: split edge does not start at a conditional jump");
+            }
+            split_blocks.push_back(std::make_unique<LabelInstruction>(edge_label));
+            for (auto& instruction : sequentialize_copies(std::move(jump_copies[b]))) {
+                ++NumPhiCopies;
+                split_blocks.push_back(std::move(instruction));
+            }
+            split_blocks.push_back(std::make_unique<JumpInstruction>(target->name));
+            target->name = edge_label;
+        }
+        for (auto& instruction : instructions) {
+            function.body.push_back(std::move(instruction));
+        }
+        append(sequentialize_copies(std::move(end_copies[b])));
+        if (!before_jump_copies[b].empty()) {
+            // The comparison the jump tests stays next to it, so that the backend can fuse them
+            std::unique_ptr<Instruction> condition;
+            auto tested = used_values(*jump);
+            auto defined = function.body.empty() ? std::nullopt : defined_variable(*function.body.back());
+            if (defined && tested.size() == 1 && variable_name(*tested.front()) && *variable_name(*tested.front()) == *defined
+                && is_independent_of(*function.body.back(), before_jump_copies[b])) {
+                condition = std::move(function.body.back());
+                function.body.pop_back();
+            }
+            append(sequentialize_copies(std::move(before_jump_copies[b])));
+            if (condition) {
+                function.body.push_back(std::move(condition));
+            }
+        }
+        if (jump) {
+            function.body.push_back(std::move(jump));
+        }
+        append(sequentialize_copies(std::move(fall_through_copies[b])));
+        instructions.clear();
+    }
+    for (auto& instruction : split_blocks) {
+        function.body.push_back(std::move(instruction));
+    }
+}
+
+std::vector<std::unique_ptr<Instruction>> SsaForm::sequentialize_copies(std::vector<std::pair<std::string, std::unique_ptr<Value>>> copies)
+{
+    std::vector<std::unique_ptr<Instruction>> sequence;
+    auto reads = [&](const std::string& variable) {
+        return std::ranges::any_of(copies, [&](const auto& copy) {
+            auto source = variable_name(copy.second);
+            return source && *source == variable;
+        });
+    };
+
+    while (!copies.empty()) {
+        // A copy whose destination no other pending copy reads can go first
+        auto ready = std::ranges::find_if(copies, [&](const auto& copy) {
+            auto source = variable_name(copy.second);
+            bool reads_itself = source && *source == copy.first;
+            return reads_itself || !reads(copy.first);
+        });
+        if (ready != copies.end()) {
+            auto source = variable_name(ready->second);
+            if (!source || *source != ready->first) {
+                sequence.push_back(std::make_unique<CopyInstruction>(std::move(ready->second), std::make_unique<TemporaryVariable>(ready->first)));
+            }
+            copies.erase(ready);
+            continue;
+        }
+
+        // Every remaining destination is still read, they form cycles. Saving one destination breaks its cycle
+        const std::string saved = copies.front().first;
+        std::string temporary = m_name_generator->make_temporary("ssa.swap");
+        m_symbol_table->insert_symbol(temporary, m_symbol_table->symbol_at(saved).type->clone(), LocalAttribute {});
+        sequence.push_back(std::make_unique<CopyInstruction>(std::make_unique<TemporaryVariable>(saved), std::make_unique<TemporaryVariable>(temporary)));
+        for (auto& [destination, source] : copies) {
+            if (auto name = variable_name(source); name && *name == saved) {
+                source = std::make_unique<TemporaryVariable>(temporary);
+            }
+        }
+    }
+    return sequence;
+}
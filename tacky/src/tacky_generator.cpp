@@ -2,6 +2,7 @@
 #include "common/data/symbol_table.h"
 #include "common/data/type.h"
 #include "common/error/internal_compiler_error.h"
+#include "common/stats/statistic.h"
 #include "parser/parser_ast.h"
 #include "tacky/tacky_ast.h"
 #include <cassert>
@@ -13,6 +14,11 @@
 
 using namespace tacky;
 
+STATISTIC(NumFunctions, "tacky-generator", "Number of functions lowered to tacky");
+STATISTIC(NumInstructions, "tacky-generator", "Number of tacky instructions generated");
+STATISTIC(MaxInstructionsPerFunction, "tacky-generator", "Maximum number of tacky instructions in a function");
+STATISTIC(NumTemporaries, "tacky-generator", "Number of temporaries created");
+
 TackyGenerator::TackyGenerator(std::shared_ptr<parser::ParserAST> ast, std::shared_ptr<NameGenerator> name_generator, std::shared_ptr<SymbolTable> symbol_table)
     : m_ast { ast }
     , m_name_generator { name_generator }
@@ -317,8 +323,7 @@ std::unique_ptr<ExpressionResult> TackyGenerator::transform_conditional_expressi
     std::string result = make_and_add_temporary(*conditional_expression.type);
 
     // Evaluate condition
-    std::unique_ptr<Value> cond = emit_tacky_and_convert(*conditional_expression.condition, instructions);
-    instructions.emplace_back(std::make_unique<JumpIfZeroInstruction>(std::move(cond), false_label));
+    emit_condition_jump(*conditional_expression.condition, false, false_label, instructions);
 
     // True branch
     std::unique_ptr<Value> true_value = emit_tacky_and_convert(*conditional_expression.true_expression, instructions);
@@ -489,6 +494,7 @@ std::unique_ptr<Value> TackyGenerator::emit_tacky_and_convert(parser::Expression
 
 void TackyGenerator::transform_statement(parser::Statement& statement, std::vector<std::unique_ptr<Instruction>>& instructions)
 {
+    size_t first_instruction = instructions.size();
     if (parser::ReturnStatement* return_statement = dynamic_cast<parser::ReturnStatement*>(&statement)) {
         transform_return_statement(*return_statement, instructions);
     } else if (parser::ExpressionStatement* expression_statement = dynamic_cast<parser::ExpressionStatement*>(&statement)) {
@@ -512,6 +518,7 @@ void TackyGenerator::transform_statement(parser::Statement& statement, std::vect
     } else {
         throw TackyGeneratorError("TackyGenerator: Invalid or Unsupported Statement");
     }
+    set_source_location(instructions, first_instruction, statement.source_location);
 }
 
 void TackyGenerator::transform_return_statement(parser::ReturnStatement& return_statement, std::vector<std::unique_ptr<Instruction>>& instructions)
@@ -526,21 +533,50 @@ void TackyGenerator::transform_expression_statement(parser::ExpressionStatement&
     emit_tacky(*(expression_statement.expression.get()), instructions);
 }
 
+void TackyGenerator::emit_condition_jump(parser::Expression& condition, bool jump_if_true, const std::string& target, std::vector<std::unique_ptr<Instruction>>& instructions)
+{
+    if (auto unary_expression = dynamic_cast<parser::UnaryExpression*>(&condition); unary_expression && unary_expression->unary_operator == parser::UnaryOperator::NOT) {
+        emit_condition_jump(*unary_expression->expression, !jump_if_true, target, instructions);
+        return;
+    }
+    if (auto binary_expression = dynamic_cast<parser::BinaryExpression*>(&condition)) {
+        bool is_and = binary_expression->binary_operator == parser::BinaryOperator::AND;
+        bool is_or = binary_expression->binary_operator == parser::BinaryOperator::OR;
+        if (is_and || is_or) {
+            // The left operand alone decides a && b when false and a || b when true
+            if (is_and != jump_if_true) {
+                emit_condition_jump(*binary_expression->left_expression, jump_if_true, target, instructions);
+                emit_condition_jump(*binary_expression->right_expression, jump_if_true, target, instructions);
+            } else {
+                std::string skip_label = m_name_generator->make_label(is_and ? "and_false" : "or_true");
+                emit_condition_jump(*binary_expression->left_expression, !jump_if_true, skip_label, instructions);
+                emit_condition_jump(*binary_expression->right_expression, jump_if_true, target, instructions);
+                instructions.emplace_back(std::make_unique<LabelInstruction>(skip_label));
+            }
+            return;
+        }
+    }
+    std::unique_ptr<Value> cond = emit_tacky_and_convert(condition, instructions);
+    if (jump_if_true) {
+        instructions.emplace_back(std::make_unique<JumpIfNotZeroInstruction>(std::move(cond), target));
+    } else {
+        instructions.emplace_back(std::make_unique<JumpIfZeroInstruction>(std::move(cond), target));
+    }
+}
+
 void TackyGenerator::transform_if_statement(parser::IfStatement& if_statement, std::vector<std::unique_ptr<Instruction>>& instructions)
 {
-    std::unique_ptr<Value> cond = emit_tacky_and_convert(*(if_statement.condition.get()), instructions);
-
     if (!if_statement.else_statement.has_value()) {
         // if without else
         std::string end_label = m_name_generator->make_label("if_end");
-        instructions.emplace_back(std::make_unique<JumpIfZeroInstruction>(std::move(cond), end_label));
+        emit_condition_jump(*if_statement.condition, false, end_label, instructions);
         transform_statement(*if_statement.then_statement, instructions);
         instructions.emplace_back(std::make_unique<LabelInstruction>(end_label));
     } else {
         // if with else
         std::string else_label = m_name_generator->make_label("else");
         std::string end_label = m_name_generator->make_label("if_end");
-        instructions.emplace_back(std::make_unique<JumpIfZeroInstruction>(std::move(cond), else_label));
+        emit_condition_jump(*if_statement.condition, false, else_label, instructions);
         transform_statement(*if_statement.then_statement, instructions);
         instructions.emplace_back(std::make_unique<JumpInstruction>(end_label));
         instructions.emplace_back(std::make_unique<LabelInstruction>(else_label));
@@ -575,23 +611,24 @@ void TackyGenerator::transform_do_while_statement(parser::DoWhileStatement& do_w
     instructions.emplace_back(std::make_unique<LabelInstruction>(start_label));
     transform_statement(*do_while_statement.body, instructions);
     instructions.emplace_back(std::make_unique<LabelInstruction>(continue_label));
-    std::unique_ptr<Value> cond = emit_tacky_and_convert(*(do_while_statement.condition.get()), instructions);
-    instructions.emplace_back(std::make_unique<JumpIfNotZeroInstruction>(std::move(cond), start_label));
+    emit_condition_jump(*do_while_statement.condition, true, start_label, instructions);
     instructions.emplace_back(std::make_unique<LabelInstruction>(break_label));
 }
 
 void TackyGenerator::transform_while_statement(parser::WhileStatement& while_statement, std::vector<std::unique_ptr<Instruction>>& instructions)
 {
+    std::string start_label = m_name_generator->make_label("while_start");
     std::string continue_label = "continue_" + while_statement.label.name;
     std::string break_label = "break_" + while_statement.label.name;
 
-    instructions.emplace_back(std::make_unique<LabelInstruction>(continue_label));
-    std::unique_ptr<Value> cond = emit_tacky_and_convert(*(while_statement.condition.get()), instructions);
-    instructions.emplace_back(std::make_unique<JumpIfZeroInstruction>(std::move(cond), break_label));
+    // Rotated: the test guards the first iteration and closes every iteration, one jump per iteration instead of two
+    emit_condition_jump(*while_statement.condition, false, break_label, instructions);
+    instructions.emplace_back(std::make_unique<LabelInstruction>(start_label));
 
     transform_statement(*while_statement.body, instructions);
 
-    instructions.emplace_back(std::make_unique<JumpInstruction>(continue_label));
+    instructions.emplace_back(std::make_unique<LabelInstruction>(continue_label));
+    emit_condition_jump(*while_statement.condition, true, start_label, instructions);
     instructions.emplace_back(std::make_unique<LabelInstruction>(break_label));
 }
 
@@ -604,14 +641,13 @@ void TackyGenerator::transform_for_statement(parser::ForStatement& for_statement
     // Initialize
     transform_for_init(*for_statement.init, instructions);
 
-    instructions.emplace_back(std::make_unique<LabelInstruction>(start_label));
-
-    // Condition
+    // Condition, rotated like a while loop
     if (for_statement.condition.has_value()) {
-        std::unique_ptr<Value> cond = emit_tacky_and_convert(*(for_statement.condition.value().get()), instructions);
-        instructions.emplace_back(std::make_unique<JumpIfZeroInstruction>(std::move(cond), break_label));
+        emit_condition_jump(*for_statement.condition.value(), false, break_label, instructions);
     }
 
+    instructions.emplace_back(std::make_unique<LabelInstruction>(start_label));
+
     // Body
     transform_statement(*for_statement.body, instructions);
 
@@ -624,7 +660,11 @@ void TackyGenerator::transform_for_statement(parser::ForStatement& for_statement
         emit_tacky(*(for_statement.post.value().get()), instructions);
     }
 
-    instructions.emplace_back(std::make_unique<JumpInstruction>(start_label));
+    if (for_statement.condition.has_value()) {
+        emit_condition_jump(*for_statement.condition.value(), true, start_label, instructions);
+    } else {
+        instructions.emplace_back(std::make_unique<JumpInstruction>(start_label));
+    }
     instructions.emplace_back(std::make_unique<LabelInstruction>(break_label));
 }
 
@@ -725,7 +765,9 @@ void TackyGenerator::transform_for_init(parser::ForInit& for_init, std::vector<s
 void TackyGenerator::transform_block_item(parser::BlockItem& block_item, std::vector<std::unique_ptr<Instruction>>& instructions)
 {
     if (parser::Declaration* declaration = dynamic_cast<parser::Declaration*>(&block_item)) {
+        size_t first_instruction = instructions.size();
         transform_declaration(*declaration, instructions);
+        set_source_location(instructions, first_instruction, declaration->source_location);
     } else if (parser::Statement* statement = dynamic_cast<parser::Statement*>(&block_item)) {
         transform_statement(*statement, instructions);
     } else {
@@ -752,8 +794,14 @@ std::unique_ptr<FunctionDefinition> TackyGenerator::transform_function(parser::F
         std::vector<std::unique_ptr<Instruction>> body;
         transform_block(*function.body.value().get(), body);
         body.emplace_back(std::make_unique<ReturnInstruction>(std::make_unique<Constant>(0)));
+        ++NumFunctions;
+        NumInstructions += body.size();
+        MaxInstructionsPerFunction.update_max(body.size());
+        set_source_location(body, 0, function.source_location);
         bool global = std::get<FunctionAttribute>(m_symbol_table->symbol_at(function.name.name).attribute).global;
-        return std::make_unique<FunctionDefinition>(function.name.name, global, params, std::move(body));
+        auto function_definition = std::make_unique<FunctionDefinition>(function.name.name, global, params, std::move(body));
+        function_definition->source_location = function.source_location;
+        return function_definition;
     }
 
     return nullptr;
@@ -784,10 +832,21 @@ std::unique_ptr<Program> TackyGenerator::transform_program(parser::Program& prog
 std::string TackyGenerator::make_and_add_temporary(const Type& type, const IdentifierAttribute& attr)
 {
     std::string temporary_name = m_name_generator->make_temporary();
+    ++NumTemporaries;
     m_symbol_table->insert_symbol(temporary_name, type.clone(), attr);
     return temporary_name;
 }
 
+void TackyGenerator::set_source_location(std::vector<std::unique_ptr<Instruction>>& instructions, size_t first, const SourceLocationIndex& location)
+{
+    // Nested statements are tagged first, only fill the instructions that are still missing a location
+    for (size_t i = first; i < instructions.size(); ++i) {
+        if (!instructions[i]->source_location.has_value()) {
+            instructions[i]->source_location = location;
+        }
+    }
+}
+
 std::unique_ptr<TemporaryVariable> TackyGenerator::make_temporary_variable(const Type& type, const IdentifierAttribute& attr)
 {
     return std::make_unique<TemporaryVariable>(make_and_add_temporary(type, attr));
@@ -0,0 +1,139 @@
+#include "tacky/tacky_optimizer.h"
+#include "common/log/log.h"
+#include "common/stats/statistic.h"
+#include "tacky/constant_folding.h"
+#include "tacky/copy_propagation.h"
+#include "tacky/dead_store_elimination.h"
+#include "tacky/global_value_numbering.h"
+#include "tacky/if_conversion.h"
+#include "tacky/induction_variable_strength_reduction.h"
+#include "tacky/loop_invariant_code_motion.h"
+#include "tacky/loop_unrolling.h"
+#include "tacky/sparse_conditional_constant_propagation.h"
+#include "tacky/ssa_form.h"
+#include "tacky/unreachable_code_elimination.h"
+#include <format>
+
+using namespace tacky;
+
+STATISTIC(NumOptimizerIterations, "tacky-optimizer", "Number of iterations of the Tacky optimization passes");
+STATISTIC(NumInstructionsRemoved, "tacky-optimizer", "Number of Tacky instructions removed by the optimization passes");
+STATISTIC(NumIterationLimitHits, "tacky-optimizer", "Number of times the cleanup passes stopped at the iteration limit before converging");
+
+namespace {
+
+// The passes usually converge in a handful of iterations. Long chains of values that are all known at compile time
+// converge only a few instructions per iteration, the limit bounds the compile time they cost
+constexpr size_t MAX_ITERATIONS = 10;
+
+constexpr const char* LOG_CONTEXT = "tacky-optimizer";
+
+}
+
+TackyOptimizer::TackyOptimizer(std::shared_ptr<TackyAST> ast, std::shared_ptr<SymbolTable> symbol_table, std::shared_ptr<NameGenerator> name_generator, std::shared_ptr<CompileOptions> compile_options,
+    std::shared_ptr<RemarkManager> remark_manager)
+    : m_ast { ast }
+    , m_symbol_table { symbol_table }
+    , m_name_generator { name_generator }
+    , m_compile_options { compile_options }
+    , m_remark_manager { remark_manager }
+{
+    if (!m_ast || !dynamic_cast<Program*>(m_ast.get())) {
+        throw TackyOptimizerError("TackyOptimizer: Invalid AST");
+    }
+    if (!m_symbol_table) {
+        throw TackyOptimizerError("TackyOptimizer: Invalid symbol table");
+    }
+    if (!m_name_generator) {
+        throw TackyOptimizerError("TackyOptimizer: Invalid name generator");
+    }
+    if (!m_compile_options) {
+        throw TackyOptimizerError("TackyOptimizer: Invalid compile options");
+    }
+    if (m_compile_options->unroll_factor < 1) {
+        throw TackyOptimizerError(std::format("TackyOptimizer: Invalid unroll factor {}", m_compile_options->unroll_factor));
+    }
+}
+
+void TackyOptimizer::optimize()
+{
+    auto& program = dynamic_cast<Program&>(*m_ast);
+    for (auto& definition : program.definitions) {
+        if (auto function = dynamic_cast<FunctionDefinition*>(definition.get())) {
+            optimize_function(*function);
+        }
+    }
+}
+
+void TackyOptimizer::optimize_function(FunctionDefinition& function)
+{
+    size_t instructions_before = function.body.size();
+    size_t iterations = run_cleanup_passes(function);
+
+    SsaForm ssa(function, m_symbol_table, m_name_generator);
+    SparseConditionalConstantPropagation sparse_conditional_constant_propagation(m_symbol_table, m_remark_manager);
+    sparse_conditional_constant_propagation.run(ssa);
+    GlobalValueNumbering global_value_numbering(m_symbol_table);
+    global_value_numbering.run(ssa);
+    // Leaving SSA form adds copies even when nothing changed, the cleanup passes remove them
+    ssa.destruct(function);
+    iterations += run_cleanup_passes(function);
+
+    LoopInvariantCodeMotion loop_invariant_code_motion(m_symbol_table, m_name_generator);
+    if (loop_invariant_code_motion.run(function)) {
+        iterations += run_cleanup_passes(function);
+    }
+    // After the invariant code left the loops, the bases of the addresses and the bounds are invariant operands
+    InductionVariableStrengthReduction induction_variable_strength_reduction(m_symbol_table, m_name_generator);
+    if (induction_variable_strength_reduction.run(function)) {
+        iterations += run_cleanup_passes(function);
+    }
+
+    // After the loop passes, the arms are as short as the other passes make them
+    IfConversion if_conversion(m_symbol_table, m_name_generator);
+    if (if_conversion.run(function)) {
+        iterations += run_cleanup_passes(function);
+    }
+    // The bodies are copied once they are as short as they get, with the branches if-conversion removed
+    if (m_compile_options->unroll_size_budget > 0) {
+        LoopUnrolling loop_unrolling(m_symbol_table, m_name_generator, m_compile_options->unroll_factor, m_compile_options->unroll_size_budget,
+            m_remark_manager);
+        if (loop_unrolling.run(function)) {
+            iterations += run_cleanup_passes(function);
+        }
+    }
+
+    NumOptimizerIterations += iterations;
+    if (function.body.size() < instructions_before) {
+        NumInstructionsRemoved += instructions_before - function.body.size();
+    }
+
+    if (m_remark_manager && m_remark_manager->is_enabled()) {
+        m_remark_manager->emit(RemarkKind::ANALYSIS, "tacky-optimizer", function.name.name, function.source_location,
+            std::format("{} instructions before optimization, {} after, {} iterations", instructions_before, function.body.size(), iterations));
+    }
+}
+
+size_t TackyOptimizer::run_cleanup_passes(FunctionDefinition& function)
+{
+    ConstantFolding constant_folding(m_symbol_table, m_remark_manager);
+    UnreachableCodeElimination unreachable_code_elimination(m_remark_manager);
+    CopyPropagation copy_propagation(m_symbol_table);
+    DeadStoreElimination dead_store_elimination(m_symbol_table);
+
+    size_t iterations = 0;
+    bool changed = true;
+    while (changed && iterations < MAX_ITERATIONS) {
+        ++iterations;
+        changed = constant_folding.run(function);
+        changed |= unreachable_code_elimination.run(function);
+        changed |= copy_propagation.run(function);
+        changed |= dead_store_elimination.run(function);
+    }
+    // The last iteration still changed the function, the code is correct but not as clean as the passes make it
+    if (changed) {
+        ++NumIterationLimitHits;
+        LOG_WARN(LOG_CONTEXT, "Cleanup passes on '{}' stopped after {} iterations without converging", function.name.name, MAX_ITERATIONS);
+    }
+    return iterations;
+}
@@ -289,6 +289,36 @@ void PrinterVisitor::visit(BinaryInstruction& node)
     }
 }
 
+void PrinterVisitor::visit(SelectInstruction& node)
+{
+    int id = get_node_id(&node);
+    m_dot_content << "  node" << id << " [label=\"SelectInstruction\"];\n";
+
+    if (node.condition) {
+        node.condition->accept(*this);
+        m_dot_content << "  node" << id << " -> node" << get_node_id(node.condition.get())
+                      << " [label=\"condition\"];\n";
+    }
+
+    if (node.true_value) {
+        node.true_value->accept(*this);
+        m_dot_content << "  node" << id << " -> node" << get_node_id(node.true_value.get())
+                      << " [label=\"true_value\"];\n";
+    }
+
+    if (node.false_value) {
+        node.false_value->accept(*this);
+        m_dot_content << "  node" << id << " -> node" << get_node_id(node.false_value.get())
+                      << " [label=\"false_value\"];\n";
+    }
+
+    if (node.destination) {
+        node.destination->accept(*this);
+        m_dot_content << "  node" << id << " -> node" << get_node_id(node.destination.get())
+                      << " [label=\"destination\"];\n";
+    }
+}
+
 void PrinterVisitor::visit(CopyInstruction& node)
 {
     int id = get_node_id(&node);
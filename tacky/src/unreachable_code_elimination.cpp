@@ -0,0 +1,82 @@
+#include "tacky/unreachable_code_elimination.h"
+#include "common/stats/statistic.h"
+#include "tacky/control_flow_graph.h"
+#include <unordered_set>
+
+using namespace tacky;
+
+STATISTIC(NumBlocksRemoved, "unreachable-code", "Number of unreachable basic blocks removed");
+STATISTIC(NumInstructionsRemoved, "unreachable-code", "Number of instructions in unreachable basic blocks removed");
+STATISTIC(NumJumpsRemoved, "unreachable-code", "Number of jumps to the next block removed");
+STATISTIC(NumLabelsRemoved, "unreachable-code", "Number of labels without jumps removed");
+
+UnreachableCodeElimination::UnreachableCodeElimination(std::shared_ptr<RemarkManager> remark_manager)
+    : m_remark_manager { remark_manager }
+{
+}
+
+bool UnreachableCodeElimination::run(FunctionDefinition& function)
+{
+    ControlFlowGraph cfg(function);
+    auto& blocks = cfg.blocks();
+    bool changed = false;
+
+    std::vector<bool> reachable = cfg.reachable_blocks();
+    for (size_t b = 0; b < blocks.size(); ++b) {
+        if (!reachable[b]) {
+            ++NumBlocksRemoved;
+            remark_block_removed(m_remark_manager, "unreachable-code", function.name.name, blocks[b], "no path from the function entry reaches it");
+            NumInstructionsRemoved += blocks[b].instructions.size();
+            blocks[b].instructions.clear();
+            changed = true;
+        }
+    }
+
+    // A block that falls through always falls into a reachable block, so once the unreachable ones are gone a jump
+    // to the label that comes next does nothing
+    for (size_t b = 0; b < blocks.size(); ++b) {
+        if (blocks[b].instructions.empty()) {
+            continue;
+        }
+        auto target = ControlFlowGraph::jump_target(*blocks[b].instructions.back());
+        if (!target) {
+            continue;
+        }
+        size_t next = b + 1;
+        while (next < blocks.size() && blocks[next].instructions.empty()) {
+            ++next;
+        }
+        if (next == blocks.size()) {
+            continue;
+        }
+        auto label = dynamic_cast<LabelInstruction*>(blocks[next].instructions.front().get());
+        if (label && label->identifier.name == *target) {
+            blocks[b].instructions.pop_back();
+            ++NumJumpsRemoved;
+            changed = true;
+        }
+    }
+
+    std::unordered_set<std::string> targets;
+    for (const auto& block : blocks) {
+        for (const auto& instruction : block.instructions) {
+            if (auto target = ControlFlowGraph::jump_target(*instruction)) {
+                targets.insert(*target);
+            }
+        }
+    }
+    for (auto& block : blocks) {
+        if (block.instructions.empty()) {
+            continue;
+        }
+        auto label = dynamic_cast<LabelInstruction*>(block.instructions.front().get());
+        if (label && !targets.contains(label->identifier.name)) {
+            block.instructions.erase(block.instructions.begin());
+            ++NumLabelsRemoved;
+            changed = true;
+        }
+    }
+
+    cfg.write_back(function);
+    return changed;
+}
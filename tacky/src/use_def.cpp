@@ -0,0 +1,205 @@
+#include "tacky/use_def.h"
+#include "common/data/type.h"
+#include <type_traits>
+#include <variant>
+
+using namespace tacky;
+
+namespace {
+
+std::optional<std::string> variable_name(const std::unique_ptr<Value>& value)
+{
+    if (auto variable = dynamic_cast<const TemporaryVariable*>(value.get())) {
+        return variable->identifier.name;
+    }
+    return std::nullopt;
+}
+
+}
+
+std::vector<std::unique_ptr<Value>*> tacky::used_values(Instruction& instruction)
+{
+    std::vector<std::unique_ptr<Value>*> values;
+    if (auto ret = dynamic_cast<ReturnInstruction*>(&instruction)) {
+        values.push_back(&ret->value);
+    } else if (auto sign_extend = dynamic_cast<SignExtendInstruction*>(&instruction)) {
+        values.push_back(&sign_extend->source);
+    } else if (auto truncate = dynamic_cast<TruncateInstruction*>(&instruction)) {
+        values.push_back(&truncate->source);
+    } else if (auto zero_extend = dynamic_cast<ZeroExtendInstruction*>(&instruction)) {
+        values.push_back(&zero_extend->source);
+    } else if (auto double_to_int = dynamic_cast<DoubleToIntIntruction*>(&instruction)) {
+        values.push_back(&double_to_int->source);
+    } else if (auto double_to_uint = dynamic_cast<DoubleToUIntIntruction*>(&instruction)) {
+        values.push_back(&double_to_uint->source);
+    } else if (auto int_to_double = dynamic_cast<IntToDoubleIntruction*>(&instruction)) {
+        values.push_back(&int_to_double->source);
+    } else if (auto uint_to_double = dynamic_cast<UIntToDoubleIntruction*>(&instruction)) {
+        values.push_back(&uint_to_double->source);
+    } else if (auto unary = dynamic_cast<UnaryInstruction*>(&instruction)) {
+        values.push_back(&unary->source);
+    } else if (auto binary = dynamic_cast<BinaryInstruction*>(&instruction)) {
+        values.push_back(&binary->source1);
+        values.push_back(&binary->source2);
+    } else if (auto copy = dynamic_cast<CopyInstruction*>(&instruction)) {
+        values.push_back(&copy->source);
+    } else if (auto select = dynamic_cast<SelectInstruction*>(&instruction)) {
+        values.push_back(&select->condition);
+        values.push_back(&select->true_value);
+        values.push_back(&select->false_value);
+    } else if (auto load = dynamic_cast<LoadInstruction*>(&instruction)) {
+        values.push_back(&load->source_pointer);
+    } else if (auto store = dynamic_cast<StoreInstruction*>(&instruction)) {
+        values.push_back(&store->source);
+        values.push_back(&store->destination_pointer);
+    } else if (auto add_pointer = dynamic_cast<AddPointerInstruction*>(&instruction)) {
+        values.push_back(&add_pointer->source_pointer);
+        values.push_back(&add_pointer->index);
+    } else if (auto copy_to_offset = dynamic_cast<CopyToOffsetInstruction*>(&instruction)) {
+        values.push_back(&copy_to_offset->source);
+    } else if (auto jump_if_zero = dynamic_cast<JumpIfZeroInstruction*>(&instruction)) {
+        values.push_back(&jump_if_zero->condition);
+    } else if (auto jump_if_not_zero = dynamic_cast<JumpIfNotZeroInstruction*>(&instruction)) {
+        values.push_back(&jump_if_not_zero->condition);
+    } else if (auto call = dynamic_cast<FunctionCallInstruction*>(&instruction)) {
+        for (auto& argument : call->arguments) {
+            values.push_back(&argument);
+        }
+    }
+    std::erase_if(values, [](std::unique_ptr<Value>* value) { return !*value; });
+    return values;
+}
+
+std::optional<std::string> tacky::defined_variable(const Instruction& instruction)
+{
+    if (auto sign_extend = dynamic_cast<const SignExtendInstruction*>(&instruction)) {
+        return variable_name(sign_extend->destination);
+    } else if (auto truncate = dynamic_cast<const TruncateInstruction*>(&instruction)) {
+        return variable_name(truncate->destination);
+    } else if (auto zero_extend = dynamic_cast<const ZeroExtendInstruction*>(&instruction)) {
+        return variable_name(zero_extend->destination);
+    } else if (auto double_to_int = dynamic_cast<const DoubleToIntIntruction*>(&instruction)) {
+        return variable_name(double_to_int->destination);
+    } else if (auto double_to_uint = dynamic_cast<const DoubleToUIntIntruction*>(&instruction)) {
+        return variable_name(double_to_uint->destination);
+    } else if (auto int_to_double = dynamic_cast<const IntToDoubleIntruction*>(&instruction)) {
+        return variable_name(int_to_double->destination);
+    } else if (auto uint_to_double = dynamic_cast<const UIntToDoubleIntruction*>(&instruction)) {
+        return variable_name(uint_to_double->destination);
+    } else if (auto unary = dynamic_cast<const UnaryInstruction*>(&instruction)) {
+        return variable_name(unary->destination);
+    } else if (auto binary = dynamic_cast<const BinaryInstruction*>(&instruction)) {
+        return variable_name(binary->destination);
+    } else if (auto copy = dynamic_cast<const CopyInstruction*>(&instruction)) {
+        return variable_name(copy->destination);
+    } else if (auto select = dynamic_cast<const SelectInstruction*>(&instruction)) {
+        return variable_name(select->destination);
+    } else if (auto get_address = dynamic_cast<const GetAddressInstruction*>(&instruction)) {
+        return variable_name(get_address->destination);
+    } else if (auto load = dynamic_cast<const LoadInstruction*>(&instruction)) {
+        return variable_name(load->destination);
+    } else if (auto add_pointer = dynamic_cast<const AddPointerInstruction*>(&instruction)) {
+        return variable_name(add_pointer->destination);
+    } else if (auto copy_to_offset = dynamic_cast<const CopyToOffsetInstruction*>(&instruction)) {
+        return copy_to_offset->identifier.name;
+    } else if (auto call = dynamic_cast<const FunctionCallInstruction*>(&instruction)) {
+        return variable_name(call->destination);
+    }
+    return std::nullopt;
+}
+
+std::unique_ptr<Value>* tacky::defined_value(Instruction& instruction)
+{
+    std::unique_ptr<Value>* value = nullptr;
+    if (auto sign_extend = dynamic_cast<SignExtendInstruction*>(&instruction)) {
+        value = &sign_extend->destination;
+    } else if (auto truncate = dynamic_cast<TruncateInstruction*>(&instruction)) {
+        value = &truncate->destination;
+    } else if (auto zero_extend = dynamic_cast<ZeroExtendInstruction*>(&instruction)) {
+        value = &zero_extend->destination;
+    } else if (auto double_to_int = dynamic_cast<DoubleToIntIntruction*>(&instruction)) {
+        value = &double_to_int->destination;
+    } else if (auto double_to_uint = dynamic_cast<DoubleToUIntIntruction*>(&instruction)) {
+        value = &double_to_uint->destination;
+    } else if (auto int_to_double = dynamic_cast<IntToDoubleIntruction*>(&instruction)) {
+        value = &int_to_double->destination;
+    } else if (auto uint_to_double = dynamic_cast<UIntToDoubleIntruction*>(&instruction)) {
+        value = &uint_to_double->destination;
+    } else if (auto unary = dynamic_cast<UnaryInstruction*>(&instruction)) {
+        value = &unary->destination;
+    } else if (auto binary = dynamic_cast<BinaryInstruction*>(&instruction)) {
+        value = &binary->destination;
+    } else if (auto copy = dynamic_cast<CopyInstruction*>(&instruction)) {
+        value = &copy->destination;
+    } else if (auto select = dynamic_cast<SelectInstruction*>(&instruction)) {
+        value = &select->destination;
+    } else if (auto get_address = dynamic_cast<GetAddressInstruction*>(&instruction)) {
+        value = &get_address->destination;
+    } else if (auto load = dynamic_cast<LoadInstruction*>(&instruction)) {
+        value = &load->destination;
+    } else if (auto add_pointer = dynamic_cast<AddPointerInstruction*>(&instruction)) {
+        value = &add_pointer->destination;
+    } else if (auto call = dynamic_cast<FunctionCallInstruction*>(&instruction)) {
+        value = &call->destination;
+    }
+    return value && *value ? value : nullptr;
+}
+
+bool tacky::is_speculatable(const Instruction& instruction, const SymbolTable& symbol_table)
+{
+    if (auto binary = dynamic_cast<const BinaryInstruction*>(&instruction)) {
+        if (binary->binary_operator != BinaryOperator::DIVIDE && binary->binary_operator != BinaryOperator::REMAINDER) {
+            return true;
+        }
+        // Double division gives infinity or NaN instead of trapping
+        auto destination = defined_variable(*binary);
+        if (destination && symbol_table.contains_symbol(*destination) && is_type<DoubleType>(*symbol_table.symbol_at(*destination).type)) {
+            return true;
+        }
+        // So does no integer division by a constant other than 0 and -1 (INT_MIN / -1 overflows)
+        auto divisor = dynamic_cast<const Constant*>(binary->source2.get());
+        return divisor && std::visit([](auto value) {
+            using T = decltype(value);
+            if constexpr (std::is_integral_v<T> && std::is_signed_v<T>) {
+                return value != 0 && value != -1;
+            } else if constexpr (std::is_integral_v<T>) {
+                return value != 0;
+            } else {
+                return false;
+            }
+        },
+            divisor->value);
+    }
+    return dynamic_cast<const CopyInstruction*>(&instruction) || dynamic_cast<const UnaryInstruction*>(&instruction)
+        || dynamic_cast<const SelectInstruction*>(&instruction) || dynamic_cast<const SignExtendInstruction*>(&instruction)
+        || dynamic_cast<const TruncateInstruction*>(&instruction) || dynamic_cast<const ZeroExtendInstruction*>(&instruction)
+        || dynamic_cast<const IntToDoubleIntruction*>(&instruction) || dynamic_cast<const DoubleToIntIntruction*>(&instruction)
+        || dynamic_cast<const UIntToDoubleIntruction*>(&instruction) || dynamic_cast<const DoubleToUIntIntruction*>(&instruction)
+        || dynamic_cast<const GetAddressInstruction*>(&instruction) || dynamic_cast<const AddPointerInstruction*>(&instruction);
+}
+
+std::unordered_set<std::string> tacky::aliased_variables(const FunctionDefinition& function, const SymbolTable& symbol_table)
+{
+    std::unordered_set<std::string> aliased;
+    auto add_if_static = [&](const std::string& name) {
+        if (symbol_table.contains_symbol(name) && !std::holds_alternative<LocalAttribute>(symbol_table.symbol_at(name).attribute)) {
+            aliased.insert(name);
+        }
+    };
+    for (const auto& instruction : function.body) {
+        if (auto get_address = dynamic_cast<const GetAddressInstruction*>(instruction.get())) {
+            if (auto name = variable_name(get_address->source)) {
+                aliased.insert(*name);
+            }
+        }
+        for (auto value : used_values(*instruction)) {
+            if (auto name = variable_name(*value)) {
+                add_if_static(*name);
+            }
+        }
+        if (auto name = defined_variable(*instruction)) {
+            add_if_static(*name);
+        }
+    }
+    return aliased;
+}
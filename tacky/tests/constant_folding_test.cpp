@@ -0,0 +1,211 @@
+#include "tacky/constant_folding.h"
+#include "tacky_test/tacky_test.h"
+#include <climits>
+#include <gtest/gtest.h>
+#include <memory>
+#include <string>
+#include <vector>
+
+class ConstantFoldingTest : public TackyTest {
+protected:
+    // Runs the pass to a fixed point and returns the instructions
+    std::vector<std::unique_ptr<Instruction>>& fold()
+    {
+        make_function();
+        ConstantFolding constant_folding(symbol_table, remark_manager);
+        return run_to_fixed_point(constant_folding);
+    }
+
+    // Value copied by a copy instruction, fails if the instruction is not a copy of a constant
+    static ConstantType copied_constant(const std::unique_ptr<Instruction>& instruction)
+    {
+        auto copy = dynamic_cast<CopyInstruction*>(instruction.get());
+        EXPECT_NE(copy, nullptr);
+        auto value = copy ? dynamic_cast<Constant*>(copy->source.get()) : nullptr;
+        EXPECT_NE(value, nullptr);
+        return value ? value->value : ConstantType {};
+    }
+
+    static std::string copied_variable(const std::unique_ptr<Instruction>& instruction)
+    {
+        auto copy = dynamic_cast<CopyInstruction*>(instruction.get());
+        EXPECT_NE(copy, nullptr);
+        auto variable = copy ? dynamic_cast<TemporaryVariable*>(copy->source.get()) : nullptr;
+        EXPECT_NE(variable, nullptr);
+        return variable ? variable->identifier.name : "";
+    }
+};
+
+TEST_F(ConstantFoldingTest, SignedArithmeticWraps)
+{
+    add_variable("a", std::make_unique<IntType>());
+    add_variable("b", std::make_unique<LongType>());
+    add_variable("c", std::make_unique<IntType>());
+    binary(BinaryOperator::ADD, constant(INT_MAX), constant(1), "a");
+    binary(BinaryOperator::MULTIPLY, constant(LONG_MAX), constant(2l), "b");
+    body.push_back(std::make_unique<UnaryInstruction>(UnaryOperator::NEGATE, constant(INT_MIN), var("c")));
+
+    auto& instructions = fold();
+    ASSERT_EQ(instructions.size(), 3u);
+    EXPECT_EQ(copied_constant(instructions[0]), ConstantType { INT_MIN });
+    EXPECT_EQ(copied_constant(instructions[1]), ConstantType { -2l });
+    EXPECT_EQ(copied_constant(instructions[2]), ConstantType { INT_MIN });
+}
+
+TEST_F(ConstantFoldingTest, UnsignedArithmeticIsModular)
+{
+    add_variable("a", std::make_unique<UnsignedIntType>());
+    add_variable("b", std::make_unique<UnsignedLongType>());
+    add_variable("c", std::make_unique<IntType>());
+    binary(BinaryOperator::SUBTRACT, constant(0u), constant(1u), "a");
+    binary(BinaryOperator::DIVIDE, constant(ULONG_MAX), constant(2ul), "b");
+    // Unsigned comparison, not signed
+    binary(BinaryOperator::LESS_THAN, constant(1u), constant(UINT_MAX), "c");
+
+    auto& instructions = fold();
+    ASSERT_EQ(instructions.size(), 3u);
+    EXPECT_EQ(copied_constant(instructions[0]), ConstantType { UINT_MAX });
+    EXPECT_EQ(copied_constant(instructions[1]), ConstantType { ULONG_MAX / 2 });
+    EXPECT_EQ(copied_constant(instructions[2]), ConstantType { 1 });
+}
+
+TEST_F(ConstantFoldingTest, DivisionThatTrapsIsNotFolded)
+{
+    add_variable("a", std::make_unique<IntType>());
+    add_variable("b", std::make_unique<LongType>());
+    add_variable("c", std::make_unique<IntType>());
+    binary(BinaryOperator::DIVIDE, constant(7), constant(0), "a");
+    binary(BinaryOperator::REMAINDER, constant(LONG_MIN), constant(-1l), "b");
+    binary(BinaryOperator::DIVIDE, constant(INT_MIN), constant(-1), "c");
+
+    auto& instructions = fold();
+    ASSERT_EQ(instructions.size(), 3u);
+    for (auto& instruction : instructions) {
+        EXPECT_NE(dynamic_cast<BinaryInstruction*>(instruction.get()), nullptr);
+    }
+}
+
+TEST_F(ConstantFoldingTest, DoubleArithmeticFollowsIEEE)
+{
+    add_variable("a", std::make_unique<DoubleType>());
+    add_variable("b", std::make_unique<DoubleType>());
+    add_variable("c", std::make_unique<IntType>());
+    binary(BinaryOperator::DIVIDE, constant(1.0), constant(0.0), "a");
+    binary(BinaryOperator::ADD, constant(0.1), constant(0.2), "b");
+    binary(BinaryOperator::EQUAL, constant(0.1 + 0.2), constant(0.3), "c");
+
+    auto& instructions = fold();
+    ASSERT_EQ(instructions.size(), 3u);
+    EXPECT_EQ(copied_constant(instructions[0]), ConstantType { 1.0 / 0.0 });
+    EXPECT_EQ(copied_constant(instructions[1]), ConstantType { 0.1 + 0.2 });
+    EXPECT_EQ(copied_constant(instructions[2]), ConstantType { 0 });
+}
+
+TEST_F(ConstantFoldingTest, ConversionsFollowTheDestinationType)
+{
+    add_variable("a", std::make_unique<CharType>());
+    add_variable("b", std::make_unique<LongType>());
+    add_variable("c", std::make_unique<UnsignedLongType>());
+    add_variable("d", std::make_unique<UnsignedIntType>());
+    add_variable("e", std::make_unique<IntType>());
+    body.push_back(std::make_unique<TruncateInstruction>(constant(300), var("a")));
+    body.push_back(std::make_unique<ZeroExtendInstruction>(constant(UINT_MAX), var("b")));
+    body.push_back(std::make_unique<SignExtendInstruction>(constant(-1), var("c")));
+    body.push_back(std::make_unique<DoubleToUIntIntruction>(constant(4294967295.5), var("d")));
+    // Out of range, undefined behavior that is left to run time
+    body.push_back(std::make_unique<DoubleToIntIntruction>(constant(3e10), var("e")));
+
+    auto& instructions = fold();
+    ASSERT_EQ(instructions.size(), 5u);
+    EXPECT_EQ(copied_constant(instructions[0]), ConstantType { static_cast<char>(44) });
+    EXPECT_EQ(copied_constant(instructions[1]), ConstantType { 4294967295l });
+    EXPECT_EQ(copied_constant(instructions[2]), ConstantType { ULONG_MAX });
+    EXPECT_EQ(copied_constant(instructions[3]), ConstantType { UINT_MAX });
+    EXPECT_NE(dynamic_cast<DoubleToIntIntruction*>(instructions[4].get()), nullptr);
+}
+
+TEST_F(ConstantFoldingTest, AlgebraicIdentitiesBecomeCopies)
+{
+    add_variable("x", std::make_unique<IntType>());
+    add_variable("y", std::make_unique<DoubleType>());
+    for (const char* name : { "a", "b", "c", "d", "e" }) {
+        add_variable(name, std::make_unique<IntType>());
+    }
+    add_variable("f", std::make_unique<DoubleType>());
+    add_variable("g", std::make_unique<DoubleType>());
+    add_variable("p", std::make_unique<PointerType>(std::make_unique<IntType>()));
+    add_variable("q", std::make_unique<PointerType>(std::make_unique<IntType>()));
+    binary(BinaryOperator::ADD, constant(0), var("x"), "a");
+    binary(BinaryOperator::MULTIPLY, var("x"), constant(0), "b");
+    binary(BinaryOperator::SUBTRACT, var("x"), var("x"), "c");
+    binary(BinaryOperator::LESS_OR_EQUAL, var("x"), var("x"), "d");
+    binary(BinaryOperator::REMAINDER, var("x"), constant(1), "e");
+    binary(BinaryOperator::MULTIPLY, var("y"), constant(1.0), "f");
+    // y + 0.0 is not y when y is -0.0
+    binary(BinaryOperator::ADD, var("y"), constant(0.0), "g");
+    body.push_back(std::make_unique<AddPointerInstruction>(var("p"), constant(0L), 4, var("q")));
+
+    auto& instructions = fold();
+    ASSERT_EQ(instructions.size(), 8u);
+    EXPECT_EQ(copied_variable(instructions[0]), "x");
+    EXPECT_EQ(copied_constant(instructions[1]), ConstantType { 0 });
+    EXPECT_EQ(copied_constant(instructions[2]), ConstantType { 0 });
+    EXPECT_EQ(copied_constant(instructions[3]), ConstantType { 1 });
+    EXPECT_EQ(copied_constant(instructions[4]), ConstantType { 0 });
+    EXPECT_EQ(copied_variable(instructions[5]), "y");
+    EXPECT_NE(dynamic_cast<BinaryInstruction*>(instructions[6].get()), nullptr);
+    EXPECT_EQ(copied_variable(instructions[7]), "p");
+}
+
+TEST_F(ConstantFoldingTest, BranchesOnConstantsAreResolved)
+{
+    add_variable("a", std::make_unique<IntType>());
+    add_variable("b", std::make_unique<IntType>());
+    binary(BinaryOperator::GREATER_THAN, constant(2), constant(1), "a");
+    body.push_back(std::make_unique<JumpIfZeroInstruction>(var("a"), "skip"));
+    body.push_back(std::make_unique<JumpIfZeroInstruction>(constant(0), "taken"));
+    body.push_back(std::make_unique<JumpIfNotZeroInstruction>(constant(0), "never"));
+    body.push_back(std::make_unique<JumpIfNotZeroInstruction>(constant(0.5), "also_taken"));
+
+    auto& instructions = fold();
+    // The branch on a is only resolved once copy propagation replaces a by its constant
+    ASSERT_EQ(instructions.size(), 4u);
+    EXPECT_EQ(copied_constant(instructions[0]), ConstantType { 1 });
+    EXPECT_NE(dynamic_cast<JumpIfZeroInstruction*>(instructions[1].get()), nullptr);
+    auto taken = dynamic_cast<JumpInstruction*>(instructions[2].get());
+    ASSERT_NE(taken, nullptr);
+    EXPECT_EQ(taken->identifier.name, "taken");
+    auto also_taken = dynamic_cast<JumpInstruction*>(instructions[3].get());
+    ASSERT_NE(also_taken, nullptr);
+    EXPECT_EQ(also_taken->identifier.name, "also_taken");
+}
+
+TEST_F(ConstantFoldingTest, RemarksEveryDecisionAtItsInstruction)
+{
+    enable_remarks(3);
+    add_variable("a", std::make_unique<IntType>());
+    add_variable("b", std::make_unique<IntType>());
+    binary(BinaryOperator::ADD, constant(2), constant(3), "a");
+    body.back()->source_location = SourceLocationIndex(0);
+    binary(BinaryOperator::DIVIDE, constant(7), constant(0), "b");
+    body.back()->source_location = SourceLocationIndex(1);
+    body.push_back(std::make_unique<JumpIfZeroInstruction>(constant(0), "taken"));
+    body.back()->source_location = SourceLocationIndex(2);
+
+    fold();
+    // The division is looked at again on every iteration but reported once
+    const auto& remarks = remark_manager->remarks();
+    ASSERT_EQ(remarks.size(), 3u);
+    EXPECT_EQ(remarks[0].kind, RemarkKind::PASSED);
+    EXPECT_EQ(remarks[0].pass_name, "constant-fold");
+    EXPECT_EQ(remarks[0].function_name, "f");
+    EXPECT_EQ(remarks[0].message, "operation on 2 and 3 folded to 5");
+    EXPECT_EQ(remarks[1].kind, RemarkKind::MISSED);
+    EXPECT_EQ(remarks[1].message, "operation on 7 and 0 not folded, it traps or its result is undefined");
+    EXPECT_EQ(remarks[2].kind, RemarkKind::PASSED);
+    EXPECT_EQ(remarks[2].message, "branch to taken on a constant is always taken, it became a jump");
+    for (size_t i = 0; i < remarks.size(); ++i) {
+        ASSERT_TRUE(remarks[i].location.has_value());
+        EXPECT_EQ(remarks[i].location->line_number, i + 1);
+    }
+}
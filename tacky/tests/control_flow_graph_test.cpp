@@ -0,0 +1,54 @@
+#include "tacky/control_flow_graph.h"
+#include "tacky_test/tacky_test.h"
+#include <gtest/gtest.h>
+#include <memory>
+#include <string>
+#include <vector>
+
+using ControlFlowGraphTest = TackyTest;
+
+TEST_F(ControlFlowGraphTest, IfElseFormsADiamond)
+{
+    // if (c) x = 1; else x = 2; return x;
+    body.push_back(std::make_unique<JumpIfZeroInstruction>(var("c"), "else"));
+    copy(1, "x");
+    body.push_back(std::make_unique<JumpInstruction>("end"));
+    label("else");
+    copy(2, "x");
+    label("end");
+    body.push_back(std::make_unique<ReturnInstruction>(var("x")));
+    FunctionDefinition& definition = make_function();
+
+    ControlFlowGraph cfg(definition);
+    const auto& blocks = cfg.blocks();
+    ASSERT_EQ(blocks.size(), 4u);
+    EXPECT_EQ(blocks[0].predecessors, std::vector<size_t> { ControlFlowGraph::ENTRY });
+    EXPECT_EQ(blocks[0].successors, (std::vector<size_t> { 2, 1 }));
+    EXPECT_EQ(blocks[1].successors, std::vector<size_t> { 3 });
+    EXPECT_EQ(blocks[2].successors, std::vector<size_t> { 3 });
+    EXPECT_EQ(blocks[3].predecessors, (std::vector<size_t> { 1, 2 }));
+    EXPECT_EQ(blocks[3].successors, std::vector<size_t> { ControlFlowGraph::EXIT });
+    EXPECT_TRUE(definition.body.empty());
+
+    cfg.write_back(definition);
+    EXPECT_EQ(definition.body.size(), 7u);
+}
+
+TEST_F(ControlFlowGraphTest, LoopHasBackEdgeAndCodeAfterReturnIsUnreachable)
+{
+    label("loop");
+    copy(1, "x");
+    body.push_back(std::make_unique<JumpIfNotZeroInstruction>(var("x"), "loop"));
+    body.push_back(std::make_unique<ReturnInstruction>(var("x")));
+    copy(2, "x");
+    body.push_back(std::make_unique<ReturnInstruction>(var("x")));
+    FunctionDefinition& definition = make_function();
+
+    ControlFlowGraph cfg(definition);
+    const auto& blocks = cfg.blocks();
+    ASSERT_EQ(blocks.size(), 3u);
+    EXPECT_EQ(blocks[0].predecessors, (std::vector<size_t> { ControlFlowGraph::ENTRY, 0 }));
+    EXPECT_EQ(blocks[0].successors, (std::vector<size_t> { 0, 1 }));
+    EXPECT_TRUE(blocks[2].predecessors.empty());
+    EXPECT_EQ(cfg.reachable_blocks(), (std::vector<bool> { true, true, false }));
+}
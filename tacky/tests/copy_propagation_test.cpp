@@ -0,0 +1,145 @@
+#include "tacky/copy_propagation.h"
+#include "tacky_test/tacky_test.h"
+#include <climits>
+#include <gtest/gtest.h>
+#include <memory>
+#include <string>
+#include <vector>
+
+class CopyPropagationTest : public TackyTest {
+protected:
+    void SetUp() override
+    {
+        TackyTest::SetUp();
+        add_int_variables({ "a", "b", "x", "y" });
+    }
+
+    void call(const std::string& destination)
+    {
+        body.push_back(std::make_unique<FunctionCallInstruction>("g", std::vector<std::unique_ptr<Value>> {}, var(destination)));
+    }
+
+    // Runs the pass to a fixed point and returns the instructions
+    std::vector<std::unique_ptr<Instruction>>& propagate()
+    {
+        make_function();
+        CopyPropagation pass(symbol_table);
+        return run_to_fixed_point(pass);
+    }
+
+    // Value returned by the last instruction
+    Value& returned() const
+    {
+        auto ret = dynamic_cast<ReturnInstruction*>(function->body.back().get());
+        EXPECT_NE(ret, nullptr);
+        return *ret->value;
+    }
+
+    static bool is_constant(const Value& value, ConstantType expected)
+    {
+        auto constant = dynamic_cast<const Constant*>(&value);
+        return constant && constant->value == expected;
+    }
+
+    static bool is_variable(const Value& value, const std::string& name)
+    {
+        auto variable = dynamic_cast<const TemporaryVariable*>(&value);
+        return variable && variable->identifier.name == name;
+    }
+};
+
+TEST_F(CopyPropagationTest, ChainOfCopiesIsCollapsed)
+{
+    copy(5, "a");
+    copy(var("a"), "b");
+    copy(var("b"), "x");
+    ret("x");
+
+    propagate();
+    EXPECT_TRUE(is_constant(returned(), 5));
+}
+
+TEST_F(CopyPropagationTest, CopyReachesJoinOnlyIfEveryPathPerformsIt)
+{
+    // if (c) { x = 1; y = 2; } else { x = 1; y = 3; } return x + y
+    add_variable("c", std::make_unique<IntType>());
+    body.push_back(std::make_unique<JumpIfZeroInstruction>(var("c"), "else"));
+    copy(1, "x");
+    copy(2, "y");
+    body.push_back(std::make_unique<JumpInstruction>("end"));
+    label("else");
+    copy(1, "x");
+    copy(3, "y");
+    label("end");
+    body.push_back(std::make_unique<BinaryInstruction>(BinaryOperator::ADD, var("x"), var("y"), var("a")));
+    ret("a");
+
+    auto& instructions = propagate();
+    auto add = dynamic_cast<BinaryInstruction*>(instructions[instructions.size() - 2].get());
+    ASSERT_NE(add, nullptr);
+    EXPECT_TRUE(is_constant(*add->source1, 1));
+    EXPECT_TRUE(is_variable(*add->source2, "y"));
+}
+
+TEST_F(CopyPropagationTest, StoreThroughPointerKillsCopiesOfAddressTakenVariables)
+{
+    add_variable("p", std::make_unique<PointerType>(std::make_unique<IntType>()));
+    copy(1, "x");
+    copy(1, "y");
+    body.push_back(std::make_unique<GetAddressInstruction>(var("x"), var("p")));
+    body.push_back(std::make_unique<StoreInstruction>(std::make_unique<Constant>(2), var("p")));
+    body.push_back(std::make_unique<BinaryInstruction>(BinaryOperator::ADD, var("x"), var("y"), var("a")));
+    ret("a");
+
+    auto& instructions = propagate();
+    auto add = dynamic_cast<BinaryInstruction*>(instructions[instructions.size() - 2].get());
+    ASSERT_NE(add, nullptr);
+    EXPECT_TRUE(is_variable(*add->source1, "x"));
+    EXPECT_TRUE(is_constant(*add->source2, 1));
+}
+
+TEST_F(CopyPropagationTest, CallKillsCopiesOfStaticVariables)
+{
+    add_variable("s", std::make_unique<IntType>(), StaticAttribute { NoInit {}, true });
+    copy(1, "s");
+    copy(2, "x");
+    call("y");
+    body.push_back(std::make_unique<BinaryInstruction>(BinaryOperator::ADD, var("s"), var("x"), var("a")));
+    ret("a");
+
+    auto& instructions = propagate();
+    auto add = dynamic_cast<BinaryInstruction*>(instructions[instructions.size() - 2].get());
+    ASSERT_NE(add, nullptr);
+    EXPECT_TRUE(is_variable(*add->source1, "s"));
+    EXPECT_TRUE(is_constant(*add->source2, 2));
+}
+
+TEST_F(CopyPropagationTest, CopyBackIsRemoved)
+{
+    call("a");
+    copy(var("a"), "x");
+    copy(var("x"), "a");
+    ret("a");
+
+    auto& instructions = propagate();
+    ASSERT_EQ(instructions.size(), 3u);
+    EXPECT_TRUE(is_variable(returned(), "a"));
+}
+
+TEST_F(CopyPropagationTest, ConstantsTakeTheTypeOfTheVariableTheyReplace)
+{
+    add_variable("u", std::make_unique<UnsignedIntType>());
+    add_variable("v", std::make_unique<UnsignedIntType>());
+    copy(-1, "u");
+    // Conversion between int and unsigned int, the variable is not propagated
+    call("a");
+    copy(var("a"), "v");
+    body.push_back(std::make_unique<BinaryInstruction>(BinaryOperator::LESS_THAN, var("u"), var("v"), var("x")));
+    ret("x");
+
+    auto& instructions = propagate();
+    auto less = dynamic_cast<BinaryInstruction*>(instructions[instructions.size() - 2].get());
+    ASSERT_NE(less, nullptr);
+    EXPECT_TRUE(is_constant(*less->source1, UINT_MAX));
+    EXPECT_TRUE(is_variable(*less->source2, "v"));
+}
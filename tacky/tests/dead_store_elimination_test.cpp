@@ -0,0 +1,73 @@
+#include "tacky/dead_store_elimination.h"
+#include "tacky_test/tacky_test.h"
+#include <gtest/gtest.h>
+#include <memory>
+#include <string>
+#include <vector>
+
+class DeadStoreEliminationTest : public TackyTest {
+protected:
+    void SetUp() override
+    {
+        TackyTest::SetUp();
+        add_int_variables({ "a", "b", "x", "y" });
+    }
+
+    void add(const std::string& source1, const std::string& source2, const std::string& destination)
+    {
+        binary(BinaryOperator::ADD, source1, source2, destination);
+    }
+
+    // Runs the pass to a fixed point and returns the instructions
+    std::vector<std::unique_ptr<Instruction>>& eliminate()
+    {
+        make_function({ Identifier("a") });
+        DeadStoreElimination pass(symbol_table);
+        return run_to_fixed_point(pass);
+    }
+};
+
+TEST_F(DeadStoreEliminationTest, OverwrittenAndUnusedValuesAreRemoved)
+{
+    copy(1, "x");
+    add("a", "a", "y");
+    copy(2, "x");
+    add("x", "a", "b");
+    ret("b");
+
+    auto& instructions = eliminate();
+    ASSERT_EQ(instructions.size(), 3u);
+    auto copy = dynamic_cast<CopyInstruction*>(instructions[0].get());
+    ASSERT_NE(copy, nullptr);
+    EXPECT_EQ(dynamic_cast<Constant&>(*copy->source).value, ConstantType { 2 });
+}
+
+TEST_F(DeadStoreEliminationTest, ValueUsedByTheNextLoopIterationIsKept)
+{
+    copy(0, "x");
+    body.push_back(std::make_unique<LabelInstruction>("loop"));
+    add("x", "a", "x");
+    body.push_back(std::make_unique<JumpIfNotZeroInstruction>(var("a"), "loop"));
+    ret("x");
+
+    EXPECT_EQ(eliminate().size(), 5u);
+}
+
+TEST_F(DeadStoreEliminationTest, CallsStoresAndAliasedVariablesAreKept)
+{
+    symbol_table->insert_symbol("s", std::make_unique<IntType>(), StaticAttribute { NoInit {}, true });
+    symbol_table->insert_symbol("p", std::make_unique<PointerType>(std::make_unique<IntType>()), LocalAttribute {});
+    body.push_back(std::make_unique<FunctionCallInstruction>("g", std::vector<std::unique_ptr<Value>> {}, var("x")));
+    copy(1, "s");
+    copy(2, "y");
+    body.push_back(std::make_unique<GetAddressInstruction>(var("y"), var("p")));
+    body.push_back(std::make_unique<StoreInstruction>(std::make_unique<Constant>(3), var("p")));
+    copy(4, "b");
+    ret("a");
+
+    auto& instructions = eliminate();
+    // Only the copy into b goes, y may be read through p
+    ASSERT_EQ(instructions.size(), 6u);
+    EXPECT_NE(dynamic_cast<FunctionCallInstruction*>(instructions[0].get()), nullptr);
+    EXPECT_NE(dynamic_cast<StoreInstruction*>(instructions[4].get()), nullptr);
+}
@@ -0,0 +1,147 @@
+#include "tacky/global_value_numbering.h"
+#include "tacky_test/tacky_test.h"
+#include <gtest/gtest.h>
+#include <memory>
+#include <string>
+#include <vector>
+
+class GlobalValueNumberingTest : public TackyTest {
+protected:
+    void SetUp() override
+    {
+        TackyTest::SetUp();
+        add_int_variables({ "a", "b", "c", "x", "y", "z" });
+        for (const char* name : { "p", "q", "r" }) {
+            add_variable(name, std::make_unique<PointerType>(std::make_unique<IntType>()));
+        }
+        add_variable("array", std::make_unique<ArrayType>(std::make_unique<IntType>(), 4));
+    }
+
+    void load(const std::string& pointer, const std::string& destination)
+    {
+        body.push_back(std::make_unique<LoadInstruction>(var(pointer), var(destination)));
+    }
+    void store(const std::string& source, const std::string& pointer)
+    {
+        body.push_back(std::make_unique<StoreInstruction>(var(source), var(pointer)));
+    }
+
+    // Numbers the function in SSA form
+    void number()
+    {
+        make_function({ Identifier("a"), Identifier("b"), Identifier("c"), Identifier("p") });
+        GlobalValueNumbering pass(symbol_table);
+        changed = run_in_ssa(pass);
+    }
+
+    // Operands of the binary instruction the function returns the result of
+    const BinaryInstruction& last_binary() const
+    {
+        const BinaryInstruction* last = nullptr;
+        for (const auto& instruction : function->body) {
+            if (auto binary = dynamic_cast<BinaryInstruction*>(instruction.get())) {
+                last = binary;
+            }
+        }
+        EXPECT_NE(last, nullptr);
+        return *last;
+    }
+
+    static const std::string& name_of(const std::unique_ptr<Value>& value)
+    {
+        return dynamic_cast<TemporaryVariable&>(*value).identifier.name;
+    }
+
+    bool changed = false;
+};
+
+TEST_F(GlobalValueNumberingTest, CommutedExpressionInDominatedBlockIsReused)
+{
+    binary(BinaryOperator::ADD, "a", "b", "x");
+    jump_if_zero("c", "end");
+    binary(BinaryOperator::ADD, "b", "a", "y");
+    binary(BinaryOperator::MULTIPLY, "x", "y", "z");
+    ret("z");
+    label("end");
+    ret("x");
+
+    number();
+    EXPECT_TRUE(changed);
+    // b + a became a copy, x * y reads x twice
+    EXPECT_EQ(count<BinaryInstruction>(), 2u);
+    const auto& product = last_binary();
+    EXPECT_EQ(name_of(product.source1), name_of(product.source2));
+}
+
+TEST_F(GlobalValueNumberingTest, ExpressionsInSiblingBlocksAreKept)
+{
+    jump_if_zero("c", "else");
+    binary(BinaryOperator::SUBTRACT, "a", "b", "x");
+    jump("end");
+    label("else");
+    binary(BinaryOperator::SUBTRACT, "a", "b", "x");
+    label("end");
+    ret("x");
+
+    number();
+    EXPECT_FALSE(changed);
+    EXPECT_EQ(count<BinaryInstruction>(), 2u);
+}
+
+TEST_F(GlobalValueNumberingTest, NonCommutativeOperandsAreNotSwapped)
+{
+    binary(BinaryOperator::SUBTRACT, "a", "b", "x");
+    binary(BinaryOperator::SUBTRACT, "b", "a", "y");
+    binary(BinaryOperator::LESS_THAN, "x", "y", "z");
+    ret("z");
+
+    number();
+    EXPECT_FALSE(changed);
+    EXPECT_EQ(count<BinaryInstruction>(), 3u);
+}
+
+TEST_F(GlobalValueNumberingTest, AddressComputationsAreReused)
+{
+    body.push_back(std::make_unique<GetAddressInstruction>(var("array"), var("p")));
+    body.push_back(std::make_unique<AddPointerInstruction>(var("p"), var("a"), 4, var("q")));
+    body.push_back(std::make_unique<GetAddressInstruction>(var("array"), var("r")));
+    body.push_back(std::make_unique<AddPointerInstruction>(var("r"), var("a"), 4, var("p")));
+    load("q", "x");
+    store("b", "p");
+    ret("x");
+
+    number();
+    EXPECT_TRUE(changed);
+    EXPECT_EQ(count<GetAddressInstruction>(), 1u);
+    EXPECT_EQ(count<AddPointerInstruction>(), 1u);
+}
+
+TEST_F(GlobalValueNumberingTest, LoadIsReusedUntilAStore)
+{
+    load("p", "x");
+    load("p", "y");
+    binary(BinaryOperator::ADD, "x", "y", "z");
+    store("z", "p");
+    load("p", "a");
+    binary(BinaryOperator::ADD, "z", "a", "b");
+    ret("b");
+
+    number();
+    EXPECT_TRUE(changed);
+    EXPECT_EQ(count<LoadInstruction>(), 2u);
+}
+
+TEST_F(GlobalValueNumberingTest, LoadIsNotReusedAcrossBlocks)
+{
+    load("p", "x");
+    jump_if_zero("c", "end");
+    store("a", "p");
+    label("end");
+    load("p", "y");
+    binary(BinaryOperator::ADD, "x", "y", "z");
+    ret("z");
+
+    number();
+    EXPECT_FALSE(changed);
+    EXPECT_EQ(count<LoadInstruction>(), 2u);
+}
@@ -0,0 +1,119 @@
+#include "tacky/if_conversion.h"
+#include "tacky_test/tacky_test.h"
+#include <gtest/gtest.h>
+#include <memory>
+#include <string>
+#include <vector>
+
+class IfConversionTest : public TackyTest {
+protected:
+    void SetUp() override
+    {
+        TackyTest::SetUp();
+        add_int_variables({ "a", "b", "c", "x", "t" });
+        add_variable("ch", std::make_unique<CharType>());
+    }
+
+    // Runs the pass once and returns the instructions
+    std::vector<std::unique_ptr<Instruction>>& convert(bool expect_changed = true)
+    {
+        make_function({ Identifier("a"), Identifier("b"), Identifier("c") });
+        IfConversion pass(symbol_table, name_generator);
+        return run_once(pass, expect_changed);
+    }
+
+    static std::string name(const std::unique_ptr<Value>& value) { return dynamic_cast<TemporaryVariable&>(*value).identifier.name; }
+};
+
+TEST_F(IfConversionTest, DiamondBecomesASelect)
+{
+    // x = c ? a + b : a
+    jump_if_zero("c", "else");
+    binary(BinaryOperator::ADD, "a", "b", "t");
+    copy("t", "x");
+    jump("end");
+    label("else");
+    copy("a", "x");
+    label("end");
+    ret("x");
+
+    auto& instructions = convert();
+    // t is only read in its arm and keeps its name, x is written to one temporary per arm
+    ASSERT_EQ(instructions.size(), 5u);
+    EXPECT_EQ(name(dynamic_cast<BinaryInstruction&>(*instructions[0]).destination), "t");
+    auto& select = dynamic_cast<SelectInstruction&>(*instructions[3]);
+    EXPECT_EQ(name(select.condition), "c");
+    EXPECT_EQ(name(select.true_value), name(dynamic_cast<CopyInstruction&>(*instructions[1]).destination));
+    EXPECT_EQ(name(select.false_value), name(dynamic_cast<CopyInstruction&>(*instructions[2]).destination));
+    EXPECT_EQ(name(select.destination), "x");
+    EXPECT_NE(name(select.true_value), "x");
+    EXPECT_NE(name(select.false_value), "x");
+}
+
+TEST_F(IfConversionTest, TriangleKeepsTheOldValueOnTheOtherSide)
+{
+    // if (!c) { a = -a; }, written as a jump when c is not zero
+    body.push_back(std::make_unique<JumpIfNotZeroInstruction>(var("c"), "end"));
+    body.push_back(std::make_unique<UnaryInstruction>(UnaryOperator::NEGATE, var("a"), var("a")));
+    label("end");
+    ret("a");
+
+    auto& instructions = convert();
+    ASSERT_EQ(instructions.size(), 3u);
+    auto& negate = dynamic_cast<UnaryInstruction&>(*instructions[0]);
+    EXPECT_EQ(name(negate.source), "a");
+    auto& select = dynamic_cast<SelectInstruction&>(*instructions[1]);
+    EXPECT_EQ(name(select.true_value), "a");
+    EXPECT_EQ(name(select.false_value), name(negate.destination));
+}
+
+TEST_F(IfConversionTest, ConditionWrittenInAnArmIsSelectedLast)
+{
+    jump_if_zero("c", "end");
+    copy("b", "a");
+    copy("a", "c");
+    label("end");
+    binary(BinaryOperator::ADD, "a", "c", "x");
+    ret("x");
+
+    auto& instructions = convert();
+    ASSERT_EQ(instructions.size(), 6u);
+    // The arm reads its own a
+    EXPECT_EQ(name(dynamic_cast<CopyInstruction&>(*instructions[1]).source), name(dynamic_cast<CopyInstruction&>(*instructions[0]).destination));
+    EXPECT_EQ(name(dynamic_cast<SelectInstruction&>(*instructions[2]).destination), "a");
+    EXPECT_EQ(name(dynamic_cast<SelectInstruction&>(*instructions[3]).destination), "c");
+}
+
+TEST_F(IfConversionTest, DivisionsCharsAndSharedLabelsKeepTheirBranch)
+{
+    jump_if_zero("c", "end1");
+    binary(BinaryOperator::DIVIDE, "a", "b", "x");
+    label("end1");
+    jump_if_zero("c", "end2");
+    copy("a", "ch");
+    label("end2");
+    jump_if_zero("c", "end3");
+    copy("a", "x");
+    label("end3");
+    jump("end3");
+    ret("x");
+
+    EXPECT_EQ(convert(false).size(), 11u);
+}
+
+TEST_F(IfConversionTest, ExpensiveArmsKeepTheirBranch)
+{
+    jump_if_zero("c", "else");
+    for (int i = 0; i < 4; ++i) {
+        binary(BinaryOperator::MULTIPLY, "a", "a", "a");
+    }
+    jump("end");
+    label("else");
+    for (int i = 0; i < 4; ++i) {
+        binary(BinaryOperator::MULTIPLY, "b", "b", "a");
+    }
+    label("end");
+    ret("a");
+
+    EXPECT_EQ(convert(false).size(), 13u);
+}
@@ -0,0 +1,125 @@
+#pragma once
+#include "common/data/name_generator.h"
+#include "common/data/remark_manager.h"
+#include "common/data/source_manager.h"
+#include "common/data/symbol_table.h"
+#include "common/data/type.h"
+#include "tacky/ssa_form.h"
+#include "tacky/tacky_ast.h"
+#include <algorithm>
+#include <gtest/gtest.h>
+#include <initializer_list>
+#include <memory>
+#include <string>
+#include <vector>
+
+using namespace tacky;
+
+// Base fixture of the Tacky pass tests. A test builds the body of the function "f" with the factories below, runs
+// the pass under test on it with one of the run helpers and inspects function->body
+class TackyTest : public ::testing::Test {
+protected:
+    void SetUp() override
+    {
+        symbol_table = std::make_shared<SymbolTable>();
+        name_generator = std::make_shared<NameGenerator>();
+    }
+
+    void add_variable(const std::string& name, std::unique_ptr<Type> type, IdentifierAttribute attribute = LocalAttribute {})
+    {
+        symbol_table->insert_symbol(name, std::move(type), attribute);
+    }
+    void add_int_variables(std::initializer_list<const char*> names)
+    {
+        for (const char* name : names) {
+            add_variable(name, std::make_unique<IntType>());
+        }
+    }
+
+    std::unique_ptr<Value> var(const std::string& name) { return std::make_unique<TemporaryVariable>(name); }
+    std::unique_ptr<Value> constant(ConstantType value) { return std::make_unique<Constant>(value); }
+
+    void copy(std::unique_ptr<Value> source, const std::string& destination)
+    {
+        body.push_back(std::make_unique<CopyInstruction>(std::move(source), var(destination)));
+    }
+    void copy(int value, const std::string& destination) { copy(constant(value), destination); }
+    void copy(const std::string& source, const std::string& destination) { copy(var(source), destination); }
+    void binary(BinaryOperator op, std::unique_ptr<Value> source1, std::unique_ptr<Value> source2, const std::string& destination)
+    {
+        body.push_back(std::make_unique<BinaryInstruction>(op, std::move(source1), std::move(source2), var(destination)));
+    }
+    void binary(BinaryOperator op, const std::string& source1, const std::string& source2, const std::string& destination)
+    {
+        binary(op, var(source1), var(source2), destination);
+    }
+    void label(const std::string& name) { body.push_back(std::make_unique<LabelInstruction>(name)); }
+    void jump(const std::string& target) { body.push_back(std::make_unique<JumpInstruction>(target)); }
+    void jump_if_zero(const std::string& condition, const std::string& target)
+    {
+        body.push_back(std::make_unique<JumpIfZeroInstruction>(var(condition), target));
+    }
+    void jump_if_not_zero(const std::string& condition, const std::string& target)
+    {
+        body.push_back(std::make_unique<JumpIfNotZeroInstruction>(var(condition), target));
+    }
+    void ret(std::unique_ptr<Value> value) { body.push_back(std::make_unique<ReturnInstruction>(std::move(value))); }
+    void ret(const std::string& name) { ret(var(name)); }
+
+    // Moves the body into the function "f"
+    FunctionDefinition& make_function(std::vector<Identifier> parameters = {})
+    {
+        function = std::make_unique<FunctionDefinition>("f", true, std::move(parameters), std::move(body));
+        return *function;
+    }
+
+    // Runs a pass on "f" until it reports no change and returns the instructions
+    template<typename Pass>
+    std::vector<std::unique_ptr<Instruction>>& run_to_fixed_point(Pass& pass)
+    {
+        while (pass.run(*function)) { }
+        return function->body;
+    }
+
+    // Runs a pass on "f" once, checks whether it reported a change and returns the instructions
+    template<typename Pass>
+    std::vector<std::unique_ptr<Instruction>>& run_once(Pass& pass, bool expect_changed)
+    {
+        EXPECT_EQ(pass.run(*function), expect_changed);
+        return function->body;
+    }
+
+    // Runs a pass on "f" between entering and leaving SSA form, returns whether it reported a change
+    template<typename Pass>
+    bool run_in_ssa(Pass& pass)
+    {
+        SsaForm ssa(*function, symbol_table, name_generator);
+        bool changed = pass.run(ssa);
+        ssa.destruct(*function);
+        return changed;
+    }
+
+    template<typename T>
+    size_t count() const
+    {
+        return std::ranges::count_if(function->body, [](const auto& instruction) { return dynamic_cast<T*>(instruction.get()) != nullptr; });
+    }
+
+    // Enables the remarks, location index i resolves to line i + 1
+    void enable_remarks(size_t lines)
+    {
+        auto tokens = std::make_shared<std::vector<Token>>();
+        for (size_t line = 1; line <= lines; ++line) {
+            tokens->emplace_back(TokenType::IDENTIFIER, "x", std::monostate {}, SourceLocation("file.c", line, 1));
+        }
+        auto source_manager = std::make_shared<SourceManager>();
+        source_manager->set_token_list(tokens);
+        remark_manager = std::make_shared<RemarkManager>(source_manager, true);
+    }
+
+    std::shared_ptr<SymbolTable> symbol_table;
+    std::shared_ptr<NameGenerator> name_generator;
+    std::shared_ptr<RemarkManager> remark_manager;
+    std::vector<std::unique_ptr<Instruction>> body;
+    std::unique_ptr<FunctionDefinition> function;
+};
@@ -0,0 +1,152 @@
+#include "tacky/induction_variable_strength_reduction.h"
+#include "tacky_test/tacky_test.h"
+#include <algorithm>
+#include <gtest/gtest.h>
+#include <memory>
+#include <string>
+#include <vector>
+
+class InductionVariableStrengthReductionTest : public TackyTest {
+protected:
+    void SetUp() override
+    {
+        TackyTest::SetUp();
+        add_int_variables({ "i", "n", "s", "v", "w", "c", "g", "d" });
+        add_variable("x", std::make_unique<LongType>());
+        add_variable("a", std::make_unique<PointerType>(std::make_unique<IntType>()));
+        add_variable("p", std::make_unique<PointerType>(std::make_unique<IntType>()));
+    }
+
+    // s = s + a[i] with i = w, w = i + 1 as leaving SSA form writes it, exiting when w < n does not hold
+    void summing_loop(bool guarded)
+    {
+        if (guarded) {
+            binary(BinaryOperator::LESS_THAN, constant(0), var("n"), "g");
+            jump_if_zero("g", "end");
+        }
+        copy(constant(0), "i");
+        copy(constant(0), "s");
+        label("loop");
+        body.push_back(std::make_unique<SignExtendInstruction>(var("i"), var("x")));
+        body.push_back(std::make_unique<AddPointerInstruction>(var("a"), var("x"), 4, var("p")));
+        body.push_back(std::make_unique<LoadInstruction>(var("p"), var("v")));
+        binary(BinaryOperator::ADD, var("s"), var("v"), "s");
+        binary(BinaryOperator::ADD, var("i"), constant(1), "w");
+        copy(var("w"), "i");
+        binary(BinaryOperator::LESS_THAN, var("w"), var("n"), "c");
+        jump_if_not_zero("c", "loop");
+        label("end");
+    }
+
+    std::vector<std::unique_ptr<Instruction>>& reduce(bool expect_changed = true)
+    {
+        make_function({ Identifier("a"), Identifier("n") });
+        InductionVariableStrengthReduction pass(symbol_table, name_generator);
+        return run_once(pass, expect_changed);
+    }
+
+    // Position of the loop label
+    size_t loop_start()
+    {
+        for (size_t k = 0; k < function->body.size(); ++k) {
+            auto label = dynamic_cast<LabelInstruction*>(function->body[k].get());
+            if (label && label->identifier.name == "loop") {
+                return k;
+            }
+        }
+        ADD_FAILURE() << "no loop label";
+        return 0;
+    }
+
+    // The compare the loop exits on
+    BinaryInstruction& exit_test()
+    {
+        auto it = std::ranges::find_if(function->body, [](const auto& instruction) { return dynamic_cast<JumpIfNotZeroInstruction*>(instruction.get()) != nullptr; });
+        return dynamic_cast<BinaryInstruction&>(**(it - 1));
+    }
+
+    bool reads(const Instruction& instruction, const std::string& name)
+    {
+        auto binary = dynamic_cast<const BinaryInstruction*>(&instruction);
+        auto is_name = [&](const std::unique_ptr<Value>& value) {
+            auto variable = dynamic_cast<TemporaryVariable*>(value.get());
+            return variable && variable->identifier.name == name;
+        };
+        return binary && (is_name(binary->source1) || is_name(binary->source2));
+    }
+};
+
+TEST_F(InductionVariableStrengthReductionTest, ElementAddressBecomesAPointerThatReplacesTheCounter)
+{
+    summing_loop(true);
+    body.push_back(std::make_unique<ReturnInstruction>(var("s")));
+
+    auto& instructions = reduce();
+    size_t start = loop_start();
+    // No sign extension or addition of the counter is left in the loop, the pointer is stepped by the element size
+    for (size_t k = start; k < instructions.size(); ++k) {
+        EXPECT_EQ(dynamic_cast<SignExtendInstruction*>(instructions[k].get()), nullptr);
+        EXPECT_FALSE(reads(*instructions[k], "i"));
+    }
+    auto step = std::ranges::find_if(instructions.begin() + start, instructions.end(), [](const auto& instruction) {
+        auto add_pointer = dynamic_cast<AddPointerInstruction*>(instruction.get());
+        return add_pointer && dynamic_cast<Constant*>(add_pointer->index.get());
+    });
+    ASSERT_NE(step, instructions.end());
+    EXPECT_EQ(dynamic_cast<AddPointerInstruction&>(**step).scale, 4u);
+
+    BinaryInstruction& test = exit_test();
+    EXPECT_EQ(test.binary_operator, BinaryOperator::LESS_THAN);
+    const std::string& pointer = dynamic_cast<TemporaryVariable&>(*test.source1).identifier.name;
+    EXPECT_TRUE(is_type<PointerType>(*symbol_table->symbol_at(pointer).type));
+}
+
+TEST_F(InductionVariableStrengthReductionTest, UnguardedLoopKeepsItsExitTest)
+{
+    // Entered without testing 0 < n, the addresses could wrap around where the integers do not
+    summing_loop(false);
+    body.push_back(std::make_unique<ReturnInstruction>(var("s")));
+
+    reduce();
+    EXPECT_TRUE(reads(exit_test(), "w"));
+}
+
+TEST_F(InductionVariableStrengthReductionTest, CounterReadAfterTheLoopIsKept)
+{
+    summing_loop(true);
+    binary(BinaryOperator::ADD, var("s"), var("i"), "s");
+    body.push_back(std::make_unique<ReturnInstruction>(var("s")));
+
+    auto& instructions = reduce();
+    EXPECT_FALSE(reads(exit_test(), "w"));
+    EXPECT_TRUE(std::ranges::any_of(instructions.begin() + loop_start(), instructions.end(), [&](const auto& instruction) { return reads(*instruction, "i"); }));
+}
+
+TEST_F(InductionVariableStrengthReductionTest, MultiplicationBecomesAddition)
+{
+    // while (i < n) { s = s + i * 3; i = i + 1; }
+    copy(constant(0), "i");
+    copy(constant(0), "s");
+    label("loop");
+    binary(BinaryOperator::MULTIPLY, var("i"), constant(3), "d");
+    binary(BinaryOperator::ADD, var("s"), var("d"), "s");
+    binary(BinaryOperator::ADD, var("i"), constant(1), "i");
+    binary(BinaryOperator::LESS_THAN, var("i"), var("n"), "c");
+    body.push_back(std::make_unique<JumpIfNotZeroInstruction>(var("c"), "loop"));
+    body.push_back(std::make_unique<ReturnInstruction>(var("s")));
+
+    auto& instructions = reduce();
+    size_t start = loop_start();
+    auto is_multiply = [](const auto& instruction) {
+        auto binary = dynamic_cast<BinaryInstruction*>(instruction.get());
+        return binary && binary->binary_operator == BinaryOperator::MULTIPLY;
+    };
+    EXPECT_TRUE(std::ranges::any_of(instructions.begin(), instructions.begin() + start, is_multiply));
+    EXPECT_FALSE(std::ranges::any_of(instructions.begin() + start, instructions.end(), is_multiply));
+    // The product steps by 3 next to i
+    EXPECT_TRUE(std::ranges::any_of(instructions.begin() + start, instructions.end(), [](const auto& instruction) {
+        auto binary = dynamic_cast<BinaryInstruction*>(instruction.get());
+        auto step = binary ? dynamic_cast<Constant*>(binary->source2.get()) : nullptr;
+        return binary && binary->binary_operator == BinaryOperator::ADD && step && step->value == ConstantType { 3 };
+    }));
+}
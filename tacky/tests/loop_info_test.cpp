@@ -0,0 +1,61 @@
+#include "tacky/control_flow_graph.h"
+#include "tacky/loop_info.h"
+#include "tacky_test/tacky_test.h"
+#include <gtest/gtest.h>
+#include <memory>
+#include <string>
+#include <vector>
+
+using LoopInfoTest = TackyTest;
+
+TEST_F(LoopInfoTest, NestedLoopsComeInnermostFirstWithTheirLabels)
+{
+    // while (c) { while (d) {} }, in the rotated shape the generator emits
+    jump_if_zero("c", "break_outer");
+    label("outer_start");
+    jump_if_zero("d", "break_inner");
+    label("inner_start");
+    label("continue_inner");
+    jump_if_not_zero("d", "inner_start");
+    label("break_inner");
+    label("continue_outer");
+    jump_if_not_zero("c", "outer_start");
+    label("break_outer");
+    ret("x");
+    FunctionDefinition& definition = make_function();
+
+    ControlFlowGraph cfg(definition);
+    LoopInfo loop_info(cfg);
+    const auto& loops = loop_info.loops();
+    ASSERT_EQ(loops.size(), 2u);
+
+    EXPECT_EQ(loops[0].header, 2u);
+    EXPECT_EQ(loops[0].blocks, (std::vector<size_t> { 2, 3 }));
+    EXPECT_EQ(loops[0].latches, std::vector<size_t> { 3 });
+    EXPECT_EQ(loops[0].exiting_blocks, std::vector<size_t> { 3 });
+    EXPECT_EQ(loops[0].label, "inner");
+
+    EXPECT_EQ(loops[1].header, 1u);
+    EXPECT_EQ(loops[1].blocks, (std::vector<size_t> { 1, 2, 3, 4, 5 }));
+    EXPECT_EQ(loops[1].latches, std::vector<size_t> { 5 });
+    EXPECT_EQ(loops[1].exiting_blocks, std::vector<size_t> { 5 });
+    EXPECT_EQ(loops[1].label, "outer");
+
+    EXPECT_TRUE(loop_info.dominates(1, 4));
+    EXPECT_FALSE(loop_info.dominates(2, 4));
+}
+
+TEST_F(LoopInfoTest, LoopWrittenWithGotoHasNoLabel)
+{
+    label("top");
+    jump_if_not_zero("c", "top");
+    ret("x");
+    FunctionDefinition& definition = make_function();
+
+    ControlFlowGraph cfg(definition);
+    LoopInfo loop_info(cfg);
+    ASSERT_EQ(loop_info.loops().size(), 1u);
+    EXPECT_EQ(loop_info.loops()[0].header, 0u);
+    EXPECT_EQ(loop_info.loops()[0].latches, std::vector<size_t> { 0 });
+    EXPECT_FALSE(loop_info.loops()[0].label.has_value());
+}
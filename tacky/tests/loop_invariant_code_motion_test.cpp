@@ -0,0 +1,102 @@
+#include "tacky/loop_invariant_code_motion.h"
+#include "tacky_test/tacky_test.h"
+#include <functional>
+#include <gtest/gtest.h>
+#include <memory>
+#include <string>
+#include <vector>
+
+class LoopInvariantCodeMotionTest : public TackyTest {
+protected:
+    void SetUp() override
+    {
+        TackyTest::SetUp();
+        add_int_variables({ "a", "b", "n", "s", "t", "u" });
+        add_variable("p", std::make_unique<PointerType>(std::make_unique<IntType>()));
+    }
+
+    void decrement(const std::string& name) { binary(BinaryOperator::SUBTRACT, var(name), constant(1), name); }
+
+    // while (n) { <loop_body> n = n - 1; } return s;
+    void loop(const std::function<void()>& loop_body)
+    {
+        jump_if_zero("n", "end");
+        label("loop");
+        loop_body();
+        decrement("n");
+        jump_if_not_zero("n", "loop");
+        label("end");
+        ret("s");
+    }
+
+    std::vector<std::unique_ptr<Instruction>>& hoist(bool expect_changed = true)
+    {
+        make_function({ Identifier("a"), Identifier("b"), Identifier("n"), Identifier("p") });
+        LoopInvariantCodeMotion pass(symbol_table, name_generator);
+        return run_once(pass, expect_changed);
+    }
+};
+
+TEST_F(LoopInvariantCodeMotionTest, InvariantInstructionsMoveToAPreheader)
+{
+    loop([&] {
+        binary(BinaryOperator::MULTIPLY, "a", "b", "t");
+        binary(BinaryOperator::ADD, "t", "a", "u");
+        binary(BinaryOperator::ADD, "s", "u", "s");
+    });
+
+    auto& instructions = hoist();
+    // The guard jumps around the loop as well, the preheader is a new block between it and the header
+    ASSERT_EQ(instructions.size(), 10u);
+    EXPECT_TRUE(dynamic_cast<JumpIfZeroInstruction*>(instructions[0].get()));
+    auto& preheader = dynamic_cast<LabelInstruction&>(*instructions[1]);
+    EXPECT_NE(preheader.identifier.name, "loop");
+    EXPECT_EQ(dynamic_cast<BinaryInstruction&>(*instructions[2]).binary_operator, BinaryOperator::MULTIPLY);
+    EXPECT_EQ(dynamic_cast<BinaryInstruction&>(*instructions[3]).binary_operator, BinaryOperator::ADD);
+    EXPECT_EQ(dynamic_cast<LabelInstruction&>(*instructions[4]).identifier.name, "loop");
+    EXPECT_EQ(dynamic_cast<BinaryInstruction&>(*instructions[5]).binary_operator, BinaryOperator::ADD);
+}
+
+TEST_F(LoopInvariantCodeMotionTest, OperandWrittenInTheLoopKeepsTheInstruction)
+{
+    loop([&] {
+        binary(BinaryOperator::MULTIPLY, "n", "b", "t");
+        binary(BinaryOperator::ADD, "s", "t", "s");
+    });
+
+    hoist(false);
+}
+
+TEST_F(LoopInvariantCodeMotionTest, DivisionByAVariableMightTrap)
+{
+    loop([&] {
+        binary(BinaryOperator::DIVIDE, "a", "b", "t");
+        binary(BinaryOperator::ADD, "s", "t", "s");
+    });
+
+    hoist(false);
+}
+
+TEST_F(LoopInvariantCodeMotionTest, LoadMovesOnlyWhenTheLoopWritesNoMemory)
+{
+    loop([&] {
+        body.push_back(std::make_unique<LoadInstruction>(var("p"), var("t")));
+        binary(BinaryOperator::ADD, "s", "t", "s");
+    });
+    auto& instructions = hoist();
+    EXPECT_TRUE(dynamic_cast<LoadInstruction*>(instructions[2].get()));
+
+    loop([&] {
+        body.push_back(std::make_unique<LoadInstruction>(var("p"), var("t")));
+        binary(BinaryOperator::ADD, "s", "t", "s");
+        body.push_back(std::make_unique<StoreInstruction>(var("s"), var("p")));
+    });
+    hoist(false);
+
+    loop([&] {
+        body.push_back(std::make_unique<LoadInstruction>(var("p"), var("t")));
+        binary(BinaryOperator::ADD, "s", "t", "s");
+        body.push_back(std::make_unique<FunctionCallInstruction>("g", std::vector<std::unique_ptr<Value>> {}, nullptr));
+    });
+    hoist(false);
+}
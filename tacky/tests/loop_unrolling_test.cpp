@@ -0,0 +1,217 @@
+#include "tacky/control_flow_graph.h"
+#include "tacky/loop_unrolling.h"
+#include "tacky_test/tacky_test.h"
+#include <algorithm>
+#include <gtest/gtest.h>
+#include <map>
+#include <memory>
+#include <set>
+#include <string>
+#include <vector>
+
+class LoopUnrollingTest : public TackyTest {
+protected:
+    void SetUp() override
+    {
+        TackyTest::SetUp();
+        add_int_variables({ "i", "n", "s", "c", "g", "t" });
+    }
+
+    // i = 0; do { s = s + i; i = i + 1; } while (i < bound); return s;
+    void counting_loop(std::unique_ptr<Value> bound)
+    {
+        copy(0, "i");
+        copy(0, "s");
+        label("loop");
+        binary(BinaryOperator::ADD, var("s"), var("i"), "s");
+        binary(BinaryOperator::ADD, var("i"), constant(1), "i");
+        binary(BinaryOperator::LESS_THAN, var("i"), std::move(bound), "c");
+        jump_if_not_zero("c", "loop");
+        ret("s");
+    }
+
+    std::vector<std::unique_ptr<Instruction>>& unroll(size_t factor, size_t size_budget, bool expect_changed = true)
+    {
+        make_function({ Identifier("n") });
+        LoopUnrolling pass(symbol_table, name_generator, factor, size_budget, remark_manager);
+        return run_once(pass, expect_changed);
+    }
+
+    // Copies of s = s + i
+    size_t sums()
+    {
+        return std::ranges::count_if(function->body, [](const auto& instruction) {
+            auto binary = dynamic_cast<BinaryInstruction*>(instruction.get());
+            auto destination = binary ? dynamic_cast<TemporaryVariable*>(binary->destination.get()) : nullptr;
+            return destination && destination->identifier.name == "s";
+        });
+    }
+};
+
+TEST_F(LoopUnrollingTest, RuntimeTripCountRunsCopiesInFrontOfTheLoop)
+{
+    counting_loop(var("n"));
+
+    auto& instructions = unroll(4, 64);
+    // Four copies and the loop running the remaining iterations
+    EXPECT_EQ(sums(), 5u);
+    // Only the last copy and the loop test whether to go on, the check in front of the copies leaves for the loop
+    EXPECT_EQ(count<JumpIfNotZeroInstruction>(), 2u);
+    auto check = std::ranges::find_if(instructions, [](const auto& instruction) {
+        auto jump = dynamic_cast<JumpIfZeroInstruction*>(instruction.get());
+        return jump && jump->identifier.name == "loop";
+    });
+    ASSERT_NE(check, instructions.end());
+    auto compare = dynamic_cast<BinaryInstruction*>((check - 1)->get());
+    ASSERT_NE(compare, nullptr);
+    EXPECT_EQ(compare->binary_operator, BinaryOperator::LESS_THAN);
+}
+
+TEST_F(LoopUnrollingTest, KnownTripCountIsUnrolledCompletely)
+{
+    counting_loop(constant(3));
+
+    auto& instructions = unroll(4, 64);
+    // Three copies, the loop is left with no way in
+    EXPECT_EQ(sums(), 4u);
+    EXPECT_EQ(count<JumpIfNotZeroInstruction>(), 1u);
+    EXPECT_EQ(count<JumpIfZeroInstruction>(), 0u);
+    auto loop = std::ranges::find_if(instructions, [](const auto& instruction) {
+        auto label = dynamic_cast<LabelInstruction*>(instruction.get());
+        return label && label->identifier.name == "loop";
+    });
+    ASSERT_NE(loop, instructions.end());
+    EXPECT_NE(dynamic_cast<JumpInstruction*>((loop - 1)->get()), nullptr);
+}
+
+TEST_F(LoopUnrollingTest, SizeBudgetLimitsTheCopies)
+{
+    counting_loop(var("n"));
+    unroll(4, 8);
+    // The body has four instructions, the budget fits two copies
+    EXPECT_EQ(sums(), 3u);
+
+    SetUp();
+    counting_loop(var("n"));
+    unroll(4, 7, false);
+    EXPECT_EQ(sums(), 1u);
+}
+
+TEST_F(LoopUnrollingTest, BreakAndContinueKeepTheirTargets)
+{
+    // do { if (i % 2 == 0) continue; if (s > 100) break; s = s + i; } while (++i < n)
+    body.push_back(std::make_unique<CopyInstruction>(constant(0), var("i")));
+    body.push_back(std::make_unique<CopyInstruction>(constant(0), var("s")));
+    label("loop");
+    binary(BinaryOperator::REMAINDER, var("i"), constant(2), "t");
+    body.push_back(std::make_unique<JumpIfZeroInstruction>(var("t"), "continue_loop"));
+    binary(BinaryOperator::GREATER_THAN, var("s"), constant(100), "g");
+    body.push_back(std::make_unique<JumpIfNotZeroInstruction>(var("g"), "break_loop"));
+    binary(BinaryOperator::ADD, var("s"), var("i"), "s");
+    label("continue_loop");
+    binary(BinaryOperator::ADD, var("i"), constant(1), "i");
+    binary(BinaryOperator::LESS_THAN, var("i"), var("n"), "c");
+    body.push_back(std::make_unique<JumpIfNotZeroInstruction>(var("c"), "loop"));
+    label("break_loop");
+    body.push_back(std::make_unique<ReturnInstruction>(var("s")));
+
+    auto& instructions = unroll(4, 64);
+    EXPECT_EQ(sums(), 5u);
+    std::map<std::string, size_t> labels;
+    std::vector<std::string> targets;
+    size_t breaks = 0;
+    std::set<std::string> continues;
+    // Every copy tests a condition of its own, named after the one of the loop
+    std::set<std::string> conditions;
+    auto is_copy_of = [&](const std::unique_ptr<Value>& condition, const std::string& original) {
+        const std::string& name = dynamic_cast<TemporaryVariable&>(*condition).identifier.name;
+        if (name != original && !name.starts_with(original + ".")) {
+            return false;
+        }
+        conditions.insert(name);
+        return true;
+    };
+    for (const auto& instruction : instructions) {
+        if (auto label = dynamic_cast<LabelInstruction*>(instruction.get())) {
+            ++labels[label->identifier.name];
+        } else if (auto target = ControlFlowGraph::jump_target(*instruction)) {
+            targets.push_back(*target);
+        }
+        if (auto jump = dynamic_cast<JumpIfNotZeroInstruction*>(instruction.get()); jump && is_copy_of(jump->condition, "g")) {
+            EXPECT_EQ(jump->identifier.name, "break_loop");
+            ++breaks;
+        }
+        if (auto jump = dynamic_cast<JumpIfZeroInstruction*>(instruction.get()); jump && is_copy_of(jump->condition, "t")) {
+            EXPECT_TRUE(jump->identifier.name.starts_with("continue_loop"));
+            continues.insert(jump->identifier.name);
+        }
+    }
+    for (const auto& [name, definitions] : labels) {
+        EXPECT_EQ(definitions, 1u) << name;
+    }
+    for (const auto& target : targets) {
+        EXPECT_TRUE(labels.contains(target)) << target;
+    }
+    // Every copy breaks out of the loop, and continues at its own copy of the label
+    EXPECT_EQ(breaks, 5u);
+    EXPECT_EQ(continues.size(), 5u);
+    EXPECT_EQ(conditions.size(), 10u);
+}
+
+TEST_F(LoopUnrollingTest, RemarksEveryDecisionAtTheLoop)
+{
+    enable_remarks(6);
+    add_variable("l", std::make_unique<LongType>());
+    // Unrolls the loop in body, whose sum is at line, and returns the one remark about it
+    auto remark = [&](size_t line, size_t factor, size_t size_budget, bool expect_changed) {
+        body[2]->source_location = SourceLocationIndex(line - 1);
+        size_t remarks_before = remark_manager->remarks().size();
+        unroll(factor, size_budget, expect_changed);
+        body.clear();
+        const auto& remarks = remark_manager->remarks();
+        EXPECT_EQ(remarks.size(), remarks_before + 1);
+        EXPECT_EQ(remarks.back().pass_name, "loop-unroll");
+        EXPECT_EQ(remarks.back().function_name, "f");
+        EXPECT_TRUE(remarks.back().location.has_value() && remarks.back().location->line_number == line);
+        return remarks.back();
+    };
+
+    counting_loop(var("n"));
+    Remark unrolled = remark(1, 4, 64, true);
+    EXPECT_EQ(unrolled.kind, RemarkKind::PASSED);
+    EXPECT_EQ(unrolled.message, "loop unrolled by a factor of 4, the loop runs the remaining iterations");
+
+    counting_loop(constant(3));
+    Remark fully_unrolled = remark(2, 4, 64, true);
+    EXPECT_EQ(fully_unrolled.kind, RemarkKind::PASSED);
+    EXPECT_EQ(fully_unrolled.message, "loop fully unrolled, 3 copies of its body");
+
+    counting_loop(var("n"));
+    Remark over_budget = remark(3, 4, 4, false);
+    EXPECT_EQ(over_budget.kind, RemarkKind::MISSED);
+    EXPECT_EQ(over_budget.message, "loop not unrolled, two copies of its 4 instructions exceed the size budget of 4");
+
+    counting_loop(var("n"));
+    Remark factor_one = remark(4, 1, 64, false);
+    EXPECT_EQ(factor_one.kind, RemarkKind::MISSED);
+    EXPECT_EQ(factor_one.message, "loop not unrolled, its trip count is unknown and the unroll factor is 1");
+
+    // The bound grows with the sum
+    counting_loop(var("s"));
+    Remark variant_bound = remark(5, 4, 64, false);
+    EXPECT_EQ(variant_bound.kind, RemarkKind::MISSED);
+    EXPECT_EQ(variant_bound.message, "loop not unrolled, the bound of the exit test on 'i' is not loop-invariant");
+
+    // l = 0; do { s = s + i; l = l + 1; } while (l < n);
+    copy(constant(0L), "l");
+    copy(0, "s");
+    label("loop");
+    binary(BinaryOperator::ADD, var("s"), var("i"), "s");
+    binary(BinaryOperator::ADD, var("l"), constant(1L), "l");
+    binary(BinaryOperator::LESS_THAN, var("l"), var("n"), "c");
+    jump_if_not_zero("c", "loop");
+    ret("s");
+    Remark long_counter = remark(6, 4, 64, false);
+    EXPECT_EQ(long_counter.kind, RemarkKind::MISSED);
+    EXPECT_EQ(long_counter.message, "loop not unrolled, the counter 'l' is not an int, an unsigned int or a pointer");
+}
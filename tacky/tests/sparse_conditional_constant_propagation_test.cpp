@@ -0,0 +1,135 @@
+#include "tacky/sparse_conditional_constant_propagation.h"
+#include "tacky_test/tacky_test.h"
+#include <algorithm>
+#include <gtest/gtest.h>
+#include <memory>
+#include <optional>
+#include <string>
+#include <vector>
+
+class SparseConditionalConstantPropagationTest : public TackyTest {
+protected:
+    void SetUp() override
+    {
+        TackyTest::SetUp();
+        remark_manager = std::make_shared<RemarkManager>(nullptr, true);
+        add_int_variables({ "c", "x", "y", "z" });
+    }
+
+    // Runs the pass between entering and leaving SSA form and returns the instructions
+    std::vector<std::unique_ptr<Instruction>>& propagate()
+    {
+        make_function({ Identifier("c") });
+        SparseConditionalConstantPropagation pass(symbol_table, remark_manager);
+        changed = run_in_ssa(pass);
+        return function->body;
+    }
+
+    // Constant returned by the return instruction, the function must have exactly one
+    std::optional<ConstantType> returned_constant() const
+    {
+        EXPECT_EQ(count<ReturnInstruction>(), 1u);
+        for (const auto& instruction : function->body) {
+            if (auto ret = dynamic_cast<ReturnInstruction*>(instruction.get())) {
+                if (auto value = dynamic_cast<Constant*>(ret->value.get())) {
+                    return value->value;
+                }
+            }
+        }
+        return std::nullopt;
+    }
+
+    bool changed = false;
+};
+
+TEST_F(SparseConditionalConstantPropagationTest, ConstantBranchRemovesTheOtherArm)
+{
+    copy(1, "x");
+    jump_if_zero("x", "else");
+    copy(2, "y");
+    jump("end");
+    label("else");
+    copy(3, "y");
+    label("end");
+    ret("y");
+
+    propagate();
+    EXPECT_TRUE(changed);
+    EXPECT_EQ(returned_constant(), ConstantType { 2 });
+    EXPECT_EQ(count<JumpIfZeroInstruction>(), 0u);
+    EXPECT_EQ(count<LabelInstruction>(), 1u);
+
+    std::vector<std::string> messages;
+    for (const Remark& remark : remark_manager->remarks()) {
+        EXPECT_EQ(remark.kind, RemarkKind::PASSED);
+        EXPECT_EQ(remark.pass_name, "sccp");
+        messages.push_back(remark.message);
+    }
+    EXPECT_NE(std::ranges::find(messages, "branch to else is never taken, it was removed"), messages.end());
+    EXPECT_NE(std::ranges::find(messages, "block else of 1 instructions removed, no executable edge reaches it"), messages.end());
+}
+
+TEST_F(SparseConditionalConstantPropagationTest, ValueUnchangedAroundLoopIsConstant)
+{
+    // x = 7; while (c) x = x * 1 + 0; return x
+    copy(7, "x");
+    label("loop");
+    jump_if_zero("c", "end");
+    binary(BinaryOperator::MULTIPLY, var("x"), constant(1), "y");
+    binary(BinaryOperator::ADD, var("y"), constant(0), "x");
+    jump("loop");
+    label("end");
+    ret("x");
+
+    propagate();
+    EXPECT_EQ(returned_constant(), ConstantType { 7 });
+    // The loop itself depends on the parameter and stays
+    EXPECT_EQ(count<JumpIfZeroInstruction>(), 1u);
+}
+
+TEST_F(SparseConditionalConstantPropagationTest, ValueChangingAroundLoopIsNotConstant)
+{
+    copy(0, "x");
+    label("loop");
+    jump_if_zero("c", "end");
+    binary(BinaryOperator::ADD, var("x"), constant(1), "x");
+    jump("loop");
+    label("end");
+    ret("x");
+
+    propagate();
+    EXPECT_EQ(returned_constant(), std::nullopt);
+}
+
+TEST_F(SparseConditionalConstantPropagationTest, InfeasibleBranchDoesNotLowerThePhi)
+{
+    // x = 1; loop: if (x != 1) z = 2 else z = 1; x = z; if (c) goto loop; return x. Plain constant propagation
+    // sees x = 2 flow in from the arm that never runs
+    copy(1, "x");
+    label("loop");
+    binary(BinaryOperator::NOT_EQUAL, var("x"), constant(1), "y");
+    jump_if_zero("y", "else");
+    copy(2, "z");
+    jump("join");
+    label("else");
+    copy(1, "z");
+    label("join");
+    body.push_back(std::make_unique<CopyInstruction>(var("z"), var("x")));
+    body.push_back(std::make_unique<JumpIfNotZeroInstruction>(var("c"), "loop"));
+    ret("x");
+
+    propagate();
+    EXPECT_EQ(returned_constant(), ConstantType { 1 });
+    EXPECT_EQ(count<JumpIfZeroInstruction>(), 0u);
+}
+
+TEST_F(SparseConditionalConstantPropagationTest, DivisionByZeroIsNotFolded)
+{
+    copy(0, "x");
+    body.push_back(std::make_unique<BinaryInstruction>(BinaryOperator::DIVIDE, constant(1), var("x"), var("y")));
+    ret("y");
+
+    propagate();
+    EXPECT_EQ(returned_constant(), std::nullopt);
+    EXPECT_EQ(count<BinaryInstruction>(), 1u);
+}
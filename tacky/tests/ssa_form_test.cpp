@@ -0,0 +1,178 @@
+#include "tacky/ssa_form.h"
+#include "tacky_test/tacky_test.h"
+#include <gtest/gtest.h>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+class SsaFormTest : public TackyTest {
+protected:
+    void SetUp() override
+    {
+        TackyTest::SetUp();
+        add_int_variables({ "a", "b", "c", "x" });
+    }
+
+    void add(const std::string& source, int value, const std::string& destination)
+    {
+        binary(BinaryOperator::ADD, var(source), constant(value), destination);
+    }
+
+    SsaForm& build()
+    {
+        make_function({ Identifier("c") });
+        ssa = std::make_unique<SsaForm>(*function, symbol_table, name_generator);
+        return *ssa;
+    }
+
+    // Runs straight line code and returns the value of the variables it assigns
+    static std::unordered_map<std::string, int> run(const std::vector<std::unique_ptr<Instruction>>& instructions, std::unordered_map<std::string, int> values)
+    {
+        for (const auto& instruction : instructions) {
+            auto copy = dynamic_cast<CopyInstruction*>(instruction.get());
+            EXPECT_NE(copy, nullptr);
+            auto source = dynamic_cast<TemporaryVariable*>(copy->source.get());
+            auto destination = dynamic_cast<TemporaryVariable*>(copy->destination.get());
+            values[destination->identifier.name] = values.at(source->identifier.name);
+        }
+        return values;
+    }
+
+    std::unique_ptr<SsaForm> ssa;
+};
+
+TEST_F(SsaFormTest, DiamondGetsOnePhiAtTheJoin)
+{
+    jump_if_zero("c", "else");
+    copy(1, "x");
+    jump("end");
+    label("else");
+    copy(2, "x");
+    label("end");
+    ret("x");
+
+    SsaForm& form = build();
+    ASSERT_EQ(form.cfg().blocks().size(), 4u);
+    EXPECT_EQ(form.immediate_dominators()[3], 0u);
+    EXPECT_EQ(form.immediate_dominators()[2], 0u);
+    EXPECT_EQ(form.immediate_dominators()[0], ControlFlowGraph::ENTRY);
+    for (size_t b = 0; b < 3; ++b) {
+        EXPECT_TRUE(form.phis(b).empty());
+    }
+    ASSERT_EQ(form.phis(3).size(), 1u);
+    const auto& phi = form.phis(3)[0];
+    EXPECT_EQ(phi.variable, "x");
+    EXPECT_TRUE(form.is_ssa_variable(phi.destination));
+    EXPECT_EQ(form.original_name(phi.destination), "x");
+
+    // The return reads the phi, each arm defines its own version
+    auto& returned = dynamic_cast<ReturnInstruction&>(*form.cfg().blocks()[3].instructions.back());
+    EXPECT_EQ(dynamic_cast<TemporaryVariable&>(*returned.value).identifier.name, phi.destination);
+    auto& then_copy = dynamic_cast<CopyInstruction&>(*form.cfg().blocks()[1].instructions[0]);
+    auto& else_copy = dynamic_cast<CopyInstruction&>(*form.cfg().blocks()[2].instructions[1]);
+    std::string then_version = dynamic_cast<TemporaryVariable&>(*then_copy.destination).identifier.name;
+    std::string else_version = dynamic_cast<TemporaryVariable&>(*else_copy.destination).identifier.name;
+    EXPECT_NE(then_version, else_version);
+    EXPECT_EQ(dynamic_cast<TemporaryVariable&>(*phi.arguments[0]).identifier.name, then_version);
+    EXPECT_EQ(dynamic_cast<TemporaryVariable&>(*phi.arguments[1]).identifier.name, else_version);
+}
+
+TEST_F(SsaFormTest, LoopVariableGetsPhiAtTheHeader)
+{
+    copy(0, "x");
+    label("loop");
+    jump_if_zero("c", "end");
+    add("x", 1, "x");
+    jump("loop");
+    label("end");
+    ret("x");
+
+    SsaForm& form = build();
+    ASSERT_EQ(form.cfg().blocks().size(), 4u);
+    ASSERT_EQ(form.phis(1).size(), 1u);
+    EXPECT_TRUE(form.phis(3).empty());
+    // The parameter is never defined, it keeps its name
+    auto& condition = dynamic_cast<JumpIfZeroInstruction&>(*form.cfg().blocks()[1].instructions.back());
+    EXPECT_EQ(dynamic_cast<TemporaryVariable&>(*condition.condition).identifier.name, "c");
+
+    form.destruct(*function);
+    for (const auto& instruction : function->body) {
+        if (auto binary = dynamic_cast<BinaryInstruction*>(instruction.get())) {
+            EXPECT_NE(dynamic_cast<TemporaryVariable&>(*binary->source1).identifier.name, "x");
+        }
+    }
+    // A copy into the version of the phi precedes the jump back to the header
+    size_t back_jump = function->body.size();
+    for (size_t i = 0; i < function->body.size(); ++i) {
+        if (auto jump = dynamic_cast<JumpInstruction*>(function->body[i].get()); jump && jump->identifier.name == "loop") {
+            back_jump = i;
+        }
+    }
+    ASSERT_LT(back_jump, function->body.size());
+    auto& phi_copy = dynamic_cast<CopyInstruction&>(*function->body[back_jump - 1]);
+    EXPECT_EQ(dynamic_cast<TemporaryVariable&>(*phi_copy.destination).identifier.name, form.phis(1)[0].destination);
+}
+
+TEST_F(SsaFormTest, RotatedLoopKeepsItsBackEdge)
+{
+    copy(0, "x");
+    jump_if_zero("c", "end");
+    label("loop");
+    add("x", 1, "x");
+    body.push_back(std::make_unique<JumpIfNotZeroInstruction>(var("c"), "loop"));
+    label("end");
+    ret("x");
+
+    SsaForm& form = build();
+    // x is merged at the header and again after the loop, which the guard skips
+    ASSERT_EQ(form.phis(1).size(), 1u);
+    ASSERT_EQ(form.phis(2).size(), 1u);
+    form.destruct(*function);
+
+    // The copies of both conditional jumps are dead on their fall through edge, no edge is split
+    for (const auto& instruction : function->body) {
+        if (auto label = dynamic_cast<LabelInstruction*>(instruction.get())) {
+            EXPECT_TRUE(label->identifier.name == "loop" || label->identifier.name == "end");
+        }
+    }
+    size_t back_jump = function->body.size();
+    for (size_t i = 0; i < function->body.size(); ++i) {
+        if (dynamic_cast<JumpIfNotZeroInstruction*>(function->body[i].get())) {
+            back_jump = i;
+        }
+    }
+    ASSERT_LT(back_jump, function->body.size());
+    auto& phi_copy = dynamic_cast<CopyInstruction&>(*function->body[back_jump - 1]);
+    EXPECT_EQ(dynamic_cast<TemporaryVariable&>(*phi_copy.destination).identifier.name, form.phis(1)[0].destination);
+}
+
+TEST_F(SsaFormTest, SwapIsSequentializedThroughATemporary)
+{
+    SsaForm& form = build();
+    std::vector<std::pair<std::string, std::unique_ptr<Value>>> copies;
+    copies.emplace_back("a", var("b"));
+    copies.emplace_back("b", var("a"));
+    copies.emplace_back("x", var("a"));
+    auto sequence = form.sequentialize_copies(std::move(copies));
+
+    EXPECT_EQ(sequence.size(), 4u);
+    auto values = run(sequence, { { "a", 1 }, { "b", 2 }, { "x", 3 } });
+    EXPECT_EQ(values["a"], 2);
+    EXPECT_EQ(values["b"], 1);
+    EXPECT_EQ(values["x"], 1);
+}
+
+TEST_F(SsaFormTest, SelfCopiesAreDropped)
+{
+    SsaForm& form = build();
+    std::vector<std::pair<std::string, std::unique_ptr<Value>>> copies;
+    copies.emplace_back("a", var("a"));
+    copies.emplace_back("b", var("a"));
+    auto sequence = form.sequentialize_copies(std::move(copies));
+
+    ASSERT_EQ(sequence.size(), 1u);
+    auto values = run(sequence, { { "a", 1 }, { "b", 2 } });
+    EXPECT_EQ(values["b"], 1);
+}
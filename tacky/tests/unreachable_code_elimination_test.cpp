@@ -0,0 +1,74 @@
+#include "tacky/unreachable_code_elimination.h"
+#include "tacky_test/tacky_test.h"
+#include <gtest/gtest.h>
+#include <memory>
+#include <string>
+#include <vector>
+
+class UnreachableCodeEliminationTest : public TackyTest {
+protected:
+    // Runs the pass to a fixed point and returns the instructions
+    std::vector<std::unique_ptr<Instruction>>& eliminate()
+    {
+        make_function();
+        UnreachableCodeElimination pass(remark_manager);
+        return run_to_fixed_point(pass);
+    }
+};
+
+TEST_F(UnreachableCodeEliminationTest, RemovesCodeAfterReturnAndSkippedBranch)
+{
+    // Constant folding turned "if (0) x = 2;" into a jump over the assignment
+    copy(1, "x");
+    jump("end");
+    copy(2, "x");
+    label("end");
+    ret("x");
+    copy(3, "x");
+    ret("x");
+
+    auto& instructions = eliminate();
+    ASSERT_EQ(instructions.size(), 2u);
+    EXPECT_NE(dynamic_cast<CopyInstruction*>(instructions[0].get()), nullptr);
+    EXPECT_NE(dynamic_cast<ReturnInstruction*>(instructions[1].get()), nullptr);
+}
+
+TEST_F(UnreachableCodeEliminationTest, KeepsLoopsAndTheLabelsTheyUse)
+{
+    label("unused");
+    label("loop");
+    copy(1, "x");
+    body.push_back(std::make_unique<JumpIfNotZeroInstruction>(var("x"), "loop"));
+    body.push_back(std::make_unique<JumpIfZeroInstruction>(var("x"), "next"));
+    label("next");
+    ret("x");
+
+    auto& instructions = eliminate();
+    ASSERT_EQ(instructions.size(), 4u);
+    auto loop = dynamic_cast<LabelInstruction*>(instructions[0].get());
+    ASSERT_NE(loop, nullptr);
+    EXPECT_EQ(loop->identifier.name, "loop");
+    EXPECT_NE(dynamic_cast<CopyInstruction*>(instructions[1].get()), nullptr);
+    EXPECT_NE(dynamic_cast<JumpIfNotZeroInstruction*>(instructions[2].get()), nullptr);
+    EXPECT_NE(dynamic_cast<ReturnInstruction*>(instructions[3].get()), nullptr);
+}
+
+TEST_F(UnreachableCodeEliminationTest, RemarksRemovedBlocks)
+{
+    enable_remarks(4);
+    copy(1, "x");
+    ret("x");
+    label("dead");
+    copy(2, "x");
+    body.back()->source_location = SourceLocationIndex(3);
+    ret("x");
+
+    eliminate();
+    ASSERT_EQ(remark_manager->remarks().size(), 1u);
+    const Remark& remark = remark_manager->remarks()[0];
+    EXPECT_EQ(remark.kind, RemarkKind::PASSED);
+    EXPECT_EQ(remark.pass_name, "unreachable-code");
+    EXPECT_EQ(remark.message, "block dead of 2 instructions removed, no path from the function entry reaches it");
+    ASSERT_TRUE(remark.location.has_value());
+    EXPECT_EQ(remark.location->line_number, 4u);
+}